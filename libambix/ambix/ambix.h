@@ -123,11 +123,52 @@ typedef enum {
   AMBIX_READ  = (1 << 4),
   /** open file for writing */
   AMBIX_WRITE = (1 << 5),
-  /** open file for reading&writing */
-  AMBIX_RDRW = (AMBIX_READ|AMBIX_WRITE)
+  /** open an existing file for editing its markers, regions and adaptor
+   * matrix (the sample data can only be read); see ambix_open() */
+  AMBIX_RDRW = (AMBIX_READ|AMBIX_WRITE),
+  /** map the sample data into memory (only together with @ref AMBIX_READ);
+   * see ambix_map_frames() */
+  AMBIX_MMAP = (1 << 6),
+  /** read the sample data in a background thread (only together with
+   * @ref AMBIX_READ); see ambix_get_prefetch() */
+  AMBIX_PREFETCH = (1 << 7),
+  /** write the sample data in a background thread (only together with
+   * @ref AMBIX_WRITE); see ambix_set_backpressure() */
+  AMBIX_WRITEBEHIND = (1 << 8),
+  /** make ambix_readf() and ambix_writef() safe to call from an audio
+   * callback; see ambix_set_max_blocksize() */
+  AMBIX_REALTIME = (1 << 9)
 
 } ambix_filemode_t;
 
+/** what ambix_writef() does if the write-behind queue is full */
+typedef enum {
+  /** wait until the background thread has made enough room */
+  AMBIX_BACKPRESSURE_BLOCK = 0,
+  /** discard the frames (they are counted as dropped) */
+  AMBIX_BACKPRESSURE_DROP,
+  /** discard the frames and return an error */
+  AMBIX_BACKPRESSURE_ERROR
+} ambix_backpressure_t;
+
+/** how the matrix kernels accumulate the products; see ambix_set_precision() */
+typedef enum {
+  /** single precision for the adaptor matrices, double precision for
+   * ambix_matrix_multiply_float32() */
+  AMBIX_PRECISION_DEFAULT = 0,
+  /** accumulate in single precision (using fused multiply-adds where the CPU
+   * supports them) */
+  AMBIX_PRECISION_FAST,
+  /** accumulate in double precision */
+  AMBIX_PRECISION_DOUBLE,
+  /** compensated (Kahan-Babuska) summation: slower, but (almost) independent
+   * of the number of channels */
+  AMBIX_PRECISION_KAHAN,
+
+  /** flag: treat denormal numbers as zero (FTZ/DAZ) while applying the matrix */
+  AMBIX_PRECISION_FLUSH_DENORMALS = (1 << 8)
+} ambix_precision_t;
+
 /** ambix file types */
 typedef enum {
   /** file is not an ambix file (or unknown) */
@@ -197,7 +238,17 @@ typedef struct ambix_matrix_t {
   uint32_t rows;
   /** number of columns */
   uint32_t cols;
-  /** matrix data (as vector (length: rows) of row-vectors (length: cols)) */
+  /** matrix data (as vector (length: rows) of row-vectors (length: cols))
+   *
+   * @remark for matrices created with ambix_matrix_init() all row-vectors are
+   * stored consecutively in a single (aligned) block of rows*cols values,
+   * starting at data[0]; data[0] is the supported way to access the
+   * coefficients as a flat (row-major) array
+   *
+   * @remark matrices assembled by the host may instead allocate each
+   * row-vector separately (with malloc()); ambix_matrix_deinit() and
+   * ambix_matrix_destroy() then free() each of the rows as well
+   */
   float32_t **data;
 } ambix_matrix_t;
 
@@ -264,6 +315,24 @@ typedef struct ambix_region_t {
   char name[256];
 } ambix_region_t;
 
+/** callbacks for accessing data that is not a file on disk; see ambix_open_virtual()
+ *
+ * the callbacks have the same semantics as libsndfile's SF_VIRTUAL_IO
+ */
+typedef struct ambix_virtual_io_t {
+  /** get the size of the data (in bytes), or -1 if it is unknown (e.g. for pipes) */
+  int64_t (*get_filelen)(void*userdata);
+  /** move to a position (whence is SEEK_SET, SEEK_CUR or SEEK_END);
+   * returns the new position, or -1 if the data is not seekable */
+  int64_t (*seek)(int64_t offset, int whence, void*userdata);
+  /** read up to count bytes; returns the number of bytes read (0 at the end of the data) */
+  int64_t (*read)(void*ptr, int64_t count, void*userdata);
+  /** write (up to) count bytes; returns the number of bytes written */
+  int64_t (*write)(const void*ptr, int64_t count, void*userdata);
+  /** get the current position (in bytes) */
+  int64_t (*tell)(void*userdata);
+} ambix_virtual_io_t;
+
 /*
  * @section api_main Main Interface
  */
@@ -296,6 +365,15 @@ typedef struct ambix_region_t {
  * else ambixinfo.ambichannels must be >0; if ambixinfo.ambixformat is
  * @ref AMBIX_BASIC, then ambixinfo.ambichannels must be @f$(order_{ambi}+1)^2@f$
  *
+ * @remark when opening a file with @ref AMBIX_RDRW, the ambixinfo is filled in
+ * as with @ref AMBIX_READ; markers and regions can be added and deleted, and
+ * the adaptor matrix can be replaced with ambix_set_adaptormatrix() (as long as
+ * it has as many columns as the file has ambisonics channels). the changes are
+ * written when the file is closed, without rewriting the sample data: the
+ * chunks are updated in place if possible, else they are appended to the file.
+ * @ref AMBIX_RDRW is only supported for CAF files (and not together with
+ * @ref AMBIX_PREFETCH or @ref AMBIX_WRITEBEHIND).
+ *
  * @return A handle to the opened file (or NULL on failure)
  *
  * @ingroup ambix
@@ -303,6 +381,93 @@ typedef struct ambix_region_t {
 AMBIX_API
 ambix_t *ambix_open (const char *path, const ambix_filemode_t mode, ambix_info_t *ambixinfo) ;
 
+/** @brief Open an ambix stream via callbacks
+ *
+ * Opens anything that can be read/written via the callbacks in vio as if
+ * it was an ambix file (see ambix_open())
+ *
+ * @param vio callbacks for accessing the data; only needs to stay valid
+ * during this call (but the callbacks are used until the handle is closed)
+ *
+ * @param mode whether to open the stream for reading and/or writing (@ref
+ * AMBIX_READ, @ref AMBIX_WRITE, @ref AMBIX_RDRW)
+ *
+ * @param ambixinfo pointer to a valid ambix_info_t structure (see ambix_open())
+ *
+ * @param userdata passed to each of the callbacks
+ *
+ * @return A handle to the opened stream (or NULL on failure)
+ *
+ * @remark if the stream is not seekable (the seek callback returns -1), it
+ * can only be read (resp. written) sequentially: markers, regions and the
+ * adaptor matrix must precede the sample data, ambix_seek() fails, and
+ * ambixinfo.frames is 0 if the length of the sample data is not known in
+ * advance; streams written this way leave the size of the sample data
+ * unspecified (as allowed by the CAF specification).
+ *
+ * @remark streams are not supported by the CoreAudio backend (used on macOS
+ * if libsndfile is not available): there, ambix_open_virtual() (and thus
+ * ambix_open_fd() and ambix_open_memory()) always returns NULL.
+ * Configure with `--with-native-caf` to get streams on such systems.
+ *
+ * @ingroup ambix
+ */
+AMBIX_API
+ambix_t *ambix_open_virtual (const ambix_virtual_io_t *vio, const ambix_filemode_t mode, ambix_info_t *ambixinfo, void *userdata) ;
+
+/** @brief Open an ambix stream on a file descriptor
+ *
+ * Same as ambix_open(), but using an already opened file descriptor (which
+ * might also be a pipe or a socket; see ambix_open_virtual())
+ *
+ * @param fd the file descriptor (opened with the proper mode)
+ *
+ * @param mode whether to open the stream for reading and/or writing (@ref
+ * AMBIX_READ, @ref AMBIX_WRITE, @ref AMBIX_RDRW)
+ *
+ * @param ambixinfo pointer to a valid ambix_info_t structure (see ambix_open())
+ *
+ * @param close_desc if non-zero, the file descriptor is closed by ambix_close()
+ *
+ * @return A handle to the opened stream (or NULL on failure)
+ *
+ * @remark not supported by the CoreAudio backend (see ambix_open_virtual())
+ *
+ * @ingroup ambix
+ */
+AMBIX_API
+ambix_t *ambix_open_fd (int fd, const ambix_filemode_t mode, ambix_info_t *ambixinfo, int close_desc) ;
+
+/** @brief Open an ambix stream in memory
+ *
+ * Same as ambix_open(), but reading from resp. writing to a memory buffer.
+ *
+ * @param data pointer to the buffer
+ *
+ * @param size pointer to the size of the buffer (in bytes)
+ *
+ * @param mode whether to open the stream for reading and/or writing (@ref
+ * AMBIX_READ, @ref AMBIX_WRITE, @ref AMBIX_RDRW)
+ *
+ * @param ambixinfo pointer to a valid ambix_info_t structure (see ambix_open())
+ *
+ * @return A handle to the opened stream (or NULL on failure)
+ *
+ * @remark with @ref AMBIX_READ, *data and *size describe the (constant) encoded
+ * data, which must stay valid until the handle is closed.
+ * with @ref AMBIX_WRITE, the library allocates the buffer: when the handle is
+ * closed, *data is set to the encoded data and *size to its size; the caller
+ * must free() the data.
+ * with @ref AMBIX_RDRW, *data must have been allocated with malloc() (e.g. by
+ * writing); it might be reallocated, and *data and *size are updated when closing.
+ *
+ * @remark not supported by the CoreAudio backend (see ambix_open_virtual())
+ *
+ * @ingroup ambix
+ */
+AMBIX_API
+ambix_t *ambix_open_memory (void **data, int64_t *size, const ambix_filemode_t mode, ambix_info_t *ambixinfo) ;
+
 /** @brief Close an ambix handle
  *
  * Closes an ambix handle and cleans up all memory allocations associated with
@@ -317,6 +482,31 @@ ambix_t *ambix_open (const char *path, const ambix_filemode_t mode, ambix_info_t
 AMBIX_API
 ambix_err_t ambix_close (ambix_t *ambix) ;
 
+/** @brief Get the format of an ambix file without opening it
+ *
+ * Reads only the header of a CAF file (the 'desc' and 'uuid' chunks), without
+ * setting up a handle for reading samples: this is much cheaper than
+ * ambix_open() followed by ambix_close(), e.g. when scanning large collections
+ * of files.
+ *
+ * @param path filename of the file to probe
+ *
+ * @param ambixinfo receives the format of the file as it is stored, just like
+ * ambix_open() reports it if ambixinfo.fileformat is @ref AMBIX_NONE (so for an
+ * EXTENDED file, ambixinfo.ambichannels is the size of the reduced set)
+ *
+ * @param matrix a valid matrix that receives the adaptor matrix if the file is
+ * @ref AMBIX_EXTENDED (or NULL, if you are not interested in the matrix);
+ * for other formats it is left untouched
+ *
+ * @return an errorcode indicating success; @ref AMBIX_ERR_INVALID_FILE if the
+ * file is not a CAF file (other formats can only be inspected with ambix_open())
+ *
+ * @ingroup ambix
+ */
+AMBIX_API
+ambix_err_t ambix_probe (const char *path, ambix_info_t *ambixinfo, ambix_matrix_t *matrix) ;
+
 /** @brief Reposition the file pointer
  *
  * Reposition the file read (and/or write) pointer to a new offset.
@@ -337,6 +527,121 @@ ambix_err_t ambix_close (ambix_t *ambix) ;
 AMBIX_API
 int64_t ambix_seek (ambix_t *ambix, int64_t frames, int whence) ;
 
+/** @brief Access the sample data without copying
+ *
+ * Gives read-only access to the next (at most) frames sample frames of a file
+ * opened with @ref AMBIX_READ|@ref AMBIX_MMAP, and advances the read position
+ * (just like ambix_readf_float32() would).
+ * The data is interleaved, with ambix->info.ambichannels+ambix->info.extrachannels
+ * samples per frame, exactly as stored in the file.
+ *
+ * This is only possible if the file holds 32bit floating point samples in the
+ * byte order of the host, and no adaptor matrix needs to be applied (e.g.
+ * reading an @ref AMBIX_BASIC file, or an @ref AMBIX_EXTENDED file as
+ * @ref AMBIX_EXTENDED); use ambix_readf() in all other cases (which will still
+ * read from the mapped file).
+ *
+ * @param ambix The handle to an ambix file
+ *
+ * @param data pointer that receives the address of the first frame
+ *
+ * @param frames maximum number of sample frames you want to access
+ *
+ * @return the number of sample frames available at data (0 at the end of the
+ * file), or a negative error code
+ *
+ * @remark the data stays valid until the handle is closed; use ambix_seek() to
+ * access other parts of the file.
+ *
+ * @ingroup ambix
+ */
+AMBIX_API
+int64_t ambix_map_frames (ambix_t *ambix, const float32_t **data, int64_t frames) ;
+
+/** @brief Get the state of the background reader
+ *
+ * A file opened with @ref AMBIX_READ|@ref AMBIX_PREFETCH is read by a
+ * library-owned thread into a ringbuffer, so ambix_readf() only has to copy
+ * data out of memory (which makes it suitable for realtime threads).
+ * ambix_seek() empties the ring, which is then refilled from the new position.
+ *
+ * If the ring runs empty (e.g. right after opening or seeking, or because the
+ * disk cannot keep up), ambix_readf() waits for the reader thread; each such
+ * call counts as an underrun.
+ *
+ * The ring holds the samples as found in the file (24 and 32bit integers as
+ * int32, 16bit integers as float32), so prefetching does not change the data
+ * read with any sample type.
+ *
+ * @param ambix The handle to an ambix file
+ *
+ * @param available receives the number of frames that can be read without
+ * waiting (may be NULL)
+ *
+ * @param size receives the size of the ring in frames (may be NULL)
+ *
+ * @param underruns receives the number of reads that had to wait for the
+ * reader thread (may be NULL)
+ *
+ * @return an errorcode indicating success; @ref AMBIX_ERR_INVALID_HANDLE if
+ * the file is not read in the background (e.g. because the platform lacks
+ * thread support)
+ *
+ * @ingroup ambix
+ */
+AMBIX_API
+ambix_err_t ambix_get_prefetch (ambix_t *ambix, int64_t *available, int64_t *size, uint64_t *underruns) ;
+
+/** @brief Set how to deal with a full write-behind queue
+ *
+ * A file opened with @ref AMBIX_WRITE|@ref AMBIX_WRITEBEHIND is written by a
+ * library-owned thread: ambix_writef() merely copies the frames into a queue of
+ * fixed size (so it is suitable for realtime threads), and the background
+ * thread applies the adaptor matrix and writes the data to disk.
+ * ambix_seek() and ambix_close() wait until all queued frames are written.
+ *
+ * If the disk cannot keep up and the queue is full, ambix_writef() either
+ * waits (@ref AMBIX_BACKPRESSURE_BLOCK, the default), silently discards the
+ * frames (@ref AMBIX_BACKPRESSURE_DROP) or returns an error
+ * (@ref AMBIX_BACKPRESSURE_ERROR).
+ * Frames are only discarded as a whole block (as passed to ambix_writef()),
+ * so with these policies blocks larger than the queue (4MB) are never written.
+ *
+ * @param ambix The handle to an ambix file
+ *
+ * @param policy what to do when the queue is full
+ *
+ * @return an errorcode indicating success; @ref AMBIX_ERR_INVALID_HANDLE if
+ * the file is not written in the background (e.g. because the platform lacks
+ * thread support)
+ *
+ * @ingroup ambix
+ */
+AMBIX_API
+ambix_err_t ambix_set_backpressure (ambix_t *ambix, ambix_backpressure_t policy) ;
+
+/** @brief Get the state of the write-behind queue
+ *
+ * @param ambix The handle to an ambix file (opened with @ref AMBIX_WRITEBEHIND)
+ *
+ * @param queued receives the number of frames waiting to be written (may be NULL)
+ *
+ * @param highwater receives the maximum number of frames that have been
+ * waiting at any time (may be NULL)
+ *
+ * @param overruns receives the number of ambix_writef() calls that found the
+ * queue full (may be NULL)
+ *
+ * @param dropped receives the number of frames discarded because of
+ * @ref AMBIX_BACKPRESSURE_DROP (may be NULL)
+ *
+ * @return an errorcode indicating success
+ *
+ * @ingroup ambix
+ */
+AMBIX_API
+ambix_err_t ambix_get_writebehind (ambix_t *ambix, int64_t *queued, int64_t *highwater, uint64_t *overruns, uint64_t *dropped) ;
+
 /** @brief Read samples from the ambix file
  * @defgroup ambix_readf ambix_readf()
  *
@@ -435,6 +740,92 @@ int64_t ambix_writef_float32 (ambix_t *ambix, const float32_t *ambidata, const f
 AMBIX_API
 int64_t ambix_writef_float64 (ambix_t *ambix, const float64_t *ambidata, const float64_t *otherdata, int64_t frames) ;
 
+/** @brief Read samples into per-channel buffers
+ * @defgroup ambix_readf_planar ambix_readf_planar()
+ *
+ * Like ambix_readf(), but each channel is stored in a separate
+ * (non-interleaved) buffer, e.g. the port buffers of a JACK client.
+ * The adaptor matrix is applied directly into the per-channel buffers, so
+ * there is no need to de-interleave the data afterwards.
+ *
+ * @param ambix The handle to an ambix file
+ *
+ * @param ambidata array of ambix->info.ambichannels pointers to user
+ * allocated buffers, each large enough to hold frames samples
+ *
+ * @param otherdata array of ambix->info.extrachannels pointers to user
+ * allocated buffers, each large enough to hold frames samples
+ *
+ * @param frames number of sample frames you want to read
+ *
+ * @return the number of sample frames successfully read
+ *
+ * @ingroup ambix
+ */
+
+/** @brief Read (16bit signed integer) samples into per-channel buffers
+ * @ingroup ambix_readf_planar
+ */
+AMBIX_API
+int64_t ambix_readf_int16_planar (ambix_t *ambix, int16_t **ambidata, int16_t **otherdata, int64_t frames) ;
+/** @brief Read (32bit signed integer) samples into per-channel buffers
+ * @ingroup ambix_readf_planar
+ */
+AMBIX_API
+int64_t ambix_readf_int32_planar (ambix_t *ambix, int32_t **ambidata, int32_t **otherdata, int64_t frames) ;
+/** @brief Read (32bit floating point) samples into per-channel buffers
+ * @ingroup ambix_readf_planar
+ */
+AMBIX_API
+int64_t ambix_readf_float32_planar (ambix_t *ambix, float32_t **ambidata, float32_t **otherdata, int64_t frames) ;
+/** @brief Read (64bit floating point) samples into per-channel buffers
+ * @ingroup ambix_readf_planar
+ */
+AMBIX_API
+int64_t ambix_readf_float64_planar (ambix_t *ambix, float64_t **ambidata, float64_t **otherdata, int64_t frames) ;
+
+/** @brief Write samples from per-channel buffers
+ * @defgroup ambix_writef_planar ambix_writef_planar()
+ *
+ * Like ambix_writef(), but each channel is taken from a separate
+ * (non-interleaved) buffer, e.g. the port buffers of a JACK client.
+ *
+ * @param ambix The handle to an ambix file
+ *
+ * @param ambidata array of ambix->info.ambichannels pointers to user
+ * allocated buffers, each holding frames samples
+ *
+ * @param otherdata array of ambix->info.extrachannels pointers to user
+ * allocated buffers, each holding frames samples
+ *
+ * @param frames number of sample frames you want to write
+ *
+ * @return the number of sample frames successfully written
+ *
+ * @ingroup ambix
+ */
+
+/** @brief Write (16bit signed integer) samples from per-channel buffers
+ * @ingroup ambix_writef_planar
+ */
+AMBIX_API
+int64_t ambix_writef_int16_planar (ambix_t *ambix, int16_t *const*ambidata, int16_t *const*otherdata, int64_t frames) ;
+/** @brief Write (32bit signed integer) samples from per-channel buffers
+ * @ingroup ambix_writef_planar
+ */
+AMBIX_API
+int64_t ambix_writef_int32_planar (ambix_t *ambix, int32_t *const*ambidata, int32_t *const*otherdata, int64_t frames) ;
+/** @brief Write (32bit floating point) samples from per-channel buffers
+ * @ingroup ambix_writef_planar
+ */
+AMBIX_API
+int64_t ambix_writef_float32_planar (ambix_t *ambix, float32_t *const*ambidata, float32_t *const*otherdata, int64_t frames) ;
+/** @brief Write (64bit floating point) samples from per-channel buffers
+ * @ingroup ambix_writef_planar
+ */
+AMBIX_API
+int64_t ambix_writef_float64_planar (ambix_t *ambix, float64_t *const*ambidata, float64_t *const*otherdata, int64_t frames) ;
+
 /** @brief Get the libsndfile handle associated with the ambix handle
  *
  * If possible, require an SNDFILE handle; if the ambix handle is
@@ -455,6 +846,9 @@ SNDFILE *ambix_get_sndfile (ambix_t *ambix) ;
 #pragma pop_macro("SNDFILE")
 
 /** @brief Get the number of stored markers within the ambix file.
+ *
+ * Markers and regions are only read from the file when they are first
+ * accessed (so files with many markers open quickly if the markers are not used).
  *
  * @return number of markers.
  *
@@ -584,7 +978,10 @@ const ambix_matrix_t *ambix_get_adaptormatrix (ambix_t *ambix) ;
  * loudspeaker feeds directly (by supplying a decoder matrix); in this case, the
  * matrix MUST have ambix->ambichannels columns. When WRITEing an ambix '@ref
  * AMBIX_EXTENDED' file, this tells the library to store the matrix as the
- * adaptor matrix within the file.
+ * adaptor matrix within the file. When editing a file opened with @ref
+ * AMBIX_RDRW, the matrix replaces the adaptor matrix stored in the file (turning
+ * an '@ref AMBIX_BASIC' file into an '@ref AMBIX_EXTENDED' one); it MUST have
+ * as many columns as the file has ambisonics channels.
  *
  * @param ambix The handle to an ambix file
  *
@@ -594,7 +991,7 @@ const ambix_matrix_t *ambix_get_adaptormatrix (ambix_t *ambix) ;
  * @return an errorcode indicating success
  *
  * @remark using this on ambix handles other than @ref AMBIX_READ/@ref
- * AMBIX_BASIC or @ref AMBIX_WRITE/@ref AMBIX_EXTENDED
+ * AMBIX_BASIC, @ref AMBIX_WRITE/@ref AMBIX_EXTENDED or @ref AMBIX_RDRW
  * is an error.
  *
  * @ingroup ambix
@@ -602,6 +999,210 @@ const ambix_matrix_t *ambix_get_adaptormatrix (ambix_t *ambix) ;
 AMBIX_API
 ambix_err_t ambix_set_adaptormatrix (ambix_t *ambix, const ambix_matrix_t *matrix) ;
 
+/** @brief Replace the adaptor matrix while another thread is reading
+ *
+ * This is the thread-safe counterpart of ambix_set_adaptormatrix() for
+ * handles opened for @ref AMBIX_READ as @ref AMBIX_BASIC, e.g. for rotating
+ * the scene or switching the decoder during playback.
+ *
+ * The matrix is prepared in the calling thread and handed over to the
+ * reading thread without locks: the next ambix_readf() picks it up at the
+ * beginning of the block. The matrix it replaces is freed later (by the next
+ * call to this function, or when the handle is closed), so the reading thread
+ * neither blocks nor allocates memory.
+ *
+ * Just like with ambix_set_adaptormatrix(), the matrix is pre-multiplied to
+ * the reconstruction matrix of the file (if any). The channels returned by
+ * ambix_readf() cannot change, so the result must have the same dimensions
+ * as the matrix currently in use (or be square, if there is none).
+ *
+ * @param ambix The handle to an ambix file
+ *
+ * @param matrix the new matrix; can be freed after this call
+ *
+ * @param crossfade the number of frames over which the output fades linearly
+ * from the old to the new matrix (to avoid zipper noise); 0 switches at once.
+ * A crossfade that is still running when the next matrix is picked up, is cut short.
+ *
+ * @return an errorcode indicating success
+ *
+ * @remark this function may be called concurrently with ambix_readf_*() on the
+ * same handle, but not with any other function on that handle (including
+ * itself).
+ * Platforms without atomic operations cannot swap matrices safely; there this
+ * returns an error.
+ *
+ * @ingroup ambix
+ */
+AMBIX_API
+ambix_err_t ambix_swap_adaptormatrix (ambix_t *ambix, const ambix_matrix_t *matrix, int64_t crossfade) ;
+
+/** @brief Add a keyframe to a time-varying adaptor matrix
+ *
+ * Besides the (static) adaptor matrix, an @ref AMBIX_EXTENDED file can hold
+ * a list of keyframes, each giving the adaptor matrix from a given frame on
+ * (e.g. for head-tracked recordings, or for edits of the scene).
+ * When the file is read as @ref AMBIX_BASIC, the matrix is interpolated
+ * (linearly) between the keyframes and replaces the static adaptor matrix:
+ * before the first keyframe, the first keyframe is used; after the last
+ * keyframe, the last one. Several keyframes at the same frame make the matrix
+ * jump.
+ * The matrix is evaluated for blocks of (at most) 64 frames, and looked up
+ * anew after ambix_seek(), so reading can start anywhere in the file.
+ *
+ * The static adaptor matrix is still stored in the file (for readers that do
+ * not know about keyframes), and must be set with ambix_set_adaptormatrix()
+ * before adding keyframes.
+ *
+ * @param ambix The handle to an ambix file opened for @ref AMBIX_WRITE
+ *
+ * @param frame the position (in frames) from which on the matrix is used
+ *
+ * @param matrix the adaptor matrix at that position; it MUST have the same
+ * dimensions as the (static) adaptor matrix; can be freed after this call
+ *
+ * @return an errorcode indicating success
+ *
+ * @remark Keyframes have to be added before sample data is written! They
+ * cannot be changed in files opened with @ref AMBIX_RDRW (where the keyframes
+ * found in the file are kept as they are).
+ *
+ * @remark A matrix set with ambix_set_adaptormatrix() when reading is
+ * pre-multiplied to all keyframes; a matrix swapped in with
+ * ambix_swap_adaptormatrix() replaces the keyframes (it is only multiplied with the
+ * static adaptor matrix).
+ *
+ * @ingroup ambix
+ */
+AMBIX_API
+ambix_err_t ambix_add_keyframe (ambix_t *ambix, int64_t frame, const ambix_matrix_t *matrix) ;
+/** @brief Get the number of keyframes of the adaptor matrix
+ *
+ * @param ambix The handle to an ambix file
+ *
+ * @return Number of keyframes (see ambix_add_keyframe()).
+ *
+ * @ingroup ambix
+ */
+AMBIX_API
+uint32_t ambix_get_num_keyframes (ambix_t *ambix) ;
+/** @brief Get one keyframe of the adaptor matrix
+ *
+ * @param ambix The handle to an ambix file
+ *
+ * @param index The index of the keyframe (keyframes are sorted by their position)
+ *
+ * @param frame returns the position of the keyframe (may be NULL)
+ *
+ * @return The adaptor matrix at that keyframe (as stored in the file), or NULL
+ * if there is no such keyframe; the memory is owned by the library.
+ *
+ * @ingroup ambix
+ */
+AMBIX_API
+const ambix_matrix_t *ambix_get_keyframe (ambix_t *ambix, uint32_t index, int64_t *frame) ;
+/** @brief Deletes all keyframes of the adaptor matrix
+ *
+ * @param ambix The handle to an ambix file opened for @ref AMBIX_WRITE
+ *
+ * @return an errorcode indicating success.
+ *
+ * @ingroup ambix
+ */
+AMBIX_API
+ambix_err_t ambix_delete_keyframes (ambix_t *ambix) ;
+
+/** @brief Use multiple threads for applying the adaptor matrix
+ *
+ * By default, all processing is done in the thread calling ambix_readf() resp.
+ * ambix_writef().
+ * With this, large reads/writes (that need to apply an adaptor matrix) are
+ * split into ranges of frames that are processed in parallel by a pool of
+ * worker threads.
+ * Small blocks (e.g. the typical realtime blocksizes) are always processed in
+ * the calling thread.
+ *
+ * @param ambix The handle to an ambix file
+ *
+ * @param threads the total number of threads to use (including the calling
+ * thread); 1 disables multi-threading, 0 uses one thread per CPU
+ *
+ * @return an errorcode indicating success
+ *
+ * @remark the worker threads are private to the ambix handle; the handle
+ * itself must still not be accessed from multiple threads concurrently.
+ *
+ * @ingroup ambix
+ */
+AMBIX_API
+ambix_err_t ambix_set_threads (ambix_t *ambix, uint32_t threads) ;
+
+/** @brief Trade speed for precision when applying the adaptor matrix
+ *
+ * By default, the adaptor matrix is applied to floating point data with
+ * single precision accumulators, which is fast but loses precision for large
+ * matrices.
+ * Integer data uses exact fixed-point arithmetic (where the matrix allows it),
+ * and 64bit data is always accumulated in (at least) double precision.
+ *
+ * Denormal numbers (e.g. from decaying signals) can slow down the matrix
+ * multiplication considerably on some CPUs; with
+ * @ref AMBIX_PRECISION_FLUSH_DENORMALS they are treated as zero while the
+ * matrix is applied (the floating point environment of the calling thread is
+ * restored afterwards).
+ *
+ * @param ambix The handle to an ambix file
+ *
+ * @param precision one of @ref AMBIX_PRECISION_DEFAULT, @ref
+ * AMBIX_PRECISION_FAST, @ref AMBIX_PRECISION_DOUBLE or @ref
+ * AMBIX_PRECISION_KAHAN, optionally OR'ed with @ref
+ * AMBIX_PRECISION_FLUSH_DENORMALS
+ *
+ * @return an errorcode indicating success
+ *
+ * @ingroup ambix
+ */
+AMBIX_API
+ambix_err_t ambix_set_precision (ambix_t *ambix, ambix_precision_t precision) ;
+
+/** @brief Preallocate the buffers for reading/writing blocks of a given size
+ *
+ * ambix_readf() and ambix_writef() use an internal buffer (for interleaving
+ * the ambisonics and extra channels, and for applying the adaptor matrix).
+ * Large blocks are processed in chunks of a few hundred kilobytes, so the
+ * buffer does not grow with the size of the block.
+ * This allocates the buffer for chunks of (at least) the given size in
+ * advance.
+ *
+ * @param ambix The handle to an ambix file
+ *
+ * @param frames the maximum number of frames passed to a single call of
+ * ambix_readf() resp. ambix_writef()
+ *
+ * @return an errorcode indicating success
+ *
+ * @remark If the file was opened with @ref AMBIX_REALTIME, ambix_readf() and
+ * ambix_writef() (and their planar variants) do not allocate memory, take
+ * locks or do any syscalls apart from the backend's file I/O. In this mode:
+ * - the chunks are never larger than the maximum blocksize (64 frames,
+ *   unless set with this function), so larger blocks take several passes
+ * - when writing, this function also writes the header, so the adaptor
+ *   matrix, markers and regions must be set before (and cannot be changed
+ *   afterwards)
+ * - with @ref AMBIX_PREFETCH, ambix_readf() returns fewer frames (instead of
+ *   waiting) if the background thread cannot keep up; ambix_get_prefetch()
+ *   tells underruns from the end of the file
+ * - with @ref AMBIX_WRITEBEHIND, frames that do not fit into the queue are
+ *   dropped (@ref AMBIX_BACKPRESSURE_BLOCK is not available), and all blocks
+ *   must be written with the same sample type
+ * - ambix_set_threads() only accepts a single thread
+ * Seeking, closing and changing the matrix are not realtime-safe.
+ *
+ * @ingroup ambix
+ */
+AMBIX_API
+ambix_err_t ambix_set_max_blocksize (ambix_t *ambix, int64_t frames) ;
+
 /*
  * @section api_matrix matrix utility functions
  */
@@ -787,6 +1388,24 @@ ambix_err_t ambix_matrix_multiply_float32(float32_t *dest, const ambix_matrix_t
  */
 AMBIX_API
 ambix_err_t ambix_matrix_multiply_float64(float64_t *dest, const ambix_matrix_t *mtx, const float64_t *source, int64_t frames) ;
+/** @brief Multiply a matrix with (32bit floating point) data, with the given precision
+ *
+ * @param precision how to accumulate the products (see ambix_set_precision());
+ * @ref AMBIX_PRECISION_DEFAULT is the same as @ref AMBIX_PRECISION_DOUBLE here
+ *
+ * @ingroup ambix_matrix_multiply_data
+ */
+AMBIX_API
+ambix_err_t ambix_matrix_multiply_float32_precision(float32_t *dest, const ambix_matrix_t *mtx, const float32_t *source, int64_t frames, ambix_precision_t precision) ;
+/** @brief Multiply a matrix with (64bit float) data, with the given precision
+ *
+ * @param precision how to accumulate the products (see ambix_set_precision());
+ * apart from @ref AMBIX_PRECISION_KAHAN, this always accumulates in double precision
+ *
+ * @ingroup ambix_matrix_multiply_data
+ */
+AMBIX_API
+ambix_err_t ambix_matrix_multiply_float64_precision(float64_t *dest, const ambix_matrix_t *mtx, const float64_t *source, int64_t frames, ambix_precision_t precision) ;
 /** @brief Multiply a matrix with (32bit signed integer) data
  *
  * @ingroup ambix_matrix_multiply_data
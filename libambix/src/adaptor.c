@@ -56,6 +56,24 @@ ambix_err_t _ambix_adaptorbuffer_resize(ambix_t*ambix, uint64_t frames, uint16_t
   return AMBIX_ERR_SUCCESS;
 }
 
+int64_t _ambix_adaptorbuffer_chunkframes(const ambix_t*ambix, uint16_t itemsize) {
+  uint32_t ambichannels=max_u64(ambix->info.ambichannels,ambix->realinfo.ambichannels);
+  uint32_t extrachannels=max_u64(ambix->info.extrachannels,ambix->realinfo.extrachannels);
+  uint64_t framesize=(uint64_t)(ambichannels + extrachannels)*itemsize;
+  int64_t frames;
+  /* never grow the buffer beyond what has been reserved for the audio thread */
+  if(AMBIX_REALTIME & ambix->filemode)
+    return ambix->maxblocksize;
+  if(framesize<1)
+    framesize=1;
+  /* each worker thread gets a cache-sized slice */
+  frames=(int64_t)((uint64_t)AMBIX_ADAPTORBUFFER_CHUNKSIZE*_ambix_threadpool_size(ambix->threadpool)/framesize);
+  /* the buffer is that large anyhow */
+  if(frames<ambix->maxblocksize)
+    frames=ambix->maxblocksize;
+  return (frames<1)?1:frames;
+}
+
 ambix_err_t _ambix_adaptorbuffer_destroy(ambix_t*ambix) {
   if(ambix->adaptorbuffer)
     free(ambix->adaptorbuffer);
@@ -87,7 +105,7 @@ _AMBIX_SPLITADAPTOR(int16);
 
 
 
-#define _AMBIX_SPLITADAPTOR_MATRIX(type, sumtype)                       \
+#define _AMBIX_SPLITADAPTOR_MATRIX(type, sumtype, convert)                     \
   ambix_err_t _ambix_splitAdaptormatrix_##type(const type##_t*source, uint32_t sourcechannels, \
                                                const ambix_matrix_t*matrix, \
                                                type##_t*dest_ambi, type##_t*dest_other, \
@@ -104,7 +122,7 @@ _AMBIX_SPLITADAPTOR(int16);
         for(inchan=0; inchan<rawambichannels; inchan++) {               \
           sum+=mtx[outchan][inchan] * src[inchan];                      \
         }                                                               \
-        *dest_ambi++=(type##_t)sum;  /* FIXXXME: integer saturation */  \
+        *dest_ambi++=convert(sum);                                      \
       }                                                                 \
       for(inchan=rawambichannels; inchan<sourcechannels; inchan++)      \
         *dest_other++=src[inchan];                                      \
@@ -112,13 +130,40 @@ _AMBIX_SPLITADAPTOR(int16);
     return AMBIX_ERR_SUCCESS;                                           \
   }
 
-_AMBIX_SPLITADAPTOR_MATRIX(float32, float32);
-_AMBIX_SPLITADAPTOR_MATRIX(float64, float64);
-/* both _int16 and _int32 are highly unoptimized!
- * LATER: add some fixed point magic to speed things up
+_AMBIX_SPLITADAPTOR_MATRIX(float64, float64, (float64_t));
+/* _int16 and _int32 are the (slow) floating point reference,
+ * the adaptor plans use fixed point kernels instead;
+ * single precision cannot even represent all 32bit samples, so we use double
  */
-_AMBIX_SPLITADAPTOR_MATRIX(int32, float32);
-_AMBIX_SPLITADAPTOR_MATRIX(int16, float32);
+_AMBIX_SPLITADAPTOR_MATRIX(int32, float64, _ambix_float_to_int32);
+_AMBIX_SPLITADAPTOR_MATRIX(int16, float64, _ambix_float_to_int16);
+
+/* float32 uses the (SIMD) matrix kernels, the other channels are simply copied */
+ambix_err_t _ambix_splitAdaptormatrix_float32(const float32_t*source, uint32_t sourcechannels,
+                                              const ambix_matrix_t*matrix,
+                                              float32_t*dest_ambi, float32_t*dest_other,
+                                              int64_t frames) {
+  const float32_t*mtx=_ambix_matrix_data(matrix);
+  const uint32_t fullambichannels=matrix->rows;
+  const uint32_t rawambichannels=matrix->cols;
+  const uint32_t otherchannels=sourcechannels-rawambichannels;
+  int64_t f;
+  if(!mtx && fullambichannels && rawambichannels)
+    return AMBIX_ERR_INVALID_MATRIX;
+  if(mtx)
+    _ambix_mtxmul_float32_tiled(_ambix_get_kernels()->mtxmul_float32,
+                                dest_ambi, fullambichannels, mtx, fullambichannels, rawambichannels,
+                                source, sourcechannels, frames);
+  if(otherchannels) {
+    for(f=0; f<frames; f++) {
+      const float32_t*src = source+sourcechannels*f+rawambichannels;
+      uint32_t chan;
+      for(chan=0; chan<otherchannels; chan++)
+        *dest_other++=src[chan];
+    }
+  }
+  return AMBIX_ERR_SUCCESS;
+}
 
 #define _AMBIX_MERGEADAPTOR(type)                                       \
   ambix_err_t _ambix_mergeAdaptor_##type(const type##_t*source1, uint32_t source1channels, \
@@ -143,7 +188,7 @@ _AMBIX_MERGEADAPTOR(int16);
 
 //#define _AMBIX_MERGEADAPTOR_MATRIX(type)      \
 
-#define _AMBIX_MERGEADAPTOR_MATRIX(type, sumtype)                       \
+#define _AMBIX_MERGEADAPTOR_MATRIX(type, sumtype, convert)                   \
   ambix_err_t _ambix_mergeAdaptormatrix_##type(const type##_t*ambi_data, const ambix_matrix_t*matrix, \
                                                const type##_t*otherdata, uint32_t source2channels, \
                                                type##_t*destination, int64_t frames) { \
@@ -160,7 +205,7 @@ _AMBIX_MERGEADAPTOR(int16);
         for(inchan=0; inchan<fullambichannels; inchan++) {              \
           sum+=mtx[outchan][inchan] * src[inchan];                      \
         }                                                               \
-        *destination++=(type##_t)sum;                                   \
+        *destination++=convert(sum);                                    \
       }                                                                 \
       /* store the otherchannels */                                     \
       for(inchan=0; inchan<source2channels; inchan++)                   \
@@ -169,7 +214,313 @@ _AMBIX_MERGEADAPTOR(int16);
     return AMBIX_ERR_SUCCESS;                                           \
   }
 
-_AMBIX_MERGEADAPTOR_MATRIX(float32, float32);
-_AMBIX_MERGEADAPTOR_MATRIX(float64, float64);
-_AMBIX_MERGEADAPTOR_MATRIX(int32, float32);
-_AMBIX_MERGEADAPTOR_MATRIX(int16, float32);
+_AMBIX_MERGEADAPTOR_MATRIX(float64, float64, (float64_t));
+_AMBIX_MERGEADAPTOR_MATRIX(int32, float64, _ambix_float_to_int32);
+_AMBIX_MERGEADAPTOR_MATRIX(int16, float64, _ambix_float_to_int16);
+
+ambix_err_t _ambix_mergeAdaptormatrix_float32(const float32_t*ambi_data, const ambix_matrix_t*matrix,
+                                              const float32_t*otherdata, uint32_t source2channels,
+                                              float32_t*destination, int64_t frames) {
+  const float32_t*mtx=_ambix_matrix_data(matrix);
+  const uint32_t fullambichannels=matrix->cols;
+  const uint32_t ambixchannels=matrix->rows;
+  const uint32_t destchannels=ambixchannels+source2channels;
+  int64_t f;
+  if(!mtx && fullambichannels && ambixchannels)
+    return AMBIX_ERR_INVALID_MATRIX;
+  /* encode ambisonics->ambix and store in destination */
+  if(mtx)
+    _ambix_mtxmul_float32_tiled(_ambix_get_kernels()->mtxmul_float32,
+                                destination, destchannels, mtx, ambixchannels, fullambichannels,
+                                ambi_data, fullambichannels, frames);
+  /* store the otherchannels */
+  if(source2channels) {
+    for(f=0; f<frames; f++) {
+      float32_t*dst=destination+destchannels*f+ambixchannels;
+      uint32_t chan;
+      for(chan=0; chan<source2channels; chan++)
+        dst[chan]=*otherdata++;
+    }
+  }
+  return AMBIX_ERR_SUCCESS;
+}
+
+
+#define _AMBIX_ADAPTORPLAN(typ)                                        \
+  ambix_err_t _ambix_splitAdaptorplan_##typ(const typ##_t*source, uint32_t sourcechannels, \
+                                             const _ambix_matrixplan_t*plan, \
+                                             typ##_t*dest_ambi, typ##_t*dest_other, \
+                                             int64_t frames) {          \
+    const uint32_t rawambichannels=plan->cols;                          \
+    const uint32_t otherchannels=sourcechannels-rawambichannels;        \
+    int64_t f;                                                          \
+    /* plans that cannot be applied directly fall back to the dense matrix */ \
+    if(AMBIX_ERR_SUCCESS!=_ambix_matrixplan_apply_##typ(plan, dest_ambi, plan->rows, source, sourcechannels, frames)) \
+      return _ambix_splitAdaptormatrix_##typ(source, sourcechannels, plan->matrix, dest_ambi, dest_other, frames); \
+    if(otherchannels) {                                                 \
+      for(f=0; f<frames; f++) {                                         \
+        const typ##_t*src = source+sourcechannels*f+rawambichannels;   \
+        uint32_t chan;                                                  \
+        for(chan=0; chan<otherchannels; chan++)                         \
+          *dest_other++=src[chan];                                      \
+      }                                                                 \
+    }                                                                   \
+    return AMBIX_ERR_SUCCESS;                                           \
+  }                                                                     \
+  ambix_err_t _ambix_mergeAdaptorplan_##typ(const typ##_t*ambi_data, const _ambix_matrixplan_t*plan, \
+                                             const typ##_t*otherdata, uint32_t source2channels, \
+                                             typ##_t*destination, int64_t frames) { \
+    const uint32_t ambixchannels=plan->rows;                            \
+    const uint32_t destchannels=ambixchannels+source2channels;          \
+    int64_t f;                                                          \
+    if(AMBIX_ERR_SUCCESS!=_ambix_matrixplan_apply_##typ(plan, destination, destchannels, ambi_data, plan->cols, frames)) \
+      return _ambix_mergeAdaptormatrix_##typ(ambi_data, plan->matrix, otherdata, source2channels, destination, frames); \
+    if(source2channels) {                                               \
+      for(f=0; f<frames; f++) {                                         \
+        typ##_t*dst=destination+destchannels*f+ambixchannels;          \
+        uint32_t chan;                                                  \
+        for(chan=0; chan<source2channels; chan++)                       \
+          dst[chan]=*otherdata++;                                       \
+      }                                                                 \
+    }                                                                   \
+    return AMBIX_ERR_SUCCESS;                                           \
+  }
+
+_AMBIX_ADAPTORPLAN(float32);
+_AMBIX_ADAPTORPLAN(float64);
+_AMBIX_ADAPTORPLAN(int32);
+_AMBIX_ADAPTORPLAN(int16);
+
+
+/* planar data (one buffer per channel):
+ * the interleaved data is converted in blocks of frames that fit into a small
+ * (cache-resident) scratch buffer; this saves the caller an extra pass over
+ * the (large) interleaved buffers.
+ * 'offset' is the first frame to access in the per-channel buffers.
+ */
+#define _AMBIX_PLANAR_SCRATCHSIZE 4096
+#define _AMBIX_PLANAR_BLOCKSIZE 64
+
+#define _AMBIX_PLANARADAPTOR(typ)                                       \
+  ambix_err_t _ambix_splitAdaptor_planar_##typ(const typ##_t*source, uint32_t sourcechannels, \
+                                                uint32_t ambichannels, typ##_t**dest_ambi, typ##_t**dest_other, \
+                                                int64_t offset, int64_t frames) { \
+    int64_t f0;                                                         \
+    for(f0=0; f0<frames; f0+=_AMBIX_PLANAR_BLOCKSIZE) {                 \
+      const int64_t n=(frames-f0<_AMBIX_PLANAR_BLOCKSIZE)?(frames-f0):_AMBIX_PLANAR_BLOCKSIZE; \
+      const typ##_t*src=source+f0*sourcechannels;                       \
+      uint32_t chan;                                                    \
+      int64_t f;                                                        \
+      for(chan=0; chan<sourcechannels; chan++) {                        \
+        typ##_t*dst=((chan<ambichannels)?dest_ambi[chan]:dest_other[chan-ambichannels])+offset+f0; \
+        for(f=0; f<n; f++)                                              \
+          dst[f]=src[f*sourcechannels+chan];                            \
+      }                                                                 \
+    }                                                                   \
+    return AMBIX_ERR_SUCCESS;                                           \
+  }                                                                     \
+  ambix_err_t _ambix_mergeAdaptor_planar_##typ(typ##_t*const*source1, uint32_t source1channels, \
+                                                typ##_t*const*source2, uint32_t source2channels, \
+                                                int64_t offset, typ##_t*destination, int64_t frames) { \
+    const uint32_t destchannels=source1channels+source2channels;        \
+    int64_t f0;                                                         \
+    for(f0=0; f0<frames; f0+=_AMBIX_PLANAR_BLOCKSIZE) {                 \
+      const int64_t n=(frames-f0<_AMBIX_PLANAR_BLOCKSIZE)?(frames-f0):_AMBIX_PLANAR_BLOCKSIZE; \
+      typ##_t*dst=destination+f0*destchannels;                          \
+      uint32_t chan;                                                    \
+      int64_t f;                                                        \
+      for(chan=0; chan<destchannels; chan++) {                          \
+        const typ##_t*src=((chan<source1channels)?source1[chan]:source2[chan-source1channels])+offset+f0; \
+        for(f=0; f<n; f++)                                              \
+          dst[f*destchannels+chan]=src[f];                              \
+      }                                                                 \
+    }                                                                   \
+    return AMBIX_ERR_SUCCESS;                                           \
+  }                                                                     \
+  ambix_err_t _ambix_splitAdaptorplan_planar_##typ(const typ##_t*source, uint32_t sourcechannels, \
+                                                    const _ambix_matrixplan_t*plan, \
+                                                    typ##_t**dest_ambi, typ##_t**dest_other, \
+                                                    int64_t offset, int64_t frames) { \
+    typ##_t scratch[_AMBIX_PLANAR_SCRATCHSIZE];                         \
+    const uint32_t ambichannels=plan->rows;                             \
+    const uint32_t otherchannels=sourcechannels-plan->cols;             \
+    const uint32_t channels=ambichannels+otherchannels;                 \
+    typ##_t*buffer=scratch;                                             \
+    int64_t blocksize=_AMBIX_PLANAR_SCRATCHSIZE/(channels?channels:1);  \
+    ambix_err_t err=AMBIX_ERR_SUCCESS;                                  \
+    int64_t f0;                                                         \
+    if(blocksize<1) {                                                   \
+      blocksize=1;                                                      \
+      buffer=(typ##_t*)malloc(channels*sizeof(*buffer));                \
+      if(!buffer)                                                       \
+        return AMBIX_ERR_UNKNOWN;                                       \
+    }                                                                   \
+    for(f0=0; f0<frames; f0+=blocksize) {                               \
+      const int64_t n=(frames-f0<blocksize)?(frames-f0):blocksize;      \
+      typ##_t*ambi=buffer, *other=buffer+n*ambichannels;                \
+      uint32_t chan;                                                    \
+      int64_t f;                                                        \
+      err=_ambix_splitAdaptorplan_##typ(source+f0*sourcechannels, sourcechannels, plan, ambi, other, n); \
+      if(AMBIX_ERR_SUCCESS!=err)                                        \
+        break;                                                          \
+      for(chan=0; chan<ambichannels; chan++) {                          \
+        typ##_t*dst=dest_ambi[chan]+offset+f0;                          \
+        for(f=0; f<n; f++)                                              \
+          dst[f]=ambi[f*ambichannels+chan];                             \
+      }                                                                 \
+      for(chan=0; chan<otherchannels; chan++) {                         \
+        typ##_t*dst=dest_other[chan]+offset+f0;                         \
+        for(f=0; f<n; f++)                                              \
+          dst[f]=other[f*otherchannels+chan];                           \
+      }                                                                 \
+    }                                                                   \
+    if(buffer!=scratch)                                                 \
+      free(buffer);                                                     \
+    return err;                                                         \
+  }                                                                     \
+  ambix_err_t _ambix_mergeAdaptorplan_planar_##typ(typ##_t*const*ambi_data, const _ambix_matrixplan_t*plan, \
+                                                    typ##_t*const*otherdata, uint32_t source2channels, \
+                                                    int64_t offset, typ##_t*destination, int64_t frames) { \
+    typ##_t scratch[_AMBIX_PLANAR_SCRATCHSIZE];                         \
+    const uint32_t ambichannels=plan->cols;                             \
+    const uint32_t channels=ambichannels+source2channels;               \
+    const uint32_t destchannels=plan->rows+source2channels;             \
+    typ##_t*buffer=scratch;                                             \
+    int64_t blocksize=_AMBIX_PLANAR_SCRATCHSIZE/(channels?channels:1);  \
+    ambix_err_t err=AMBIX_ERR_SUCCESS;                                  \
+    int64_t f0;                                                         \
+    if(blocksize<1) {                                                   \
+      blocksize=1;                                                      \
+      buffer=(typ##_t*)malloc(channels*sizeof(*buffer));                \
+      if(!buffer)                                                       \
+        return AMBIX_ERR_UNKNOWN;                                       \
+    }                                                                   \
+    for(f0=0; f0<frames; f0+=blocksize) {                               \
+      const int64_t n=(frames-f0<blocksize)?(frames-f0):blocksize;      \
+      typ##_t*ambi=buffer, *other=buffer+n*ambichannels;                \
+      uint32_t chan;                                                    \
+      int64_t f;                                                        \
+      for(chan=0; chan<ambichannels; chan++) {                          \
+        const typ##_t*src=ambi_data[chan]+offset+f0;                    \
+        for(f=0; f<n; f++)                                              \
+          ambi[f*ambichannels+chan]=src[f];                             \
+      }                                                                 \
+      for(chan=0; chan<source2channels; chan++) {                       \
+        const typ##_t*src=otherdata[chan]+offset+f0;                    \
+        for(f=0; f<n; f++)                                              \
+          other[f*source2channels+chan]=src[f];                         \
+      }                                                                 \
+      err=_ambix_mergeAdaptorplan_##typ(ambi, plan, other, source2channels, destination+f0*destchannels, n); \
+      if(AMBIX_ERR_SUCCESS!=err)                                        \
+        break;                                                          \
+    }                                                                   \
+    if(buffer!=scratch)                                                 \
+      free(buffer);                                                     \
+    return err;                                                         \
+  }
+
+_AMBIX_PLANARADAPTOR(float32);
+_AMBIX_PLANARADAPTOR(float64);
+_AMBIX_PLANARADAPTOR(int32);
+_AMBIX_PLANARADAPTOR(int16);
+
+
+/* crossfading after ambix_swap_adaptormatrix():
+ * the outgoing plan (or no matrix at all) is applied to the destination as
+ * usual, the incoming plan blockwise into a small scratch buffer, which is
+ * then faded in linearly (reaching full gain with the last frame of the fade).
+ * the extra channels are the same for both plans.
+ */
+#define _AMBIX_FADEGAIN(fade, frame)                                    \
+  (((fade)->pos+(frame)+1 >= (fade)->length)?1.:(float64_t)((fade)->pos+(frame)+1)/(float64_t)(fade)->length)
+
+#define _AMBIX_FADEADAPTOR(typ, convert)                                \
+  ambix_err_t _ambix_splitAdaptorfade_##typ(const typ##_t*source, uint32_t sourcechannels, \
+                                             const _ambix_matrixfade_t*fade, const _ambix_matrixplan_t*plan, \
+                                             typ##_t*dest_ambi, typ##_t*dest_other, \
+                                             int64_t frames) {          \
+    typ##_t scratch[_AMBIX_PLANAR_SCRATCHSIZE];                         \
+    const uint32_t ambichannels=plan->rows;                             \
+    const uint32_t channels=ambichannels+sourcechannels-plan->cols;     \
+    typ##_t*buffer=scratch;                                             \
+    int64_t blocksize=_AMBIX_PLANAR_SCRATCHSIZE/(channels?channels:1);  \
+    ambix_err_t err;                                                    \
+    int64_t f0;                                                         \
+    if(fade->plan)                                                      \
+      err=_ambix_splitAdaptorplan_##typ(source, sourcechannels, fade->plan, dest_ambi, dest_other, frames); \
+    else                                                                \
+      err=_ambix_splitAdaptor_##typ(source, sourcechannels, plan->cols, dest_ambi, dest_other, frames); \
+    if(AMBIX_ERR_SUCCESS!=err)                                          \
+      return err;                                                       \
+    if(blocksize<1) {                                                   \
+      blocksize=1;                                                      \
+      buffer=(typ##_t*)malloc(channels*sizeof(*buffer));                \
+      if(!buffer)                                                       \
+        return AMBIX_ERR_UNKNOWN;                                       \
+    }                                                                   \
+    for(f0=0; f0<frames; f0+=blocksize) {                               \
+      const int64_t n=(frames-f0<blocksize)?(frames-f0):blocksize;      \
+      typ##_t*ambi=buffer, *other=buffer+n*ambichannels;                \
+      int64_t f;                                                        \
+      err=_ambix_splitAdaptorplan_##typ(source+f0*sourcechannels, sourcechannels, plan, ambi, other, n); \
+      if(AMBIX_ERR_SUCCESS!=err)                                        \
+        break;                                                          \
+      for(f=0; f<n; f++) {                                              \
+        const float64_t gain=_AMBIX_FADEGAIN(fade, f0+f);               \
+        typ##_t*dst=dest_ambi+(f0+f)*ambichannels;                      \
+        const typ##_t*src=ambi+f*ambichannels;                          \
+        uint32_t chan;                                                  \
+        for(chan=0; chan<ambichannels; chan++)                          \
+          dst[chan]=convert(dst[chan] + gain*((float64_t)src[chan]-dst[chan])); \
+      }                                                                 \
+    }                                                                   \
+    if(buffer!=scratch)                                                 \
+      free(buffer);                                                     \
+    return err;                                                         \
+  }                                                                     \
+  ambix_err_t _ambix_splitAdaptorfade_planar_##typ(const typ##_t*source, uint32_t sourcechannels, \
+                                                    const _ambix_matrixfade_t*fade, const _ambix_matrixplan_t*plan, \
+                                                    typ##_t**dest_ambi, typ##_t**dest_other, \
+                                                    int64_t offset, int64_t frames) { \
+    typ##_t scratch[_AMBIX_PLANAR_SCRATCHSIZE];                         \
+    const uint32_t ambichannels=plan->rows;                             \
+    const uint32_t channels=ambichannels+sourcechannels-plan->cols;     \
+    typ##_t*buffer=scratch;                                             \
+    int64_t blocksize=_AMBIX_PLANAR_SCRATCHSIZE/(channels?channels:1);  \
+    ambix_err_t err;                                                    \
+    int64_t f0;                                                         \
+    if(fade->plan)                                                      \
+      err=_ambix_splitAdaptorplan_planar_##typ(source, sourcechannels, fade->plan, dest_ambi, dest_other, offset, frames); \
+    else                                                                \
+      err=_ambix_splitAdaptor_planar_##typ(source, sourcechannels, plan->cols, dest_ambi, dest_other, offset, frames); \
+    if(AMBIX_ERR_SUCCESS!=err)                                          \
+      return err;                                                       \
+    if(blocksize<1) {                                                   \
+      blocksize=1;                                                      \
+      buffer=(typ##_t*)malloc(channels*sizeof(*buffer));                \
+      if(!buffer)                                                       \
+        return AMBIX_ERR_UNKNOWN;                                       \
+    }                                                                   \
+    for(f0=0; f0<frames; f0+=blocksize) {                               \
+      const int64_t n=(frames-f0<blocksize)?(frames-f0):blocksize;      \
+      typ##_t*ambi=buffer, *other=buffer+n*ambichannels;                \
+      uint32_t chan;                                                    \
+      err=_ambix_splitAdaptorplan_##typ(source+f0*sourcechannels, sourcechannels, plan, ambi, other, n); \
+      if(AMBIX_ERR_SUCCESS!=err)                                        \
+        break;                                                          \
+      for(chan=0; chan<ambichannels; chan++) {                          \
+        typ##_t*dst=dest_ambi[chan]+offset+f0;                          \
+        int64_t f;                                                      \
+        for(f=0; f<n; f++)                                              \
+          dst[f]=convert(dst[f] + _AMBIX_FADEGAIN(fade, f0+f)*((float64_t)ambi[f*ambichannels+chan]-dst[f])); \
+      }                                                                 \
+    }                                                                   \
+    if(buffer!=scratch)                                                 \
+      free(buffer);                                                     \
+    return err;                                                         \
+  }
+
+_AMBIX_FADEADAPTOR(float32, (float32_t));
+_AMBIX_FADEADAPTOR(float64, (float64_t));
+_AMBIX_FADEADAPTOR(int32, _ambix_float_to_int32);
+_AMBIX_FADEADAPTOR(int16, _ambix_float_to_int16);
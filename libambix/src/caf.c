@@ -0,0 +1,1121 @@
+/* caf.c -  native CAF support              -*- c -*-
+
+   Copyright © 2026 IOhannes m zmölnig <zmoelnig@iem.at>.
+         Institute of Electronic Music and Acoustics (IEM),
+         University of Music and Dramatic Arts, Graz
+
+   This file is part of libambix
+
+   libambix is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   libambix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+ * a minimal reader/writer for (linear PCM) Core Audio Format files,
+ * for use without libsndfile.
+ *
+ * the file is scanned once on opening, remembering the position of all chunks;
+ * 'desc' and 'data' are interpreted right away, any other chunk ('uuid',
+ * 'mark', 'regn', 'strg',...) is only read when asked for.
+ *
+ * sample data is read resp. written in large blocks and converted with the
+ * functions below; if the file already holds the requested sample format in
+ * the native byte order, the data is transferred directly (without copying).
+ *
+ * with AMBIX_MMAP, the entire file is mapped into memory (read-only) and
+ * samples are taken from the mapping instead of being read via stdio;
+ * read-ahead is requested explicitly (in _CAF_READAHEAD steps), so random
+ * access (scrubbing) does not pay for pages that are never touched.
+ *
+ * new files are written in the byte order of the host (as with libsndfile,
+ * the chunks written by libambix use the same byte order as the sample data).
+ * all chunks are written when the header is written (before the first sample
+ * frame), the size of the 'data' chunk is fixed up when closing the file.
+ *
+ * all access to the file goes through a set of ambix_virtual_io_t callbacks
+ * (for files opened by name, these simply call stdio).
+ * streams that cannot seek (pipes) are read resp. written sequentially:
+ * only the chunks before the sample data are seen, and the size of the 'data'
+ * chunk is left unspecified when writing.
+ *
+ * files opened with AMBIX_RDRW are only modified when they are closed:
+ * chunks that have been replaced (or deleted) are turned into 'free' chunks,
+ * and the new chunks are written into the space of a 'free' chunk if they
+ * fit, or appended to the end of the file otherwise. the sample data is
+ * never moved.
+ */
+
+#include "private.h"
+
+#ifdef HAVE_STDLIB_H
+# include <stdlib.h>
+#endif /* HAVE_STDLIB_H */
+#ifdef HAVE_STRING_H
+# include <string.h>
+#endif /* HAVE_STRING_H */
+#include <stdio.h>
+
+#if defined HAVE_MMAP && defined HAVE_SYS_MMAN_H
+# include <sys/mman.h>
+# include <unistd.h>
+# define _CAF_HAVE_MMAP 1
+#endif
+
+#ifdef _WIN32
+# define _caf_fseek _fseeki64
+# define _caf_ftell _ftelli64
+#else
+# define _caf_fseek fseeko
+# define _caf_ftell ftello
+#endif
+
+/* number of frames in a 'data' chunk of unknown size (on a non-seekable stream) */
+#define _CAF_UNKNOWN_FRAMES (((int64_t)1)<<48)
+
+/* number of samples (not frames) converted at once */
+#define _CAF_BLOCKSIZE 16384
+
+/* number of bytes to request ahead of the current read position in mmap-mode */
+#define _CAF_READAHEAD (1<<20)
+
+typedef struct _caf_chunk {
+  /** chunk type, as found in the file */
+  uint32_t id;
+  /** offset of the payload in the file */
+  int64_t offset;
+  /** size of the payload */
+  int64_t size;
+  /** payload of chunks that are yet to be written */
+  void*data;
+  /** whether the chunk is to be removed from the file (AMBIX_RDRW) */
+  int deleted;
+} _caf_chunk_t;
+
+typedef struct ambixcaf_private_t {
+  /** the file (if opened by name) */
+  FILE*file;
+  /** how to access the data (and the userdata for the callbacks) */
+  ambix_virtual_io_t io;
+  void*iodata;
+  /** whether we can seek in the file */
+  int seekable;
+  /** the current position in the file (in bytes) */
+  int64_t filepos;
+  ambix_filemode_t mode;
+
+  double samplerate;
+  /** sample format in the file */
+  ambix_sampleformat_t sampleformat;
+  /** bytes per sample */
+  uint32_t samplesize;
+  /** number of channels */
+  uint32_t channels;
+  /** bytes per sample frame */
+  uint32_t framesize;
+  /** whether the samples are stored big-endian */
+  int bigendian;
+  /** whether the samples need to be byte-swapped */
+  int swap;
+
+  /** offset of the first sample frame in the file */
+  int64_t dataoffset;
+  /** number of sample frames in the file */
+  int64_t frames;
+  /** current position (in frames) */
+  int64_t position;
+  /** whether the file position no longer matches 'position' */
+  int needseek;
+
+  /** the chunks found in the file (when reading), resp. to be written (when writing) */
+  _caf_chunk_t*chunks;
+  uint32_t numchunks;
+  /** whether the header (and the pending chunks) have been written */
+  int headerwritten;
+  /** offset of the 'data' chunk size (to be fixed up when closing) */
+  int64_t datasizeoffset;
+  /** size of the 'data' chunk (when reading) */
+  int64_t datachunksize;
+  /** index of the chunk holding the adaptor matrix (or -1) */
+  int32_t uuidchunk;
+
+  /** the entire file (up to the end of the sample data) mapped into memory */
+  const unsigned char*map;
+  size_t mapsize;
+  /** offset up to which read-ahead has been requested */
+  int64_t advised;
+
+  /** scratch buffers for converting samples (holding 'blocksize' frames each) */
+  unsigned char*rawbuffer;
+  unsigned char*convbuffer;
+  uint32_t blocksize;
+} ambixcaf_private_t;
+static inline ambixcaf_private_t*PRIVATE(ambix_t*ax) { return ((ambixcaf_private_t*)(ax->private_data)); }
+
+static uint32_t _caf_id(const char id[4]) {
+  uint32_t result;
+  memcpy(&result, id, 4);
+  return result;
+}
+
+static void _caf_set32(unsigned char*data, uint32_t v) {
+  data[0]=(unsigned char)(v>>24);
+  data[1]=(unsigned char)(v>>16);
+  data[2]=(unsigned char)(v>> 8);
+  data[3]=(unsigned char)(v    );
+}
+static void _caf_set64(unsigned char*data, uint64_t v) {
+  _caf_set32(data, (uint32_t)(v>>32));
+  _caf_set32(data+4, (uint32_t)v);
+}
+
+static void _caf_swap2array(uint16_t*data, size_t count) {
+  size_t i;
+  for(i=0; i<count; i++)
+    data[i]=(uint16_t)((data[i]>>8) | (data[i]<<8));
+}
+static void _caf_swaparray(void*data, uint32_t samplesize, size_t count) {
+  switch(samplesize) {
+  case 2: _caf_swap2array((uint16_t*)data, count); break;
+  case 4: _ambix_swap4array((uint32_t*)data, count); break;
+  case 8: _ambix_swap8array((uint64_t*)data, count); break;
+  default: break;
+  }
+}
+
+/* 24bit samples are handled as the upper 24bits of 32bit integers */
+static void _caf_unpack24(int32_t*dest, const unsigned char*src, size_t count, int bigendian) {
+  size_t i;
+  if(bigendian) {
+    for(i=0; i<count; i++, src+=3)
+      dest[i]=(int32_t)((((uint32_t)src[0])<<24) | (((uint32_t)src[1])<<16) | (((uint32_t)src[2])<<8));
+  } else {
+    for(i=0; i<count; i++, src+=3)
+      dest[i]=(int32_t)((((uint32_t)src[2])<<24) | (((uint32_t)src[1])<<16) | (((uint32_t)src[0])<<8));
+  }
+}
+static void _caf_pack24(unsigned char*dest, const int32_t*src, size_t count, int bigendian) {
+  size_t i;
+  for(i=0; i<count; i++, dest+=3) {
+    /* round to 24bit */
+    const int64_t v64=((int64_t)src[i] + 128) >> 8;
+    const uint32_t v=(uint32_t)((v64>0x7FFFFF)?0x7FFFFF:v64);
+    if(bigendian) {
+      dest[0]=(unsigned char)(v>>16);
+      dest[1]=(unsigned char)(v>> 8);
+      dest[2]=(unsigned char)(v    );
+    } else {
+      dest[2]=(unsigned char)(v>>16);
+      dest[1]=(unsigned char)(v>> 8);
+      dest[0]=(unsigned char)(v    );
+    }
+  }
+}
+
+/* the in-memory representation of each sample format */
+static ambix_sampleformat_t _caf_memoryformat(ambix_sampleformat_t format) {
+  return (AMBIX_SAMPLEFORMAT_PCM24 == format)?AMBIX_SAMPLEFORMAT_PCM32:format;
+}
+
+static inline double _caf_round(double v) {
+  return (v<0.)?(v-.5):(v+.5);
+}
+static inline int16_t _caf_float_to_int16(double v) {
+  return _ambix_float_to_int16(_caf_round(v*32767.));
+}
+static inline int32_t _caf_float_to_int32(double v) {
+  return _ambix_float_to_int32(_caf_round(v*2147483647.));
+}
+
+/* convert 'count' samples between the in-memory sample formats
+ * (integers are scaled to [-1..+1) as with libsndfile) */
+static void _caf_convert(void*dest, ambix_sampleformat_t destformat,
+                         const void*src, ambix_sampleformat_t srcformat,
+                         size_t count) {
+  size_t i;
+#define _CAF_CONVERT(dtyp, styp, expr) {                   \
+    dtyp##_t*d=(dtyp##_t*)dest;                            \
+    const styp##_t*s=(const styp##_t*)src;                 \
+    for(i=0; i<count; i++) {                               \
+      const styp##_t x=s[i];                               \
+      d[i]=(dtyp##_t)(expr);                               \
+    }                                                      \
+  }
+  if(destformat == srcformat) {
+    if(dest!=src)
+      memcpy(dest, src, count*_ambix_caf_samplesize(srcformat));
+    return;
+  }
+  switch(srcformat) {
+  case AMBIX_SAMPLEFORMAT_PCM16:
+    switch(destformat) {
+    case AMBIX_SAMPLEFORMAT_PCM32  : _CAF_CONVERT(int32,   int16, x*65536); break;
+    case AMBIX_SAMPLEFORMAT_FLOAT32: _CAF_CONVERT(float32, int16, x*(1.f/32768.f)); break;
+    case AMBIX_SAMPLEFORMAT_FLOAT64: _CAF_CONVERT(float64, int16, x*(1./32768.)); break;
+    default: break;
+    }
+    break;
+  case AMBIX_SAMPLEFORMAT_PCM32:
+    switch(destformat) {
+    case AMBIX_SAMPLEFORMAT_PCM16  : _CAF_CONVERT(int16,   int32, x>>16); break;
+    case AMBIX_SAMPLEFORMAT_FLOAT32: _CAF_CONVERT(float32, int32, x*(1./2147483648.)); break;
+    case AMBIX_SAMPLEFORMAT_FLOAT64: _CAF_CONVERT(float64, int32, x*(1./2147483648.)); break;
+    default: break;
+    }
+    break;
+  case AMBIX_SAMPLEFORMAT_FLOAT32:
+    switch(destformat) {
+    case AMBIX_SAMPLEFORMAT_PCM16  : _CAF_CONVERT(int16,   float32, _caf_float_to_int16(x)); break;
+    case AMBIX_SAMPLEFORMAT_PCM32  : _CAF_CONVERT(int32,   float32, _caf_float_to_int32(x)); break;
+    case AMBIX_SAMPLEFORMAT_FLOAT64: _CAF_CONVERT(float64, float32, x); break;
+    default: break;
+    }
+    break;
+  case AMBIX_SAMPLEFORMAT_FLOAT64:
+    switch(destformat) {
+    case AMBIX_SAMPLEFORMAT_PCM16  : _CAF_CONVERT(int16,   float64, _caf_float_to_int16(x)); break;
+    case AMBIX_SAMPLEFORMAT_PCM32  : _CAF_CONVERT(int32,   float64, _caf_float_to_int32(x)); break;
+    case AMBIX_SAMPLEFORMAT_FLOAT32: _CAF_CONVERT(float32, float64, x); break;
+    default: break;
+    }
+    break;
+  default:
+    break;
+  }
+#undef _CAF_CONVERT
+}
+
+
+/* stdio callbacks, for files opened by name */
+static int64_t _caf_stdio_filelen(void*userdata) {
+  FILE*file=(FILE*)userdata;
+  const int64_t pos=_caf_ftell(file);
+  int64_t size=-1;
+  if(pos<0 || _caf_fseek(file, 0, SEEK_END))
+    return -1;
+  size=_caf_ftell(file);
+  if(_caf_fseek(file, pos, SEEK_SET))
+    return -1;
+  return size;
+}
+static int64_t _caf_stdio_seek(int64_t offset, int whence, void*userdata) {
+  FILE*file=(FILE*)userdata;
+  if(_caf_fseek(file, offset, whence))
+    return -1;
+  return _caf_ftell(file);
+}
+static int64_t _caf_stdio_read(void*ptr, int64_t count, void*userdata) {
+  return (int64_t)fread(ptr, 1, (size_t)count, (FILE*)userdata);
+}
+static int64_t _caf_stdio_write(const void*ptr, int64_t count, void*userdata) {
+  return (int64_t)fwrite(ptr, 1, (size_t)count, (FILE*)userdata);
+}
+static int64_t _caf_stdio_tell(void*userdata) {
+  return _caf_ftell((FILE*)userdata);
+}
+static const ambix_virtual_io_t _caf_stdio = {
+  _caf_stdio_filelen,
+  _caf_stdio_seek,
+  _caf_stdio_read,
+  _caf_stdio_write,
+  _caf_stdio_tell,
+};
+
+/* read 'size' bytes (unless we hit the end of the file); returns the number of bytes read */
+static int64_t _caf_read(ambixcaf_private_t*priv, void*data, int64_t size) {
+  unsigned char*ptr=(unsigned char*)data;
+  int64_t done=0;
+  /* callbacks (e.g. on pipes) may return less than requested */
+  while(done<size) {
+    const int64_t got=priv->io.read(ptr+done, size-done, priv->iodata);
+    if(got<=0)
+      break;
+    done+=got;
+  }
+  priv->filepos+=done;
+  return done;
+}
+static int64_t _caf_writebytes(ambixcaf_private_t*priv, const void*data, int64_t size) {
+  const unsigned char*ptr=(const unsigned char*)data;
+  int64_t done=0;
+  while(done<size) {
+    const int64_t got=priv->io.write(ptr+done, size-done, priv->iodata);
+    if(got<=0)
+      break;
+    done+=got;
+  }
+  priv->filepos+=done;
+  return done;
+}
+/* returns 0 on success (like fseek()) */
+static int _caf_seek(ambixcaf_private_t*priv, int64_t offset, int whence) {
+  int64_t pos;
+  if(!priv->seekable) {
+    /* we can only "seek" to where we are already */
+    if(SEEK_CUR == whence)
+      offset+=priv->filepos;
+    return (SEEK_END == whence || offset != priv->filepos);
+  }
+  pos=priv->io.seek(offset, whence, priv->iodata);
+  if(pos<0)
+    return -1;
+  priv->filepos=pos;
+  return 0;
+}
+static int64_t _caf_tell(ambixcaf_private_t*priv) {
+  return priv->filepos;
+}
+/* skip over 'size' bytes */
+static int _caf_skip(ambixcaf_private_t*priv, int64_t size) {
+  unsigned char buffer[1024];
+  if(priv->seekable)
+    return !_caf_seek(priv, size, SEEK_CUR);
+  while(size>0) {
+    const int64_t want=(size<(int64_t)sizeof(buffer))?size:(int64_t)sizeof(buffer);
+    if(_caf_read(priv, buffer, want) != want)
+      return 0;
+    size-=want;
+  }
+  return 1;
+}
+
+/* make sure that the file position matches the current frame */
+static int _caf_seekfile(ambixcaf_private_t*priv) {
+  if(priv->needseek) {
+    const int64_t offset=priv->dataoffset + priv->position*priv->framesize;
+    if(_caf_seek(priv, offset, SEEK_SET))
+      return 0;
+    priv->needseek=0;
+  }
+  return 1;
+}
+
+/* map the file into memory (if requested and possible);
+ * on failure we silently fall back to reading via stdio */
+static void _caf_map(ambixcaf_private_t*priv) {
+#ifdef _CAF_HAVE_MMAP
+  const int64_t size=priv->dataoffset + priv->frames*priv->framesize;
+  void*map;
+  if(!priv->file || !priv->frames || size<=0 || (uint64_t)size > (uint64_t)((size_t)-1))
+    return;
+  map=mmap(NULL, (size_t)size, PROT_READ, MAP_SHARED, fileno(priv->file), 0);
+  if(MAP_FAILED == map)
+    return;
+  priv->map=(const unsigned char*)map;
+  priv->mapsize=(size_t)size;
+  priv->advised=0;
+#endif
+}
+static void _caf_unmap(ambixcaf_private_t*priv) {
+#ifdef _CAF_HAVE_MMAP
+  if(priv->map)
+    munmap((void*)priv->map, priv->mapsize);
+#endif
+  priv->map=NULL;
+  priv->mapsize=0;
+}
+/* get the address of the frame at the current position,
+ * and make sure that the kernel starts reading the following data */
+static const unsigned char*_caf_mapped(ambixcaf_private_t*priv, int64_t frames) {
+  const int64_t offset=priv->dataoffset + priv->position*priv->framesize;
+#if defined _CAF_HAVE_MMAP && defined HAVE_MADVISE
+  const int64_t end=offset + frames*priv->framesize;
+  if(end > priv->advised) {
+    const int64_t pagesize=(int64_t)sysconf(_SC_PAGESIZE);
+    int64_t start=(offset > priv->advised)?offset:priv->advised;
+    int64_t stop=end + _CAF_READAHEAD;
+    if(pagesize>0)
+      start-=start%pagesize;
+    if(stop > (int64_t)priv->mapsize)
+      stop=(int64_t)priv->mapsize;
+    if(stop > start)
+      madvise((void*)(priv->map + start), (size_t)(stop-start), MADV_WILLNEED);
+    priv->advised=stop;
+  }
+#endif
+  return priv->map + offset;
+}
+
+static _caf_chunk_t*_caf_addchunk(ambixcaf_private_t*priv, uint32_t id, int64_t offset, int64_t size) {
+  _caf_chunk_t*chunks=(_caf_chunk_t*)realloc(priv->chunks, (priv->numchunks+1)*sizeof(*chunks));
+  _caf_chunk_t*chunk;
+  if(!chunks)
+    return NULL;
+  priv->chunks=chunks;
+  chunk=chunks+priv->numchunks;
+  priv->numchunks++;
+  chunk->id=id;
+  chunk->offset=offset;
+  chunk->size=size;
+  chunk->data=NULL;
+  chunk->deleted=0;
+  return chunk;
+}
+/* get the chunk_it-th (not deleted) chunk with the given id */
+static _caf_chunk_t*_caf_findchunk(ambixcaf_private_t*priv, uint32_t id, uint32_t chunk_it) {
+  uint32_t i;
+  for(i=0; i<priv->numchunks; i++) {
+    _caf_chunk_t*chunk=priv->chunks+i;
+    if(chunk->id != id || chunk->deleted)
+      continue;
+    if(!chunk_it--)
+      return chunk;
+  }
+  return NULL;
+}
+
+static int _caf_write(ambixcaf_private_t*priv, const void*data, size_t size) {
+  return ((int64_t)size == _caf_writebytes(priv, data, (int64_t)size));
+}
+static int _caf_writechunkheader(ambixcaf_private_t*priv, uint32_t id, int64_t size) {
+  unsigned char header[12];
+  memcpy(header, &id, 4);
+  _caf_set64(header+4, (uint64_t)size);
+  return _caf_write(priv, header, sizeof(header));
+}
+/* write all chunks that are still held in memory */
+static int _caf_writechunks(ambixcaf_private_t*priv) {
+  uint32_t i;
+  for(i=0; i<priv->numchunks; i++) {
+    _caf_chunk_t*chunk=priv->chunks+i;
+    if(!chunk->data)
+      continue;
+    if(!_caf_writechunkheader(priv, chunk->id, chunk->size))
+      return 0;
+    chunk->offset=_caf_tell(priv);
+    if(!_caf_write(priv, chunk->data, (size_t)chunk->size))
+      return 0;
+    free(chunk->data);
+    chunk->data=NULL;
+  }
+  return 1;
+}
+
+/* write the file header, the 'desc' chunk, all pending chunks and the header of the 'data' chunk */
+static int _caf_writeheader(ambixcaf_private_t*priv) {
+  const int isfloat=(AMBIX_SAMPLEFORMAT_FLOAT32 == priv->sampleformat) || (AMBIX_SAMPLEFORMAT_FLOAT64 == priv->sampleformat);
+  unsigned char desc[32];
+  unsigned char editcount[4] = {0, 0, 0, 0};
+  uint64_t rate;
+  if(priv->headerwritten)
+    return 1;
+  priv->headerwritten=1;
+
+  if(!_caf_write(priv, "caff\0\1\0\0", 8))
+    return 0;
+
+  memcpy(&rate, &priv->samplerate, sizeof(rate));
+  _caf_set64(desc+ 0, rate);
+  memcpy(desc+8, "lpcm", 4);
+  _caf_set32(desc+12, (isfloat?AMBIX_CAF_FLAG_FLOAT:0) | (priv->bigendian?0:AMBIX_CAF_FLAG_LITTLEENDIAN));
+  _caf_set32(desc+16, priv->framesize); /* bytes per packet */
+  _caf_set32(desc+20, 1); /* frames per packet */
+  _caf_set32(desc+24, priv->channels);
+  _caf_set32(desc+28, priv->samplesize*8);
+  if(!_caf_writechunkheader(priv, _caf_id("desc"), sizeof(desc)) || !_caf_write(priv, desc, sizeof(desc)))
+    return 0;
+
+  if(!_caf_writechunks(priv))
+    return 0;
+
+  /* the size of the 'data' chunk is unknown (-1) until the file is closed */
+  priv->datasizeoffset=_caf_tell(priv)+4;
+  if(!_caf_writechunkheader(priv, _caf_id("data"), -1) || !_caf_write(priv, editcount, sizeof(editcount)))
+    return 0;
+  priv->dataoffset=_caf_tell(priv);
+  priv->needseek=0;
+  return 1;
+}
+/* write the trailing chunks and fix the size of the 'data' chunk */
+static int _caf_finalize(ambixcaf_private_t*priv) {
+  unsigned char size[8];
+  int result=1;
+  const int64_t datasize=priv->frames*priv->framesize;
+  if(_caf_seek(priv, priv->dataoffset + datasize, SEEK_SET))
+    return 0;
+  if(!priv->seekable) {
+    uint32_t i;
+    /* the 'data' chunk (of unspecified size) must be the last one */
+    for(i=0; i<priv->numchunks; i++)
+      if(priv->chunks[i].data)
+        return 0;
+    return 1;
+  }
+  result=_caf_writechunks(priv);
+  _caf_set64(size, (uint64_t)(datasize+4));
+  if(_caf_seek(priv, priv->datasizeoffset, SEEK_SET) || !_caf_write(priv, size, sizeof(size)))
+    result=0;
+  return result;
+}
+
+/* AMBIX_RDRW: write the modified chunks back to the file */
+static int _caf_commit(ambixcaf_private_t*priv) {
+  uint32_t i, j;
+  unsigned char size[8];
+  int appended=0;
+  /* the space of deleted chunks is up for grabs */
+  for(i=0; i<priv->numchunks; i++) {
+    const _caf_chunk_t*chunk=priv->chunks+i;
+    if(!chunk->deleted || chunk->offset<0 || _caf_id("free") == chunk->id)
+      continue;
+    if(_caf_seek(priv, chunk->offset-12, SEEK_SET) || !_caf_write(priv, "free", 4))
+      return 0;
+  }
+  for(i=0; i<priv->numchunks; i++) {
+    _caf_chunk_t*chunk=priv->chunks+i;
+    _caf_chunk_t*hole=NULL;
+    if(!chunk->data)
+      continue;
+    /* find a 'free' chunk that fits exactly, or else leaves room for another 'free' chunk
+     * (so repeated edits of the same size keep the file size) */
+    for(j=0; j<priv->numchunks; j++) {
+      _caf_chunk_t*c=priv->chunks+j;
+      if(!c->deleted || c->offset<0)
+        continue;
+      if(c->size == chunk->size) {
+        hole=c;
+        break;
+      }
+      if(!hole && c->size >= chunk->size+12)
+        hole=c;
+    }
+    if(hole) {
+      if(_caf_seek(priv, hole->offset-12, SEEK_SET))
+        return 0;
+    } else {
+      if(!appended && priv->datasizeoffset>0) {
+        /* the 'data' chunk extends to the end of the file; give it a proper size */
+        _caf_set64(size, (uint64_t)priv->datachunksize);
+        if(_caf_seek(priv, priv->datasizeoffset, SEEK_SET) || !_caf_write(priv, size, sizeof(size)))
+          return 0;
+      }
+      appended=1;
+      if(_caf_seek(priv, 0, SEEK_END))
+        return 0;
+    }
+    if(!_caf_writechunkheader(priv, chunk->id, chunk->size) || !_caf_write(priv, chunk->data, (size_t)chunk->size))
+      return 0;
+    free(chunk->data);
+    chunk->data=NULL;
+    if(hole) {
+      if(hole->size == chunk->size) {
+        hole->offset=-1;
+      } else {
+        /* the remaining space stays free */
+        hole->offset+=chunk->size+12;
+        hole->size-=chunk->size+12;
+        if(!_caf_writechunkheader(priv, _caf_id("free"), hole->size))
+          return 0;
+      }
+    }
+  }
+  return 1;
+}
+
+/* parse the 'desc' chunk */
+static int _caf_readdesc(ambixcaf_private_t*priv, const unsigned char data[32]) {
+  _ambix_caf_desc_t desc;
+  if(!_ambix_caf_parsedesc(data, &desc))
+    return 0;
+  priv->samplerate=desc.samplerate;
+  priv->sampleformat=desc.sampleformat;
+  priv->samplesize=desc.samplesize;
+  priv->channels=desc.channels;
+  priv->framesize=desc.framesize;
+  priv->bigendian=desc.bigendian;
+  return 1;
+}
+
+/* scan all chunks of the file */
+static int _caf_readheader(ambixcaf_private_t*priv) {
+  unsigned char header[12];
+  unsigned char desc[32];
+  int64_t offset=8, filesize=0, datasize=0;
+  int havedesc=0, havedata=0;
+
+  if(priv->seekable) {
+    filesize=(priv->io.get_filelen)?priv->io.get_filelen(priv->iodata):-1;
+    if(filesize<0 || _caf_seek(priv, 0, SEEK_SET))
+      return 0;
+  } else {
+    /* we don't know how much there is to come */
+    filesize=INT64_MAX/2;
+  }
+  if(8 != _caf_read(priv, header, 8) || !_ambix_caf_checkheader(header))
+    return 0;
+
+  while(offset+12 <= filesize) {
+    uint32_t id;
+    int64_t size;
+    const int64_t pos=_caf_tell(priv);
+    if(offset<pos || (offset>pos && !_caf_skip(priv, offset-pos)))
+      break;
+    if(12 != _caf_read(priv, header, 12))
+      break;
+    memcpy(&id, header, 4);
+    size=(int64_t)_ambix_caf_get64(header+4);
+    offset+=12;
+    if(!priv->seekable && _caf_id("data") == id) {
+      /* we cannot look beyond the sample data */
+      if(size>=0 && size<4)
+        return 0;
+      if(!_caf_skip(priv, 4))
+        return 0;
+      priv->dataoffset=offset+4;
+      datasize=(size<0)?-1:size-4;
+      havedata=1;
+      break;
+    } else if(_caf_id("data") == id) {
+      /* a size of -1 means: up to the end of the file */
+      if(size<0 || size > filesize-offset) {
+        /* remember where to fix the size, in case we append chunks later */
+        priv->datasizeoffset=offset-8;
+        size=filesize-offset;
+      }
+      if(size<4)
+        return 0;
+      priv->datachunksize=size;
+      priv->dataoffset=offset+4;
+      datasize=size-4;
+      havedata=1;
+    } else if(size<0 || size > filesize-offset) {
+      /* broken chunk */
+      break;
+    } else if(_caf_id("desc") == id) {
+      if(size<32 || 32 != _caf_read(priv, desc, 32))
+        return 0;
+      havedesc=1;
+    } else {
+      _caf_chunk_t*chunk=_caf_addchunk(priv, id, offset, size);
+      if(!chunk)
+        return 0;
+      /* 'free' chunks can be reused when editing the file */
+      chunk->deleted=(_caf_id("free") == id);
+      if(!priv->seekable && !chunk->deleted && size>0) {
+        /* we won't be able to come back, so keep the chunk in memory */
+        if((uint64_t)size > (uint64_t)((size_t)-1))
+          return 0;
+        chunk->data=malloc((size_t)size);
+        if(!chunk->data || size != _caf_read(priv, chunk->data, size))
+          return 0;
+      }
+    }
+    offset+=size;
+  }
+  if(!havedesc || !havedata || !_caf_readdesc(priv, desc))
+    return 0;
+  priv->frames=(datasize<0)?_CAF_UNKNOWN_FRAMES:(datasize / priv->framesize);
+  return 1;
+}
+
+static int _caf_read_uuidchunk(ambix_t*ax) {
+  uint32_t i;
+  for(i=0; ; i++) {
+    int64_t datasize=0;
+    char*data=(char*)_ambix_read_chunk(ax, _caf_id("uuid"), i, &datasize);
+    if(!data)
+      break;
+    if(datasize>16 && 1==_ambix_checkUUID(data)) {
+      if(_ambix_uuid1_to_matrix(data+16, datasize-16, &ax->matrix, ax->byteswap)) {
+        PRIVATE(ax)->uuidchunk=(int32_t)(_caf_findchunk(PRIVATE(ax), _caf_id("uuid"), i) - PRIVATE(ax)->chunks);
+        free(data);
+        return 1;
+      }
+    }
+    free(data);
+  }
+  return 0;
+}
+
+/* open the file, once we know how to access it */
+static ambix_err_t _caf_open(ambix_t*ambix, const ambix_filemode_t mode, const ambix_info_t*ambixinfo) {
+  ambixcaf_private_t*priv=PRIVATE(ambix);
+  /* pipes don't know where they are */
+  priv->seekable=(priv->io.seek && priv->io.seek(0, SEEK_CUR, priv->iodata)>=0);
+  priv->filepos=0;
+
+  if((mode & AMBIX_READ) && (mode & AMBIX_WRITE)) {
+    /* only the chunks can be modified, the sample data is left alone */
+    if(!priv->seekable || !priv->io.write || !_caf_readheader(priv))
+      return AMBIX_ERR_INVALID_FILE;
+    priv->headerwritten=1;
+    if(mode & AMBIX_MMAP)
+      _caf_map(priv);
+  } else if (mode & AMBIX_WRITE) {
+    priv->sampleformat=ambixinfo->sampleformat;
+    priv->samplesize=_ambix_caf_samplesize(priv->sampleformat);
+    if(!priv->samplesize) {
+      priv->sampleformat=AMBIX_SAMPLEFORMAT_PCM24;
+      priv->samplesize=_ambix_caf_samplesize(priv->sampleformat);
+    }
+    priv->channels=ambixinfo->ambichannels+ambixinfo->extrachannels;
+    priv->framesize=priv->samplesize*priv->channels;
+    priv->bigendian=_ambix_caf_host_bigendian();
+    priv->samplerate=ambixinfo->samplerate;
+    if(!priv->channels || priv->channels>AMBIX_CAF_MAXCHANNELS || !priv->io.write)
+      return AMBIX_ERR_INVALID_FILE;
+    if(priv->seekable && _caf_seek(priv, 0, SEEK_SET))
+      return AMBIX_ERR_INVALID_FILE;
+  } else if (mode & AMBIX_READ) {
+    if(!priv->io.read || !_caf_readheader(priv))
+      return AMBIX_ERR_INVALID_FILE;
+    priv->headerwritten=1;
+    if(mode & AMBIX_MMAP)
+      _caf_map(priv);
+  } else
+    return AMBIX_ERR_INVALID_FILE;
+
+  priv->mode=mode;
+  priv->swap=(priv->bigendian != _ambix_caf_host_bigendian());
+  priv->position=0;
+  priv->needseek=1;
+
+  priv->blocksize=_CAF_BLOCKSIZE/priv->channels;
+  if(!priv->blocksize)
+    priv->blocksize=1;
+  /* the in-memory representation takes up to 8 bytes per sample */
+  priv->rawbuffer=(unsigned char*)malloc((size_t)priv->blocksize*priv->framesize);
+  priv->convbuffer=(unsigned char*)malloc((size_t)priv->blocksize*priv->channels*sizeof(float64_t));
+  if(!priv->rawbuffer || !priv->convbuffer)
+    return AMBIX_ERR_UNKNOWN;
+
+  memset(&ambix->realinfo, 0, sizeof(ambix->realinfo));
+  /* the length of a stream might be unknown */
+  ambix->realinfo.frames=(_CAF_UNKNOWN_FRAMES == priv->frames)?0:(uint64_t)priv->frames;
+  ambix->realinfo.samplerate=priv->samplerate;
+  ambix->realinfo.extrachannels=priv->channels;
+  ambix->realinfo.sampleformat=priv->sampleformat;
+
+  ambix->byteswap=priv->swap;
+  ambix->channels=priv->channels;
+  ambix->is_AMBIX=1;
+  ambix->format=(_caf_read_uuidchunk(ambix))?AMBIX_EXTENDED:AMBIX_BASIC;
+
+  return AMBIX_ERR_SUCCESS;
+}
+
+ambix_err_t _ambix_open (ambix_t*ambix, const char *path, const ambix_filemode_t mode, const ambix_info_t*ambixinfo) {
+  const char*fmode="rb";
+  ambixcaf_private_t*priv=(ambixcaf_private_t*)calloc(1, sizeof(ambixcaf_private_t));
+  ambix->private_data=priv;
+  if(!priv)
+    return AMBIX_ERR_UNKNOWN;
+  priv->uuidchunk=-1;
+
+  if((mode & AMBIX_READ) && (mode & AMBIX_WRITE))
+    fmode="r+b";
+  else if(mode & AMBIX_WRITE)
+    fmode="wb";
+  else if(!(mode & AMBIX_READ))
+    return AMBIX_ERR_INVALID_FILE;
+  /* check the channels before creating a file */
+  if(!(mode & AMBIX_READ) && (!(ambixinfo->ambichannels+ambixinfo->extrachannels)
+                               || ambixinfo->ambichannels+ambixinfo->extrachannels>AMBIX_CAF_MAXCHANNELS))
+    return AMBIX_ERR_INVALID_FILE;
+  priv->file=fopen(path, fmode);
+  if(!priv->file)
+    return AMBIX_ERR_INVALID_FILE;
+  priv->io=_caf_stdio;
+  priv->iodata=priv->file;
+  return _caf_open(ambix, mode, ambixinfo);
+}
+
+ambix_err_t _ambix_open_virtual(ambix_t*ambix, const ambix_virtual_io_t*vio, void*userdata,
+                                const ambix_filemode_t mode, const ambix_info_t*ambixinfo) {
+  ambixcaf_private_t*priv=(ambixcaf_private_t*)calloc(1, sizeof(ambixcaf_private_t));
+  ambix->private_data=priv;
+  if(!priv)
+    return AMBIX_ERR_UNKNOWN;
+  priv->uuidchunk=-1;
+  priv->io=*vio;
+  priv->iodata=userdata;
+  return _caf_open(ambix, mode, ambixinfo);
+}
+
+ambix_err_t     _ambix_close    (ambix_t*ambix) {
+  ambixcaf_private_t*priv=PRIVATE(ambix);
+  ambix_err_t res=AMBIX_ERR_SUCCESS;
+  uint32_t i;
+  if(!priv)
+    return AMBIX_ERR_INVALID_HANDLE;
+  if(priv->io.read || priv->io.write) {
+    if(priv->mode & AMBIX_READ) {
+      if((priv->mode & AMBIX_WRITE) && !_caf_commit(priv))
+        res=AMBIX_ERR_UNKNOWN;
+    } else if(priv->mode & AMBIX_WRITE) {
+      if(!_caf_writeheader(priv) || !_caf_finalize(priv))
+        res=AMBIX_ERR_UNKNOWN;
+    }
+    _caf_unmap(priv);
+  }
+  if(priv->file && fclose(priv->file))
+    res=AMBIX_ERR_UNKNOWN;
+  priv->file=NULL;
+
+  for(i=0; i<priv->numchunks; i++)
+    free(priv->chunks[i].data);
+  free(priv->chunks);
+  free(priv->rawbuffer);
+  free(priv->convbuffer);
+  free(priv);
+  ambix->private_data=NULL;
+  return res;
+}
+
+int64_t _ambix_seek (ambix_t* ambix, int64_t frames, int whence) {
+  ambixcaf_private_t*priv=PRIVATE(ambix);
+  int64_t position=frames;
+  if(!priv || !priv->io.read)
+    return -1;
+  switch(whence & (SEEK_SET|SEEK_CUR|SEEK_END)) {
+  case SEEK_CUR: position+=priv->position; break;
+  case SEEK_END: position+=priv->frames; break;
+  default: break;
+  }
+  if(position<0 || position>priv->frames)
+    return -1;
+  /* streams can only be read sequentially */
+  if(!priv->seekable && position != priv->position)
+    return -1;
+  priv->position=position;
+  priv->needseek=1;
+  /* restart read-ahead at the new position */
+  priv->advised=0;
+  return position;
+}
+
+void*_ambix_get_sndfile      (ambix_t*ambix) {
+  return NULL;
+}
+
+const float32_t*_ambix_map_float32(ambix_t*ambix, int64_t*frames) {
+  ambixcaf_private_t*priv=PRIVATE(ambix);
+  const unsigned char*data;
+  if(!priv || !priv->map || priv->swap || AMBIX_SAMPLEFORMAT_FLOAT32 != priv->sampleformat)
+    return NULL;
+  /* CAF does not align the sample data */
+  if(priv->dataoffset % sizeof(float32_t))
+    return NULL;
+  if(*frames > priv->frames - priv->position)
+    *frames=priv->frames - priv->position;
+  if(*frames < 0)
+    *frames=0;
+  data=_caf_mapped(priv, *frames);
+  priv->position+=*frames;
+  priv->needseek=1;
+  return (const float32_t*)data;
+}
+
+static int64_t _caf_readf(ambix_t*ambix, void*data, ambix_sampleformat_t format, int64_t frames) {
+  ambixcaf_private_t*priv=PRIVATE(ambix);
+  const uint32_t memsize=_ambix_caf_samplesize(format);
+  unsigned char*dest=(unsigned char*)data;
+  const unsigned char*mapped=NULL;
+  int64_t done=0;
+  if(!priv || !priv->io.read || !(priv->mode & AMBIX_READ))
+    return -1;
+  if(frames > priv->frames - priv->position)
+    frames=priv->frames - priv->position;
+  if(frames<=0)
+    return 0;
+  if(priv->map) {
+    /* the entire file is in memory; no need to touch the file position */
+    mapped=_caf_mapped(priv, frames);
+  } else if(!_caf_seekfile(priv))
+    return -1;
+
+  if(format == priv->sampleformat) {
+    /* read directly into the destination buffer */
+    if(mapped) {
+      memcpy(dest, mapped, (size_t)frames*priv->framesize);
+      done=frames;
+    } else
+      done=_caf_read(priv, dest, frames*priv->framesize) / priv->framesize;
+    if(priv->swap)
+      _caf_swaparray(dest, priv->samplesize, (size_t)done*priv->channels);
+  } else {
+    while(done<frames) {
+      const size_t want=(size_t)((frames-done < priv->blocksize)?(frames-done):priv->blocksize);
+      const unsigned char*raw=priv->rawbuffer;
+      size_t got, samples;
+      if(mapped) {
+        /* convert straight from the mapping
+         * (unless we have to swap bytes, or the samples are not aligned) */
+        raw=mapped + done*priv->framesize;
+        got=want;
+        if(AMBIX_SAMPLEFORMAT_PCM24 != priv->sampleformat
+           && (priv->swap || (priv->dataoffset % priv->samplesize))) {
+          memcpy(priv->rawbuffer, raw, got*priv->framesize);
+          raw=priv->rawbuffer;
+        }
+      } else
+        got=(size_t)(_caf_read(priv, priv->rawbuffer, (int64_t)want*priv->framesize) / priv->framesize);
+      samples=got*priv->channels;
+      if(AMBIX_SAMPLEFORMAT_PCM24 == priv->sampleformat) {
+        _caf_unpack24((int32_t*)priv->convbuffer, raw, samples, priv->bigendian);
+        _caf_convert(dest, format, priv->convbuffer, AMBIX_SAMPLEFORMAT_PCM32, samples);
+      } else {
+        if(priv->swap)
+          _caf_swaparray(priv->rawbuffer, priv->samplesize, samples);
+        _caf_convert(dest, format, raw, priv->sampleformat, samples);
+      }
+      dest+=samples*memsize;
+      done+=got;
+      if(got<want)
+        break;
+    }
+  }
+  if(done<frames || mapped)
+    priv->needseek=1;
+  priv->position+=done;
+  return done;
+}
+static int64_t _caf_writef(ambix_t*ambix, const void*data, ambix_sampleformat_t format, int64_t frames) {
+  ambixcaf_private_t*priv=PRIVATE(ambix);
+  const uint32_t memsize=_ambix_caf_samplesize(format);
+  const ambix_sampleformat_t memformat=_caf_memoryformat(priv->sampleformat);
+  const unsigned char*src=(const unsigned char*)data;
+  int64_t done=0;
+  if(!priv || !priv->io.write || !(priv->mode & AMBIX_WRITE) || (priv->mode & AMBIX_READ))
+    return -1;
+  if(frames<=0)
+    return 0;
+  if(!_caf_writeheader(priv) || !_caf_seekfile(priv))
+    return -1;
+
+  if(format == priv->sampleformat && !priv->swap) {
+    /* write directly from the source buffer */
+    done=_caf_writebytes(priv, src, frames*priv->framesize) / priv->framesize;
+  } else {
+    while(done<frames) {
+      const size_t want=(size_t)((frames-done < priv->blocksize)?(frames-done):priv->blocksize);
+      const size_t samples=want*priv->channels;
+      const unsigned char*out=priv->convbuffer;
+      size_t got;
+      _caf_convert(priv->convbuffer, memformat, src, format, samples);
+      if(AMBIX_SAMPLEFORMAT_PCM24 == priv->sampleformat) {
+        _caf_pack24(priv->rawbuffer, (const int32_t*)priv->convbuffer, samples, priv->bigendian);
+        out=priv->rawbuffer;
+      } else if(priv->swap) {
+        _caf_swaparray(priv->convbuffer, priv->samplesize, samples);
+      }
+      got=(size_t)(_caf_writebytes(priv, out, (int64_t)want*priv->framesize) / priv->framesize);
+      src+=samples*memsize;
+      done+=got;
+      if(got<want)
+        break;
+    }
+  }
+  if(done<frames)
+    priv->needseek=1;
+  priv->position+=done;
+  if(priv->position > priv->frames)
+    priv->frames=priv->position;
+  return done;
+}
+
+#define AMBIX_CAF_READWRITE(type, fmt)                                   \
+  int64_t _ambix_readf_##type (ambix_t*ambix, type##_t*data, int64_t frames) { \
+    return _caf_readf(ambix, data, fmt, frames);                        \
+  }                                                                     \
+  int64_t _ambix_writef_##type (ambix_t*ambix, const type##_t*data, int64_t frames) { \
+    return _caf_writef(ambix, data, fmt, frames);                       \
+  }
+AMBIX_CAF_READWRITE(int16, AMBIX_SAMPLEFORMAT_PCM16);
+AMBIX_CAF_READWRITE(int32, AMBIX_SAMPLEFORMAT_PCM32);
+AMBIX_CAF_READWRITE(float32, AMBIX_SAMPLEFORMAT_FLOAT32);
+AMBIX_CAF_READWRITE(float64, AMBIX_SAMPLEFORMAT_FLOAT64);
+
+/* chunks are kept in memory until the header is written;
+ * chunks added later are written after the sample data
+ * (with AMBIX_RDRW, they are written when closing the file) */
+static ambix_err_t _caf_setchunk(ambix_t*ax, uint32_t id, const void*data, int64_t datasize, int replace) {
+  ambixcaf_private_t*priv=PRIVATE(ax);
+  _caf_chunk_t*chunk=NULL;
+  void*copy;
+  uint32_t i;
+  if(!priv || !(priv->mode & AMBIX_WRITE) || datasize<0)
+    return AMBIX_ERR_UNKNOWN;
+  copy=malloc((size_t)datasize+1);
+  if(!copy)
+    return AMBIX_ERR_UNKNOWN;
+  memcpy(copy, data, (size_t)datasize);
+
+  if(replace) {
+    for(i=0; i<priv->numchunks; i++) {
+      if(priv->chunks[i].id == id && priv->chunks[i].data) {
+        chunk=priv->chunks+i;
+        free(chunk->data);
+        break;
+      }
+    }
+    /* the chunk read from the file is superseded */
+    if(!chunk && priv->uuidchunk>=0 && _caf_id("uuid") == id) {
+      priv->chunks[priv->uuidchunk].deleted=1;
+      priv->uuidchunk=-1;
+    }
+  }
+  if(!chunk)
+    chunk=_caf_addchunk(priv, id, -1, datasize);
+  if(!chunk) {
+    free(copy);
+    return AMBIX_ERR_UNKNOWN;
+  }
+  chunk->offset=-1;
+  chunk->size=datasize;
+  chunk->data=copy;
+  return AMBIX_ERR_SUCCESS;
+}
+ambix_err_t _ambix_write_uuidchunk(ambix_t*ax, const void*data, int64_t datasize) {
+  return _caf_setchunk(ax, _caf_id("uuid"), data, datasize, 1);
+}
+ambix_err_t _ambix_write_chunk(ambix_t*ax, uint32_t id, const void*data, int64_t datasize) {
+  return _caf_setchunk(ax, id, data, datasize, 0);
+}
+ambix_err_t _ambix_delete_chunks(ambix_t*ax, uint32_t id) {
+  ambixcaf_private_t*priv=PRIVATE(ax);
+  _caf_chunk_t*chunk;
+  if(!priv || !(priv->mode & AMBIX_WRITE))
+    return AMBIX_ERR_UNKNOWN;
+  while((chunk=_caf_findchunk(priv, id, 0))) {
+    free(chunk->data);
+    chunk->data=NULL;
+    chunk->deleted=1;
+  }
+  return AMBIX_ERR_SUCCESS;
+}
+void* _ambix_read_chunk(ambix_t*ax, uint32_t id, uint32_t chunk_it, int64_t *datasize) {
+  ambixcaf_private_t*priv=PRIVATE(ax);
+  const _caf_chunk_t*chunk;
+  void*data;
+  *datasize=0;
+  if(!priv)
+    return NULL;
+  chunk=_caf_findchunk(priv, id, chunk_it);
+  if(!chunk || !chunk->size)
+    return NULL;
+  data=malloc((size_t)chunk->size);
+  if(!data)
+    return NULL;
+  if(chunk->data) {
+    memcpy(data, chunk->data, (size_t)chunk->size);
+  } else {
+    priv->needseek=1;
+    if(_caf_seek(priv, chunk->offset, SEEK_SET) || chunk->size != _caf_read(priv, data, chunk->size)) {
+      free(data);
+      return NULL;
+    }
+  }
+  *datasize=chunk->size;
+  return data;
+}
@@ -0,0 +1,101 @@
+/* caf_header.c -  parse the header of CAF files              -*- c -*-
+
+   Copyright © 2026 IOhannes m zmölnig <zmoelnig@iem.at>.
+         Institute of Electronic Music and Acoustics (IEM),
+         University of Music and Dramatic Arts, Graz
+
+   This file is part of libambix
+
+   libambix is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   libambix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+ * the parts of the CAF format that are needed both by the native CAF backend
+ * and by ambix_probe() (which reads the header regardless of the backend).
+ */
+
+#include "private.h"
+
+#ifdef HAVE_STRING_H
+# include <string.h>
+#endif /* HAVE_STRING_H */
+
+uint32_t _ambix_caf_get32(const unsigned char*data) {
+  return (((uint32_t)data[0])<<24) | (((uint32_t)data[1])<<16) | (((uint32_t)data[2])<<8) | ((uint32_t)data[3]);
+}
+uint64_t _ambix_caf_get64(const unsigned char*data) {
+  return (((uint64_t)_ambix_caf_get32(data))<<32) | _ambix_caf_get32(data+4);
+}
+
+int _ambix_caf_host_bigendian(void) {
+  const union {
+    uint32_t i;
+    unsigned char c[4];
+  } u = {0x01020304};
+  return (0x01 == u.c[0]);
+}
+
+uint32_t _ambix_caf_samplesize(ambix_sampleformat_t format) {
+  switch(format) {
+  case AMBIX_SAMPLEFORMAT_PCM16: return 2;
+  case AMBIX_SAMPLEFORMAT_PCM24: return 3;
+  case AMBIX_SAMPLEFORMAT_PCM32: return 4;
+  case AMBIX_SAMPLEFORMAT_FLOAT32: return 4;
+  case AMBIX_SAMPLEFORMAT_FLOAT64: return 8;
+  default: break;
+  }
+  return 0;
+}
+
+int _ambix_caf_checkheader(const unsigned char header[8]) {
+  return (!memcmp(header, "caff", 4) && 1 == ((header[4]<<8) | header[5]));
+}
+
+int _ambix_caf_parsedesc(const unsigned char data[32], _ambix_caf_desc_t*desc) {
+  const uint64_t rate=_ambix_caf_get64(data);
+  const uint32_t flags=_ambix_caf_get32(data+12);
+  const uint32_t bytesperpacket=_ambix_caf_get32(data+16);
+  const uint32_t framesperpacket=_ambix_caf_get32(data+20);
+  const uint32_t channels=_ambix_caf_get32(data+24);
+  const uint32_t bits=_ambix_caf_get32(data+28);
+  memcpy(&desc->samplerate, &rate, sizeof(desc->samplerate));
+  desc->sampleformat=AMBIX_SAMPLEFORMAT_NONE;
+  if(memcmp(data+8, "lpcm", 4) || 1!=framesperpacket || !channels || channels>AMBIX_CAF_MAXCHANNELS)
+    return 0;
+  if(flags & AMBIX_CAF_FLAG_FLOAT) {
+    switch(bits) {
+    case 32: desc->sampleformat=AMBIX_SAMPLEFORMAT_FLOAT32; break;
+    case 64: desc->sampleformat=AMBIX_SAMPLEFORMAT_FLOAT64; break;
+    default: return 0;
+    }
+  } else {
+    switch(bits) {
+    case 16: desc->sampleformat=AMBIX_SAMPLEFORMAT_PCM16; break;
+    case 24: desc->sampleformat=AMBIX_SAMPLEFORMAT_PCM24; break;
+    case 32: desc->sampleformat=AMBIX_SAMPLEFORMAT_PCM32; break;
+    default: return 0;
+    }
+  }
+  desc->samplesize=_ambix_caf_samplesize(desc->sampleformat);
+  /* the frame size must neither overflow nor be 0 */
+  if(!bytesperpacket || channels > UINT32_MAX/desc->samplesize)
+    return 0;
+  desc->channels=channels;
+  desc->framesize=desc->samplesize*channels;
+  if(bytesperpacket != desc->framesize)
+    return 0;
+  desc->bigendian=!(flags & AMBIX_CAF_FLAG_LITTLEENDIAN);
+  return 1;
+}
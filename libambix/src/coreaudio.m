@@ -426,7 +426,7 @@ ambix_err_t _ambix_open_write(ambix_t*ambix, const char *path, const ambix_info_
 }
 ambix_err_t _ambix_open	(ambix_t*ambix, const char *path, const ambix_filemode_t mode, const ambix_info_t*ambixinfo) {
 //printf("AMBIX: CoreAudio support\n");
-  if((mode & AMBIX_READ) & (mode & AMBIX_WRITE))
+  if((mode & AMBIX_READ) && (mode & AMBIX_WRITE))
     return AMBIX_ERR_INVALID_FILE;
   else if (mode & AMBIX_WRITE)
     return _ambix_open_write(ambix, path, ambixinfo);
@@ -435,6 +435,11 @@ ambix_err_t _ambix_open	(ambix_t*ambix, const char *path, const ambix_filemode_t
 
   return AMBIX_ERR_INVALID_FILE;
 }
+ambix_err_t _ambix_open_virtual (ambix_t*ambix, const ambix_virtual_io_t*vio, void*userdata, const ambix_filemode_t mode, const ambix_info_t*ambixinfo) {
+  /* not supported (documented with ambix_open_virtual());
+   * LATER: use AudioFileOpenWithCallbacks() resp. AudioFileInitializeWithCallbacks() */
+  return AMBIX_ERR_INVALID_FILE;
+}
 
 ambix_err_t	_ambix_close	(ambix_t*ambix) {
   if(ambix&&ambix->private_data) {
@@ -640,3 +645,10 @@ int64_t _ambix_seek (ambix_t* ambix, int64_t frames, int whence) {
   return _ambix_tell(ambix);
 }
 
+
+const float32_t*_ambix_map_float32(ambix_t*ambix, int64_t*frames) {
+  return NULL;
+}
+ambix_err_t _ambix_delete_chunks(ambix_t*ax, uint32_t id) {
+  return AMBIX_ERR_UNKNOWN;
+}
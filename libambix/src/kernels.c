@@ -0,0 +1,384 @@
+/* kernels.c -  matrix kernels and runtime CPU dispatch              -*- c -*-
+
+   Copyright © 2026 IOhannes m zmölnig <zmoelnig@iem.at>.
+         Institute of Electronic Music and Acoustics (IEM),
+         University of Music and Dramatic Arts, Graz
+
+   This file is part of libambix
+
+   libambix is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   libambix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "private.h"
+
+#ifdef HAVE_STDLIB_H
+# include <stdlib.h>
+#endif /* HAVE_STDLIB_H */
+
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif /* HAVE_UNISTD_H */
+
+#include <math.h>
+
+/* the floating point control register (for flushing denormals) */
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+# include <xmmintrin.h>
+# define AMBIX_HAVE_MXCSR 1
+#elif defined __aarch64__ && defined __GNUC__
+# define AMBIX_HAVE_FPCR 1
+#endif
+
+/* the scalar kernels are the reference implementation:
+ * all SIMD kernels must give the same results (up to rounding)
+ */
+static AMBIX_ALWAYS_INLINE void
+_mtxmul_float32_scalar(float32_t*dest, uint32_t deststride,
+                       const float32_t*mtx, uint32_t rows, uint32_t cols,
+                       const float32_t*source, uint32_t sourcestride,
+                       int64_t frames) {
+  int64_t f;
+  for(f=0; f<frames; f++) {
+    const float32_t*src=source+f*sourcestride;
+    float32_t*dst=dest+f*deststride;
+    const float32_t*m=mtx;
+    uint32_t outchan, inchan;
+    for(outchan=0; outchan<rows; outchan++) {
+      float32_t sum=0.;
+      for(inchan=0; inchan<cols; inchan++)
+        sum+=*m++ * src[inchan];
+      dst[outchan]=sum;
+    }
+  }
+}
+_AMBIX_MTXKERNEL_SPECIALISE_FLOAT32(, _ambix_mtxmul_float32_scalar, _mtxmul_float32_scalar)
+
+static AMBIX_ALWAYS_INLINE void
+_mtxmul_float32_acc64_scalar(float32_t*dest, uint32_t deststride,
+                             const float32_t*mtx, uint32_t rows, uint32_t cols,
+                             const float32_t*source, uint32_t sourcestride,
+                             int64_t frames) {
+  int64_t f;
+  for(f=0; f<frames; f++) {
+    const float32_t*src=source+f*sourcestride;
+    float32_t*dst=dest+f*deststride;
+    const float32_t*m=mtx;
+    uint32_t outchan, inchan;
+    for(outchan=0; outchan<rows; outchan++) {
+      double sum=0.;
+      for(inchan=0; inchan<cols; inchan++) {
+        double scale=*m++;
+        double in=src[inchan];
+        sum+=scale*in;
+      }
+      dst[outchan]=(float32_t)sum;
+    }
+  }
+}
+_AMBIX_MTXKERNEL_SPECIALISE_FLOAT32(, _ambix_mtxmul_float32_acc64_scalar, _mtxmul_float32_acc64_scalar)
+
+/* compensated summation: Knuth's branch-free TwoSum recovers the exact rounding
+ * error of each addition (which also copes with terms that are larger than the
+ * running sum); the product of two floats is exact in double precision, so for
+ * float32 data the only rounding errors left are those of the (compensated) sum.
+ * a single sum is latency-bound, so we interleave a few frames */
+#define _AMBIX_KAHAN_ADD(sum, comp, term) do {                          \
+    const double _t=(sum)+(term);                                       \
+    const double _z=_t-(sum);                                           \
+    (comp)+=((sum)-(_t-_z))+((term)-_z);                                \
+    (sum)=_t;                                                           \
+  } while(0)
+#define _AMBIX_KAHAN_FRAMES 4
+
+#define _AMBIX_MTXMUL_KAHAN(typ)                                        \
+  static AMBIX_ALWAYS_INLINE void                                       \
+  _mtxmul_##typ##_kahan_scalar(typ##_t*dest, uint32_t deststride,       \
+                               const float32_t*mtx, uint32_t rows, uint32_t cols, \
+                               const typ##_t*source, uint32_t sourcestride, \
+                               int64_t frames) {                        \
+    int64_t f;                                                          \
+    uint32_t outchan, inchan, i;                                        \
+    for(f=0; f+_AMBIX_KAHAN_FRAMES<=frames; f+=_AMBIX_KAHAN_FRAMES) {   \
+      const typ##_t*src=source+f*sourcestride;                          \
+      typ##_t*dst=dest+f*deststride;                                    \
+      const float32_t*m=mtx;                                            \
+      for(outchan=0; outchan<rows; outchan++) {                         \
+        double sum[_AMBIX_KAHAN_FRAMES]={0.}, comp[_AMBIX_KAHAN_FRAMES]={0.}; \
+        for(inchan=0; inchan<cols; inchan++) {                          \
+          const double scale=*m++;                                      \
+          for(i=0; i<_AMBIX_KAHAN_FRAMES; i++) {                        \
+            const double prod=scale*src[i*sourcestride+inchan];         \
+            _AMBIX_KAHAN_ADD(sum[i], comp[i], prod);                    \
+          }                                                             \
+        }                                                               \
+        for(i=0; i<_AMBIX_KAHAN_FRAMES; i++)                            \
+          dst[i*deststride+outchan]=(typ##_t)(sum[i]+comp[i]);          \
+      }                                                                 \
+    }                                                                   \
+    for(; f<frames; f++) {                                              \
+      const typ##_t*src=source+f*sourcestride;                          \
+      typ##_t*dst=dest+f*deststride;                                    \
+      const float32_t*m=mtx;                                            \
+      for(outchan=0; outchan<rows; outchan++) {                         \
+        double sum=0., comp=0.;                                         \
+        for(inchan=0; inchan<cols; inchan++) {                          \
+          const double prod=(double)*m++ * src[inchan];                 \
+          _AMBIX_KAHAN_ADD(sum, comp, prod);                            \
+        }                                                               \
+        dst[outchan]=(typ##_t)(sum+comp);                               \
+      }                                                                 \
+    }                                                                   \
+  }
+_AMBIX_MTXMUL_KAHAN(float32)
+_AMBIX_MTXKERNEL_SPECIALISE_FLOAT32(, _ambix_mtxmul_float32_kahan_scalar, _mtxmul_float32_kahan_scalar)
+_AMBIX_MTXMUL_KAHAN(float64)
+void _ambix_mtxmul_float64_kahan_scalar(float64_t*dest, uint32_t deststride,
+                                        const float32_t*mtx, uint32_t rows, uint32_t cols,
+                                        const float64_t*source, uint32_t sourcestride,
+                                        int64_t frames) {
+  _mtxmul_float64_kahan_scalar(dest, deststride, mtx, rows, cols, source, sourcestride, frames);
+}
+
+
+/* fixed-point kernels: 64bit accumulators, rounding and saturating to the output type */
+#define _AMBIX_MTXMUL_FIXED_SCALAR(typ)                                 \
+  static AMBIX_ALWAYS_INLINE void                                       \
+  _mtxmul_##typ##_scalar(typ##_t*dest, uint32_t deststride,             \
+                         const int32_t*mtx, uint32_t rows, uint32_t cols, uint32_t shift, \
+                         const typ##_t*source, uint32_t sourcestride,   \
+                         int64_t frames) {                              \
+    int64_t f;                                                          \
+    for(f=0; f<frames; f++) {                                           \
+      const typ##_t*src=source+f*sourcestride;                          \
+      typ##_t*dst=dest+f*deststride;                                    \
+      const int32_t*m=mtx;                                              \
+      uint32_t outchan, inchan;                                         \
+      for(outchan=0; outchan<rows; outchan++) {                         \
+        int64_t sum=0;                                                  \
+        for(inchan=0; inchan<cols; inchan++)                            \
+          sum+=(int64_t)*m++ * src[inchan];                             \
+        dst[outchan]=_ambix_fixed_to_##typ(sum, shift);                 \
+      }                                                                 \
+    }                                                                   \
+  }                                                                     \
+  _AMBIX_MTXKERNEL_SPECIALISE_FIXED(, typ, _ambix_mtxmul_##typ##_scalar, _mtxmul_##typ##_scalar)
+_AMBIX_MTXMUL_FIXED_SCALAR(int16);
+_AMBIX_MTXMUL_FIXED_SCALAR(int32);
+
+int _ambix_matrix_to_fixed(const float32_t*coeffs, uint32_t rows, uint32_t cols, int32_t*fixed) {
+  double maxnorm=0.;
+  int shift=31;
+  uint32_t r, c;
+  for(r=0; r<rows; r++) {
+    double norm=0.;
+    for(c=0; c<cols; c++)
+      norm+=fabs(coeffs[r*cols+c]);
+    /* this also catches NaNs */
+    if(!(norm<2147483648.))
+      return -1;
+    if(norm>maxnorm)
+      maxnorm=norm;
+  }
+  /* leave some room for rounding the coefficients */
+  while(shift>=0 && ldexp(maxnorm, shift)+cols >= 2147483648.)
+    shift--;
+  if(shift<0)
+    return -1;
+  for(r=0; r<rows*cols; r++)
+    fixed[r]=(int32_t)floor(ldexp(coeffs[r], shift)+0.5);
+  return shift;
+}
+
+/* cache-blocking:
+ * the kernels walk through all matrix rows for each frame; once the matrix no
+ * longer fits into the L1 cache, it is evicted for every single frame.
+ * so we split the matrix into blocks of rows that fit into (half of) L1,
+ * and the frames into tiles that fit into (half of) L2, and apply each row
+ * block to the entire tile before moving on to the next one.
+ */
+#define AMBIX_L1CACHE_DEFAULT (32*1024)
+#define AMBIX_L2CACHE_DEFAULT (256*1024)
+#define AMBIX_TILE_MINFRAMES 16
+
+static size_t _ambix_cachesize(int level) {
+  static volatile long s_l1 = 0, s_l2 = 0;
+  long l1=s_l1, l2=s_l2;
+  if(!l1 || !l2) {
+    l1=l2=0;
+#if defined HAVE_UNISTD_H && defined _SC_LEVEL1_DCACHE_SIZE && defined _SC_LEVEL2_CACHE_SIZE
+    l1=sysconf(_SC_LEVEL1_DCACHE_SIZE);
+    l2=sysconf(_SC_LEVEL2_CACHE_SIZE);
+#endif
+    if(l1<=0)l1=AMBIX_L1CACHE_DEFAULT;
+    if(l2<=l1)l2=(l1>AMBIX_L2CACHE_DEFAULT)?(8*l1):AMBIX_L2CACHE_DEFAULT;
+    s_l1=l1;
+    s_l2=l2;
+  }
+  return (level>1)?l2:l1;
+}
+
+/* calculate the number of matrix rows resp. frames per tile;
+ * returns 0 if the matrix fits into the cache anyhow */
+static int _ambix_tiling(uint32_t rows, uint32_t cols, size_t coeffsize,
+                         size_t framesize, uint32_t*rowblock, int64_t*frametile) {
+  size_t rb=(_ambix_cachesize(1)/2)/(cols*coeffsize);
+  size_t ft;
+  if(rb>=rows)
+    return 0;
+  /* the kernels calculate 4 rows at once */
+  rb&=~((size_t)3);
+  if(rb<4)rb=4;
+  ft=(_ambix_cachesize(2)/2)/framesize;
+  if(ft<AMBIX_TILE_MINFRAMES)ft=AMBIX_TILE_MINFRAMES;
+  *rowblock=rb;
+  *frametile=ft;
+  return 1;
+}
+
+void _ambix_mtxmul_float32_tiled(_ambix_mtxkernel_float32_t kernel,
+                                 float32_t*dest, uint32_t deststride,
+                                 const float32_t*mtx, uint32_t rows, uint32_t cols,
+                                 const float32_t*source, uint32_t sourcestride,
+                                 int64_t frames) {
+  uint32_t rowblock, r;
+  int64_t frametile, f;
+  if(!_ambix_tiling(rows, cols, sizeof(*mtx), (sourcestride+deststride)*sizeof(*source), &rowblock, &frametile)) {
+    kernel(dest, deststride, mtx, rows, cols, source, sourcestride, frames);
+    return;
+  }
+  for(f=0; f<frames; f+=frametile) {
+    const int64_t n=(frames-f<frametile)?(frames-f):frametile;
+    for(r=0; r<rows; r+=rowblock) {
+      const uint32_t nrows=(rows-r<rowblock)?(rows-r):rowblock;
+      kernel(dest+f*deststride+r, deststride, mtx+(size_t)r*cols, nrows, cols,
+             source+f*sourcestride, sourcestride, n);
+    }
+  }
+}
+
+#define _AMBIX_MTXMUL_FIXED_TILED(typ)                                  \
+  void _ambix_mtxmul_##typ##_tiled(_ambix_mtxkernel_##typ##_t kernel,   \
+                                   typ##_t*dest, uint32_t deststride,   \
+                                   const int32_t*mtx, uint32_t rows, uint32_t cols, uint32_t shift, \
+                                   const typ##_t*source, uint32_t sourcestride, \
+                                   int64_t frames) {                    \
+    uint32_t rowblock, r;                                               \
+    int64_t frametile, f;                                               \
+    if(!_ambix_tiling(rows, cols, sizeof(*mtx), (sourcestride+deststride)*sizeof(*source), &rowblock, &frametile)) { \
+      kernel(dest, deststride, mtx, rows, cols, shift, source, sourcestride, frames); \
+      return;                                                           \
+    }                                                                   \
+    for(f=0; f<frames; f+=frametile) {                                  \
+      const int64_t n=(frames-f<frametile)?(frames-f):frametile;        \
+      for(r=0; r<rows; r+=rowblock) {                                   \
+        const uint32_t nrows=(rows-r<rowblock)?(rows-r):rowblock;       \
+        kernel(dest+f*deststride+r, deststride, mtx+(size_t)r*cols, nrows, cols, shift, \
+               source+f*sourcestride, sourcestride, n);                 \
+      }                                                                 \
+    }                                                                   \
+  }
+_AMBIX_MTXMUL_FIXED_TILED(int16);
+_AMBIX_MTXMUL_FIXED_TILED(int32);
+
+static const _ambix_kernels_t s_kernels_scalar = {
+  AMBIX_SIMD_NONE,
+  _ambix_mtxmul_float32_scalar,
+  _ambix_mtxmul_float32_acc64_scalar,
+  _ambix_mtxmul_int16_scalar,
+  _ambix_mtxmul_int32_scalar,
+};
+
+const _ambix_kernels_t*_ambix_get_kernels_simd(_ambix_simd_t simd) {
+  switch(simd) {
+  case AMBIX_SIMD_NONE:
+    return &s_kernels_scalar;
+#ifdef ENABLE_SIMD
+  case AMBIX_SIMD_SSE2:
+  case AMBIX_SIMD_AVX2:
+  case AMBIX_SIMD_AVX512:
+    return _ambix_get_kernels_x86(simd);
+  case AMBIX_SIMD_NEON:
+    return _ambix_get_kernels_neon();
+#endif /* ENABLE_SIMD */
+  default:
+    break;
+  }
+  return NULL;
+}
+
+_ambix_mtxkernel_float32_t _ambix_get_mtxkernel_float32(ambix_precision_t precision, ambix_precision_t fallback) {
+  if(AMBIX_PRECISION_DEFAULT == _AMBIX_PRECISION_MODE(precision))
+    precision=fallback;
+  switch(_AMBIX_PRECISION_MODE(precision)) {
+  case AMBIX_PRECISION_DOUBLE:
+    return _ambix_get_kernels()->mtxmul_float32_acc64;
+  case AMBIX_PRECISION_KAHAN:
+    return _ambix_mtxmul_float32_kahan_scalar;
+  default:
+    break;
+  }
+  return _ambix_get_kernels()->mtxmul_float32;
+}
+
+/* FTZ (flush results to zero) and DAZ (treat denormal inputs as zero) */
+#define AMBIX_MXCSR_FTZ_DAZ 0x8040
+#define AMBIX_FPCR_FZ (1<<24)
+
+void _ambix_denormals_disable(_ambix_fpstate_t*saved) {
+#if defined AMBIX_HAVE_MXCSR
+  const unsigned int csr=_mm_getcsr();
+  saved->state=csr;
+  _mm_setcsr(csr | AMBIX_MXCSR_FTZ_DAZ);
+#elif defined AMBIX_HAVE_FPCR
+  uint64_t fpcr;
+  __asm__ __volatile__("mrs %0, fpcr" : "=r"(fpcr));
+  saved->state=fpcr;
+  __asm__ __volatile__("msr fpcr, %0" : : "r"(fpcr | AMBIX_FPCR_FZ));
+#else
+  saved->state=0;
+#endif
+}
+void _ambix_denormals_restore(const _ambix_fpstate_t*saved) {
+#if defined AMBIX_HAVE_MXCSR
+  _mm_setcsr((unsigned int)saved->state);
+#elif defined AMBIX_HAVE_FPCR
+  __asm__ __volatile__("msr fpcr, %0" : : "r"(saved->state));
+#endif
+}
+
+const _ambix_kernels_t*_ambix_get_kernels(void) {
+  /* the detection is idempotent, so concurrent first calls are harmless */
+  static const _ambix_kernels_t* volatile s_kernels = NULL;
+  const _ambix_kernels_t*kernels=s_kernels;
+  if(!kernels) {
+    static const _ambix_simd_t preferred[] = {
+      AMBIX_SIMD_AVX512,
+      AMBIX_SIMD_AVX2,
+      AMBIX_SIMD_NEON,
+      AMBIX_SIMD_SSE2,
+    };
+    unsigned int i;
+    kernels=&s_kernels_scalar;
+    for(i=0; i<sizeof(preferred)/sizeof(*preferred); i++) {
+      const _ambix_kernels_t*k=_ambix_get_kernels_simd(preferred[i]);
+      if(k) {
+        kernels=k;
+        break;
+      }
+    }
+    s_kernels=kernels;
+  }
+  return kernels;
+}
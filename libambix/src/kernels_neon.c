@@ -0,0 +1,184 @@
+/* kernels_neon.c -  NEON matrix kernels              -*- c -*-
+
+   Copyright © 2026 IOhannes m zmölnig <zmoelnig@iem.at>.
+         Institute of Electronic Music and Acoustics (IEM),
+         University of Music and Dramatic Arts, Graz
+
+   This file is part of libambix
+
+   libambix is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   libambix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+ * NEON is part of the AArch64 baseline, so there is nothing to detect at
+ * runtime: if we are compiled for aarch64, the kernels are always available.
+ * (32bit ARM is left to the scalar kernels)
+ * see kernels_x86.c for a description of the kernel layout.
+ */
+
+#include "private.h"
+
+#ifdef HAVE_STDLIB_H
+# include <stdlib.h>
+#endif /* HAVE_STDLIB_H */
+
+#if defined ENABLE_SIMD && defined __aarch64__
+
+#include <arm_neon.h>
+
+static AMBIX_ALWAYS_INLINE void
+mtxmul_float32_neon_body(float32_t*dest, uint32_t deststride,
+                         const float32_t*mtx, uint32_t rows, uint32_t cols,
+                         const float32_t*source, uint32_t sourcestride,
+                         int64_t frames) {
+  int64_t f;
+  for(f=0; f<frames; f++) {
+    const float32_t*src=source+f*sourcestride;
+    float32_t*dst=dest+f*deststride;
+    uint32_t o=0;
+    for(; o+4<=rows; o+=4) {
+      const float32_t*m0=mtx+(size_t)o*cols, *m1=m0+cols, *m2=m1+cols, *m3=m2+cols;
+      float32x4_t a0=vdupq_n_f32(0.f), a1=vdupq_n_f32(0.f), a2=vdupq_n_f32(0.f), a3=vdupq_n_f32(0.f);
+      float32x4_t sum;
+      uint32_t i=0;
+      for(; i+4<=cols; i+=4) {
+        const float32x4_t x=vld1q_f32(src+i);
+        a0=vfmaq_f32(a0, vld1q_f32(m0+i), x);
+        a1=vfmaq_f32(a1, vld1q_f32(m1+i), x);
+        a2=vfmaq_f32(a2, vld1q_f32(m2+i), x);
+        a3=vfmaq_f32(a3, vld1q_f32(m3+i), x);
+      }
+      /* [sum(a0), sum(a1), sum(a2), sum(a3)] */
+      sum=vpaddq_f32(vpaddq_f32(a0, a1), vpaddq_f32(a2, a3));
+      for(; i<cols; i++) {
+        const float32_t col[4]={m0[i], m1[i], m2[i], m3[i]};
+        sum=vfmaq_n_f32(sum, vld1q_f32(col), src[i]);
+      }
+      vst1q_f32(dst+o, sum);
+    }
+    for(; o<rows; o++) {
+      const float32_t*m0=mtx+(size_t)o*cols;
+      float32x4_t a0=vdupq_n_f32(0.f);
+      float32_t sum;
+      uint32_t i=0;
+      for(; i+4<=cols; i+=4)
+        a0=vfmaq_f32(a0, vld1q_f32(m0+i), vld1q_f32(src+i));
+      sum=vaddvq_f32(a0);
+      for(; i<cols; i++)
+        sum+=m0[i]*src[i];
+      dst[o]=sum;
+    }
+  }
+}
+_AMBIX_MTXKERNEL_SPECIALISE_FLOAT32(static, mtxmul_float32_neon, mtxmul_float32_neon_body)
+
+static AMBIX_ALWAYS_INLINE void
+mtxmul_float32_acc64_neon_body(float32_t*dest, uint32_t deststride,
+                               const float32_t*mtx, uint32_t rows, uint32_t cols,
+                               const float32_t*source, uint32_t sourcestride,
+                               int64_t frames) {
+  int64_t f;
+  for(f=0; f<frames; f++) {
+    const float32_t*src=source+f*sourcestride;
+    float32_t*dst=dest+f*deststride;
+    uint32_t o=0;
+    for(; o+2<=rows; o+=2) {
+      const float32_t*m0=mtx+(size_t)o*cols, *m1=m0+cols;
+      float64x2_t a0=vdupq_n_f64(0.), a1=vdupq_n_f64(0.);
+      float64x2_t sum;
+      uint32_t i=0;
+      for(; i+2<=cols; i+=2) {
+        const float64x2_t x=vcvt_f64_f32(vld1_f32(src+i));
+        a0=vfmaq_f64(a0, vcvt_f64_f32(vld1_f32(m0+i)), x);
+        a1=vfmaq_f64(a1, vcvt_f64_f32(vld1_f32(m1+i)), x);
+      }
+      /* [sum(a0), sum(a1)] */
+      sum=vpaddq_f64(a0, a1);
+      if(i<cols) {
+        const float64_t col[2]={m0[i], m1[i]};
+        sum=vfmaq_n_f64(sum, vld1q_f64(col), src[i]);
+      }
+      vst1_f32(dst+o, vcvt_f32_f64(sum));
+    }
+    for(; o<rows; o++) {
+      const float32_t*m0=mtx+(size_t)o*cols;
+      double sum=0.;
+      uint32_t i;
+      for(i=0; i<cols; i++)
+        sum+=(double)m0[i]*(double)src[i];
+      dst[o]=(float32_t)sum;
+    }
+  }
+}
+_AMBIX_MTXKERNEL_SPECIALISE_FLOAT32(static, mtxmul_float32_acc64_neon, mtxmul_float32_acc64_neon_body)
+
+/* fixed-point: widening multiply-accumulate (32x32->64) of 4 samples at once */
+#define AMBIX_LOAD4_int32(p) vld1q_s32(p)
+#define AMBIX_LOAD4_int16(p) vmovl_s16(vld1_s16(p))
+#define AMBIX_MTXMUL_FIXED_NEON(typ)                                    \
+  static AMBIX_ALWAYS_INLINE void                                       \
+  mtxmul_##typ##_neon_body(typ##_t*dest, uint32_t deststride,           \
+                           const int32_t*mtx, uint32_t rows, uint32_t cols, uint32_t shift, \
+                           const typ##_t*source, uint32_t sourcestride, \
+                           int64_t frames) {                            \
+    int64_t f;                                                          \
+    for(f=0; f<frames; f++) {                                           \
+      const typ##_t*src=source+f*sourcestride;                          \
+      typ##_t*dst=dest+f*deststride;                                    \
+      uint32_t o;                                                       \
+      for(o=0; o<rows; o++) {                                           \
+        const int32_t*m0=mtx+(size_t)o*cols;                            \
+        int64x2_t a0=vdupq_n_s64(0);                                    \
+        int64_t sum;                                                    \
+        uint32_t i=0;                                                   \
+        for(; i+4<=cols; i+=4) {                                        \
+          const int32x4_t x=AMBIX_LOAD4_##typ(src+i);                   \
+          const int32x4_t m=vld1q_s32(m0+i);                            \
+          a0=vmlal_s32(a0, vget_low_s32(m), vget_low_s32(x));           \
+          a0=vmlal_high_s32(a0, m, x);                                  \
+        }                                                               \
+        sum=vaddvq_s64(a0);                                             \
+        for(; i<cols; i++)                                              \
+          sum+=(int64_t)m0[i]*src[i];                                   \
+        dst[o]=_ambix_fixed_to_##typ(sum, shift);                       \
+      }                                                                 \
+    }                                                                   \
+  }                                                                     \
+  _AMBIX_MTXKERNEL_SPECIALISE_FIXED(static, typ, mtxmul_##typ##_neon, mtxmul_##typ##_neon_body)
+AMBIX_MTXMUL_FIXED_NEON(int16)
+AMBIX_MTXMUL_FIXED_NEON(int32)
+#undef AMBIX_MTXMUL_FIXED_NEON
+#undef AMBIX_LOAD4_int16
+#undef AMBIX_LOAD4_int32
+
+static const _ambix_kernels_t s_kernels_neon = {
+  AMBIX_SIMD_NEON,
+  mtxmul_float32_neon,
+  mtxmul_float32_acc64_neon,
+  mtxmul_int16_neon,
+  mtxmul_int32_neon,
+};
+
+const _ambix_kernels_t*_ambix_get_kernels_neon(void) {
+  return &s_kernels_neon;
+}
+
+#elif defined ENABLE_SIMD
+
+const _ambix_kernels_t*_ambix_get_kernels_neon(void) {
+  return NULL;
+}
+
+#endif /* ENABLE_SIMD */
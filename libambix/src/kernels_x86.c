@@ -0,0 +1,550 @@
+/* kernels_x86.c -  SSE2/AVX2/AVX-512 matrix kernels              -*- c -*-
+
+   Copyright © 2026 IOhannes m zmölnig <zmoelnig@iem.at>.
+         Institute of Electronic Music and Acoustics (IEM),
+         University of Music and Dramatic Arts, Graz
+
+   This file is part of libambix
+
+   libambix is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   libambix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+ * the kernels compute dest[f][o] = sum_i(mtx[o][i] * source[f][i])
+ * for each frame, 4 output channels are calculated at once, so each source
+ * vector is loaded once for 4 matrix rows; the 4 partial sums are then
+ * reduced horizontally and stored with a single 4-float write.
+ *
+ * each instruction set lives in its own target()-annotated functions, so the
+ * library itself can be compiled for the baseline architecture and the best
+ * kernel is picked at runtime.
+ */
+
+#include "private.h"
+
+#ifdef HAVE_STDLIB_H
+# include <stdlib.h>
+#endif /* HAVE_STDLIB_H */
+
+#if defined ENABLE_SIMD && defined __GNUC__ && (defined __x86_64__ || defined __i386__)
+
+#include <immintrin.h>
+
+#define AMBIX_TARGET(x) __attribute__((target(x)))
+
+/* ------------------------------ SSE2 ------------------------------ */
+
+/* [sum(a0), sum(a1), sum(a2), sum(a3)] */
+AMBIX_TARGET("sse2") static inline __m128 hsum4_sse2(__m128 a0, __m128 a1, __m128 a2, __m128 a3) {
+  _MM_TRANSPOSE4_PS(a0, a1, a2, a3);
+  return _mm_add_ps(_mm_add_ps(a0, a1), _mm_add_ps(a2, a3));
+}
+AMBIX_TARGET("sse2") static inline float32_t hsum_sse2(__m128 a) {
+  float32_t result[4];
+  _mm_storeu_ps(result, a);
+  return (result[0]+result[1])+(result[2]+result[3]);
+}
+/* load 2 floats and widen them to doubles */
+AMBIX_TARGET("sse2") static inline __m128d load2_pd_sse2(const float32_t*p) {
+  return _mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64((const __m128i*)p)));
+}
+
+AMBIX_TARGET("sse2") static AMBIX_ALWAYS_INLINE void
+mtxmul_float32_sse2_body(float32_t*dest, uint32_t deststride,
+                         const float32_t*mtx, uint32_t rows, uint32_t cols,
+                         const float32_t*source, uint32_t sourcestride,
+                         int64_t frames) {
+  int64_t f;
+  for(f=0; f<frames; f++) {
+    const float32_t*src=source+f*sourcestride;
+    float32_t*dst=dest+f*deststride;
+    uint32_t o=0;
+    for(; o+4<=rows; o+=4) {
+      const float32_t*m0=mtx+(size_t)o*cols, *m1=m0+cols, *m2=m1+cols, *m3=m2+cols;
+      __m128 a0=_mm_setzero_ps(), a1=_mm_setzero_ps(), a2=_mm_setzero_ps(), a3=_mm_setzero_ps();
+      __m128 sum;
+      uint32_t i=0;
+      for(; i+4<=cols; i+=4) {
+        const __m128 x=_mm_loadu_ps(src+i);
+        a0=_mm_add_ps(a0, _mm_mul_ps(_mm_loadu_ps(m0+i), x));
+        a1=_mm_add_ps(a1, _mm_mul_ps(_mm_loadu_ps(m1+i), x));
+        a2=_mm_add_ps(a2, _mm_mul_ps(_mm_loadu_ps(m2+i), x));
+        a3=_mm_add_ps(a3, _mm_mul_ps(_mm_loadu_ps(m3+i), x));
+      }
+      sum=hsum4_sse2(a0, a1, a2, a3);
+      for(; i<cols; i++) {
+        const __m128 x=_mm_set1_ps(src[i]);
+        sum=_mm_add_ps(sum, _mm_mul_ps(_mm_setr_ps(m0[i], m1[i], m2[i], m3[i]), x));
+      }
+      _mm_storeu_ps(dst+o, sum);
+    }
+    for(; o<rows; o++) {
+      const float32_t*m0=mtx+(size_t)o*cols;
+      __m128 a0=_mm_setzero_ps();
+      float32_t sum;
+      uint32_t i=0;
+      for(; i+4<=cols; i+=4)
+        a0=_mm_add_ps(a0, _mm_mul_ps(_mm_loadu_ps(m0+i), _mm_loadu_ps(src+i)));
+      sum=hsum_sse2(a0);
+      for(; i<cols; i++)
+        sum+=m0[i]*src[i];
+      dst[o]=sum;
+    }
+  }
+}
+_AMBIX_MTXKERNEL_SPECIALISE_FLOAT32(AMBIX_TARGET("sse2") static, mtxmul_float32_sse2, mtxmul_float32_sse2_body)
+
+AMBIX_TARGET("sse2") static AMBIX_ALWAYS_INLINE void
+mtxmul_float32_acc64_sse2_body(float32_t*dest, uint32_t deststride,
+                               const float32_t*mtx, uint32_t rows, uint32_t cols,
+                               const float32_t*source, uint32_t sourcestride,
+                               int64_t frames) {
+  int64_t f;
+  for(f=0; f<frames; f++) {
+    const float32_t*src=source+f*sourcestride;
+    float32_t*dst=dest+f*deststride;
+    uint32_t o=0;
+    for(; o+4<=rows; o+=4) {
+      const float32_t*m0=mtx+(size_t)o*cols, *m1=m0+cols, *m2=m1+cols, *m3=m2+cols;
+      __m128d a0=_mm_setzero_pd(), a1=_mm_setzero_pd(), a2=_mm_setzero_pd(), a3=_mm_setzero_pd();
+      __m128d s01, s23;
+      uint32_t i=0;
+      for(; i+2<=cols; i+=2) {
+        const __m128d x=load2_pd_sse2(src+i);
+        a0=_mm_add_pd(a0, _mm_mul_pd(load2_pd_sse2(m0+i), x));
+        a1=_mm_add_pd(a1, _mm_mul_pd(load2_pd_sse2(m1+i), x));
+        a2=_mm_add_pd(a2, _mm_mul_pd(load2_pd_sse2(m2+i), x));
+        a3=_mm_add_pd(a3, _mm_mul_pd(load2_pd_sse2(m3+i), x));
+      }
+      s01=_mm_add_pd(_mm_unpacklo_pd(a0, a1), _mm_unpackhi_pd(a0, a1));
+      s23=_mm_add_pd(_mm_unpacklo_pd(a2, a3), _mm_unpackhi_pd(a2, a3));
+      if(i<cols) {
+        const __m128d x=_mm_set1_pd(src[i]);
+        s01=_mm_add_pd(s01, _mm_mul_pd(_mm_setr_pd(m0[i], m1[i]), x));
+        s23=_mm_add_pd(s23, _mm_mul_pd(_mm_setr_pd(m2[i], m3[i]), x));
+      }
+      _mm_storeu_ps(dst+o, _mm_movelh_ps(_mm_cvtpd_ps(s01), _mm_cvtpd_ps(s23)));
+    }
+    for(; o<rows; o++) {
+      const float32_t*m0=mtx+(size_t)o*cols;
+      double sum=0.;
+      uint32_t i;
+      for(i=0; i<cols; i++)
+        sum+=(double)m0[i]*(double)src[i];
+      dst[o]=(float32_t)sum;
+    }
+  }
+}
+_AMBIX_MTXKERNEL_SPECIALISE_FLOAT32(AMBIX_TARGET("sse2") static, mtxmul_float32_acc64_sse2, mtxmul_float32_acc64_sse2_body)
+
+/* SSE2 has no signed 32x32->64 multiplication, so the fixed-point kernels are scalar */
+static const _ambix_kernels_t s_kernels_sse2 = {
+  AMBIX_SIMD_SSE2,
+  mtxmul_float32_sse2,
+  mtxmul_float32_acc64_sse2,
+  _ambix_mtxmul_int16_scalar,
+  _ambix_mtxmul_int32_scalar,
+};
+
+/* ------------------------------ AVX2 ------------------------------ */
+
+#define AMBIX_TARGET_AVX2 AMBIX_TARGET("avx2,fma")
+
+AMBIX_TARGET_AVX2 static inline __m128 hsum4_avx2(__m256 a0, __m256 a1, __m256 a2, __m256 a3) {
+  /* fold the upper halves onto the lower ones, then reduce horizontally */
+  const __m128 b0=_mm_add_ps(_mm256_castps256_ps128(a0), _mm256_extractf128_ps(a0, 1));
+  const __m128 b1=_mm_add_ps(_mm256_castps256_ps128(a1), _mm256_extractf128_ps(a1, 1));
+  const __m128 b2=_mm_add_ps(_mm256_castps256_ps128(a2), _mm256_extractf128_ps(a2, 1));
+  const __m128 b3=_mm_add_ps(_mm256_castps256_ps128(a3), _mm256_extractf128_ps(a3, 1));
+  return _mm_hadd_ps(_mm_hadd_ps(b0, b1), _mm_hadd_ps(b2, b3));
+}
+/* [sum(a0), sum(a1), sum(a2), sum(a3)] */
+AMBIX_TARGET_AVX2 static inline __m256d hsum4_pd_avx2(__m256d a0, __m256d a1, __m256d a2, __m256d a3) {
+  const __m256d t0=_mm256_hadd_pd(a0, a1);
+  const __m256d t1=_mm256_hadd_pd(a2, a3);
+  return _mm256_add_pd(_mm256_permute2f128_pd(t0, t1, 0x21), _mm256_blend_pd(t0, t1, 0xC));
+}
+
+AMBIX_TARGET_AVX2 static AMBIX_ALWAYS_INLINE void
+mtxmul_float32_avx2_body(float32_t*dest, uint32_t deststride,
+                         const float32_t*mtx, uint32_t rows, uint32_t cols,
+                         const float32_t*source, uint32_t sourcestride,
+                         int64_t frames) {
+  int64_t f;
+  for(f=0; f<frames; f++) {
+    const float32_t*src=source+f*sourcestride;
+    float32_t*dst=dest+f*deststride;
+    uint32_t o=0;
+    for(; o+4<=rows; o+=4) {
+      const float32_t*m0=mtx+(size_t)o*cols, *m1=m0+cols, *m2=m1+cols, *m3=m2+cols;
+      __m256 a0=_mm256_setzero_ps(), a1=_mm256_setzero_ps(), a2=_mm256_setzero_ps(), a3=_mm256_setzero_ps();
+      __m128 sum;
+      uint32_t i=0;
+      for(; i+8<=cols; i+=8) {
+        const __m256 x=_mm256_loadu_ps(src+i);
+        a0=_mm256_fmadd_ps(_mm256_loadu_ps(m0+i), x, a0);
+        a1=_mm256_fmadd_ps(_mm256_loadu_ps(m1+i), x, a1);
+        a2=_mm256_fmadd_ps(_mm256_loadu_ps(m2+i), x, a2);
+        a3=_mm256_fmadd_ps(_mm256_loadu_ps(m3+i), x, a3);
+      }
+      if(i+4<=cols) {
+        /* a 4-channel step (e.g. 1st order) in the lower lanes */
+        const __m256 zero=_mm256_setzero_ps();
+#define AMBIX_LOAD4(m) _mm256_insertf128_ps(zero, _mm_loadu_ps(m+i), 0)
+        const __m256 x=AMBIX_LOAD4(src);
+        a0=_mm256_fmadd_ps(AMBIX_LOAD4(m0), x, a0);
+        a1=_mm256_fmadd_ps(AMBIX_LOAD4(m1), x, a1);
+        a2=_mm256_fmadd_ps(AMBIX_LOAD4(m2), x, a2);
+        a3=_mm256_fmadd_ps(AMBIX_LOAD4(m3), x, a3);
+#undef AMBIX_LOAD4
+        i+=4;
+      }
+      sum=hsum4_avx2(a0, a1, a2, a3);
+      for(; i<cols; i++)
+        sum=_mm_fmadd_ps(_mm_setr_ps(m0[i], m1[i], m2[i], m3[i]), _mm_set1_ps(src[i]), sum);
+      _mm_storeu_ps(dst+o, sum);
+    }
+    for(; o<rows; o++) {
+      const float32_t*m0=mtx+(size_t)o*cols;
+      __m256 a0=_mm256_setzero_ps();
+      float32_t sum;
+      uint32_t i=0;
+      for(; i+8<=cols; i+=8)
+        a0=_mm256_fmadd_ps(_mm256_loadu_ps(m0+i), _mm256_loadu_ps(src+i), a0);
+      sum=hsum_sse2(_mm_add_ps(_mm256_castps256_ps128(a0), _mm256_extractf128_ps(a0, 1)));
+      for(; i<cols; i++)
+        sum+=m0[i]*src[i];
+      dst[o]=sum;
+    }
+  }
+}
+_AMBIX_MTXKERNEL_SPECIALISE_FLOAT32(AMBIX_TARGET_AVX2 static, mtxmul_float32_avx2, mtxmul_float32_avx2_body)
+
+AMBIX_TARGET_AVX2 static AMBIX_ALWAYS_INLINE void
+mtxmul_float32_acc64_avx2_body(float32_t*dest, uint32_t deststride,
+                               const float32_t*mtx, uint32_t rows, uint32_t cols,
+                               const float32_t*source, uint32_t sourcestride,
+                               int64_t frames) {
+  int64_t f;
+  for(f=0; f<frames; f++) {
+    const float32_t*src=source+f*sourcestride;
+    float32_t*dst=dest+f*deststride;
+    uint32_t o=0;
+    for(; o+4<=rows; o+=4) {
+      const float32_t*m0=mtx+(size_t)o*cols, *m1=m0+cols, *m2=m1+cols, *m3=m2+cols;
+      __m256d a0=_mm256_setzero_pd(), a1=_mm256_setzero_pd(), a2=_mm256_setzero_pd(), a3=_mm256_setzero_pd();
+      __m256d sum;
+      uint32_t i=0;
+      for(; i+4<=cols; i+=4) {
+        const __m256d x=_mm256_cvtps_pd(_mm_loadu_ps(src+i));
+        a0=_mm256_fmadd_pd(_mm256_cvtps_pd(_mm_loadu_ps(m0+i)), x, a0);
+        a1=_mm256_fmadd_pd(_mm256_cvtps_pd(_mm_loadu_ps(m1+i)), x, a1);
+        a2=_mm256_fmadd_pd(_mm256_cvtps_pd(_mm_loadu_ps(m2+i)), x, a2);
+        a3=_mm256_fmadd_pd(_mm256_cvtps_pd(_mm_loadu_ps(m3+i)), x, a3);
+      }
+      sum=hsum4_pd_avx2(a0, a1, a2, a3);
+      for(; i<cols; i++)
+        sum=_mm256_fmadd_pd(_mm256_setr_pd(m0[i], m1[i], m2[i], m3[i]), _mm256_set1_pd(src[i]), sum);
+      _mm_storeu_ps(dst+o, _mm256_cvtpd_ps(sum));
+    }
+    for(; o<rows; o++) {
+      const float32_t*m0=mtx+(size_t)o*cols;
+      double sum=0.;
+      uint32_t i;
+      for(i=0; i<cols; i++)
+        sum+=(double)m0[i]*(double)src[i];
+      dst[o]=(float32_t)sum;
+    }
+  }
+}
+_AMBIX_MTXKERNEL_SPECIALISE_FLOAT32(AMBIX_TARGET_AVX2 static, mtxmul_float32_acc64_avx2, mtxmul_float32_acc64_avx2_body)
+
+/* fixed-point: samples and coefficients are widened to 64bit lanes,
+ * multiplied with _mm256_mul_epi32 (signed 32x32->64) and accumulated in 64bit
+ */
+AMBIX_TARGET("avx2") static inline int64_t hsum_epi64_avx2(__m256i a) {
+  int64_t result[4];
+  _mm256_storeu_si256((__m256i*)result, a);
+  return (result[0]+result[1])+(result[2]+result[3]);
+}
+#define AMBIX_LOAD4_int32(p) _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i*)(p)))
+#define AMBIX_LOAD4_int16(p) _mm256_cvtepi32_epi64(_mm_cvtepi16_epi32(_mm_loadl_epi64((const __m128i*)(p))))
+#define AMBIX_MTXMUL_FIXED_AVX2(typ)                                    \
+  AMBIX_TARGET("avx2") static AMBIX_ALWAYS_INLINE void                  \
+  mtxmul_##typ##_avx2_body(typ##_t*dest, uint32_t deststride,           \
+                           const int32_t*mtx, uint32_t rows, uint32_t cols, uint32_t shift, \
+                           const typ##_t*source, uint32_t sourcestride, \
+                           int64_t frames) {                            \
+    int64_t f;                                                          \
+    for(f=0; f<frames; f++) {                                           \
+      const typ##_t*src=source+f*sourcestride;                          \
+      typ##_t*dst=dest+f*deststride;                                    \
+      uint32_t o=0;                                                     \
+      for(; o+4<=rows; o+=4) {                                          \
+        const int32_t*m0=mtx+(size_t)o*cols, *m1=m0+cols, *m2=m1+cols, *m3=m2+cols; \
+        __m256i a0=_mm256_setzero_si256(), a1=_mm256_setzero_si256(), a2=_mm256_setzero_si256(), a3=_mm256_setzero_si256(); \
+        int64_t s0, s1, s2, s3;                                         \
+        uint32_t i=0;                                                   \
+        for(; i+4<=cols; i+=4) {                                        \
+          const __m256i x=AMBIX_LOAD4_##typ(src+i);                     \
+          a0=_mm256_add_epi64(a0, _mm256_mul_epi32(AMBIX_LOAD4_int32(m0+i), x)); \
+          a1=_mm256_add_epi64(a1, _mm256_mul_epi32(AMBIX_LOAD4_int32(m1+i), x)); \
+          a2=_mm256_add_epi64(a2, _mm256_mul_epi32(AMBIX_LOAD4_int32(m2+i), x)); \
+          a3=_mm256_add_epi64(a3, _mm256_mul_epi32(AMBIX_LOAD4_int32(m3+i), x)); \
+        }                                                               \
+        s0=hsum_epi64_avx2(a0); s1=hsum_epi64_avx2(a1);                 \
+        s2=hsum_epi64_avx2(a2); s3=hsum_epi64_avx2(a3);                 \
+        for(; i<cols; i++) {                                            \
+          s0+=(int64_t)m0[i]*src[i]; s1+=(int64_t)m1[i]*src[i];         \
+          s2+=(int64_t)m2[i]*src[i]; s3+=(int64_t)m3[i]*src[i];         \
+        }                                                               \
+        dst[o+0]=_ambix_fixed_to_##typ(s0, shift);                      \
+        dst[o+1]=_ambix_fixed_to_##typ(s1, shift);                      \
+        dst[o+2]=_ambix_fixed_to_##typ(s2, shift);                      \
+        dst[o+3]=_ambix_fixed_to_##typ(s3, shift);                      \
+      }                                                                 \
+      for(; o<rows; o++) {                                              \
+        const int32_t*m0=mtx+(size_t)o*cols;                            \
+        __m256i a0=_mm256_setzero_si256();                              \
+        int64_t s0;                                                     \
+        uint32_t i=0;                                                   \
+        for(; i+4<=cols; i+=4)                                          \
+          a0=_mm256_add_epi64(a0, _mm256_mul_epi32(AMBIX_LOAD4_int32(m0+i), AMBIX_LOAD4_##typ(src+i))); \
+        s0=hsum_epi64_avx2(a0);                                         \
+        for(; i<cols; i++)                                              \
+          s0+=(int64_t)m0[i]*src[i];                                    \
+        dst[o]=_ambix_fixed_to_##typ(s0, shift);                        \
+      }                                                                 \
+    }                                                                   \
+  }                                                                     \
+  _AMBIX_MTXKERNEL_SPECIALISE_FIXED(AMBIX_TARGET("avx2") static, typ,   \
+                                    mtxmul_##typ##_avx2, mtxmul_##typ##_avx2_body)
+AMBIX_MTXMUL_FIXED_AVX2(int16)
+AMBIX_MTXMUL_FIXED_AVX2(int32)
+#undef AMBIX_MTXMUL_FIXED_AVX2
+#undef AMBIX_LOAD4_int16
+#undef AMBIX_LOAD4_int32
+
+static const _ambix_kernels_t s_kernels_avx2 = {
+  AMBIX_SIMD_AVX2,
+  mtxmul_float32_avx2,
+  mtxmul_float32_acc64_avx2,
+  mtxmul_int16_avx2,
+  mtxmul_int32_avx2,
+};
+
+/* ----------------------------- AVX-512 ----------------------------- */
+
+#define AMBIX_TARGET_AVX512 AMBIX_TARGET("avx512f,avx2,fma")
+
+AMBIX_TARGET_AVX512 static AMBIX_ALWAYS_INLINE void
+mtxmul_float32_avx512_body(float32_t*dest, uint32_t deststride,
+                           const float32_t*mtx, uint32_t rows, uint32_t cols,
+                           const float32_t*source, uint32_t sourcestride,
+                           int64_t frames) {
+  /* the remaining (cols%16) channels are handled with a masked load */
+  const __mmask16 tailmask=(__mmask16)((1u<<(cols%16))-1);
+  const uint32_t fullcols=cols-(cols%16);
+  int64_t f;
+  for(f=0; f<frames; f++) {
+    const float32_t*src=source+f*sourcestride;
+    float32_t*dst=dest+f*deststride;
+    const __m512 xtail=_mm512_maskz_loadu_ps(tailmask, src+fullcols);
+    uint32_t o=0;
+    for(; o+4<=rows; o+=4) {
+      const float32_t*m0=mtx+(size_t)o*cols, *m1=m0+cols, *m2=m1+cols, *m3=m2+cols;
+      __m512 a0=_mm512_setzero_ps(), a1=_mm512_setzero_ps(), a2=_mm512_setzero_ps(), a3=_mm512_setzero_ps();
+      uint32_t i=0;
+      for(; i<fullcols; i+=16) {
+        const __m512 x=_mm512_loadu_ps(src+i);
+        a0=_mm512_fmadd_ps(_mm512_loadu_ps(m0+i), x, a0);
+        a1=_mm512_fmadd_ps(_mm512_loadu_ps(m1+i), x, a1);
+        a2=_mm512_fmadd_ps(_mm512_loadu_ps(m2+i), x, a2);
+        a3=_mm512_fmadd_ps(_mm512_loadu_ps(m3+i), x, a3);
+      }
+      if(tailmask) {
+        a0=_mm512_fmadd_ps(_mm512_maskz_loadu_ps(tailmask, m0+i), xtail, a0);
+        a1=_mm512_fmadd_ps(_mm512_maskz_loadu_ps(tailmask, m1+i), xtail, a1);
+        a2=_mm512_fmadd_ps(_mm512_maskz_loadu_ps(tailmask, m2+i), xtail, a2);
+        a3=_mm512_fmadd_ps(_mm512_maskz_loadu_ps(tailmask, m3+i), xtail, a3);
+      }
+      dst[o+0]=_mm512_reduce_add_ps(a0);
+      dst[o+1]=_mm512_reduce_add_ps(a1);
+      dst[o+2]=_mm512_reduce_add_ps(a2);
+      dst[o+3]=_mm512_reduce_add_ps(a3);
+    }
+    for(; o<rows; o++) {
+      const float32_t*m0=mtx+(size_t)o*cols;
+      __m512 a0=_mm512_setzero_ps();
+      uint32_t i=0;
+      for(; i<fullcols; i+=16)
+        a0=_mm512_fmadd_ps(_mm512_loadu_ps(m0+i), _mm512_loadu_ps(src+i), a0);
+      if(tailmask)
+        a0=_mm512_fmadd_ps(_mm512_maskz_loadu_ps(tailmask, m0+i), xtail, a0);
+      dst[o]=_mm512_reduce_add_ps(a0);
+    }
+  }
+}
+_AMBIX_MTXKERNEL_SPECIALISE_FLOAT32(AMBIX_TARGET_AVX512 static, mtxmul_float32_avx512, mtxmul_float32_avx512_body)
+
+AMBIX_TARGET_AVX512 static AMBIX_ALWAYS_INLINE void
+mtxmul_float32_acc64_avx512_body(float32_t*dest, uint32_t deststride,
+                                 const float32_t*mtx, uint32_t rows, uint32_t cols,
+                                 const float32_t*source, uint32_t sourcestride,
+                                 int64_t frames) {
+  const __mmask16 tailmask=(__mmask16)((1u<<(cols%8))-1);
+  const uint32_t fullcols=cols-(cols%8);
+#define AMBIX_LOAD8(p) _mm512_cvtps_pd(_mm256_loadu_ps(p))
+#define AMBIX_LOADTAIL(p) _mm512_cvtps_pd(_mm512_castps512_ps256(_mm512_maskz_loadu_ps(tailmask, p)))
+  int64_t f;
+  for(f=0; f<frames; f++) {
+    const float32_t*src=source+f*sourcestride;
+    float32_t*dst=dest+f*deststride;
+    const __m512d xtail=AMBIX_LOADTAIL(src+fullcols);
+    uint32_t o=0;
+    for(; o+4<=rows; o+=4) {
+      const float32_t*m0=mtx+(size_t)o*cols, *m1=m0+cols, *m2=m1+cols, *m3=m2+cols;
+      __m512d a0=_mm512_setzero_pd(), a1=_mm512_setzero_pd(), a2=_mm512_setzero_pd(), a3=_mm512_setzero_pd();
+      uint32_t i=0;
+      for(; i<fullcols; i+=8) {
+        const __m512d x=AMBIX_LOAD8(src+i);
+        a0=_mm512_fmadd_pd(AMBIX_LOAD8(m0+i), x, a0);
+        a1=_mm512_fmadd_pd(AMBIX_LOAD8(m1+i), x, a1);
+        a2=_mm512_fmadd_pd(AMBIX_LOAD8(m2+i), x, a2);
+        a3=_mm512_fmadd_pd(AMBIX_LOAD8(m3+i), x, a3);
+      }
+      if(tailmask) {
+        a0=_mm512_fmadd_pd(AMBIX_LOADTAIL(m0+i), xtail, a0);
+        a1=_mm512_fmadd_pd(AMBIX_LOADTAIL(m1+i), xtail, a1);
+        a2=_mm512_fmadd_pd(AMBIX_LOADTAIL(m2+i), xtail, a2);
+        a3=_mm512_fmadd_pd(AMBIX_LOADTAIL(m3+i), xtail, a3);
+      }
+      dst[o+0]=(float32_t)_mm512_reduce_add_pd(a0);
+      dst[o+1]=(float32_t)_mm512_reduce_add_pd(a1);
+      dst[o+2]=(float32_t)_mm512_reduce_add_pd(a2);
+      dst[o+3]=(float32_t)_mm512_reduce_add_pd(a3);
+    }
+    for(; o<rows; o++) {
+      const float32_t*m0=mtx+(size_t)o*cols;
+      __m512d a0=_mm512_setzero_pd();
+      uint32_t i=0;
+      for(; i<fullcols; i+=8)
+        a0=_mm512_fmadd_pd(AMBIX_LOAD8(m0+i), AMBIX_LOAD8(src+i), a0);
+      if(tailmask)
+        a0=_mm512_fmadd_pd(AMBIX_LOADTAIL(m0+i), xtail, a0);
+      dst[o]=(float32_t)_mm512_reduce_add_pd(a0);
+    }
+  }
+#undef AMBIX_LOAD8
+#undef AMBIX_LOADTAIL
+}
+_AMBIX_MTXKERNEL_SPECIALISE_FLOAT32(AMBIX_TARGET_AVX512 static, mtxmul_float32_acc64_avx512, mtxmul_float32_acc64_avx512_body)
+
+#define AMBIX_LOAD8_int32(p) _mm512_cvtepi32_epi64(_mm256_loadu_si256((const __m256i*)(p)))
+#define AMBIX_LOAD8_int16(p) _mm512_cvtepi16_epi64(_mm_loadu_si128((const __m128i*)(p)))
+#define AMBIX_MTXMUL_FIXED_AVX512(typ)                                  \
+  AMBIX_TARGET("avx512f,avx2") static AMBIX_ALWAYS_INLINE void          \
+  mtxmul_##typ##_avx512_body(typ##_t*dest, uint32_t deststride,         \
+                             const int32_t*mtx, uint32_t rows, uint32_t cols, uint32_t shift, \
+                             const typ##_t*source, uint32_t sourcestride, \
+                             int64_t frames) {                          \
+    int64_t f;                                                          \
+    for(f=0; f<frames; f++) {                                           \
+      const typ##_t*src=source+f*sourcestride;                          \
+      typ##_t*dst=dest+f*deststride;                                    \
+      uint32_t o=0;                                                     \
+      for(; o+4<=rows; o+=4) {                                          \
+        const int32_t*m0=mtx+(size_t)o*cols, *m1=m0+cols, *m2=m1+cols, *m3=m2+cols; \
+        __m512i a0=_mm512_setzero_si512(), a1=_mm512_setzero_si512(), a2=_mm512_setzero_si512(), a3=_mm512_setzero_si512(); \
+        int64_t s0, s1, s2, s3;                                         \
+        uint32_t i=0;                                                   \
+        for(; i+8<=cols; i+=8) {                                        \
+          const __m512i x=AMBIX_LOAD8_##typ(src+i);                     \
+          a0=_mm512_add_epi64(a0, _mm512_mul_epi32(AMBIX_LOAD8_int32(m0+i), x)); \
+          a1=_mm512_add_epi64(a1, _mm512_mul_epi32(AMBIX_LOAD8_int32(m1+i), x)); \
+          a2=_mm512_add_epi64(a2, _mm512_mul_epi32(AMBIX_LOAD8_int32(m2+i), x)); \
+          a3=_mm512_add_epi64(a3, _mm512_mul_epi32(AMBIX_LOAD8_int32(m3+i), x)); \
+        }                                                               \
+        s0=_mm512_reduce_add_epi64(a0); s1=_mm512_reduce_add_epi64(a1); \
+        s2=_mm512_reduce_add_epi64(a2); s3=_mm512_reduce_add_epi64(a3); \
+        for(; i<cols; i++) {                                            \
+          s0+=(int64_t)m0[i]*src[i]; s1+=(int64_t)m1[i]*src[i];         \
+          s2+=(int64_t)m2[i]*src[i]; s3+=(int64_t)m3[i]*src[i];         \
+        }                                                               \
+        dst[o+0]=_ambix_fixed_to_##typ(s0, shift);                      \
+        dst[o+1]=_ambix_fixed_to_##typ(s1, shift);                      \
+        dst[o+2]=_ambix_fixed_to_##typ(s2, shift);                      \
+        dst[o+3]=_ambix_fixed_to_##typ(s3, shift);                      \
+      }                                                                 \
+      for(; o<rows; o++) {                                              \
+        const int32_t*m0=mtx+(size_t)o*cols;                            \
+        __m512i a0=_mm512_setzero_si512();                              \
+        int64_t s0;                                                     \
+        uint32_t i=0;                                                   \
+        for(; i+8<=cols; i+=8)                                          \
+          a0=_mm512_add_epi64(a0, _mm512_mul_epi32(AMBIX_LOAD8_int32(m0+i), AMBIX_LOAD8_##typ(src+i))); \
+        s0=_mm512_reduce_add_epi64(a0);                                 \
+        for(; i<cols; i++)                                              \
+          s0+=(int64_t)m0[i]*src[i];                                    \
+        dst[o]=_ambix_fixed_to_##typ(s0, shift);                        \
+      }                                                                 \
+    }                                                                   \
+  }                                                                     \
+  _AMBIX_MTXKERNEL_SPECIALISE_FIXED(AMBIX_TARGET("avx512f,avx2") static, typ, \
+                                    mtxmul_##typ##_avx512, mtxmul_##typ##_avx512_body)
+AMBIX_MTXMUL_FIXED_AVX512(int16)
+AMBIX_MTXMUL_FIXED_AVX512(int32)
+#undef AMBIX_MTXMUL_FIXED_AVX512
+#undef AMBIX_LOAD8_int16
+#undef AMBIX_LOAD8_int32
+
+static const _ambix_kernels_t s_kernels_avx512 = {
+  AMBIX_SIMD_AVX512,
+  mtxmul_float32_avx512,
+  mtxmul_float32_acc64_avx512,
+  mtxmul_int16_avx512,
+  mtxmul_int32_avx512,
+};
+
+/* ---------------------------- dispatch ---------------------------- */
+
+const _ambix_kernels_t*_ambix_get_kernels_x86(_ambix_simd_t simd) {
+  __builtin_cpu_init();
+  switch(simd) {
+  case AMBIX_SIMD_SSE2:
+    if(__builtin_cpu_supports("sse2"))
+      return &s_kernels_sse2;
+    break;
+  case AMBIX_SIMD_AVX2:
+    if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+      return &s_kernels_avx2;
+    break;
+  case AMBIX_SIMD_AVX512:
+    if(__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+      return &s_kernels_avx512;
+    break;
+  default:
+    break;
+  }
+  return NULL;
+}
+
+#elif defined ENABLE_SIMD
+
+const _ambix_kernels_t*_ambix_get_kernels_x86(_ambix_simd_t simd) {
+  return NULL;
+}
+
+#endif /* ENABLE_SIMD */
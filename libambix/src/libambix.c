@@ -76,18 +76,101 @@ static void _ambix_info_set(ambix_t*ambix
   ambix->ambisonics_order=(fullambichannels>0)?ambix_channels2order(fullambichannels):0;
 }
 
-ambix_t*        ambix_open      (const char *path, const ambix_filemode_t mode, ambix_info_t*ambixinfo) {
+/* parse the markers/regions/strings chunks (on first use) */
+static void _ambix_load_markersregions(ambix_t*ambix) {
+  if(!ambix->pendingMarkers)
+    return;
+  /* reading adds the markers via ambix_add_marker() */
+  ambix->pendingMarkers=0;
+  _ambix_read_markersregions(ambix);
+}
+
+/* the 'uuid' chunk id (in the byte order the backends expect) */
+static uint32_t _ambix_uuid_id(void) {
+  const char id[4]={'u', 'u', 'i', 'd'};
+  uint32_t result;
+  memcpy(&result, id, 4);
+  return result;
+}
+
+/* read the keyframes of the adaptor matrix (if there are any) */
+static void _ambix_load_timeline(ambix_t*ambix) {
+  uint32_t i;
+  for(i=0; !ambix->timeline; i++) {
+    int64_t datasize=0;
+    char*data=(char*)_ambix_read_chunk(ambix, _ambix_uuid_id(), i, &datasize);
+    if(!data)
+      break;
+    if(datasize>16 && 2==_ambix_checkUUID(data))
+      ambix->timeline=_ambix_uuid2_to_timeline(data+16, datasize-16, &ambix->matrix, ambix->byteswap);
+    free(data);
+  }
+}
+
+/* store the keyframes of the adaptor matrix (after the adaptor matrix itself) */
+static ambix_err_t _ambix_write_timeline(ambix_t*ambix) {
+  ambix_err_t res=AMBIX_ERR_UNKNOWN;
+  const uint64_t datalen=_ambix_timeline_to_uuid2(ambix->timeline, NULL, ambix->byteswap);
+  void*data=NULL;
+  if(datalen<1)
+    return AMBIX_ERR_SUCCESS;
+  data=calloc(1+datalen/sizeof(float32_t), sizeof(float32_t));
+  if(data && _ambix_timeline_to_uuid2(ambix->timeline, data, ambix->byteswap)==datalen)
+    res=_ambix_write_chunk(ambix, _ambix_uuid_id(), data, datalen);
+  free(data);
+  return res;
+}
+
+/* select the matrix for reading/writing, and find the cheapest way to apply it */
+static void _ambix_use_matrix(ambix_t*ambix, int use_matrix) {
+  ambix->use_matrix=use_matrix;
+  switch(use_matrix) {
+  case 1:
+    _ambix_matrixplan_init(&ambix->matrixplan, &ambix->matrix);
+    break;
+  case 2:
+    _ambix_matrixplan_init(&ambix->matrixplan, &ambix->matrix2);
+    break;
+  default:
+    _ambix_matrixplan_deinit(&ambix->matrixplan);
+  }
+  ambix->matrixplan.precision=ambix->precision;
+}
+
+/* make room for blocks of up to 'frames' frames (of any sample type) */
+static ambix_err_t _ambix_reserve_blocksize(ambix_t*ambix, int64_t frames) {
+  ambix_err_t err=_ambix_adaptorbuffer_resize(ambix, frames, sizeof(float64_t));
+  if(AMBIX_ERR_SUCCESS == err)
+    ambix->maxblocksize=frames;
+  return err;
+}
+
+/* open a file by name (or via the callbacks, if vio is non-NULL) */
+static ambix_t*_ambix_open_handle(const char *path, const ambix_virtual_io_t*vio, void*userdata,
+                                  const ambix_filemode_t mode, ambix_info_t*ambixinfo) {
   ambix_t*ambix=NULL;
   ambix_err_t err = AMBIX_ERR_UNKNOWN;
   int32_t ambichannels=0, otherchannels=0;
   int basic2extended = 0; /* writing extended file as basic */
 
-  if((AMBIX_WRITE & mode) && (AMBIX_READ & mode)) {
-    /* RDRW not yet implemented */
+  const int rdrw=(AMBIX_RDRW == (AMBIX_RDRW & mode));
+
+  if(rdrw && ((AMBIX_PREFETCH|AMBIX_WRITEBEHIND) & mode)) {
+    /* RDRW only edits the chunks, the sample data is read synchronously */
+    return NULL;
+  }
+  if((AMBIX_MMAP & mode) && !(AMBIX_READ & mode)) {
+    /* we can only map existing files */
+    return NULL;
+  }
+  if((AMBIX_PREFETCH & mode) && !(AMBIX_READ & mode)) {
+    return NULL;
+  }
+  if((AMBIX_WRITEBEHIND & mode) && !(AMBIX_WRITE & mode)) {
     return NULL;
   }
 
-  if(AMBIX_WRITE & mode) {
+  if((AMBIX_WRITE & mode) && !rdrw) {
     err=_check_write_ambixinfo(ambixinfo);
     if(err!=AMBIX_ERR_SUCCESS) {
       if (AMBIX_BASIC == ambixinfo->fileformat) {
@@ -109,13 +192,17 @@ ambix_t*        ambix_open      (const char *path, const ambix_filemode_t mode,
   }
 
   ambix=(ambix_t*)calloc(1, sizeof(ambix_t));
-  if(AMBIX_ERR_SUCCESS == _ambix_open(ambix, path, mode, ambixinfo)) {
+  if(vio)
+    err=_ambix_open_virtual(ambix, vio, userdata, mode, ambixinfo);
+  else
+    err=_ambix_open(ambix, path, mode, ambixinfo);
+  if(AMBIX_ERR_SUCCESS == err) {
     const ambix_fileformat_t wantformat=basic2extended?AMBIX_BASIC:ambixinfo->fileformat;
     ambix_fileformat_t haveformat;
     uint32_t channels = ambix->channels;
     /* successfully opened, initialize common stuff... */
     if(ambix->is_AMBIX) {
-      if(AMBIX_WRITE & mode) {
+      if((AMBIX_WRITE & mode) && !rdrw) {
         switch(ambixinfo->fileformat) {
         case(AMBIX_NONE):
           _ambix_info_set(ambix, AMBIX_NONE, channels, 0, 0);
@@ -157,14 +244,16 @@ ambix_t*        ambix_open      (const char *path, const ambix_filemode_t mode,
           }
         }
       }
-      /* retrieve markers/regions/strings*/
-      _ambix_read_markersregions(ambix);
+      /* markers/regions/strings are only retrieved when asked for */
+      ambix->pendingMarkers=1;
     } else {
       /* it's not a CAF file.... */
       _ambix_info_set(ambix, AMBIX_NONE, channels, 0, 0);
     }
 
     haveformat=ambix->realinfo.fileformat;
+    if((AMBIX_READ & mode) && AMBIX_EXTENDED==haveformat)
+      _ambix_load_timeline(ambix);
 
     ambix->filemode=mode;
     memcpy(&ambix->info, &ambix->realinfo, sizeof(ambix->info));
@@ -180,18 +269,31 @@ ambix_t*        ambix_open      (const char *path, const ambix_filemode_t mode,
     if(0) {
     } else if(AMBIX_BASIC==wantformat && AMBIX_EXTENDED==haveformat) {
       ambix->info.fileformat=AMBIX_BASIC;
-      ambix->use_matrix=1;
+      _ambix_use_matrix(ambix, 1);
       ambix->info.ambichannels=ambix->matrix.rows;
     } else if(AMBIX_EXTENDED==wantformat && AMBIX_BASIC==haveformat) {
       ambix_matrix_init(ambix->realinfo.ambichannels, ambix->realinfo.ambichannels, &ambix->matrix);
       ambix_matrix_fill(&ambix->matrix, AMBIX_MATRIX_IDENTITY);
       ambix->info.fileformat=AMBIX_EXTENDED;
-      ambix->use_matrix=0;
+      _ambix_use_matrix(ambix, 0);
     }
 
     memcpy(ambixinfo, &ambix->info, sizeof(ambix->info));
 
-    if(_ambix_adaptorbuffer_resize(ambix, DEFAULT_ADAPTORBUFFER_SIZE, sizeof(float32_t)) == AMBIX_ERR_SUCCESS)
+    /* if there's no thread support, we just read synchronously */
+    if(AMBIX_PREFETCH & mode) {
+      /* the reader thread owns the file, so we cannot read the markers later */
+      _ambix_load_markersregions(ambix);
+      ambix->prefetch=_ambix_prefetch_create(ambix, AMBIX_PREFETCH_FRAMES);
+    }
+    if(AMBIX_WRITEBEHIND & mode)
+      ambix->writebehind=_ambix_writebehind_create(ambix, AMBIX_WRITEBEHIND_BYTES);
+    /* matrices can only be swapped while reading a file presented as BASIC
+     * (NULL without atomics) */
+    if((AMBIX_READ & mode) && AMBIX_BASIC == ambix->info.fileformat)
+      ambix->matrixswap=_ambix_matrixswap_create();
+
+    if(_ambix_reserve_blocksize(ambix, DEFAULT_ADAPTORBUFFER_SIZE) == AMBIX_ERR_SUCCESS)
       return ambix;
   }
 
@@ -199,22 +301,56 @@ ambix_t*        ambix_open      (const char *path, const ambix_filemode_t mode,
   return NULL;
 }
 
+ambix_t*        ambix_open      (const char *path, const ambix_filemode_t mode, ambix_info_t*ambixinfo) {
+  return _ambix_open_handle(path, NULL, NULL, mode, ambixinfo);
+}
+
+ambix_t*        ambix_open_virtual (const ambix_virtual_io_t *vio, const ambix_filemode_t mode, ambix_info_t*ambixinfo, void*userdata) {
+  if(!vio || ((AMBIX_READ & mode) && !vio->read) || ((AMBIX_WRITE & mode) && !vio->write))
+    return NULL;
+  return _ambix_open_handle(NULL, vio, userdata, mode, ambixinfo);
+}
+
 ambix_err_t     ambix_close     (ambix_t*ambix) {
-  ambix_err_t res=AMBIX_ERR_SUCCESS;
+  ambix_err_t res=AMBIX_ERR_SUCCESS, writeres;
   if(NULL==ambix) {
     return AMBIX_ERR_INVALID_HANDLE;
   }
 
+  /* flush everything still queued */
+  writeres=_ambix_writebehind_destroy(ambix->writebehind);
+  ambix->writebehind=NULL;
+
   if((ambix->filemode & AMBIX_WRITE) && ambix->pendingHeaders) {
-    _ambix_write_header(ambix);
+    if(AMBIX_ERR_SUCCESS != _ambix_write_header(ambix) && AMBIX_ERR_SUCCESS == writeres)
+      writeres=AMBIX_ERR_UNKNOWN;
   }
 
+  _ambix_prefetch_destroy(ambix->prefetch);
+  ambix->prefetch=NULL;
+
   res=_ambix_close(ambix);
+  if(AMBIX_ERR_SUCCESS == res)
+    res=writeres;
+  /* release whatever the stream was opened on (e.g. the file descriptor) */
+  if(ambix->closefun) {
+    writeres=ambix->closefun(ambix->closedata);
+    if(AMBIX_ERR_SUCCESS == res)
+      res=writeres;
+  }
 
   _ambix_adaptorbuffer_destroy(ambix);
   ambix_matrix_deinit(&ambix->matrix);
   ambix_matrix_deinit(&ambix->matrix2);
-
+  _ambix_matrixplan_deinit(&ambix->matrixplan);
+  _ambix_matrixswap_destroy(ambix->matrixswap);
+  ambix->matrixswap=NULL;
+  _ambix_timeline_destroy(ambix->timeline);
+  ambix->timeline=NULL;
+  _ambix_threadpool_destroy(ambix->threadpool);
+  ambix->threadpool=NULL;
+
+  ambix->pendingMarkers=0;
   ambix_delete_markers(ambix);
   ambix_delete_regions(ambix);
 
@@ -224,7 +360,57 @@ ambix_err_t     ambix_close     (ambix_t*ambix) {
 }
 
 int64_t ambix_seek (ambix_t* ambix, int64_t frames, int whence) {
-  return _ambix_seek(ambix, frames, whence);
+  int64_t position;
+  if(ambix->prefetch) {
+    position=_ambix_prefetch_seek(ambix->prefetch, frames, whence);
+  } else {
+    if(ambix->writebehind && AMBIX_ERR_SUCCESS != _ambix_writebehind_drain(ambix->writebehind))
+      return -1;
+    position=_ambix_seek(ambix, frames, whence);
+  }
+  /* the keyframes are looked up (again) with the next block */
+  if(position>=0)
+    _ambix_timeline_seek(ambix->timeline, position);
+  return position;
+}
+
+int64_t ambix_map_frames (ambix_t*ambix, const float32_t**data, int64_t frames) {
+  const float32_t*mapped=NULL;
+  if(!ambix || !data)
+    return -AMBIX_ERR_INVALID_HANDLE;
+  /* the data is only usable as is, if we don't need to apply a matrix */
+  if(!(ambix->filemode & AMBIX_MMAP) || ambix->use_matrix || ambix->prefetch
+     || _ambix_matrixswap_active(ambix->matrixswap))
+    return -AMBIX_ERR_INVALID_FORMAT;
+  mapped=_ambix_map_float32(ambix, &frames);
+  if(!mapped)
+    return -AMBIX_ERR_INVALID_FORMAT;
+  ambix->startedReading=1;
+  *data=mapped;
+  return frames;
+}
+
+ambix_err_t ambix_get_prefetch (ambix_t*ambix, int64_t*available, int64_t*size, uint64_t*underruns) {
+  if(!ambix || !ambix->prefetch)
+    return AMBIX_ERR_INVALID_HANDLE;
+  _ambix_prefetch_status(ambix->prefetch, available, size, underruns);
+  return AMBIX_ERR_SUCCESS;
+}
+
+ambix_err_t ambix_set_backpressure (ambix_t*ambix, ambix_backpressure_t policy) {
+  if(!ambix || !ambix->writebehind)
+    return AMBIX_ERR_INVALID_HANDLE;
+  /* the audio thread must never wait */
+  if((AMBIX_REALTIME & ambix->filemode) && AMBIX_BACKPRESSURE_BLOCK == policy)
+    return AMBIX_ERR_UNKNOWN;
+  return _ambix_writebehind_setpolicy(ambix->writebehind, policy);
+}
+
+ambix_err_t ambix_get_writebehind (ambix_t*ambix, int64_t*queued, int64_t*highwater, uint64_t*overruns, uint64_t*dropped) {
+  if(!ambix || !ambix->writebehind)
+    return AMBIX_ERR_INVALID_HANDLE;
+  _ambix_writebehind_status(ambix->writebehind, queued, highwater, overruns, dropped);
+  return AMBIX_ERR_SUCCESS;
 }
 
 void*ambix_get_sndfile    (ambix_t*ambix) {
@@ -235,18 +421,22 @@ void*ambix_get_sndfile    (ambix_t*ambix) {
 }
 
 uint32_t ambix_get_num_markers (ambix_t*ambix) {
+  _ambix_load_markersregions(ambix);
   return ambix->num_markers;
 }
 uint32_t ambix_get_num_regions(ambix_t *ambix) {
+  _ambix_load_markersregions(ambix);
   return ambix->num_regions;
 }
 ambix_marker_t *ambix_get_marker(ambix_t *ambix, uint32_t id) {
+  _ambix_load_markersregions(ambix);
   if (id < ambix->num_markers)
     return &ambix->markers[id];
   else
     return NULL;
 }
 ambix_region_t *ambix_get_region(ambix_t *ambix, uint32_t id) {
+  _ambix_load_markersregions(ambix);
   if (id < ambix->num_regions)
     return &ambix->regions[id];
   else
@@ -259,10 +449,13 @@ ambix_err_t ambix_add_marker(ambix_t *ambix, ambix_marker_t *marker) {
   if (!marker)
     return AMBIX_ERR_UNKNOWN;
 
+  _ambix_load_markersregions(ambix);
+  /* the storage is doubled whenever the number of markers reaches a power of 2 */
   if (ambix->num_markers > 0)
-    if (ambix->markers)
-      ambix->markers = (ambix_marker_t*)realloc(ambix->markers, (ambix->num_markers+1)*sizeof(ambix_marker_t));
-    else
+    if (ambix->markers) {
+      if (!(ambix->num_markers & (ambix->num_markers-1)))
+        ambix->markers = (ambix_marker_t*)realloc(ambix->markers, 2*ambix->num_markers*sizeof(ambix_marker_t));
+    } else
       return AMBIX_ERR_UNKNOWN;
   else
     ambix->markers = (ambix_marker_t*)calloc(1, sizeof(ambix_marker_t));
@@ -280,10 +473,13 @@ ambix_err_t ambix_add_region(ambix_t *ambix, ambix_region_t *region) {
   if (!region)
     return AMBIX_ERR_UNKNOWN;
 
+  _ambix_load_markersregions(ambix);
+  /* see ambix_add_marker() */
   if (ambix->num_regions > 0)
-    if (ambix->regions)
-      ambix->regions = (ambix_region_t*)realloc(ambix->regions, (ambix->num_regions+1)*sizeof(ambix_region_t));
-    else
+    if (ambix->regions) {
+      if (!(ambix->num_regions & (ambix->num_regions-1)))
+        ambix->regions = (ambix_region_t*)realloc(ambix->regions, 2*ambix->num_regions*sizeof(ambix_region_t));
+    } else
       return AMBIX_ERR_UNKNOWN;
   else
     ambix->regions = (ambix_region_t*)calloc(1, sizeof(ambix_region_t));
@@ -295,6 +491,8 @@ ambix_err_t ambix_add_region(ambix_t *ambix, ambix_region_t *region) {
   return AMBIX_ERR_SUCCESS;
 }
 ambix_err_t ambix_delete_markers(ambix_t *ambix) {
+  /* make sure the markers don't come back later */
+  _ambix_load_markersregions(ambix);
   if (ambix->num_markers > 0) {
     if (ambix->markers)
       free (ambix->markers);
@@ -302,12 +500,15 @@ ambix_err_t ambix_delete_markers(ambix_t *ambix) {
       return AMBIX_ERR_UNKNOWN;
 
     ambix->num_markers = 0;
+    if(!ambix->startedWriting)
+      ambix->pendingHeaders = 1;
     return AMBIX_ERR_SUCCESS;
   }
 
   return AMBIX_ERR_UNKNOWN;
 }
 ambix_err_t ambix_delete_regions(ambix_t *ambix) {
+  _ambix_load_markersregions(ambix);
   if (ambix->num_regions > 0) {
     if (ambix->regions)
       free (ambix->regions);
@@ -315,6 +516,8 @@ ambix_err_t ambix_delete_regions(ambix_t *ambix) {
       return AMBIX_ERR_UNKNOWN;
 
     ambix->num_regions = 0;
+    if(!ambix->startedWriting)
+      ambix->pendingHeaders = 1;
     return AMBIX_ERR_SUCCESS;
   }
   return AMBIX_ERR_UNKNOWN;
@@ -325,8 +528,29 @@ const ambix_matrix_t*ambix_get_adaptormatrix    (ambix_t*ambix) {
     return &(ambix->matrix);
   return NULL;
 }
-ambix_err_t ambix_set_adaptormatrix     (ambix_t*ambix, const ambix_matrix_t*matrix) {
+static ambix_err_t _ambix_set_adaptormatrix (ambix_t*ambix, const ambix_matrix_t*matrix) {
   if(0) {
+  } else if(AMBIX_RDRW == (ambix->filemode & AMBIX_RDRW)) {
+    /* RDRW: replace the adaptor matrix stored in the file */
+    if((AMBIX_EXTENDED != ambix->realinfo.fileformat) && (AMBIX_BASIC != ambix->realinfo.fileformat))
+      return AMBIX_ERR_UNKNOWN;
+    /* the number of channels in the file cannot change */
+    if(!ambix_is_fullset(matrix->rows) || (matrix->cols != ambix->realinfo.ambichannels))
+      return AMBIX_ERR_INVALID_DIMENSION;
+    /* the keyframes stored in the file must still fit */
+    if(ambix->timeline && matrix->rows != _ambix_timeline_rows(ambix->timeline))
+      return AMBIX_ERR_INVALID_DIMENSION;
+    if(!ambix_matrix_copy(matrix, &ambix->matrix))
+      return AMBIX_ERR_UNKNOWN;
+    ambix->realinfo.fileformat=AMBIX_EXTENDED;
+    ambix->ambisonics_order=ambix_channels2order(matrix->rows);
+    /* a file presented as BASIC is still expanded to the full set */
+    if(AMBIX_BASIC == ambix->info.fileformat) {
+      ambix->info.ambichannels=matrix->rows;
+      _ambix_use_matrix(ambix, 1);
+    }
+    ambix->pendingHeaders=1;
+    return AMBIX_ERR_SUCCESS;
   } else if((ambix->filemode & AMBIX_READ ) && (AMBIX_BASIC   == ambix->info.fileformat)) {
     ambix_matrix_t*mtx=NULL;
     /* multiply the matrix with the previous adaptor matrix */
@@ -334,7 +558,10 @@ ambix_err_t ambix_set_adaptormatrix     (ambix_t*ambix, const ambix_matrix_t*mat
       mtx=_ambix_matrix_multiply(matrix, &ambix->matrix, &ambix->matrix2);
       if(mtx != &ambix->matrix2)
         return AMBIX_ERR_UNKNOWN;
-      ambix->use_matrix=2;
+      /* ...and with the keyframes */
+      if(AMBIX_ERR_SUCCESS != _ambix_timeline_premultiply(ambix->timeline, matrix))
+        return AMBIX_ERR_UNKNOWN;
+      _ambix_use_matrix(ambix, 2);
       return AMBIX_ERR_SUCCESS;
     } else {
       if(matrix->cols != ambix->realinfo.ambichannels) {
@@ -342,7 +569,7 @@ ambix_err_t ambix_set_adaptormatrix     (ambix_t*ambix, const ambix_matrix_t*mat
       }
       mtx=ambix_matrix_copy(matrix, &ambix->matrix2);
       if(mtx) {
-        ambix->use_matrix=2;
+        _ambix_use_matrix(ambix, 2);
       } else {
         return AMBIX_ERR_UNKNOWN;
       }
@@ -357,6 +584,10 @@ ambix_err_t ambix_set_adaptormatrix     (ambix_t*ambix, const ambix_matrix_t*mat
     /* check whether the matrix will expand to a full set */
     if(!ambix_is_fullset(matrix->rows))
       return AMBIX_ERR_INVALID_DIMENSION;
+    /* the keyframes must have the same dimensions */
+    if(ambix->timeline && (matrix->rows != _ambix_timeline_rows(ambix->timeline)
+                           || matrix->cols != _ambix_timeline_cols(ambix->timeline)))
+      return AMBIX_ERR_INVALID_DIMENSION;
 
     if(basic2extended) {
       ambix_matrix_t*pinv=NULL;
@@ -386,7 +617,7 @@ ambix_err_t ambix_set_adaptormatrix     (ambix_t*ambix, const ambix_matrix_t*mat
     if(basic2extended) {
       ambix->realinfo.fileformat=AMBIX_EXTENDED;
       ambix->info.ambichannels=matrix->rows;
-      ambix->use_matrix=2;
+      _ambix_use_matrix(ambix, 2);
     }
 
     /* ready to write it to file */
@@ -397,8 +628,122 @@ ambix_err_t ambix_set_adaptormatrix     (ambix_t*ambix, const ambix_matrix_t*mat
   return AMBIX_ERR_UNKNOWN;
 }
 
+ambix_err_t ambix_set_adaptormatrix     (ambix_t*ambix, const ambix_matrix_t*matrix) {
+  ambix_err_t err=_ambix_set_adaptormatrix(ambix, matrix);
+  /* the number of channels might have changed */
+  if(AMBIX_ERR_SUCCESS == err) {
+    _ambix_matrixswap_reset(ambix->matrixswap);
+    err=_ambix_reserve_blocksize(ambix, ambix->maxblocksize);
+  }
+  return err;
+}
+
+ambix_err_t ambix_swap_adaptormatrix    (ambix_t*ambix, const ambix_matrix_t*matrix, int64_t crossfade) {
+  const int extended=ambix && (AMBIX_EXTENDED == ambix->realinfo.fileformat);
+  ambix_matrix_t*mtx=NULL;
+  uint32_t rows, cols;
+  if(!ambix)
+    return AMBIX_ERR_INVALID_HANDLE;
+  if(!ambix->matrixswap || !matrix)
+    return AMBIX_ERR_UNKNOWN;
+  /* the number of channels presented to the reader must not change */
+  rows=ambix->use_matrix?ambix->matrixplan.rows:ambix->realinfo.ambichannels;
+  cols=ambix->realinfo.ambichannels;
+  if(matrix->rows != rows || matrix->cols != (extended?ambix->matrix.rows:cols))
+    return AMBIX_ERR_INVALID_DIMENSION;
+  /* multiply the matrix with the adaptor matrix of the file */
+  if(extended)
+    mtx=_ambix_matrix_multiply(matrix, &ambix->matrix, NULL);
+  else
+    mtx=ambix_matrix_copy(matrix, NULL);
+  if(!mtx)
+    return AMBIX_ERR_UNKNOWN;
+  return _ambix_matrixswap_publish(ambix->matrixswap, mtx, crossfade);
+}
+
+ambix_err_t ambix_add_keyframe (ambix_t*ambix, int64_t frame, const ambix_matrix_t*matrix) {
+  if(!ambix)
+    return AMBIX_ERR_INVALID_HANDLE;
+  if(!matrix || frame<0)
+    return AMBIX_ERR_UNKNOWN;
+  /* the keyframes are written along with the adaptor matrix, before the sample data */
+  if(AMBIX_WRITE != (ambix->filemode & AMBIX_RDRW) || ambix->startedWriting
+     || AMBIX_EXTENDED != ambix->realinfo.fileformat)
+    return AMBIX_ERR_UNKNOWN;
+  /* the keyframes replace the adaptor matrix (so it must have been set already) */
+  if(!ambix->matrix.rows || matrix->rows != ambix->matrix.rows || matrix->cols != ambix->matrix.cols)
+    return AMBIX_ERR_INVALID_DIMENSION;
+  if(!ambix->timeline) {
+    ambix->timeline=_ambix_timeline_create(matrix->rows, matrix->cols);
+    if(!ambix->timeline)
+      return AMBIX_ERR_UNKNOWN;
+  }
+  ambix->pendingHeaders=1;
+  return _ambix_timeline_add(ambix->timeline, frame, matrix);
+}
+uint32_t ambix_get_num_keyframes (ambix_t*ambix) {
+  return ambix?_ambix_timeline_size(ambix->timeline):0;
+}
+const ambix_matrix_t*ambix_get_keyframe (ambix_t*ambix, uint32_t index, int64_t*frame) {
+  if(!ambix)
+    return NULL;
+  return _ambix_timeline_get(ambix->timeline, index, frame);
+}
+ambix_err_t ambix_delete_keyframes (ambix_t*ambix) {
+  if(!ambix)
+    return AMBIX_ERR_INVALID_HANDLE;
+  if(AMBIX_WRITE != (ambix->filemode & AMBIX_RDRW) || ambix->startedWriting || !ambix->timeline)
+    return AMBIX_ERR_UNKNOWN;
+  _ambix_timeline_destroy(ambix->timeline);
+  ambix->timeline=NULL;
+  ambix->pendingHeaders=1;
+  return AMBIX_ERR_SUCCESS;
+}
+
+ambix_err_t ambix_set_threads(ambix_t*ambix, uint32_t threads) {
+  _ambix_threadpool_t*pool=NULL;
+  if(!ambix)
+    return AMBIX_ERR_INVALID_HANDLE;
+  if(!threads)
+    threads=_ambix_num_cpus();
+  if(threads>AMBIX_MAX_THREADS)
+    threads=AMBIX_MAX_THREADS;
+  if(threads == _ambix_threadpool_size(ambix->threadpool))
+    return AMBIX_ERR_SUCCESS;
+  /* handing work to other threads means locking */
+  if((AMBIX_REALTIME & ambix->filemode) && threads>1)
+    return AMBIX_ERR_UNKNOWN;
+  /* the background writer might be using the threadpool */
+  if(ambix->writebehind)
+    _ambix_writebehind_drain(ambix->writebehind);
+  if(threads>1) {
+    pool=_ambix_threadpool_create(threads);
+    if(!pool)
+      return AMBIX_ERR_UNKNOWN;
+  }
+  _ambix_threadpool_destroy(ambix->threadpool);
+  ambix->threadpool=pool;
+  return AMBIX_ERR_SUCCESS;
+}
+
+ambix_err_t ambix_set_precision(ambix_t*ambix, ambix_precision_t precision) {
+  if(!ambix)
+    return AMBIX_ERR_INVALID_HANDLE;
+  if(_AMBIX_PRECISION_MODE(precision) > AMBIX_PRECISION_KAHAN)
+    return AMBIX_ERR_UNKNOWN;
+  /* the background writer might be applying the matrix */
+  if(ambix->writebehind)
+    _ambix_writebehind_drain(ambix->writebehind);
+  ambix->precision=precision;
+  ambix->matrixplan.precision=precision;
+  return AMBIX_ERR_SUCCESS;
+}
+
 ambix_err_t     _ambix_write_header     (ambix_t*ambix) {
   void*data=NULL;
+  /* RDRW: the markers found in the file are written back (with the changes) */
+  if(ambix->filemode & AMBIX_READ)
+    _ambix_load_markersregions(ambix);
   if(ambix->filemode & AMBIX_WRITE) {
     if((AMBIX_EXTENDED == ambix->realinfo.fileformat)) {
       _ambix_write_markersregions(ambix); // this need to be done in a more elegant way...!
@@ -418,6 +763,9 @@ ambix_err_t     _ambix_write_header     (ambix_t*ambix) {
       res=_ambix_write_uuidchunk(ambix, data, datalen);
       if(data)
         free(data);
+      /* RDRW: the keyframes in the file are left alone */
+      if(AMBIX_ERR_SUCCESS==res && !(ambix->filemode & AMBIX_READ))
+        res=_ambix_write_timeline(ambix);
 
       if(AMBIX_ERR_SUCCESS==res)
         ambix->pendingHeaders=0;
@@ -440,6 +788,9 @@ ambix_err_t     _ambix_write_header     (ambix_t*ambix) {
 }
 
 static ambix_err_t _ambix_check_write(ambix_t*ambix, const void*ambidata, const void*otherdata, int64_t frames) {
+  /* with RDRW, only the metadata can be changed */
+  if(ambix->filemode & AMBIX_READ)
+    return AMBIX_ERR_INVALID_FILE;
   /* TODO: add some checks whether writing is feasible
    * e.g. format=extended but no (or wrong) matrix present */
   if((ambix->realinfo.fileformat==AMBIX_EXTENDED) && !ambix_is_fullset(ambix->matrix.rows))
@@ -447,7 +798,12 @@ static ambix_err_t _ambix_check_write(ambix_t*ambix, const void*ambidata, const
 
   /* write out any headers if we haven't done so yet */
   if(ambix->pendingHeaders) {
-    ambix_err_t res=_ambix_write_header(ambix);
+    ambix_err_t res=AMBIX_ERR_SUCCESS;
+    /* don't touch the file while the background writer is busy */
+    if(ambix->writebehind)
+      res=_ambix_writebehind_drain(ambix->writebehind);
+    if(AMBIX_ERR_SUCCESS==res)
+      res=_ambix_write_header(ambix);
     if(AMBIX_ERR_SUCCESS!=res)
       return res;
   }
@@ -463,49 +819,337 @@ static ambix_err_t _ambix_check_read(ambix_t*ambix, const void*ambidata, const v
   return AMBIX_ERR_SUCCESS;
 }
 
+ambix_err_t ambix_set_max_blocksize (ambix_t*ambix, int64_t frames) {
+  ambix_err_t err;
+  if(!ambix)
+    return AMBIX_ERR_INVALID_HANDLE;
+  if(frames<1)
+    return AMBIX_ERR_INVALID_DIMENSION;
+  err=_ambix_reserve_blocksize(ambix, frames);
+  if(AMBIX_ERR_SUCCESS != err)
+    return err;
+  /* the header is written before the first block, so get it out of the way */
+  if((AMBIX_REALTIME & ambix->filemode) && AMBIX_WRITE == (ambix->filemode & AMBIX_RDRW))
+    err=_ambix_check_write(ambix, NULL, NULL, 0);
+  return err;
+}
 
-#define AMBIX_READF(type)                                               \
-  int64_t ambix_readf_##type (ambix_t*ambix, type##_t*ambidata, type##_t*otherdata, int64_t frames) { \
-    int64_t realframes;                                                 \
+
+/* applying the adaptor matrix to large blocks is split into (at most one per
+ * thread) ranges of at least AMBIX_THREADS_MINFRAMES frames, that are
+ * processed in parallel.
+ * each range reads and writes its own part of the buffers, so all we need
+ * to synchronize is the final join.
+ */
+#define AMBIX_THREADS_MINFRAMES 512
+
+typedef struct _ambix_adaptorjob {
+  ambix_t*ambix;
+  void*ambidata;
+  void*otherdata;
+  void*buffer;
+  /* where in ambidata/otherdata the buffer goes (in frames) */
+  int64_t offset;
+  int64_t frames;
+  uint32_t numtasks;
+  /* the adaptor plan (or NULL to just split/merge the channels) */
+  const _ambix_matrixplan_t*plan;
+  /* crossfading from another plan (after ambix_swap_adaptormatrix()) */
+  _ambix_matrixfade_t fade;
+  /* the split/merge function (see _ambix_adaptorjob_run()) */
+  _ambix_threadfun_t fun;
+} _ambix_adaptorjob_t;
+
+/* the plan of the handle's own adaptor matrix (if any) */
+static const _ambix_matrixplan_t*_ambix_adaptorplan(const ambix_t*ambix) {
+  return ambix->use_matrix?&ambix->matrixplan:NULL;
+}
+
+static void _ambix_adaptorjob_init(_ambix_adaptorjob_t*job, ambix_t*ambix, const _ambix_matrixplan_t*plan,
+                                   const void*ambidata, const void*otherdata, void*buffer,
+                                   int64_t offset, int64_t frames) {
+  const uint32_t threads=_ambix_threadpool_size(ambix->threadpool);
+  int64_t numtasks=frames/AMBIX_THREADS_MINFRAMES;
+  /* copying channels around is memory-bound, so we only parallelize the matrix */
+  if(!plan || numtasks<1)
+    numtasks=1;
+  if(numtasks>threads)
+    numtasks=threads;
+  job->ambix=ambix;
+  job->ambidata=(void*)ambidata;
+  job->otherdata=(void*)otherdata;
+  job->buffer=buffer;
+  job->offset=offset;
+  job->frames=frames;
+  job->numtasks=(uint32_t)numtasks;
+  job->plan=plan;
+  job->fade.plan=NULL;
+  job->fade.pos=job->fade.length=0;
+}
+
+#define AMBIX_ADAPTORJOB(type)                                          \
+  static void _ambix_splitjob_##type(void*userdata, uint32_t task) {    \
+    const _ambix_adaptorjob_t*job=(const _ambix_adaptorjob_t*)userdata; \
+    ambix_t*ambix=job->ambix;                                           \
+    const uint32_t sourcechannels=ambix->realinfo.ambichannels+ambix->realinfo.extrachannels; \
+    const int64_t start=job->frames*task/job->numtasks;                 \
+    const int64_t frames=job->frames*(task+1)/job->numtasks - start;    \
+    const type##_t*source=(const type##_t*)job->buffer + start*sourcechannels; \
+    type##_t*ambidata=(type##_t*)job->ambidata;                         \
+    type##_t*otherdata=(type##_t*)job->otherdata;                       \
+    const _ambix_matrixplan_t*plan=job->plan;                           \
+    if(plan) {                                                          \
+      if(ambidata)ambidata+=(job->offset+start)*plan->rows;             \
+      if(otherdata)otherdata+=(job->offset+start)*(sourcechannels-plan->cols); \
+      if(job->fade.length) {                                            \
+        _ambix_matrixfade_t fade=job->fade;                             \
+        fade.pos+=start;                                                \
+        _ambix_splitAdaptorfade_##type(source, sourcechannels, &fade, plan, ambidata, otherdata, frames); \
+      } else                                                            \
+        _ambix_splitAdaptorplan_##type(source, sourcechannels, plan, ambidata, otherdata, frames); \
+    } else {                                                            \
+      if(ambidata)ambidata+=(job->offset+start)*ambix->realinfo.ambichannels; \
+      if(otherdata)otherdata+=(job->offset+start)*ambix->realinfo.extrachannels; \
+      _ambix_splitAdaptor_##type      (source, sourcechannels, ambix->realinfo.ambichannels, ambidata, otherdata, frames); \
+    }                                                                   \
+  }                                                                     \
+  static void _ambix_mergejob_##type(void*userdata, uint32_t task) {    \
+    const _ambix_adaptorjob_t*job=(const _ambix_adaptorjob_t*)userdata; \
+    ambix_t*ambix=job->ambix;                                           \
+    const uint32_t extrachannels=ambix->info.extrachannels;             \
+    const int64_t start=job->frames*task/job->numtasks;                 \
+    const int64_t frames=job->frames*(task+1)/job->numtasks - start;    \
+    const type##_t*ambidata=(const type##_t*)job->ambidata;             \
+    const type##_t*otherdata=(const type##_t*)job->otherdata;           \
+    type##_t*destination=(type##_t*)job->buffer;                        \
+    const _ambix_matrixplan_t*plan=job->plan;                           \
+    if(otherdata)otherdata+=(job->offset+start)*extrachannels;          \
+    if(plan) {                                                          \
+      if(ambidata)ambidata+=(job->offset+start)*plan->cols;             \
+      destination+=start*(plan->rows+extrachannels);                    \
+      _ambix_mergeAdaptorplan_##type(ambidata, plan, otherdata, extrachannels, destination, frames); \
+    } else {                                                            \
+      if(ambidata)ambidata+=(job->offset+start)*ambix->info.ambichannels; \
+      destination+=start*(ambix->info.ambichannels+extrachannels);      \
+      _ambix_mergeAdaptor_##type(ambidata, ambix->info.ambichannels, otherdata, extrachannels, destination, frames); \
+    }                                                                   \
+  }
+
+AMBIX_ADAPTORJOB(int16);
+AMBIX_ADAPTORJOB(int32);
+AMBIX_ADAPTORJOB(float32);
+AMBIX_ADAPTORJOB(float64);
+
+/* the same for planar data: ambidata/otherdata are arrays of channel pointers */
+#define AMBIX_ADAPTORJOB_PLANAR(type)                                   \
+  static void _ambix_splitjob_planar_##type(void*userdata, uint32_t task) { \
+    const _ambix_adaptorjob_t*job=(const _ambix_adaptorjob_t*)userdata; \
+    ambix_t*ambix=job->ambix;                                           \
+    const uint32_t sourcechannels=ambix->realinfo.ambichannels+ambix->realinfo.extrachannels; \
+    const int64_t start=job->frames*task/job->numtasks;                 \
+    const int64_t frames=job->frames*(task+1)/job->numtasks - start;    \
+    const type##_t*source=(const type##_t*)job->buffer + start*sourcechannels; \
+    type##_t**ambidata=(type##_t**)job->ambidata;                       \
+    type##_t**otherdata=(type##_t**)job->otherdata;                     \
+    const _ambix_matrixplan_t*plan=job->plan;                           \
+    if(plan) {                                                          \
+      if(job->fade.length) {                                            \
+        _ambix_matrixfade_t fade=job->fade;                             \
+        fade.pos+=start;                                                \
+        _ambix_splitAdaptorfade_planar_##type(source, sourcechannels, &fade, plan, ambidata, otherdata, job->offset+start, frames); \
+      } else                                                            \
+        _ambix_splitAdaptorplan_planar_##type(source, sourcechannels, plan, ambidata, otherdata, job->offset+start, frames); \
+    } else {                                                            \
+      _ambix_splitAdaptor_planar_##type(source, sourcechannels, ambix->realinfo.ambichannels, ambidata, otherdata, job->offset+start, frames); \
+    }                                                                   \
+  }                                                                     \
+  static void _ambix_mergejob_planar_##type(void*userdata, uint32_t task) { \
+    const _ambix_adaptorjob_t*job=(const _ambix_adaptorjob_t*)userdata; \
+    ambix_t*ambix=job->ambix;                                           \
+    const uint32_t extrachannels=ambix->info.extrachannels;             \
+    const int64_t start=job->frames*task/job->numtasks;                 \
+    const int64_t frames=job->frames*(task+1)/job->numtasks - start;    \
+    type##_t*const*ambidata=(type##_t*const*)job->ambidata;             \
+    type##_t*const*otherdata=(type##_t*const*)job->otherdata;           \
+    type##_t*destination=(type##_t*)job->buffer;                        \
+    const _ambix_matrixplan_t*plan=job->plan;                           \
+    if(plan) {                                                          \
+      destination+=start*(plan->rows+extrachannels);                    \
+      _ambix_mergeAdaptorplan_planar_##type(ambidata, plan, otherdata, extrachannels, job->offset+start, destination, frames); \
+    } else {                                                            \
+      destination+=start*(ambix->info.ambichannels+extrachannels);      \
+      _ambix_mergeAdaptor_planar_##type(ambidata, ambix->info.ambichannels, otherdata, extrachannels, job->offset+start, destination, frames); \
+    }                                                                   \
+  }
+
+AMBIX_ADAPTORJOB_PLANAR(int16);
+AMBIX_ADAPTORJOB_PLANAR(int32);
+AMBIX_ADAPTORJOB_PLANAR(float32);
+AMBIX_ADAPTORJOB_PLANAR(float64);
+
+/* flush denormals in whichever thread runs the task */
+static void _ambix_adaptorjob_task_ftz(void*userdata, uint32_t task) {
+  const _ambix_adaptorjob_t*job=(const _ambix_adaptorjob_t*)userdata;
+  _ambix_fpstate_t fpstate;
+  _ambix_denormals_disable(&fpstate);
+  job->fun(userdata, task);
+  _ambix_denormals_restore(&fpstate);
+}
+static void _ambix_adaptorjob_run(_ambix_adaptorjob_t*job, _ambix_threadfun_t fun) {
+  job->fun=fun;
+  if(AMBIX_PRECISION_FLUSH_DENORMALS & job->ambix->precision)
+    fun=_ambix_adaptorjob_task_ftz;
+  _ambix_threadpool_run(job->ambix->threadpool, fun, job, job->numtasks);
+}
+
+/* split frames read from the file, with whichever matrix has been swapped in
+ * (or the one interpolated from the keyframes);
+ * a crossfade is split off into a job of its own, so it never spans past the
+ * end of the fade (resp. a keyframe) */
+static void _ambix_adaptorjob_split(ambix_t*ambix, void*ambidata, void*otherdata,
+                                    const void*buffer, uint16_t typesize,
+                                    int64_t offset, int64_t frames, _ambix_threadfun_t splitfun) {
+  const uint32_t framesize=typesize*(ambix->realinfo.ambichannels+ambix->realinfo.extrachannels);
+  while(frames>0) {
+    _ambix_adaptorjob_t job;
+    _ambix_matrixfade_t fade;
+    const _ambix_matrixplan_t*plan=_ambix_adaptorplan(ambix);
+    int64_t count=frames;
+    /* the keyframes (if any) replace the adaptor matrix of the file */
+    if(plan && ambix->timeline) {
+      const _ambix_matrixplan_t*keyplan=_ambix_timeline_acquire(ambix->timeline, ambix->precision, &count);
+      if(keyplan)
+        plan=keyplan;
+    }
+    plan=_ambix_matrixswap_acquire(ambix->matrixswap, plan, ambix->precision, &fade);
+    if(fade.length && fade.length-fade.pos<count)
+      count=fade.length-fade.pos;
+    _ambix_adaptorjob_init(&job, ambix, plan, ambidata, otherdata, (void*)buffer, offset, count);
+    job.fade=fade;
+    _ambix_adaptorjob_run(&job, splitfun);
+    _ambix_matrixswap_advance(ambix->matrixswap, count);
+    _ambix_timeline_advance(ambix->timeline, count);
+    buffer=(const char*)buffer+count*framesize;
+    offset+=count;
+    frames-=count;
+  }
+}
+
+/* the sample data as found in the file (if it is memory mapped);
+ * only float32 data can be used without converting it first */
+static const int16_t*_ambix_mapf_int16(ambix_t*ambix, int64_t*frames) {
+  return NULL;
+}
+static const int32_t*_ambix_mapf_int32(ambix_t*ambix, int64_t*frames) {
+  return NULL;
+}
+static const float32_t*_ambix_mapf_float32(ambix_t*ambix, int64_t*frames) {
+  return _ambix_map_float32(ambix, frames);
+}
+static const float64_t*_ambix_mapf_float64(ambix_t*ambix, int64_t*frames) {
+  return NULL;
+}
+
+/* read (at most) 'frames' frames and split them into ambidata/otherdata;
+ * large requests are read in chunks, so the adaptorbuffer stays small */
+#define AMBIX_READF_CHUNKED(type)                                       \
+  static int64_t _ambix_readf_chunked_##type (ambix_t*ambix, void*ambidata, void*otherdata, int64_t frames, \
+                                              _ambix_threadfun_t splitfun) { \
+    int64_t realframes=frames, chunkframes, done=0;                     \
+    const type##_t*source;                                              \
     type##_t*adaptorbuffer;                                             \
-    ambix_err_t err= _ambix_check_read(ambix, (const void*)ambidata, (const void*)otherdata, frames); \
+    ambix_err_t err;                                                    \
+    source=ambix->prefetch?NULL:_ambix_mapf_##type(ambix, &realframes); \
+    if(source) {                                                        \
+      /* memory mapped data needs no copying */                         \
+      if(realframes>0)                                                  \
+        _ambix_adaptorjob_split(ambix, ambidata, otherdata, source, sizeof(type##_t), 0, realframes, splitfun); \
+      return realframes;                                                \
+    }                                                                   \
+    chunkframes=_ambix_adaptorbuffer_chunkframes(ambix, sizeof(type##_t)); \
+    err=_ambix_adaptorbuffer_resize(ambix, (frames<chunkframes)?frames:chunkframes, sizeof(type##_t)); \
     if(AMBIX_ERR_SUCCESS != err) { return (err>0)?-err:err;}            \
-    err=_ambix_adaptorbuffer_resize(ambix, frames, sizeof(type##_t));   \
+    adaptorbuffer=(type##_t*)ambix->adaptorbuffer;                      \
+    while(done<frames) {                                                \
+      const int64_t count=(frames-done<chunkframes)?(frames-done):chunkframes; \
+      if(ambix->prefetch)                                               \
+        realframes=_ambix_prefetch_readf_##type(ambix->prefetch, adaptorbuffer, count); \
+      else                                                              \
+        realframes=_ambix_readf_##type(ambix, adaptorbuffer, count);    \
+      if(realframes<=0)                                                 \
+        return done?done:realframes;                                    \
+      _ambix_adaptorjob_split(ambix, ambidata, otherdata, adaptorbuffer, sizeof(type##_t), done, realframes, splitfun); \
+      done+=realframes;                                                 \
+      if(realframes<count)                                              \
+        break;                                                          \
+    }                                                                   \
+    return done;                                                        \
+  }
+
+/* merge ambidata/otherdata and write them to the file, chunk by chunk */
+#define AMBIX_WRITEF_CHUNKED(type)                                      \
+  static int64_t _ambix_writef_chunked_##type (ambix_t*ambix, const void*ambidata, const void*otherdata, int64_t frames, \
+                                               _ambix_threadfun_t mergefun) { \
+    const int64_t chunkframes=_ambix_adaptorbuffer_chunkframes(ambix, sizeof(type##_t)); \
+    int64_t done=0;                                                     \
+    type##_t*adaptorbuffer;                                             \
+    _ambix_adaptorjob_t job;                                            \
+    ambix_err_t err=_ambix_adaptorbuffer_resize(ambix, (frames<chunkframes)?frames:chunkframes, sizeof(type##_t)); \
     if(AMBIX_ERR_SUCCESS != err) { return (err>0)?-err:err;}            \
     adaptorbuffer=(type##_t*)ambix->adaptorbuffer;                      \
-    realframes=_ambix_readf_##type(ambix, adaptorbuffer, frames);       \
-    switch(ambix->use_matrix) {                                         \
-    case 1:                                                             \
-      _ambix_splitAdaptormatrix_##type(adaptorbuffer, ambix->realinfo.ambichannels+ambix->realinfo.extrachannels, &ambix->matrix          , ambidata, otherdata, realframes); \
-      break;                                                            \
-    case 2:                                                             \
-      _ambix_splitAdaptormatrix_##type(adaptorbuffer, ambix->realinfo.ambichannels+ambix->realinfo.extrachannels, &ambix->matrix2         , ambidata, otherdata, realframes); \
-      break;                                                            \
-    default:                                                            \
-      _ambix_splitAdaptor_##type      (adaptorbuffer, ambix->realinfo.ambichannels+ambix->realinfo.extrachannels, ambix->realinfo.ambichannels, ambidata, otherdata, realframes); \
-    };                                                                  \
-    return realframes;                                                  \
+    if(frames<1)                                                        \
+      return _ambix_writef_##type(ambix, adaptorbuffer, frames);        \
+    while(done<frames) {                                                \
+      const int64_t count=(frames-done<chunkframes)?(frames-done):chunkframes; \
+      int64_t written;                                                  \
+      _ambix_adaptorjob_init(&job, ambix, _ambix_adaptorplan(ambix), ambidata, otherdata, adaptorbuffer, done, count); \
+      _ambix_adaptorjob_run(&job, mergefun);                            \
+      written=_ambix_writef_##type(ambix, adaptorbuffer, count);        \
+      if(written<=0)                                                    \
+        return done?done:written;                                       \
+      done+=written;                                                    \
+      if(written<count)                                                 \
+        break;                                                          \
+    }                                                                   \
+    return done;                                                        \
+  }
+
+AMBIX_READF_CHUNKED(int16);
+AMBIX_READF_CHUNKED(int32);
+AMBIX_READF_CHUNKED(float32);
+AMBIX_READF_CHUNKED(float64);
+
+AMBIX_WRITEF_CHUNKED(int16);
+AMBIX_WRITEF_CHUNKED(int32);
+AMBIX_WRITEF_CHUNKED(float32);
+AMBIX_WRITEF_CHUNKED(float64);
+
+#define AMBIX_READF(type)                                               \
+  int64_t ambix_readf_##type (ambix_t*ambix, type##_t*ambidata, type##_t*otherdata, int64_t frames) { \
+    ambix_err_t err= _ambix_check_read(ambix, (const void*)ambidata, (const void*)otherdata, frames); \
+    if(AMBIX_ERR_SUCCESS != err) { return (err>0)?-err:err;}            \
+    return _ambix_readf_chunked_##type(ambix, ambidata, otherdata, frames, _ambix_splitjob_##type); \
   }
 
+/* the number of ambisonics channels the caller passes to ambix_writef() */
+static uint32_t _ambix_writechannels(const ambix_t*ambix) {
+  return ambix->use_matrix?ambix->matrixplan.cols:ambix->info.ambichannels;
+}
+
+/* merge the (interleaved) channels and write them to the file;
+ * with AMBIX_WRITEBEHIND this is called from the writer thread */
 #define AMBIX_WRITEF(type)                                              \
+  static int64_t _ambix_writef_merge_##type (ambix_t*ambix, const void*ambidata, const void*otherdata, int64_t frames) { \
+    return _ambix_writef_chunked_##type(ambix, ambidata, otherdata, frames, _ambix_mergejob_##type); \
+  }                                                                     \
   int64_t ambix_writef_##type (ambix_t*ambix, const type##_t *ambidata, const type##_t*otherdata, int64_t frames) { \
-    type##_t*adaptorbuffer;                                             \
     ambix_err_t err= _ambix_check_write(ambix, (const void*)ambidata, (const void*)otherdata, frames); \
     if(AMBIX_ERR_SUCCESS != err) { return (err>0)?-err:err;}            \
-    err=_ambix_adaptorbuffer_resize(ambix, frames, sizeof(type##_t));   \
-    if(AMBIX_ERR_SUCCESS != err) { return (err>0)?-err:err;}            \
-    adaptorbuffer=(type##_t*)ambix->adaptorbuffer;                      \
-    switch(ambix->use_matrix) {                                         \
-    case 1:                                                             \
-      _ambix_mergeAdaptormatrix_##type(ambidata, &ambix->matrix , otherdata, ambix->info.extrachannels, adaptorbuffer, frames); \
-      break;                                                            \
-    case 2:                                                             \
-      _ambix_mergeAdaptormatrix_##type(ambidata, &ambix->matrix2, otherdata, ambix->info.extrachannels, adaptorbuffer, frames); \
-      break;                                                            \
-    default:                                                            \
-      _ambix_mergeAdaptor_##type(ambidata, ambix->info.ambichannels, otherdata, ambix->info.extrachannels, adaptorbuffer, frames); \
-    };                                                                  \
-    return _ambix_writef_##type(ambix, adaptorbuffer, frames);          \
+    if(ambix->writebehind)                                              \
+      return _ambix_writebehind_write(ambix->writebehind, _ambix_writef_merge_##type, sizeof(type##_t), \
+                                      _ambix_writechannels(ambix), ambix->info.extrachannels, \
+                                      ambidata, otherdata, 0, frames);  \
+    return _ambix_writef_merge_##type(ambix, ambidata, otherdata, frames); \
   }
 
 AMBIX_READF(int16);
@@ -517,3 +1161,32 @@ AMBIX_WRITEF(int16);
 AMBIX_WRITEF(int32);
 AMBIX_WRITEF(float32);
 AMBIX_WRITEF(float64);
+
+#define AMBIX_READF_PLANAR(type)                                        \
+  int64_t ambix_readf_##type##_planar (ambix_t*ambix, type##_t**ambidata, type##_t**otherdata, int64_t frames) { \
+    ambix_err_t err= _ambix_check_read(ambix, (const void*)ambidata, (const void*)otherdata, frames); \
+    if(AMBIX_ERR_SUCCESS != err) { return (err>0)?-err:err;}            \
+    return _ambix_readf_chunked_##type(ambix, ambidata, otherdata, frames, _ambix_splitjob_planar_##type); \
+  }
+
+#define AMBIX_WRITEF_PLANAR(type)                                       \
+  int64_t ambix_writef_##type##_planar (ambix_t*ambix, type##_t*const*ambidata, type##_t*const*otherdata, int64_t frames) { \
+    ambix_err_t err= _ambix_check_write(ambix, (const void*)ambidata, (const void*)otherdata, frames); \
+    if(AMBIX_ERR_SUCCESS != err) { return (err>0)?-err:err;}            \
+    /* the writer thread only deals with interleaved data */            \
+    if(ambix->writebehind)                                              \
+      return _ambix_writebehind_write(ambix->writebehind, _ambix_writef_merge_##type, sizeof(type##_t), \
+                                      _ambix_writechannels(ambix), ambix->info.extrachannels, \
+                                      ambidata, otherdata, 1, frames);  \
+    return _ambix_writef_chunked_##type(ambix, ambidata, otherdata, frames, _ambix_mergejob_planar_##type); \
+  }
+
+AMBIX_READF_PLANAR(int16);
+AMBIX_READF_PLANAR(int32);
+AMBIX_READF_PLANAR(float32);
+AMBIX_READF_PLANAR(float64);
+
+AMBIX_WRITEF_PLANAR(int16);
+AMBIX_WRITEF_PLANAR(int32);
+AMBIX_WRITEF_PLANAR(float32);
+AMBIX_WRITEF_PLANAR(float64);
@@ -187,6 +187,9 @@ void swap_stringid(CAFStringID* caf_stringid) {
 unsigned char* get_string_from_buffer(strings_buffer* buffer, uint32_t id) {
   if (buffer) {
     uint32_t i;
+    /* libambix numbers the strings 1...n */
+    if (id > 0 && id <= buffer->num_strings && buffer->string_ids[id-1] == id)
+      return buffer->strings[id-1];
     for (i=0; i<buffer->num_strings;i++) {
       if (buffer->string_ids[i] == id)
         return buffer->strings[i];
@@ -404,12 +407,24 @@ ambix_err_t _ambix_write_markersregions(ambix_t*ambix) {
   int64_t byteoffset_strings = 0;
   CAFStrings *strings_chunk = NULL;
 
+  /* RDRW: replace the chunks found in the file */
+  if (ambix->filemode & AMBIX_READ) {
+    union int_chars mark_id, regn_id, strg_id;
+    mark_id.b[0] = 'm'; mark_id.b[1] = 'a'; mark_id.b[2] = 'r'; mark_id.b[3] = 'k';
+    regn_id.b[0] = 'r'; regn_id.b[1] = 'e'; regn_id.b[2] = 'g'; regn_id.b[3] = 'n';
+    strg_id.b[0] = 's'; strg_id.b[1] = 't'; strg_id.b[2] = 'r'; strg_id.b[3] = 'g';
+    if (AMBIX_ERR_SUCCESS != _ambix_delete_chunks(ambix, mark_id.a)
+        || AMBIX_ERR_SUCCESS != _ambix_delete_chunks(ambix, regn_id.a)
+        || AMBIX_ERR_SUCCESS != _ambix_delete_chunks(ambix, strg_id.a))
+      return AMBIX_ERR_UNKNOWN;
+  }
+
   /* reserve space for strings */
   if (!num_strings) {
     return AMBIX_ERR_SUCCESS;
   }
   datasize_strings = sizeof(uint32_t)+num_strings*sizeof(CAFStringID);
-  strings_data = calloc(1, datasize_strings+256); // reserve a fixed space of 256 bytes for each string
+  strings_data = calloc(1, datasize_strings+num_strings*256); // reserve a fixed space of 256 bytes for each string
   byte_ptr_strings = (unsigned char*)strings_data;
   byte_ptr_strings += (sizeof(uint32_t)+num_strings*(sizeof(CAFStringID)));
   byte_ptr_stringid = (unsigned char*)strings_data;
@@ -511,11 +526,13 @@ ambix_err_t _ambix_write_markersregions(ambix_t*ambix) {
     union int_chars mark_id, regn_id, strg_id;
 
     mark_id.b[0] = 'm'; mark_id.b[1] = 'a'; mark_id.b[2] = 'r'; mark_id.b[3] = 'k';
-    _ambix_write_chunk(ambix, mark_id.a, marker_data, datasize_markers);
+    if (datasize_markers)
+      _ambix_write_chunk(ambix, mark_id.a, marker_data, datasize_markers);
     free(marker_data);
 
     regn_id.b[0] = 'r'; regn_id.b[1] = 'e'; regn_id.b[2] = 'g'; regn_id.b[3] = 'n';
-    _ambix_write_chunk(ambix, regn_id.a, region_data, datasize_regions);
+    if (datasize_regions)
+      _ambix_write_chunk(ambix, regn_id.a, region_data, datasize_regions);
     free(region_data);
 
     strg_id.b[0] = 's'; strg_id.b[1] = 't'; strg_id.b[2] = 'r'; strg_id.b[3] = 'g';
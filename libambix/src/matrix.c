@@ -27,6 +27,10 @@
 # include <stdlib.h>
 #endif /* HAVE_STDLIB_H */
 
+#ifdef HAVE_STRING_H
+# include <string.h>
+#endif /* HAVE_STRING_H */
+
 #include <math.h>
 
 
@@ -40,13 +44,19 @@ ambix_matrix_destroy(ambix_matrix_t*mtx) {
   free(mtx);
   mtx=NULL;
 }
+/* where ambix_matrix_init() puts the coefficients (after the row-pointers) */
+static float32_t*_ambix_matrix_block(float32_t**table, uint32_t rows) {
+  const uintptr_t block=(uintptr_t)(((char*)table) + rows*sizeof(float32_t*));
+  return (float32_t*)((block + AMBIX_MATRIX_ALIGNMENT-1) & ~((uintptr_t)AMBIX_MATRIX_ALIGNMENT-1));
+}
 void
 ambix_matrix_deinit(ambix_matrix_t*mtx) {
   uint32_t r;
-  if(mtx->data) {
+  /* with ambix_matrix_init(), row-pointers and coefficients live in a single
+   * allocation; matrices assembled by the host have their rows allocated separately */
+  if(mtx->data && !(_ambix_matrix_data(mtx) && mtx->data[0] == _ambix_matrix_block(mtx->data, mtx->rows))) {
     for(r=0; r<mtx->rows; r++) {
-      if(mtx->data[r])
-        free(mtx->data[r]);
+      free(mtx->data[r]);
       mtx->data[r]=NULL;
     }
   }
@@ -67,18 +77,46 @@ ambix_matrix_init(uint32_t rows, uint32_t cols, ambix_matrix_t*orgmtx) {
   }
   ambix_matrix_deinit(mtx);
 
-  mtx->rows=rows;
-  mtx->cols=cols;
   if(rows>0 && cols > 0) {
-    mtx->data=(float32_t**)calloc(rows, sizeof(float32_t*));
+    /* the row-pointer table is followed by an aligned block that holds all
+     * coefficients row-by-row (without padding), so mtx->data[0] can be used
+     * as a flat [rows*cols] array */
+    const size_t tablesize=rows*sizeof(float32_t*);
+    const size_t blocksize=(size_t)rows*(size_t)cols*sizeof(float32_t);
+    char*mem=(char*)calloc(1, tablesize + AMBIX_MATRIX_ALIGNMENT + blocksize);
+    float32_t*block;
+    if(!mem) {
+      if(mtx!=orgmtx)
+        free(mtx);
+      return NULL;
+    }
+    mtx->data=(float32_t**)mem;
+    block=_ambix_matrix_block(mtx->data, rows);
     for(r=0; r<rows; r++) {
-      mtx->data[r]=(float32_t*)calloc(cols, sizeof(float32_t));
+      mtx->data[r]=block + (size_t)r*cols;
     }
   }
+  mtx->rows=rows;
+  mtx->cols=cols;
 
   return mtx;
 }
 
+float32_t*
+_ambix_matrix_data(const ambix_matrix_t*mtx) {
+  float32_t*block;
+  uint32_t r;
+  if(!mtx || !mtx->data || !mtx->rows || !mtx->cols)
+    return NULL;
+  block=mtx->data[0];
+  /* matrices assembled by the host need not be contiguous */
+  for(r=1; r<mtx->rows; r++) {
+    if(mtx->data[r] != block + (size_t)r*mtx->cols)
+      return NULL;
+  }
+  return block;
+}
+
 ambix_matrix_t*
 _ambix_matrix_transpose(const ambix_matrix_t*matrix, ambix_matrix_t*xirtam) {
   uint32_t rows, cols, r, c;
@@ -106,6 +144,11 @@ ambix_matrix_fill_data(ambix_matrix_t*mtx, const float32_t*ndata) {
   uint32_t cols=mtx->cols;
   uint32_t r;
   const float*data=(const float*)ndata;
+  float32_t*flat=_ambix_matrix_data(mtx);
+  if(flat) {
+    memcpy(flat, data, (size_t)rows*cols*sizeof(float32_t));
+    return AMBIX_ERR_SUCCESS;
+  }
   for(r=0; r<rows; r++) {
     uint32_t c;
     for(c=0; c<cols; c++) {
@@ -173,6 +216,13 @@ ambix_matrix_copy(const ambix_matrix_t*src, ambix_matrix_t*dest) {
     uint32_t r, c;
     float32_t**s=src->data;
     float32_t**d=dest->data;
+    const float32_t*sflat=_ambix_matrix_data(src);
+    float32_t*dflat=_ambix_matrix_data(dest);
+    if(sflat && dflat) {
+      if(sflat != dflat)
+        memcpy(dflat, sflat, (size_t)src->rows*src->cols*sizeof(float32_t));
+      break;
+    }
     for(r=0; r<src->rows; r++) {
       for(c=0; c<src->cols; c++) {
         d[r][c]=s[r][c];
@@ -184,11 +234,36 @@ ambix_matrix_copy(const ambix_matrix_t*src, ambix_matrix_t*dest) {
 }
 
 
+/*
+ * the product is computed in blocks of _AMBIX_MULTIPLY_ROWS x _AMBIX_MULTIPLY_COLS
+ * (accumulated in double precision), running once through the common dimension
+ * per block.
+ * the right-hand matrix is first packed into contiguous (zero-padded) panels of
+ * common x _AMBIX_MULTIPLY_COLS coefficients; each panel is then re-used (from
+ * the cache) for all rows of the left-hand matrix, and the innermost loop runs
+ * along the (fixed-width) rows of the panel, so the compiler can vectorise it.
+ * each coefficient is still summed up in the same order as with the naive loop.
+ */
+#define _AMBIX_MULTIPLY_ROWS 16
+#define _AMBIX_MULTIPLY_COLS 64
+
+/* acc[c] += lv*row[c] */
+static inline void _ambix_multiply_panel(double*AMBIX_RESTRICT acc, float32_t lv,
+                                         const float32_t*AMBIX_RESTRICT row) {
+  uint32_t c;
+  for(c=0; c<_AMBIX_MULTIPLY_COLS; c++) {
+    const float32_t prod=lv*row[c];
+    acc[c]+=prod;
+  }
+}
+
 ambix_matrix_t*
 _ambix_matrix_multiply(const ambix_matrix_t*left, const ambix_matrix_t*right, ambix_matrix_t*dest) {
-  uint32_t r, c, rows, cols, common;
+  double acc[_AMBIX_MULTIPLY_ROWS][_AMBIX_MULTIPLY_COLS];
+  uint32_t rows, cols, common;
+  uint32_t r0, c0;
   float32_t**ldat,**rdat,**ddat;
-  float32_t lv, rv;
+  float32_t*panel=NULL;
   if(!left || !right)
     return NULL;
 
@@ -209,17 +284,48 @@ _ambix_matrix_multiply(const ambix_matrix_t*left, const ambix_matrix_t*right, am
   rdat=right->data;
   ddat=dest->data;
 
-  for(r=0; r<rows; r++)
-    for(c=0; c<cols; c++) {
-      double sum=0.;
-      uint32_t i;
+  if(rows && cols && common)
+    panel=(float32_t*)malloc((size_t)common*_AMBIX_MULTIPLY_COLS*sizeof(*panel));
+  if(!panel) {
+    /* (out of memory or empty) fall back to the naive loop */
+    uint32_t r, c, i;
+    for(r=0; r<rows; r++)
+      for(c=0; c<cols; c++) {
+        double sum=0.;
+        for(i=0; i<common; i++) {
+          const float32_t prod=ldat[r][i]*rdat[i][c];
+          sum+=prod;
+        }
+        ddat[r][c]=(float32_t)sum;
+      }
+    return dest;
+  }
+
+  for(c0=0; c0<cols; c0+=_AMBIX_MULTIPLY_COLS) {
+    const uint32_t ncols=(cols-c0<_AMBIX_MULTIPLY_COLS)?(cols-c0):_AMBIX_MULTIPLY_COLS;
+    uint32_t i;
+    for(i=0; i<common; i++) {
+      float32_t*prow=panel+(size_t)i*_AMBIX_MULTIPLY_COLS;
+      memcpy(prow, rdat[i]+c0, ncols*sizeof(*prow));
+      memset(prow+ncols, 0, (_AMBIX_MULTIPLY_COLS-ncols)*sizeof(*prow));
+    }
+    for(r0=0; r0<rows; r0+=_AMBIX_MULTIPLY_ROWS) {
+      const uint32_t nrows=(rows-r0<_AMBIX_MULTIPLY_ROWS)?(rows-r0):_AMBIX_MULTIPLY_ROWS;
+      uint32_t r, c;
+      memset(acc, 0, sizeof(acc));
       for(i=0; i<common; i++) {
-        lv=ldat[r][i];
-        rv=rdat[i][c];
-        sum+=lv*rv;
+        const float32_t*prow=panel+(size_t)i*_AMBIX_MULTIPLY_COLS;
+        for(r=0; r<nrows; r++)
+          _ambix_multiply_panel(acc[r], ldat[r0+r][i], prow);
+      }
+      for(r=0; r<nrows; r++) {
+        float32_t*drow=ddat[r0+r]+c0;
+        for(c=0; c<ncols; c++)
+          drow[c]=(float32_t)acc[r][c];
       }
-      ddat[r][c]=(float32_t)sum;
     }
+  }
+  free(panel);
 
   return dest;
 }
@@ -230,11 +336,11 @@ ambix_matrix_fill(ambix_matrix_t*matrix, ambix_matrixtype_t typ) {
   int32_t cols=matrix->cols;
   int32_t r, c;
   float32_t**mtx=matrix->data;
-  ambix_matrix_t*result=NULL;
 
   switch(typ) {
   default:
-    return NULL;
+    /* the conversion matrices are only computed once */
+    return _ambix_matrix_fill_cached(matrix, typ);
   case (AMBIX_MATRIX_ZERO):
     for(r=0; r<rows; r++) {
       for(c=0; c<cols; c++)
@@ -253,7 +359,20 @@ ambix_matrix_fill(ambix_matrix_t*matrix, ambix_matrixtype_t typ) {
         mtx[r][c]=(float32_t)((r==c)?1.:0.);
     }
     break;
+  }
+
+  return matrix;
+}
+
+ambix_matrix_t*
+_ambix_matrix_generate(ambix_matrix_t*matrix, ambix_matrixtype_t typ) {
+  int32_t rows=matrix->rows;
+  int32_t cols=matrix->cols;
+  ambix_matrix_t*result=NULL;
 
+  switch(typ) {
+  default:
+    return NULL;
   case (AMBIX_MATRIX_FUMA): /* Furse Malham -> ACN/SN3D */
     result=_matrix_fuma2ambix(cols);
     if(!result)
@@ -281,6 +400,8 @@ ambix_matrix_fill(ambix_matrix_t*matrix, ambix_matrixtype_t typ) {
     break;
   case (AMBIX_MATRIX_TO_SID): /* ACN -> SID */ {
     float32_t*ordering=(float32_t*)malloc(rows*sizeof(float32_t));
+    if(!ordering)
+      return NULL;
     if(!_matrix_sid2acn(ordering, rows)) {
       free(ordering);
       return NULL;
@@ -298,6 +419,8 @@ ambix_matrix_fill(ambix_matrix_t*matrix, ambix_matrixtype_t typ) {
     if(order<0)
       return NULL;
     weights=(float32_t*)malloc(rows*sizeof(float32_t));
+    if(!weights)
+      return NULL;
     w_=weights;
     for(o=0; o<=order; o++) {
       const float32_t w=(float32_t)(1./sqrt(2.*o+1.));
@@ -318,6 +441,8 @@ ambix_matrix_fill(ambix_matrix_t*matrix, ambix_matrixtype_t typ) {
     if(order<0)
       return NULL;
     weights=(float32_t*)malloc(rows*sizeof(float32_t));
+    if(!weights)
+      return NULL;
     w_=weights;
     for(o=0; o<=order; o++) {
       const float32_t w=(float32_t)(sqrt(2.*o+1.));
@@ -342,7 +467,12 @@ _ambix_matrix_pinv(const ambix_matrix_t*A, ambix_matrix_t*P) {
   const float32_t eps=1e-7;
   ambix_matrix_t *result = NULL;
 
-  /* try cholesky inversion */
+  /* try QR decomposition */
+  result=_ambix_matrix_pinvert_qr(A, P);
+  if(result)
+    return result;
+
+  /* if that fails (out of memory), try the cheaper cholesky inversion */
   result=_ambix_matrix_pinvert_cholesky(A, P, eps);
   if(result)
     return result;
@@ -388,7 +518,7 @@ _ambix_matrix_pinv(const ambix_matrix_t*A, ambix_matrix_t*P) {
 }
 
 #define MTXMULTIPLY_DATA_FLOAT(typ)                                     \
-  ambix_err_t ambix_matrix_multiply_##typ(typ##_t*dest, const ambix_matrix_t*matrix, const typ##_t*source, int64_t frames) { \
+  static ambix_err_t _matrix_multiply_data_##typ(typ##_t*dest, const ambix_matrix_t*matrix, const typ##_t*source, int64_t frames) { \
     float32_t**mtx=matrix->data;                                        \
     const uint32_t outchannels=matrix->rows;                            \
     const uint32_t inchannels=matrix->cols;                             \
@@ -414,8 +544,56 @@ _ambix_matrix_pinv(const ambix_matrix_t*A, ambix_matrix_t*P) {
 MTXMULTIPLY_DATA_FLOAT(float32);
 MTXMULTIPLY_DATA_FLOAT(float64);
 
+static int _matrix_precision_valid(ambix_precision_t precision) {
+  return (_AMBIX_PRECISION_MODE(precision) <= AMBIX_PRECISION_KAHAN);
+}
+
+ambix_err_t ambix_matrix_multiply_float32_precision(float32_t*dest, const ambix_matrix_t*matrix, const float32_t*source, int64_t frames,
+                                                    ambix_precision_t precision) {
+  const float32_t*mtx=_ambix_matrix_data(matrix);
+  _ambix_fpstate_t fpstate;
+  if(!_matrix_precision_valid(precision))
+    return AMBIX_ERR_UNKNOWN;
+  if(AMBIX_PRECISION_FLUSH_DENORMALS & precision)
+    _ambix_denormals_disable(&fpstate);
+  /* matrices that were assembled by the host (non-contiguous) take the slow path */
+  if(!mtx)
+    _matrix_multiply_data_float32(dest, matrix, source, frames);
+  else
+    _ambix_mtxmul_float32_tiled(_ambix_get_mtxkernel_float32(precision, AMBIX_PRECISION_DOUBLE),
+                                dest, matrix->rows, mtx, matrix->rows, matrix->cols,
+                                source, matrix->cols, frames);
+  if(AMBIX_PRECISION_FLUSH_DENORMALS & precision)
+    _ambix_denormals_restore(&fpstate);
+  return AMBIX_ERR_SUCCESS;
+}
+ambix_err_t ambix_matrix_multiply_float64_precision(float64_t*dest, const ambix_matrix_t*matrix, const float64_t*source, int64_t frames,
+                                                    ambix_precision_t precision) {
+  const float32_t*mtx=_ambix_matrix_data(matrix);
+  _ambix_fpstate_t fpstate;
+  if(!_matrix_precision_valid(precision))
+    return AMBIX_ERR_UNKNOWN;
+  if(AMBIX_PRECISION_FLUSH_DENORMALS & precision)
+    _ambix_denormals_disable(&fpstate);
+  if(mtx && AMBIX_PRECISION_KAHAN == _AMBIX_PRECISION_MODE(precision))
+    _ambix_mtxmul_float64_kahan_scalar(dest, matrix->rows, mtx, matrix->rows, matrix->cols,
+                                       source, matrix->cols, frames);
+  else
+    _matrix_multiply_data_float64(dest, matrix, source, frames);
+  if(AMBIX_PRECISION_FLUSH_DENORMALS & precision)
+    _ambix_denormals_restore(&fpstate);
+  return AMBIX_ERR_SUCCESS;
+}
+ambix_err_t ambix_matrix_multiply_float32(float32_t*dest, const ambix_matrix_t*matrix, const float32_t*source, int64_t frames) {
+  return ambix_matrix_multiply_float32_precision(dest, matrix, source, frames, AMBIX_PRECISION_DEFAULT);
+}
+ambix_err_t ambix_matrix_multiply_float64(float64_t*dest, const ambix_matrix_t*matrix, const float64_t*source, int64_t frames) {
+  return ambix_matrix_multiply_float64_precision(dest, matrix, source, frames, AMBIX_PRECISION_DEFAULT);
+}
+
+/* floating point fallback for matrices that cannot be represented in fixed point */
 #define MTXMULTIPLY_DATA_INT(typ)                                       \
-  ambix_err_t ambix_matrix_multiply_##typ(typ##_t*dest, const ambix_matrix_t*matrix, const typ##_t*source, int64_t frames) { \
+  static ambix_err_t _matrix_multiply_data_##typ(typ##_t*dest, const ambix_matrix_t*matrix, const typ##_t*source, int64_t frames) { \
     float32_t**mtx=matrix->data; \
     const uint32_t outchannels=matrix->rows;                            \
     const uint32_t inchannels=matrix->cols;                             \
@@ -432,7 +610,7 @@ MTXMULTIPLY_DATA_FLOAT(float64);
           double in=src[inchan*frames];                                 \
           sum+=scale * in;                                              \
         }                                                               \
-        dst[frames*outchan]=(typ##_t)(sum);  /* FIXXXME: saturation */  \
+        dst[frames*outchan]=_ambix_float_to_##typ(sum);                 \
       }                                                                 \
     }                                                                   \
     return AMBIX_ERR_SUCCESS;                                           \
@@ -441,6 +619,53 @@ MTXMULTIPLY_DATA_FLOAT(float64);
 MTXMULTIPLY_DATA_INT(int16);
 MTXMULTIPLY_DATA_INT(int32);
 
+/* fixed point multiplication:
+ * the data is laid out channel by channel, so we accumulate a block of frames
+ * at once (which vectorizes nicely) */
+#define MTXMULTIPLY_FIXED_BLOCKSIZE 256
+#define MTXMULTIPLY_DATA_FIXED(typ)                                     \
+  ambix_err_t ambix_matrix_multiply_##typ(typ##_t*dest, const ambix_matrix_t*matrix, const typ##_t*source, int64_t frames) { \
+    const float32_t*coeffs=_ambix_matrix_data(matrix);                  \
+    const uint32_t outchannels=matrix->rows;                            \
+    const uint32_t inchannels=matrix->cols;                             \
+    int32_t*fixed=NULL;                                                 \
+    int shift=-1;                                                       \
+    uint32_t outchan, inchan;                                           \
+    if(coeffs)                                                          \
+      fixed=(int32_t*)malloc(outchannels*inchannels*sizeof(*fixed));    \
+    if(fixed)                                                           \
+      shift=_ambix_matrix_to_fixed(coeffs, outchannels, inchannels, fixed); \
+    if(shift<0) {                                                       \
+      free(fixed);                                                      \
+      return _matrix_multiply_data_##typ(dest, matrix, source, frames); \
+    }                                                                   \
+    for(outchan=0; outchan<outchannels; outchan++) {                    \
+      const int32_t*q=fixed+outchan*inchannels;                         \
+      typ##_t*dst=dest+frames*outchan;                                  \
+      int64_t offset;                                                   \
+      for(offset=0; offset<frames; offset+=MTXMULTIPLY_FIXED_BLOCKSIZE) { \
+        int64_t acc[MTXMULTIPLY_FIXED_BLOCKSIZE];                       \
+        const int64_t blocksize=(frames-offset<MTXMULTIPLY_FIXED_BLOCKSIZE)?(frames-offset):MTXMULTIPLY_FIXED_BLOCKSIZE; \
+        int64_t f;                                                      \
+        for(f=0; f<blocksize; f++)                                      \
+          acc[f]=0;                                                     \
+        for(inchan=0; inchan<inchannels; inchan++) {                    \
+          const int64_t scale=q[inchan];                                \
+          const typ##_t*src=source+frames*inchan+offset;                \
+          for(f=0; f<blocksize; f++)                                    \
+            acc[f]+=scale*src[f];                                       \
+        }                                                               \
+        for(f=0; f<blocksize; f++)                                      \
+          dst[offset+f]=_ambix_fixed_to_##typ(acc[f], shift);           \
+      }                                                                 \
+    }                                                                   \
+    free(fixed);                                                        \
+    return AMBIX_ERR_SUCCESS;                                           \
+  }
+
+MTXMULTIPLY_DATA_FIXED(int16);
+MTXMULTIPLY_DATA_FIXED(int32);
+
 
 
 /* conversion matrices
@@ -0,0 +1,124 @@
+/* matrix_cache.c -  precomputed conversion matrices              -*- c -*-
+
+   Copyright © 2026 IOhannes m zmölnig <zmoelnig@iem.at>.
+         Institute of Electronic Music and Acoustics (IEM),
+         University of Music and Dramatic Arts, Graz
+
+   This file is part of libambix
+
+   libambix is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   libambix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+ * building the conversion matrices (FuMa, SID, N3D) involves temporary
+ * matrices and weight tables; hosts tend to ask for the same few matrices
+ * over and over again.
+ * so each matrix is only computed once (per type and size), and kept
+ * (read-only) until the library is unloaded.
+ * entries are never modified nor removed once they are published, so the
+ * lock only needs to protect the lookup/insertion.
+ */
+
+#include "private.h"
+
+#ifdef HAVE_STDLIB_H
+# include <stdlib.h>
+#endif /* HAVE_STDLIB_H */
+
+#if defined HAVE_PTHREADS
+# include <pthread.h>
+static pthread_mutex_t s_cachelock=PTHREAD_MUTEX_INITIALIZER;
+# define _AMBIX_CACHE_LOCK() pthread_mutex_lock(&s_cachelock)
+# define _AMBIX_CACHE_UNLOCK() pthread_mutex_unlock(&s_cachelock)
+#elif defined _WIN32
+# include <windows.h>
+static SRWLOCK s_cachelock=SRWLOCK_INIT;
+# define _AMBIX_CACHE_LOCK() AcquireSRWLockExclusive(&s_cachelock)
+# define _AMBIX_CACHE_UNLOCK() ReleaseSRWLockExclusive(&s_cachelock)
+#else
+# define _AMBIX_CACHE_LOCK()
+# define _AMBIX_CACHE_UNLOCK()
+#endif
+
+/* the number of distinct matrices to keep;
+ * any further matrices are computed on demand (and not cached) */
+#define _AMBIX_MATRIX_CACHE_SIZE 64
+
+typedef struct _ambix_matrixcache_entry {
+  ambix_matrixtype_t type;
+  uint32_t rows, cols;
+  ambix_matrix_t*matrix;
+} _ambix_matrixcache_entry_t;
+
+static _ambix_matrixcache_entry_t s_cache[_AMBIX_MATRIX_CACHE_SIZE];
+static unsigned int s_cachesize=0;
+
+static const ambix_matrix_t*_ambix_matrixcache_find(ambix_matrixtype_t typ, uint32_t rows, uint32_t cols) {
+  unsigned int i;
+  for(i=0; i<s_cachesize; i++) {
+    const _ambix_matrixcache_entry_t*entry=s_cache+i;
+    if(entry->type == typ && entry->rows == rows && entry->cols == cols)
+      return entry->matrix;
+  }
+  return NULL;
+}
+
+ambix_matrix_t*
+_ambix_matrix_fill_cached(ambix_matrix_t*matrix, ambix_matrixtype_t typ) {
+  const uint32_t rows=matrix->rows, cols=matrix->cols;
+  const ambix_matrix_t*cached=NULL;
+  ambix_matrix_t*generated=NULL;
+  int full=0;
+
+  _AMBIX_CACHE_LOCK();
+  cached=_ambix_matrixcache_find(typ, rows, cols);
+  full=(s_cachesize >= _AMBIX_MATRIX_CACHE_SIZE);
+  _AMBIX_CACHE_UNLOCK();
+  if(cached)
+    return ambix_matrix_copy(cached, matrix);
+  if(full)
+    return _ambix_matrix_generate(matrix, typ);
+
+  /* compute the matrix outside the lock; if another thread was faster,
+   * we just throw ours away */
+  generated=ambix_matrix_init(rows, cols, NULL);
+  if(!generated)
+    return NULL;
+  if(!_ambix_matrix_generate(generated, typ)) {
+    ambix_matrix_destroy(generated);
+    return NULL;
+  }
+
+  _AMBIX_CACHE_LOCK();
+  cached=_ambix_matrixcache_find(typ, rows, cols);
+  if(!cached && s_cachesize < _AMBIX_MATRIX_CACHE_SIZE) {
+    _ambix_matrixcache_entry_t*entry=s_cache+s_cachesize;
+    entry->type=typ;
+    entry->rows=rows;
+    entry->cols=cols;
+    entry->matrix=generated;
+    s_cachesize++;
+    cached=generated;
+    generated=NULL;
+  }
+  _AMBIX_CACHE_UNLOCK();
+
+  if(generated) {
+    matrix=ambix_matrix_copy(generated, matrix);
+    ambix_matrix_destroy(generated);
+    return matrix;
+  }
+  return ambix_matrix_copy(cached, matrix);
+}
@@ -28,6 +28,8 @@
 #endif /* HAVE_STDLIB_H */
 
 #include <math.h>
+#include <float.h>
+#include <string.h>
 
 /**
  * simple matrix inversion of square matrices, using Gauss-Jordan
@@ -256,3 +258,215 @@ _ambix_matrix_pinvert_cholesky(const ambix_matrix_t*input, ambix_matrix_t*invers
 
   return result;
 }
+
+/*
+ * pseudo-inverse via a (double precision) rank-revealing QR decomposition
+ *
+ * the normal equations used by the Cholesky pseudo-inverse square the condition
+ * number of the matrix, which (in single precision) breaks down for the large
+ * reduced sets of higher orders.
+ * instead we factorize (for rows>=cols; otherwise we work on the transpose)
+ *   A*P = Q*R
+ * using Householder reflections with column pivoting, and stop at the numerical
+ * rank k. if A has full column rank, the pseudo-inverse is
+ *   pinv(A) = P * inv(R) * Q1'
+ * otherwise the trapezoidal R1 (the first k rows of R) is decomposed once more
+ * as R1' = Z1*T1, so
+ *   pinv(A) = P * Z1 * inv(T1') * Q1'
+ * (Q1 resp. Z1 being the first k columns of the orthogonal factors).
+ *
+ * all columns are stored contiguously, so the inner loops are simple dot
+ * products resp. axpy's over contiguous memory.
+ */
+
+/* sum(x[i]*y[i]), with independent partial sums to keep the pipeline busy */
+static double _qr_dot(const double*x, const double*y, uint32_t n) {
+  double s0=0., s1=0., s2=0., s3=0.;
+  uint32_t i=0;
+  for(; i+4<=n; i+=4) {
+    s0+=x[i+0]*y[i+0];
+    s1+=x[i+1]*y[i+1];
+    s2+=x[i+2]*y[i+2];
+    s3+=x[i+3]*y[i+3];
+  }
+  for(; i<n; i++)
+    s0+=x[i]*y[i];
+  return (s0+s1)+(s2+s3);
+}
+/* y += alpha*x */
+static void _qr_axpy(double*AMBIX_RESTRICT y, double alpha, const double*AMBIX_RESTRICT x, uint32_t n) {
+  uint32_t i;
+  for(i=0; i<n; i++)
+    y[i]+=alpha*x[i];
+}
+
+/* turn x[0..n-1] into the Householder vector v (with an implicit v[0]=1),
+ * so that (I-tau*v*v')*x = [alpha 0 ... 0]; x[0] receives alpha */
+static double _qr_householder(double*x, uint32_t n) {
+  const double x0=x[0];
+  const double tailnorm2=(n>1)?_qr_dot(x+1, x+1, n-1):0.;
+  double alpha, scale;
+  uint32_t i;
+  if(0.==tailnorm2)
+    return 0.;
+  alpha=sqrt(x0*x0+tailnorm2);
+  if(x0>0.)
+    alpha=-alpha;
+  scale=1./(x0-alpha);
+  for(i=1; i<n; i++)
+    x[i]*=scale;
+  x[0]=alpha;
+  return (alpha-x0)/alpha;
+}
+/* apply (I-tau*v*v') to y[0..n-1], with v=[1 v[1] ... v[n-1]] */
+static void _qr_reflect(const double*v, double tau, double*y, uint32_t n) {
+  double w;
+  if(0.==tau)
+    return;
+  w=tau*(y[0]+_qr_dot(v+1, y+1, n-1));
+  y[0]-=w;
+  _qr_axpy(y+1, -w, v+1, n-1);
+}
+
+ambix_matrix_t*
+_ambix_matrix_pinvert_qr(const ambix_matrix_t*input, ambix_matrix_t*inverse) {
+  const int transpose=(input->rows < input->cols);
+  const uint32_t m=transpose?input->cols:input->rows;
+  const uint32_t n=transpose?input->rows:input->cols;
+  double tolerance;
+  double*a, *tau, *norms, *q, *y, *z, *ztau;
+  uint32_t*perm;
+  uint32_t i, j, r, c, k=0;
+  void*mem;
+  if(!input->data || !m || !n)
+    return NULL;
+
+  /* a: [n][m] (column-major A*P, Householder vectors below the diagonal)
+   * q: [k][m] (columns of Q1)
+   * y: [n][m] (rows of the result, before permutation)
+   * z: [k][n] (columns of R1', Householder vectors below the diagonal)
+   */
+  mem=calloc(1, (3*(size_t)n*m + (size_t)n*n + 3*n)*sizeof(double) + n*sizeof(uint32_t));
+  if(!mem)
+    return NULL;
+  a=(double*)mem;
+  q=a+(size_t)n*m;
+  y=q+(size_t)n*m;
+  z=y+(size_t)n*m;
+  tau=z+(size_t)n*n;
+  ztau=tau+n;
+  norms=ztau+n;
+  perm=(uint32_t*)(norms+n);
+
+  for(j=0; j<n; j++) {
+    double*col=a+(size_t)j*m;
+    for(i=0; i<m; i++)
+      col[i]=transpose?input->data[j][i]:input->data[i][j];
+    perm[j]=j;
+  }
+
+  /* Householder QR with column pivoting, up to the numerical rank */
+  tolerance=0.;
+  for(k=0; k<n; k++) {
+    uint32_t pivot=k;
+    for(j=k; j<n; j++) {
+      const double*col=a+(size_t)j*m+k;
+      norms[j]=_qr_dot(col, col, m-k);
+      if(norms[j]>norms[pivot])
+        pivot=j;
+    }
+    if(0==k)
+      tolerance=sqrt(norms[pivot]) * (double)m * FLT_EPSILON;
+    if(!(sqrt(norms[pivot]) > tolerance))
+      break;
+    if(pivot!=k) {
+      double*col0=a+(size_t)k*m, *col1=a+(size_t)pivot*m;
+      uint32_t p=perm[k];
+      perm[k]=perm[pivot];
+      perm[pivot]=p;
+      for(i=0; i<m; i++) {
+        double t=col0[i];
+        col0[i]=col1[i];
+        col1[i]=t;
+      }
+    }
+    tau[k]=_qr_householder(a+(size_t)k*m+k, m-k);
+    for(j=k+1; j<n; j++)
+      _qr_reflect(a+(size_t)k*m+k, tau[k], a+(size_t)j*m+k, m-k);
+  }
+
+  /* Q1 = H0*H1*...*H(k-1) * [I;0] */
+  for(c=0; c<k; c++)
+    q[(size_t)c*m+c]=1.;
+  for(j=k; j-->0; ) {
+    for(c=j; c<k; c++)
+      _qr_reflect(a+(size_t)j*m+j, tau[j], q+(size_t)c*m+j, m-j);
+  }
+
+  if(k==n) {
+    /* full rank: solve R*Y = Q1' (backwards, row by row) */
+    for(r=n; r-->0; ) {
+      double*yrow=y+(size_t)r*m;
+      memcpy(yrow, q+(size_t)r*m, m*sizeof(*yrow));
+      for(c=r+1; c<n; c++)
+        _qr_axpy(yrow, -a[(size_t)c*m+r], y+(size_t)c*m, m);
+      for(i=0; i<m; i++)
+        yrow[i]/=a[(size_t)r*m+r];
+    }
+  } else if(k>0) {
+    /* rank deficient: R1' = Z1*T1 */
+    for(r=0; r<k; r++) {
+      double*zcol=z+(size_t)r*n;
+      for(c=r; c<n; c++)
+        zcol[c]=a[(size_t)c*m+r];
+    }
+    for(r=0; r<k; r++) {
+      ztau[r]=_qr_householder(z+(size_t)r*n+r, n-r);
+      for(j=r+1; j<k; j++)
+        _qr_reflect(z+(size_t)r*n+r, ztau[r], z+(size_t)j*n+r, n-r);
+    }
+    /* solve T1'*Y = Q1' (forwards, row by row); T1'[r][c] = T1[c][r] */
+    for(r=0; r<k; r++) {
+      double*yrow=y+(size_t)r*m;
+      memcpy(yrow, q+(size_t)r*m, m*sizeof(*yrow));
+      for(c=0; c<r; c++)
+        _qr_axpy(yrow, -z[(size_t)r*n+c], y+(size_t)c*m, m);
+      for(i=0; i<m; i++)
+        yrow[i]/=z[(size_t)r*n+r];
+    }
+    /* Y = Z1*[Y;0] (the rows k..n-1 of y are still 0) */
+    for(j=k; j-->0; ) {
+      /* rows j..n-1 of Y are reflected: Y -= tau*v*(v'*Y) */
+      const double*v=z+(size_t)j*n+j;
+      double*vy=q; /* Q1 is no longer needed */
+      if(0.==ztau[j])
+        continue;
+      memcpy(vy, y+(size_t)j*m, m*sizeof(*vy));
+      for(r=j+1; r<n; r++)
+        _qr_axpy(vy, v[r-j], y+(size_t)r*m, m);
+      _qr_axpy(y+(size_t)j*m, -ztau[j], vy, m);
+      for(r=j+1; r<n; r++)
+        _qr_axpy(y+(size_t)r*m, -ztau[j]*v[r-j], vy, m);
+    }
+  }
+
+  /* pinv = P*Y (resp. its transpose) */
+  if(!inverse)
+    inverse=ambix_matrix_init(input->cols, input->rows, NULL);
+  else if((inverse->rows != input->cols) || (inverse->cols != input->rows))
+    inverse=ambix_matrix_init(input->cols, input->rows, inverse);
+  if(inverse) {
+    for(r=0; r<n; r++) {
+      const double*yrow=y+(size_t)r*m;
+      const uint32_t row=perm[r];
+      for(i=0; i<m; i++) {
+        if(transpose)
+          inverse->data[i][row]=(float32_t)yrow[i];
+        else
+          inverse->data[row][i]=(float32_t)yrow[i];
+      }
+    }
+  }
+  free(mem);
+  return inverse;
+}
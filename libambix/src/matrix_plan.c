@@ -0,0 +1,440 @@
+/* matrix_plan.c -  structure-aware execution of adaptor matrices              -*- c -*-
+
+   Copyright © 2026 IOhannes m zmölnig <zmoelnig@iem.at>.
+         Institute of Electronic Music and Acoustics (IEM),
+         University of Music and Dramatic Arts, Graz
+
+   This file is part of libambix
+
+   libambix is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   libambix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+ * most matrices created by libambix itself are sparse:
+ * _matrix_router() creates permutations, _matrix_diag() creates the
+ * N3D/SN3D weights and FuMa is a weighted permutation.
+ * rotations (as applied by hosts) are block-diagonal (one block per order).
+ *
+ * instead of running the dense O(rows*cols) loop on every frame, we analyse the
+ * matrix once and pick the cheapest way to apply it.
+ */
+
+#include "private.h"
+
+#ifdef HAVE_STDLIB_H
+# include <stdlib.h>
+#endif /* HAVE_STDLIB_H */
+#ifdef HAVE_STRING_H
+# include <string.h>
+#endif /* HAVE_STRING_H */
+
+void _ambix_matrixplan_deinit(_ambix_matrixplan_t*plan) {
+  free(plan->index);
+  free(plan->gain);
+  free(plan->blocks);
+  free(plan->coeffs);
+  free(plan->fixed);
+  memset(plan, 0, sizeof(*plan));
+}
+
+/* each row has at most a single non-zero coefficient */
+static int _plan_gather(_ambix_matrixplan_t*plan, const ambix_matrix_t*matrix) {
+  const uint32_t rows=matrix->rows, cols=matrix->cols;
+  int unity=1, diagonal=(rows==cols);
+  uint32_t r, c;
+  for(r=0; r<rows; r++) {
+    const float32_t*row=matrix->data[r];
+    uint32_t nonzero=0;
+    for(c=0; c<cols; c++) {
+      if(0.f!=row[c])
+        nonzero++;
+    }
+    if(nonzero>1)
+      return 0;
+  }
+
+  plan->index=(uint32_t*)calloc(rows, sizeof(*plan->index));
+  plan->gain=(float32_t*)calloc(rows, sizeof(*plan->gain));
+  if(!plan->index || !plan->gain)
+    return 0;
+
+  for(r=0; r<rows; r++) {
+    const float32_t*row=matrix->data[r];
+    /* all-zero rows read from an arbitrary (valid) channel with 0 gain */
+    plan->index[r]=(r<cols)?r:0;
+    plan->gain[r]=0.f;
+    for(c=0; c<cols; c++) {
+      if(0.f!=row[c]) {
+        plan->index[r]=c;
+        plan->gain[r]=row[c];
+        break;
+      }
+    }
+    if(1.f!=plan->gain[r])
+      unity=0;
+    if(plan->index[r]!=r)
+      diagonal=0;
+  }
+
+  if(unity)
+    plan->type=diagonal?AMBIX_PLAN_IDENTITY:AMBIX_PLAN_PERMUTATION;
+  else
+    plan->type=diagonal?AMBIX_PLAN_DIAGONAL:AMBIX_PLAN_GATHER;
+  return 1;
+}
+
+/* split a square matrix into the finest set of blocks along the diagonal */
+static int _plan_blockdiagonal(_ambix_matrixplan_t*plan, const ambix_matrix_t*matrix) {
+  const uint32_t size=matrix->rows;
+  uint32_t*blocks=NULL;
+  uint32_t numblocks=0, start=0, reach=0;
+  uint32_t i, j, b, ncoeffs=0;
+  float32_t*coeffs;
+  if(size!=matrix->cols || size<2)
+    return 0;
+
+  blocks=(uint32_t*)calloc(size+1, sizeof(*blocks));
+  if(!blocks)
+    return 0;
+  for(i=0; i<size; i++) {
+    /* how far does row/column #i reach away from the diagonal? */
+    for(j=size-1; j>reach; j--) {
+      if(0.f!=matrix->data[i][j] || 0.f!=matrix->data[j][i]) {
+        reach=j;
+        break;
+      }
+    }
+    if(reach<=i) {
+      blocks[numblocks++]=start;
+      ncoeffs+=(i+1-start)*(i+1-start);
+      start=i+1;
+      reach=start;
+    }
+  }
+  blocks[numblocks]=size;
+  if(numblocks<2) {
+    free(blocks);
+    return 0;
+  }
+
+  coeffs=(float32_t*)calloc(ncoeffs, sizeof(*coeffs));
+  if(!coeffs) {
+    free(blocks);
+    return 0;
+  }
+  plan->blocks=blocks;
+  plan->numblocks=numblocks;
+  plan->coeffs=coeffs;
+  /* pack the blocks (row-major) one after the other */
+  for(b=0; b<numblocks; b++) {
+    const uint32_t offset=blocks[b], n=blocks[b+1]-blocks[b];
+    for(i=0; i<n; i++)
+      for(j=0; j<n; j++)
+        *coeffs++=matrix->data[offset+i][offset+j];
+  }
+  plan->type=AMBIX_PLAN_BLOCKDIAGONAL;
+  return 1;
+}
+
+/* fixed-point coefficients for the integer paths */
+static void _plan_fixed(_ambix_matrixplan_t*plan, const ambix_matrix_t*matrix) {
+  const float32_t*flat=_ambix_matrix_data(matrix);
+  int32_t*fixed=NULL;
+  int shift=-1;
+  uint32_t count=plan->rows*plan->cols;
+  switch(plan->type) {
+  case AMBIX_PLAN_DIAGONAL:
+  case AMBIX_PLAN_GATHER:
+    fixed=(int32_t*)calloc(plan->rows, sizeof(*fixed));
+    if(fixed)
+      shift=_ambix_matrix_to_fixed(plan->gain, plan->rows, 1, fixed);
+    break;
+  case AMBIX_PLAN_DENSE:
+  case AMBIX_PLAN_BLOCKDIAGONAL:
+    if(!flat)
+      break;
+    fixed=(int32_t*)calloc(count, sizeof(*fixed));
+    if(fixed)
+      shift=_ambix_matrix_to_fixed(flat, plan->rows, plan->cols, fixed);
+    if(shift>=0 && AMBIX_PLAN_BLOCKDIAGONAL==plan->type) {
+      /* the row sums of the blocks are those of the full matrix,
+       * so we can simply pack the converted coefficients */
+      int32_t*packed=fixed;
+      uint32_t b, i, j;
+      for(b=0; b<plan->numblocks; b++) {
+        const uint32_t offset=plan->blocks[b], n=plan->blocks[b+1]-plan->blocks[b];
+        for(i=0; i<n; i++)
+          for(j=0; j<n; j++)
+            *packed++=fixed[(offset+i)*plan->cols+offset+j];
+      }
+    }
+    break;
+  default:
+    /* identity and permutations are exact anyhow */
+    return;
+  }
+  if(shift<0) {
+    free(fixed);
+    return;
+  }
+  plan->fixed=fixed;
+  plan->fixedshift=shift;
+}
+
+ambix_err_t _ambix_matrixplan_init(_ambix_matrixplan_t*plan, const ambix_matrix_t*matrix) {
+  _ambix_matrixplan_deinit(plan);
+  plan->matrix=matrix;
+  plan->type=AMBIX_PLAN_DENSE;
+  if(!matrix)
+    return AMBIX_ERR_INVALID_MATRIX;
+  plan->rows=matrix->rows;
+  plan->cols=matrix->cols;
+  if(!matrix->data || !plan->rows || !plan->cols)
+    return AMBIX_ERR_SUCCESS;
+
+  if(!_plan_gather(plan, matrix)) {
+    /* a failed analysis might have left some memory behind */
+    free(plan->index);
+    free(plan->gain);
+    plan->index=NULL;
+    plan->gain=NULL;
+
+    /* if this fails as well, we stay with the DENSE plan */
+    _plan_blockdiagonal(plan, matrix);
+  }
+  _plan_fixed(plan, matrix);
+  return AMBIX_ERR_SUCCESS;
+}
+
+void _ambix_matrixplan_init_dense(_ambix_matrixplan_t*plan, const ambix_matrix_t*matrix) {
+  /* nothing to free: the plan only points to the matrix */
+  memset(plan, 0, sizeof(*plan));
+  plan->type=AMBIX_PLAN_DENSE;
+  plan->matrix=matrix;
+  plan->rows=matrix->rows;
+  plan->cols=matrix->cols;
+}
+
+/* DENSE: the float types use the kernel for the requested precision;
+ * matrices assembled by the host are handled by _ambix_split/mergeAdaptormatrix */
+static ambix_err_t _matrixplan_dense_float32(const _ambix_matrixplan_t*plan,
+                                             float32_t*dest, uint32_t deststride,
+                                             const float32_t*source, uint32_t sourcestride,
+                                             int64_t frames) {
+  const float32_t*mtx=_ambix_matrix_data(plan->matrix);
+  if(!mtx)
+    return AMBIX_ERR_INVALID_MATRIX;
+  _ambix_mtxmul_float32_tiled(_ambix_get_mtxkernel_float32(plan->precision, AMBIX_PRECISION_FAST),
+                              dest, deststride, mtx, plan->rows, plan->cols,
+                              source, sourcestride, frames);
+  return AMBIX_ERR_SUCCESS;
+}
+static ambix_err_t _matrixplan_dense_float64(const _ambix_matrixplan_t*plan,
+                                             float64_t*dest, uint32_t deststride,
+                                             const float64_t*source, uint32_t sourcestride,
+                                             int64_t frames) {
+  const float32_t*mtx=_ambix_matrix_data(plan->matrix);
+  if(!mtx || AMBIX_PRECISION_KAHAN != _AMBIX_PRECISION_MODE(plan->precision))
+    return AMBIX_ERR_INVALID_MATRIX;
+  _ambix_mtxmul_float64_kahan_scalar(dest, deststride, mtx, plan->rows, plan->cols,
+                                     source, sourcestride, frames);
+  return AMBIX_ERR_SUCCESS;
+}
+#define _AMBIX_MATRIXPLAN_DENSE_FIXED(typ)                              \
+  static ambix_err_t _matrixplan_dense_##typ(const _ambix_matrixplan_t*plan, \
+                                             typ##_t*dest, uint32_t deststride, \
+                                             const typ##_t*source, uint32_t sourcestride, \
+                                             int64_t frames) {          \
+    if(!plan->fixed)                                                    \
+      return AMBIX_ERR_INVALID_MATRIX;                                  \
+    _ambix_mtxmul_##typ##_tiled(_ambix_get_kernels()->mtxmul_##typ,    \
+                                dest, deststride, plan->fixed, plan->rows, plan->cols, plan->fixedshift, \
+                                source, sourcestride, frames);          \
+    return AMBIX_ERR_SUCCESS;                                           \
+  }
+_AMBIX_MATRIXPLAN_DENSE_FIXED(int16);
+_AMBIX_MATRIXPLAN_DENSE_FIXED(int32);
+
+/* DIAGONAL/GATHER (for DIAGONAL plans, index[r]==r) */
+#define _AMBIX_MATRIXPLAN_GATHER_FLOAT(typ)                             \
+  static void _matrixplan_gather_##typ(const _ambix_matrixplan_t*plan,  \
+                                       typ##_t*dest, uint32_t deststride, \
+                                       const typ##_t*source, uint32_t sourcestride, \
+                                       int64_t frames) {                \
+    const uint32_t rows=plan->rows;                                     \
+    const uint32_t*index=plan->index;                                   \
+    const float32_t*gain=plan->gain;                                    \
+    int64_t f;                                                          \
+    uint32_t r;                                                         \
+    for(f=0; f<frames; f++) {                                           \
+      const typ##_t*src=source+f*sourcestride;                          \
+      typ##_t*dst=dest+f*deststride;                                    \
+      for(r=0; r<rows; r++)                                             \
+        dst[r]=(typ##_t)(gain[r]*src[index[r]]);                        \
+    }                                                                   \
+  }
+_AMBIX_MATRIXPLAN_GATHER_FLOAT(float32);
+_AMBIX_MATRIXPLAN_GATHER_FLOAT(float64);
+#define _AMBIX_MATRIXPLAN_GATHER_FIXED(typ)                             \
+  static void _matrixplan_gather_##typ(const _ambix_matrixplan_t*plan,  \
+                                       typ##_t*dest, uint32_t deststride, \
+                                       const typ##_t*source, uint32_t sourcestride, \
+                                       int64_t frames) {                \
+    const uint32_t rows=plan->rows;                                     \
+    const uint32_t*index=plan->index;                                   \
+    const float32_t*gain=plan->gain;                                    \
+    const int32_t*fixed=plan->fixed;                                    \
+    const uint32_t shift=plan->fixedshift;                              \
+    int64_t f;                                                          \
+    uint32_t r;                                                         \
+    for(f=0; f<frames; f++) {                                           \
+      const typ##_t*src=source+f*sourcestride;                          \
+      typ##_t*dst=dest+f*deststride;                                    \
+      if(fixed) {                                                       \
+        for(r=0; r<rows; r++)                                           \
+          dst[r]=_ambix_fixed_to_##typ((int64_t)fixed[r]*src[index[r]], shift); \
+      } else {                                                          \
+        for(r=0; r<rows; r++)                                           \
+          dst[r]=_ambix_float_to_##typ((float64_t)gain[r]*src[index[r]]); \
+      }                                                                 \
+    }                                                                   \
+  }
+_AMBIX_MATRIXPLAN_GATHER_FIXED(int16);
+_AMBIX_MATRIXPLAN_GATHER_FIXED(int32);
+
+/* BLOCKDIAGONAL: float32 blocks use the (SIMD) matrix kernels */
+static void _matrixplan_blocks_float32(const _ambix_matrixplan_t*plan,
+                                       float32_t*dest, uint32_t deststride,
+                                       const float32_t*source, uint32_t sourcestride,
+                                       int64_t frames) {
+  const _ambix_mtxkernel_float32_t kernel=_ambix_get_mtxkernel_float32(plan->precision, AMBIX_PRECISION_FAST);
+  const float32_t*coeffs=plan->coeffs;
+  uint32_t b;
+  for(b=0; b<plan->numblocks; b++) {
+    const uint32_t offset=plan->blocks[b], n=plan->blocks[b+1]-plan->blocks[b];
+    kernel(dest+offset, deststride, coeffs, n, n, source+offset, sourcestride, frames);
+    coeffs+=n*n;
+  }
+}
+static void _matrixplan_blocks_float64(const _ambix_matrixplan_t*plan,
+                                       float64_t*dest, uint32_t deststride,
+                                       const float64_t*source, uint32_t sourcestride,
+                                       int64_t frames) {
+  int64_t f;
+  if(AMBIX_PRECISION_KAHAN == _AMBIX_PRECISION_MODE(plan->precision)) {
+    const float32_t*coeffs=plan->coeffs;
+    uint32_t b;
+    for(b=0; b<plan->numblocks; b++) {
+      const uint32_t offset=plan->blocks[b], n=plan->blocks[b+1]-plan->blocks[b];
+      _ambix_mtxmul_float64_kahan_scalar(dest+offset, deststride, coeffs, n, n, source+offset, sourcestride, frames);
+      coeffs+=n*n;
+    }
+    return;
+  }
+  for(f=0; f<frames; f++) {
+    const float64_t*src=source+f*sourcestride;
+    float64_t*dst=dest+f*deststride;
+    const float32_t*coeffs=plan->coeffs;
+    uint32_t b, outchan, inchan;
+    for(b=0; b<plan->numblocks; b++) {
+      const uint32_t offset=plan->blocks[b], n=plan->blocks[b+1]-plan->blocks[b];
+      for(outchan=0; outchan<n; outchan++) {
+        float64_t sum=0.;
+        for(inchan=0; inchan<n; inchan++)
+          sum+=*coeffs++ * src[offset+inchan];
+        dst[offset+outchan]=sum;
+      }
+    }
+  }
+}
+#define _AMBIX_MATRIXPLAN_BLOCKS_FIXED(typ)                             \
+  static void _matrixplan_blocks_##typ(const _ambix_matrixplan_t*plan,  \
+                                       typ##_t*dest, uint32_t deststride, \
+                                       const typ##_t*source, uint32_t sourcestride, \
+                                       int64_t frames) {                \
+    const _ambix_kernels_t*kernels=_ambix_get_kernels();                \
+    const int32_t*fixed=plan->fixed;                                    \
+    int64_t f;                                                          \
+    uint32_t b;                                                         \
+    if(fixed) {                                                         \
+      for(b=0; b<plan->numblocks; b++) {                                \
+        const uint32_t offset=plan->blocks[b], n=plan->blocks[b+1]-plan->blocks[b]; \
+        kernels->mtxmul_##typ(dest+offset, deststride, fixed, n, n, plan->fixedshift, \
+                              source+offset, sourcestride, frames);     \
+        fixed+=n*n;                                                     \
+      }                                                                 \
+      return;                                                           \
+    }                                                                   \
+    for(f=0; f<frames; f++) {                                           \
+      const typ##_t*src=source+f*sourcestride;                          \
+      typ##_t*dst=dest+f*deststride;                                    \
+      const float32_t*coeffs=plan->coeffs;                              \
+      uint32_t outchan, inchan;                                         \
+      for(b=0; b<plan->numblocks; b++) {                                \
+        const uint32_t offset=plan->blocks[b], n=plan->blocks[b+1]-plan->blocks[b]; \
+        for(outchan=0; outchan<n; outchan++) {                          \
+          float64_t sum=0.;                                             \
+          for(inchan=0; inchan<n; inchan++)                             \
+            sum+=*coeffs++ * src[offset+inchan];                        \
+          dst[offset+outchan]=_ambix_float_to_##typ(sum);               \
+        }                                                               \
+      }                                                                 \
+    }                                                                   \
+  }
+_AMBIX_MATRIXPLAN_BLOCKS_FIXED(int16);
+_AMBIX_MATRIXPLAN_BLOCKS_FIXED(int32);
+
+#define _AMBIX_MATRIXPLAN_APPLY(typ)                                    \
+  ambix_err_t _ambix_matrixplan_apply_##typ(const _ambix_matrixplan_t*plan, \
+                                            typ##_t*dest, uint32_t deststride, \
+                                            const typ##_t*source, uint32_t sourcestride, \
+                                            int64_t frames) {           \
+    const uint32_t rows=plan->rows;                                     \
+    const uint32_t*index=plan->index;                                   \
+    int64_t f;                                                          \
+    uint32_t r;                                                         \
+    switch(plan->type) {                                                \
+    case AMBIX_PLAN_IDENTITY:                                           \
+      if(deststride==rows && sourcestride==rows) {                      \
+        memcpy(dest, source, frames*rows*sizeof(typ##_t));              \
+        break;                                                          \
+      }                                                                 \
+      for(f=0; f<frames; f++)                                           \
+        memcpy(dest+f*deststride, source+f*sourcestride, rows*sizeof(typ##_t)); \
+      break;                                                            \
+    case AMBIX_PLAN_PERMUTATION:                                        \
+      for(f=0; f<frames; f++) {                                         \
+        const typ##_t*src=source+f*sourcestride;                        \
+        typ##_t*dst=dest+f*deststride;                                  \
+        for(r=0; r<rows; r++)                                           \
+          dst[r]=src[index[r]];                                         \
+      }                                                                 \
+      break;                                                            \
+    case AMBIX_PLAN_DIAGONAL:                                           \
+    case AMBIX_PLAN_GATHER:                                             \
+      _matrixplan_gather_##typ(plan, dest, deststride, source, sourcestride, frames); \
+      break;                                                            \
+    case AMBIX_PLAN_BLOCKDIAGONAL:                                      \
+      _matrixplan_blocks_##typ(plan, dest, deststride, source, sourcestride, frames); \
+      break;                                                            \
+    default:                                                            \
+      return _matrixplan_dense_##typ(plan, dest, deststride, source, sourcestride, frames); \
+    }                                                                   \
+    return AMBIX_ERR_SUCCESS;                                           \
+  }
+_AMBIX_MATRIXPLAN_APPLY(float32);
+_AMBIX_MATRIXPLAN_APPLY(float64);
+_AMBIX_MATRIXPLAN_APPLY(int32);
+_AMBIX_MATRIXPLAN_APPLY(int16);
@@ -0,0 +1,230 @@
+/* matrix_swap.c -  replacing the adaptor matrix while reading            -*- c -*-
+
+   Copyright © 2026 IOhannes m zmölnig <zmoelnig@iem.at>.
+         Institute of Electronic Music and Acoustics (IEM),
+         University of Music and Dramatic Arts, Graz
+
+   This file is part of libambix
+
+   libambix is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   libambix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+ * ambix_swap_adaptormatrix() hands a new matrix (and its plan) from a control
+ * thread to the thread calling ambix_readf(), RCU-style:
+ *
+ * - the control thread prepares a 'slot' (all allocations happen here) and
+ *   publishes it with a single atomic exchange of 'pending'.
+ *   if the reader has not picked up the previously published slot yet, that
+ *   one was never seen by the reader and can be freed right away.
+ * - the reader takes the pending slot (again with an atomic exchange) at the
+ *   beginning of a block; it owns 'current' and 'previous' (the slot it is
+ *   fading out from), so applying the matrices needs no synchronization.
+ * - slots the reader no longer needs are pushed onto the lock-free 'retired'
+ *   stack; the control thread frees them with the next swap (or when the
+ *   handle is closed).
+ *   the control thread always takes the entire stack, so there is no ABA
+ *   problem.
+ */
+
+#include "private.h"
+
+#ifdef HAVE_STDLIB_H
+# include <stdlib.h>
+#endif /* HAVE_STDLIB_H */
+
+#if defined HAVE_STDATOMIC_H && !defined __STDC_NO_ATOMICS__
+# define _AMBIX_HAVE_MATRIXSWAP 1
+#endif
+
+#ifdef _AMBIX_HAVE_MATRIXSWAP
+#include <stdatomic.h>
+
+typedef struct _ambix_matrixslot {
+  ambix_matrix_t*matrix;
+  _ambix_matrixplan_t plan;
+  /** length of the crossfade into this matrix (in frames) */
+  int64_t crossfade;
+  /** next slot on the 'retired' stack */
+  struct _ambix_matrixslot*next;
+} _ambix_matrixslot_t;
+
+struct _ambix_matrixswap_t_struct {
+  /** published by the control thread, taken by the reader */
+  _Atomic(_ambix_matrixslot_t*) pending;
+  /** slots the reader is done with, freed by the control thread */
+  _Atomic(_ambix_matrixslot_t*) retired;
+
+  /* owned by the reader */
+  /** the matrix in use (or NULL for the handle's own plan) */
+  _ambix_matrixslot_t*current;
+  /** the matrix we are fading out from (or NULL for the handle's own plan) */
+  _ambix_matrixslot_t*previous;
+  /** position and length of the crossfade (0 if there's none) */
+  int64_t fadepos, fadelength;
+};
+
+static void _ambix_matrixslot_free(_ambix_matrixslot_t*slot) {
+  while(slot) {
+    _ambix_matrixslot_t*next=slot->next;
+    _ambix_matrixplan_deinit(&slot->plan);
+    ambix_matrix_destroy(slot->matrix);
+    free(slot);
+    slot=next;
+  }
+}
+
+/* hand a slot back to the control thread (lock-free, no allocations) */
+static void _ambix_matrixslot_retire(_ambix_matrixswap_t*swap, _ambix_matrixslot_t*slot) {
+  if(!slot)
+    return;
+  slot->next=atomic_load(&swap->retired);
+  while(!atomic_compare_exchange_weak(&swap->retired, &slot->next, slot));
+}
+
+_ambix_matrixswap_t*_ambix_matrixswap_create(void) {
+  _ambix_matrixswap_t*swap=(_ambix_matrixswap_t*)calloc(1, sizeof(*swap));
+  if(!swap)
+    return NULL;
+  atomic_init(&swap->pending, NULL);
+  atomic_init(&swap->retired, NULL);
+  return swap;
+}
+
+void _ambix_matrixswap_reset(_ambix_matrixswap_t*swap) {
+  if(!swap)
+    return;
+  _ambix_matrixslot_free(atomic_exchange(&swap->pending, NULL));
+  _ambix_matrixslot_free(atomic_exchange(&swap->retired, NULL));
+  _ambix_matrixslot_free(swap->current);
+  _ambix_matrixslot_free(swap->previous);
+  swap->current=swap->previous=NULL;
+  swap->fadepos=swap->fadelength=0;
+}
+
+void _ambix_matrixswap_destroy(_ambix_matrixswap_t*swap) {
+  _ambix_matrixswap_reset(swap);
+  free(swap);
+}
+
+ambix_err_t _ambix_matrixswap_publish(_ambix_matrixswap_t*swap, ambix_matrix_t*matrix, int64_t crossfade) {
+  _ambix_matrixslot_t*slot=NULL;
+  ambix_err_t err;
+  if(!matrix)
+    return AMBIX_ERR_UNKNOWN;
+  if(!swap) {
+    ambix_matrix_destroy(matrix);
+    return AMBIX_ERR_UNKNOWN;
+  }
+  /* collect the garbage */
+  _ambix_matrixslot_free(atomic_exchange(&swap->retired, NULL));
+
+  slot=(_ambix_matrixslot_t*)calloc(1, sizeof(*slot));
+  if(!slot) {
+    ambix_matrix_destroy(matrix);
+    return AMBIX_ERR_UNKNOWN;
+  }
+  slot->matrix=matrix;
+  slot->crossfade=(crossfade>0)?crossfade:0;
+  err=_ambix_matrixplan_init(&slot->plan, slot->matrix);
+  if(AMBIX_ERR_SUCCESS != err) {
+    _ambix_matrixslot_free(slot);
+    return err;
+  }
+  /* a slot that has been replaced before the reader took it was never used */
+  _ambix_matrixslot_free(atomic_exchange(&swap->pending, slot));
+  return AMBIX_ERR_SUCCESS;
+}
+
+const _ambix_matrixplan_t*_ambix_matrixswap_acquire(_ambix_matrixswap_t*swap, const _ambix_matrixplan_t*base,
+                                                    ambix_precision_t precision, _ambix_matrixfade_t*fade) {
+  _ambix_matrixslot_t*slot=NULL;
+  fade->plan=NULL;
+  fade->pos=fade->length=0;
+  if(!swap)
+    return base;
+  /* only do the (more expensive) exchange if there is something to take */
+  if(atomic_load_explicit(&swap->pending, memory_order_relaxed))
+    slot=atomic_exchange(&swap->pending, NULL);
+  if(slot) {
+    /* an unfinished crossfade is cut short */
+    if(swap->fadelength)
+      _ambix_matrixslot_retire(swap, swap->previous);
+    swap->previous=NULL;
+    swap->fadepos=swap->fadelength=0;
+    if(slot->crossfade) {
+      swap->previous=swap->current;
+      swap->fadelength=slot->crossfade;
+    } else {
+      _ambix_matrixslot_retire(swap, swap->current);
+    }
+    swap->current=slot;
+  }
+  if(!swap->current)
+    return base;
+  swap->current->plan.precision=precision;
+  if(swap->fadelength) {
+    if(swap->previous)
+      swap->previous->plan.precision=precision;
+    fade->plan=swap->previous?&swap->previous->plan:base;
+    fade->pos=swap->fadepos;
+    fade->length=swap->fadelength;
+  }
+  return &swap->current->plan;
+}
+
+void _ambix_matrixswap_advance(_ambix_matrixswap_t*swap, int64_t frames) {
+  if(!swap || !swap->fadelength)
+    return;
+  swap->fadepos+=frames;
+  if(swap->fadepos>=swap->fadelength) {
+    _ambix_matrixslot_retire(swap, swap->previous);
+    swap->previous=NULL;
+    swap->fadepos=swap->fadelength=0;
+  }
+}
+
+int _ambix_matrixswap_active(_ambix_matrixswap_t*swap) {
+  return swap && (swap->current || atomic_load(&swap->pending));
+}
+
+#else /* !_AMBIX_HAVE_MATRIXSWAP */
+
+/* without atomics, the matrix cannot be swapped safely */
+_ambix_matrixswap_t*_ambix_matrixswap_create(void) {
+  return NULL;
+}
+void _ambix_matrixswap_reset(_ambix_matrixswap_t*swap) {
+}
+void _ambix_matrixswap_destroy(_ambix_matrixswap_t*swap) {
+}
+ambix_err_t _ambix_matrixswap_publish(_ambix_matrixswap_t*swap, ambix_matrix_t*matrix, int64_t crossfade) {
+  if(matrix)
+    ambix_matrix_destroy(matrix);
+  return AMBIX_ERR_UNKNOWN;
+}
+const _ambix_matrixplan_t*_ambix_matrixswap_acquire(_ambix_matrixswap_t*swap, const _ambix_matrixplan_t*base,
+                                                    ambix_precision_t precision, _ambix_matrixfade_t*fade) {
+  fade->plan=NULL;
+  fade->pos=fade->length=0;
+  return base;
+}
+void _ambix_matrixswap_advance(_ambix_matrixswap_t*swap, int64_t frames) {
+}
+int _ambix_matrixswap_active(_ambix_matrixswap_t*swap) {
+  return 0;
+}
+
+#endif /* _AMBIX_HAVE_MATRIXSWAP */
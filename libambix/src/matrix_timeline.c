@@ -0,0 +1,305 @@
+/* matrix_timeline.c -  time-varying adaptor matrices                     -*- c -*-
+
+   Copyright © 2026 IOhannes m zmölnig <zmoelnig@iem.at>.
+         Institute of Electronic Music and Acoustics (IEM),
+         University of Music and Dramatic Arts, Graz
+
+   This file is part of libambix
+
+   libambix is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   libambix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+ * a timeline is a list of (frame, matrix) keyframes, sorted by frame.
+ * when reading, the matrix is interpolated (linearly) between the two
+ * keyframes around the current position; before the first (resp. after the
+ * last) keyframe, that keyframe's matrix is used.
+ * several keyframes at the same frame make the matrix jump (the last of them
+ * is used from that frame on).
+ *
+ * the matrix is re-evaluated for each block of (at most)
+ * AMBIX_TIMELINE_BLOCKFRAMES frames; blocks never span a keyframe.
+ * the keyframe around the position is found by binary search (or, when
+ * reading sequentially, is still the one used for the previous block), so
+ * seeking costs O(log n).
+ */
+
+#include "private.h"
+
+#ifdef HAVE_STDLIB_H
+# include <stdlib.h>
+#endif /* HAVE_STDLIB_H */
+#ifdef HAVE_STRING_H
+# include <string.h>
+#endif /* HAVE_STRING_H */
+
+struct _ambix_timeline_t_struct {
+  /** dimensions of the keyframe matrices */
+  uint32_t rows, cols;
+  /** number of keyframes, and how many we have room for */
+  uint32_t count, size;
+  /** the position of each keyframe (ascending) */
+  int64_t*frames;
+  /** the keyframe matrices (as stored in the file) */
+  ambix_matrix_t**keys;
+
+  /** matrix pre-multiplied to all keyframes (or NULL) */
+  ambix_matrix_t*premultiply;
+  /** the keyframes pre-multiplied with 'premultiply' (or NULL) */
+  ambix_matrix_t**applied;
+
+  /** the matrix for the current block, and how to apply it */
+  ambix_matrix_t current;
+  _ambix_matrixplan_t plan;
+  /** the position of the next frame to be read */
+  int64_t position;
+  /** the last keyframe at or before the position of the previous block (or -1) */
+  int64_t segment;
+  /** whether 'current' still holds the (constant) matrix of 'segment' */
+  int constant;
+};
+
+_ambix_timeline_t*_ambix_timeline_create(uint32_t rows, uint32_t cols) {
+  _ambix_timeline_t*timeline=NULL;
+  if(!rows || !cols)
+    return NULL;
+  timeline=(_ambix_timeline_t*)calloc(1, sizeof(*timeline));
+  if(!timeline)
+    return NULL;
+  timeline->rows=rows;
+  timeline->cols=cols;
+  timeline->segment=-1;
+  /* allocated up front, so reading (in realtime mode) never allocates */
+  if(!ambix_matrix_init(rows, cols, &timeline->current)) {
+    free(timeline);
+    return NULL;
+  }
+  return timeline;
+}
+
+static void _ambix_timeline_freeapplied(_ambix_timeline_t*timeline) {
+  uint32_t i;
+  if(timeline->applied) {
+    for(i=0; i<timeline->count; i++)
+      if(timeline->applied[i])
+        ambix_matrix_destroy(timeline->applied[i]);
+  }
+  free(timeline->applied);
+  timeline->applied=NULL;
+}
+
+void _ambix_timeline_destroy(_ambix_timeline_t*timeline) {
+  uint32_t i;
+  if(!timeline)
+    return;
+  _ambix_timeline_freeapplied(timeline);
+  if(timeline->premultiply)
+    ambix_matrix_destroy(timeline->premultiply);
+  for(i=0; i<timeline->count; i++)
+    ambix_matrix_destroy(timeline->keys[i]);
+  free(timeline->keys);
+  free(timeline->frames);
+  ambix_matrix_deinit(&timeline->current);
+  free(timeline);
+}
+
+uint32_t _ambix_timeline_size(const _ambix_timeline_t*timeline) {
+  return timeline?timeline->count:0;
+}
+uint32_t _ambix_timeline_rows(const _ambix_timeline_t*timeline) {
+  return timeline?timeline->rows:0;
+}
+uint32_t _ambix_timeline_cols(const _ambix_timeline_t*timeline) {
+  return timeline?timeline->cols:0;
+}
+
+const ambix_matrix_t*_ambix_timeline_get(const _ambix_timeline_t*timeline, uint32_t index, int64_t*frame) {
+  if(!timeline || index>=timeline->count)
+    return NULL;
+  if(frame)
+    *frame=timeline->frames[index];
+  return timeline->keys[index];
+}
+
+/* the matrices the plan is interpolated from */
+static ambix_matrix_t**_ambix_timeline_keys(const _ambix_timeline_t*timeline) {
+  return timeline->applied?timeline->applied:timeline->keys;
+}
+
+ambix_err_t _ambix_timeline_add(_ambix_timeline_t*timeline, int64_t frame, const ambix_matrix_t*matrix) {
+  ambix_matrix_t*key=NULL, *applied=NULL;
+  uint32_t index;
+  if(!timeline || !matrix || frame<0)
+    return AMBIX_ERR_UNKNOWN;
+  if(matrix->rows != timeline->rows || matrix->cols != timeline->cols)
+    return AMBIX_ERR_INVALID_DIMENSION;
+  /* the storage is doubled whenever it is full */
+  if(timeline->count == timeline->size) {
+    const uint32_t size=timeline->size?2*timeline->size:8;
+    int64_t*frames=(int64_t*)realloc(timeline->frames, size*sizeof(*frames));
+    ambix_matrix_t**keys=NULL, **applieds=NULL;
+    if(frames)
+      timeline->frames=frames;
+    keys=frames?(ambix_matrix_t**)realloc(timeline->keys, size*sizeof(*keys)):NULL;
+    if(keys)
+      timeline->keys=keys;
+    if(keys && timeline->applied) {
+      applieds=(ambix_matrix_t**)realloc(timeline->applied, size*sizeof(*applieds));
+      if(applieds)
+        timeline->applied=applieds;
+    }
+    if(!keys || (timeline->applied && !applieds))
+      return AMBIX_ERR_UNKNOWN;
+    timeline->size=size;
+  }
+  key=ambix_matrix_copy(matrix, NULL);
+  if(!key || !_ambix_matrix_data(key)) {
+    if(key)
+      ambix_matrix_destroy(key);
+    return AMBIX_ERR_UNKNOWN;
+  }
+  if(timeline->applied) {
+    applied=_ambix_matrix_multiply(timeline->premultiply, key, NULL);
+    if(!applied || !_ambix_matrix_data(applied)) {
+      if(applied)
+        ambix_matrix_destroy(applied);
+      ambix_matrix_destroy(key);
+      return AMBIX_ERR_UNKNOWN;
+    }
+  }
+
+  /* keyframes at the same position are kept in the order they were added */
+  for(index=timeline->count; index>0 && timeline->frames[index-1]>frame; index--);
+  memmove(timeline->frames+index+1, timeline->frames+index, (timeline->count-index)*sizeof(*timeline->frames));
+  memmove(timeline->keys+index+1, timeline->keys+index, (timeline->count-index)*sizeof(*timeline->keys));
+  timeline->frames[index]=frame;
+  timeline->keys[index]=key;
+  if(timeline->applied) {
+    memmove(timeline->applied+index+1, timeline->applied+index, (timeline->count-index)*sizeof(*timeline->applied));
+    timeline->applied[index]=applied;
+  }
+  timeline->count++;
+  timeline->segment=-1;
+  timeline->constant=0;
+  return AMBIX_ERR_SUCCESS;
+}
+
+ambix_err_t _ambix_timeline_premultiply(_ambix_timeline_t*timeline, const ambix_matrix_t*matrix) {
+  uint32_t i;
+  if(!timeline)
+    return AMBIX_ERR_SUCCESS;
+  _ambix_timeline_freeapplied(timeline);
+  if(timeline->premultiply)
+    ambix_matrix_destroy(timeline->premultiply);
+  timeline->premultiply=NULL;
+  timeline->constant=0;
+  if(matrix && matrix->cols != timeline->rows)
+    return AMBIX_ERR_INVALID_DIMENSION;
+  /* 'current' takes the dimensions of the matrices that are interpolated */
+  if(!ambix_matrix_init(matrix?matrix->rows:timeline->rows, timeline->cols, &timeline->current))
+    return AMBIX_ERR_UNKNOWN;
+  if(!matrix)
+    return AMBIX_ERR_SUCCESS;
+
+  timeline->premultiply=ambix_matrix_copy(matrix, NULL);
+  timeline->applied=(ambix_matrix_t**)calloc(timeline->size?timeline->size:1, sizeof(*timeline->applied));
+  if(!timeline->premultiply || !timeline->applied)
+    goto fail;
+  for(i=0; i<timeline->count; i++) {
+    timeline->applied[i]=_ambix_matrix_multiply(timeline->premultiply, timeline->keys[i], NULL);
+    if(!timeline->applied[i] || !_ambix_matrix_data(timeline->applied[i]))
+      goto fail;
+  }
+  return AMBIX_ERR_SUCCESS;
+
+ fail:
+  _ambix_timeline_premultiply(timeline, NULL);
+  return AMBIX_ERR_UNKNOWN;
+}
+
+void _ambix_timeline_seek(_ambix_timeline_t*timeline, int64_t position) {
+  if(timeline)
+    timeline->position=position;
+}
+void _ambix_timeline_advance(_ambix_timeline_t*timeline, int64_t frames) {
+  if(timeline)
+    timeline->position+=frames;
+}
+
+/* the last keyframe at or before 'position' (or -1 if there is none) */
+static int64_t _ambix_timeline_find(const _ambix_timeline_t*timeline, int64_t position) {
+  const int64_t*frames=timeline->frames;
+  const int64_t segment=timeline->segment;
+  uint32_t lo=0, hi=timeline->count;
+  /* reading sequentially, we mostly stay within the same segment */
+  if(segment>=0 && segment<timeline->count && frames[segment]<=position
+     && (segment+1 == timeline->count || position<frames[segment+1]))
+    return segment;
+  while(lo<hi) {
+    const uint32_t mid=lo+(hi-lo)/2;
+    if(frames[mid]<=position)
+      lo=mid+1;
+    else
+      hi=mid;
+  }
+  return (int64_t)lo-1;
+}
+
+const _ambix_matrixplan_t*_ambix_timeline_acquire(_ambix_timeline_t*timeline, ambix_precision_t precision, int64_t*frames) {
+  ambix_matrix_t**keys;
+  const int64_t position=timeline?timeline->position:0;
+  int64_t segment, next=-1;
+  uint32_t rows, cols;
+  if(!timeline || !timeline->count)
+    return NULL;
+  keys=_ambix_timeline_keys(timeline);
+  rows=keys[0]->rows;
+  cols=keys[0]->cols;
+  if(timeline->current.rows != rows || timeline->current.cols != cols)
+    return NULL;
+
+  segment=_ambix_timeline_find(timeline, position);
+  if(segment+1 < timeline->count)
+    next=timeline->frames[segment+1];
+
+  if(segment<0 || next<0) {
+    /* before the first resp. after the last keyframe, the matrix is constant */
+    const ambix_matrix_t*key=keys[(segment<0)?0:segment];
+    if(!timeline->constant || segment != timeline->segment)
+      memcpy(_ambix_matrix_data(&timeline->current), _ambix_matrix_data(key), (size_t)rows*cols*sizeof(float32_t));
+    timeline->constant=1;
+  } else {
+    const float32_t*from=_ambix_matrix_data(keys[segment]);
+    const float32_t*to=_ambix_matrix_data(keys[segment+1]);
+    float32_t*dest=_ambix_matrix_data(&timeline->current);
+    const float32_t frac=(float32_t)((float64_t)(position-timeline->frames[segment])
+                                     / (float64_t)(next-timeline->frames[segment]));
+    const uint32_t count=rows*cols;
+    uint32_t i;
+    for(i=0; i<count; i++)
+      dest[i]=from[i]+frac*(to[i]-from[i]);
+    timeline->constant=0;
+    if(*frames>AMBIX_TIMELINE_BLOCKFRAMES)
+      *frames=AMBIX_TIMELINE_BLOCKFRAMES;
+  }
+  /* the block must not span the next keyframe */
+  if(next>=0 && next-position < *frames)
+    *frames=next-position;
+  timeline->segment=segment;
+
+  _ambix_matrixplan_init_dense(&timeline->plan, &timeline->current);
+  timeline->plan.precision=precision;
+  return &timeline->plan;
+}
@@ -22,16 +22,25 @@
 
 #include "private.h"
 
+#include <stddef.h>
+
 ambix_err_t _ambix_open (ambix_t*ambix, const char *path, const ambix_filemode_t mode, const ambix_info_t*ambixinfo) {
   return AMBIX_ERR_INVALID_FILE;
 }
+ambix_err_t _ambix_open_virtual (ambix_t*ambix, const ambix_virtual_io_t*vio, void*userdata, const ambix_filemode_t mode, const ambix_info_t*ambixinfo) {
+  return AMBIX_ERR_INVALID_FILE;
+}
 
 ambix_err_t     _ambix_close    (ambix_t*ambix) {
   return AMBIX_ERR_INVALID_FILE;
 }
 
-SNDFILE*_ambix_get_sndfile   (ambix_t*ambix) {
-  return 0;
+void*_ambix_get_sndfile   (ambix_t*ambix) {
+  return NULL;
+}
+
+const float32_t*_ambix_map_float32(ambix_t*ambix, int64_t*frames) {
+  return NULL;
 }
 
 int64_t _ambix_readf_int16   (ambix_t*ambix, int16_t*data, int64_t frames) {
@@ -65,3 +74,12 @@ ambix_err_t _ambix_write_uuidchunk(ambix_t*ax, const void*data, int64_t datasize
 int64_t _ambix_seek (ambix_t* ambix, int64_t frames, int whence) {
   return -1;
 }
+ambix_err_t _ambix_write_chunk(ambix_t*ax, uint32_t id, const void*data, int64_t datasize) {
+  return AMBIX_ERR_UNKNOWN;
+}
+ambix_err_t _ambix_delete_chunks(ambix_t*ax, uint32_t id) {
+  return AMBIX_ERR_UNKNOWN;
+}
+void* _ambix_read_chunk(ambix_t*ax, uint32_t id, uint32_t chunk_it, int64_t *datasize) {
+  return NULL;
+}
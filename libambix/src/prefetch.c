@@ -0,0 +1,435 @@
+/* prefetch.c -  reading sample data in a background thread              -*- c -*-
+
+   Copyright © 2026 IOhannes m zmölnig <zmoelnig@iem.at>.
+         Institute of Electronic Music and Acoustics (IEM),
+         University of Music and Dramatic Arts, Graz
+
+   This file is part of libambix
+
+   libambix is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   libambix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+ * with AMBIX_PREFETCH, a reader thread keeps a ringbuffer of (raw) frames
+ * filled, and ambix_readf() merely copies out of that ring.
+ * the ring holds the samples in a type that represents the file's samples
+ * exactly (int32 for 24/32bit integers, float64 for 64bit floats, else
+ * float32); reading other sample types converts from these.
+ *
+ * the ring has a single producer (the reader thread, which owns 'head') and
+ * a single consumer (whoever calls ambix_readf() and ambix_seek(), which owns
+ * 'tail'), so the data path does not need any locks.
+ *
+ * seeking bumps 'seekgen'; the reader thread then repositions the file,
+ * empties the ring and publishes the new generation in 'fillgen'.
+ * until 'fillgen' catches up, the consumer treats the ring as empty.
+ *
+ * the reader thread polls (every _AMBIX_PREFETCH_POLL_MS) when the ring is
+ * full, so the consumer never has to signal it.
+ * only if the ring runs dry, the consumer has to wait for the reader
+ * thread (which is counted as an underrun).
+ */
+
+#include "private.h"
+
+#ifdef HAVE_STDLIB_H
+# include <stdlib.h>
+#endif /* HAVE_STDLIB_H */
+#ifdef HAVE_STRING_H
+# include <string.h>
+#endif /* HAVE_STRING_H */
+#include <stdio.h>
+#include <math.h>
+
+#if defined HAVE_PTHREADS && defined HAVE_STDATOMIC_H && !defined __STDC_NO_ATOMICS__
+# define _AMBIX_HAVE_PREFETCH 1
+#endif
+
+#ifdef _AMBIX_HAVE_PREFETCH
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/time.h>
+
+/* number of frames read from the file at once */
+#define _AMBIX_PREFETCH_CHUNK 4096
+/* how often the reader thread checks for free space in a full ring */
+#define _AMBIX_PREFETCH_POLL_MS 10
+
+struct _ambix_prefetch_t_struct {
+  ambix_t*ambix;
+  /** number of channels per frame */
+  uint32_t channels;
+  /** the type of the samples in the ring (PCM32, FLOAT32 or FLOAT64) */
+  ambix_sampleformat_t format;
+  /** size of a frame in the ring (in bytes) */
+  size_t framesize;
+  /** size of the ring in frames (a power of 2) */
+  size_t size;
+  unsigned char*ring;
+  /** total number of frames written into resp. read from the ring */
+  atomic_size_t head, tail;
+
+  /** incremented by the consumer for each seek request */
+  atomic_uint seekgen;
+  /** the seek request the ring content belongs to */
+  atomic_uint fillgen;
+  /** whether the reader thread hit the end of the file */
+  atomic_int eof;
+  /** whether the consumer is waiting for data */
+  atomic_int waiting;
+  atomic_int quit;
+  atomic_uint_fast64_t underruns;
+
+  /** whether the consumer must never wait (AMBIX_REALTIME) */
+  int realtime;
+  /** the current read position (as seen by the consumer) */
+  int64_t position;
+  /** the requested position (protected by the mutex) */
+  int64_t seekpos;
+
+  /** scratch space for converting frames to other sample types */
+  void*convbuffer;
+  /** how to scale the ring's samples to the integer types */
+  float64_t scale16, scale32;
+  /** whether to truncate (rather than round) when converting to integers */
+  int truncate;
+
+  pthread_mutex_t mutex;
+  /** wakes the reader thread (after seeking, closing,...) */
+  pthread_cond_t wakeup;
+  /** wakes the consumer (when it is waiting for data) */
+  pthread_cond_t filled;
+  pthread_t thread;
+};
+
+static void _ambix_prefetch_sleep(_ambix_prefetch_t*p, unsigned int gen) {
+  struct timeval now;
+  struct timespec timeout;
+  gettimeofday(&now, NULL);
+  timeout.tv_sec=now.tv_sec;
+  timeout.tv_nsec=now.tv_usec*1000 + _AMBIX_PREFETCH_POLL_MS*1000000L;
+  if(timeout.tv_nsec>=1000000000L) {
+    timeout.tv_sec++;
+    timeout.tv_nsec-=1000000000L;
+  }
+  pthread_mutex_lock(&p->mutex);
+  if(!atomic_load(&p->quit) && atomic_load(&p->seekgen)==gen)
+    pthread_cond_timedwait(&p->wakeup, &p->mutex, &timeout);
+  pthread_mutex_unlock(&p->mutex);
+}
+
+/* wake up the consumer if it is waiting for us */
+static void _ambix_prefetch_notify(_ambix_prefetch_t*p) {
+  if(atomic_load(&p->waiting)) {
+    pthread_mutex_lock(&p->mutex);
+    pthread_cond_broadcast(&p->filled);
+    pthread_mutex_unlock(&p->mutex);
+  }
+}
+
+static void*_ambix_prefetch_thread(void*arg) {
+  _ambix_prefetch_t*p=(_ambix_prefetch_t*)arg;
+  unsigned int gen=atomic_load(&p->fillgen);
+  while(!atomic_load(&p->quit)) {
+    size_t head, space, offset, count;
+    int64_t got;
+    if(atomic_load(&p->seekgen)!=gen) {
+      int64_t position;
+      pthread_mutex_lock(&p->mutex);
+      gen=atomic_load(&p->seekgen);
+      position=p->seekpos;
+      pthread_mutex_unlock(&p->mutex);
+      /* the consumer ignores the ring until we publish the new generation */
+      atomic_store(&p->eof, (_ambix_seek(p->ambix, position, SEEK_SET)<0));
+      atomic_store(&p->head, atomic_load(&p->tail));
+      atomic_store(&p->fillgen, gen);
+      _ambix_prefetch_notify(p);
+    }
+    head=atomic_load(&p->head);
+    space=p->size - (head - atomic_load(&p->tail));
+    if(atomic_load(&p->eof) || space < ((p->size<_AMBIX_PREFETCH_CHUNK)?p->size:_AMBIX_PREFETCH_CHUNK)) {
+      _ambix_prefetch_sleep(p, gen);
+      continue;
+    }
+    offset=head & (p->size-1);
+    count=p->size - offset;
+    if(count>space)count=space;
+    if(count>_AMBIX_PREFETCH_CHUNK)count=_AMBIX_PREFETCH_CHUNK;
+
+    switch(p->format) {
+    case AMBIX_SAMPLEFORMAT_PCM32:
+      got=_ambix_readf_int32(p->ambix, (int32_t*)(p->ring + offset*p->framesize), (int64_t)count);
+      break;
+    case AMBIX_SAMPLEFORMAT_FLOAT64:
+      got=_ambix_readf_float64(p->ambix, (float64_t*)(p->ring + offset*p->framesize), (int64_t)count);
+      break;
+    default:
+      got=_ambix_readf_float32(p->ambix, (float32_t*)(p->ring + offset*p->framesize), (int64_t)count);
+      break;
+    }
+    if(got>0)
+      atomic_store(&p->head, head+(size_t)got);
+    if(got<(int64_t)count)
+      atomic_store(&p->eof, 1);
+    _ambix_prefetch_notify(p);
+  }
+  return NULL;
+}
+
+_ambix_prefetch_t*_ambix_prefetch_create(ambix_t*ambix, int64_t frames) {
+  _ambix_prefetch_t*p=NULL;
+  size_t size=1;
+  if(frames<1 || ambix->channels<1)
+    return NULL;
+  while(size<(uint64_t)frames)
+    size<<=1;
+  p=(_ambix_prefetch_t*)calloc(1, sizeof(*p));
+  if(!p)
+    return NULL;
+  p->ambix=ambix;
+  p->realtime=!!(AMBIX_REALTIME & ambix->filemode);
+  p->channels=(uint32_t)ambix->channels;
+  /* the backends read integer samples as int/32768 (resp. int/2^31) and
+   * convert between integer sizes by shifting, but scale (and round) floating
+   * point samples by 32767 (resp. 2^31-1) when reading them as integers:
+   * do the same, so the samples survive the ring unchanged */
+  switch(ambix->realinfo.sampleformat) {
+  case AMBIX_SAMPLEFORMAT_FLOAT32:
+  case AMBIX_SAMPLEFORMAT_FLOAT64:
+    p->format=ambix->realinfo.sampleformat;
+    p->scale16=32767.;
+    p->scale32=2147483647.;
+    p->truncate=0;
+    break;
+  case AMBIX_SAMPLEFORMAT_PCM24:
+  case AMBIX_SAMPLEFORMAT_PCM32:
+    p->format=AMBIX_SAMPLEFORMAT_PCM32;
+    p->scale16=32768.;
+    p->scale32=2147483648.;
+    p->truncate=1;
+    break;
+  default:
+    /* 16bit integers are exact in float32 */
+    p->format=AMBIX_SAMPLEFORMAT_FLOAT32;
+    p->scale16=32768.;
+    p->scale32=2147483648.;
+    p->truncate=1;
+    break;
+  }
+  p->framesize=p->channels*((AMBIX_SAMPLEFORMAT_FLOAT64==p->format)?sizeof(float64_t):sizeof(float32_t));
+  p->size=size;
+  p->ring=(unsigned char*)malloc(size*p->framesize);
+  p->convbuffer=malloc(_AMBIX_PREFETCH_CHUNK*p->framesize);
+  if(!p->ring || !p->convbuffer) {
+    free(p->ring);
+    free(p->convbuffer);
+    free(p);
+    return NULL;
+  }
+  atomic_init(&p->head, 0);
+  atomic_init(&p->tail, 0);
+  atomic_init(&p->seekgen, 0);
+  atomic_init(&p->fillgen, 0);
+  atomic_init(&p->eof, 0);
+  atomic_init(&p->waiting, 0);
+  atomic_init(&p->quit, 0);
+  atomic_init(&p->underruns, 0);
+  p->position=_ambix_seek(ambix, 0, SEEK_CUR);
+  if(p->position<0)
+    p->position=0;
+  pthread_mutex_init(&p->mutex, NULL);
+  pthread_cond_init(&p->wakeup, NULL);
+  pthread_cond_init(&p->filled, NULL);
+  if(pthread_create(&p->thread, NULL, _ambix_prefetch_thread, p)) {
+    pthread_cond_destroy(&p->filled);
+    pthread_cond_destroy(&p->wakeup);
+    pthread_mutex_destroy(&p->mutex);
+    free(p->ring);
+    free(p->convbuffer);
+    free(p);
+    return NULL;
+  }
+  return p;
+}
+
+void _ambix_prefetch_destroy(_ambix_prefetch_t*p) {
+  if(!p)
+    return;
+  pthread_mutex_lock(&p->mutex);
+  atomic_store(&p->quit, 1);
+  pthread_cond_broadcast(&p->wakeup);
+  pthread_mutex_unlock(&p->mutex);
+  pthread_join(p->thread, NULL);
+
+  pthread_cond_destroy(&p->filled);
+  pthread_cond_destroy(&p->wakeup);
+  pthread_mutex_destroy(&p->mutex);
+  free(p->ring);
+  free(p->convbuffer);
+  free(p);
+}
+
+int64_t _ambix_prefetch_seek(_ambix_prefetch_t*p, int64_t frames, int whence) {
+  const int64_t length=(int64_t)p->ambix->realinfo.frames;
+  int64_t position=frames;
+  switch(whence) {
+  case SEEK_SET: break;
+  case SEEK_CUR: position+=p->position; break;
+  case SEEK_END: position+=length; break;
+  default: return -1;
+  }
+  if(position<0 || position>length)
+    return -1;
+  pthread_mutex_lock(&p->mutex);
+  p->seekpos=position;
+  atomic_fetch_add(&p->seekgen, 1);
+  pthread_cond_broadcast(&p->wakeup);
+  pthread_mutex_unlock(&p->mutex);
+  p->position=position;
+  return position;
+}
+
+/* the number of frames the consumer can read right away */
+static size_t _ambix_prefetch_available(_ambix_prefetch_t*p, unsigned int gen) {
+  if(atomic_load(&p->fillgen)!=gen)
+    return 0;
+  return atomic_load(&p->head) - atomic_load(&p->tail);
+}
+
+static int64_t _ambix_prefetch_readf(_ambix_prefetch_t*p, void*data, int64_t frames) {
+  const unsigned int gen=atomic_load(&p->seekgen);
+  int underrun=0;
+  int64_t done=0;
+  while(done<frames) {
+    size_t available=_ambix_prefetch_available(p, gen);
+    size_t tail, offset, count;
+    if(!available) {
+      /* 'eof' must be checked before looking at the ring again */
+      if(atomic_load(&p->fillgen)==gen && atomic_load(&p->eof) && !_ambix_prefetch_available(p, gen))
+        break;
+      if(!underrun) {
+        atomic_fetch_add(&p->underruns, 1);
+        underrun=1;
+      }
+      /* rather deliver less than requested than block the audio thread */
+      if(p->realtime)
+        break;
+      pthread_mutex_lock(&p->mutex);
+      atomic_store(&p->waiting, 1);
+      if(!_ambix_prefetch_available(p, gen) && !(atomic_load(&p->fillgen)==gen && atomic_load(&p->eof))) {
+        pthread_cond_broadcast(&p->wakeup);
+        pthread_cond_wait(&p->filled, &p->mutex);
+      }
+      atomic_store(&p->waiting, 0);
+      pthread_mutex_unlock(&p->mutex);
+      continue;
+    }
+    tail=atomic_load(&p->tail);
+    offset=tail & (p->size-1);
+    count=p->size - offset;
+    if(count>available)count=available;
+    if((int64_t)count>frames-done)count=(size_t)(frames-done);
+    memcpy((unsigned char*)data + done*p->framesize, p->ring + offset*p->framesize, count*p->framesize);
+    atomic_store(&p->tail, tail+count);
+    done+=count;
+  }
+  p->position+=done;
+  return done;
+}
+
+void _ambix_prefetch_status(_ambix_prefetch_t*p, int64_t*available, int64_t*size, uint64_t*underruns) {
+  if(available)
+    *available=(int64_t)_ambix_prefetch_available(p, atomic_load(&p->seekgen));
+  if(size)
+    *size=(int64_t)p->size;
+  if(underruns)
+    *underruns=(uint64_t)atomic_load(&p->underruns);
+}
+
+/* convert 'count' samples from the ring's type (each read as 'v') */
+#define _AMBIX_PREFETCH_CONVERT(rtype, load, expr) {                    \
+    const rtype##_t*in=(const rtype##_t*)p->convbuffer;                 \
+    for(i=0; i<count; i++) {                                            \
+      const float64_t v=(load);                                         \
+      out[i]=(expr);                                                    \
+    }                                                                   \
+  }
+
+#define _AMBIX_PREFETCH_READF(type, ringformat, expr)                   \
+  int64_t _ambix_prefetch_readf_##type(_ambix_prefetch_t*p, type##_t*data, int64_t frames) { \
+    int64_t done=0;                                                     \
+    /* nothing to convert */                                            \
+    if(ringformat == p->format)                                         \
+      return _ambix_prefetch_readf(p, data, frames);                    \
+    while(done<frames) {                                                \
+      const int64_t want=(frames-done<_AMBIX_PREFETCH_CHUNK)?(frames-done):_AMBIX_PREFETCH_CHUNK; \
+      const int64_t got=_ambix_prefetch_readf(p, p->convbuffer, want); \
+      const size_t count=(size_t)got*p->channels;                       \
+      type##_t*out=data + done*p->channels;                             \
+      size_t i;                                                         \
+      switch(p->format) {                                               \
+      case AMBIX_SAMPLEFORMAT_PCM32:                                    \
+        _AMBIX_PREFETCH_CONVERT(int32, in[i]*(1./2147483648.), expr);   \
+        break;                                                          \
+      case AMBIX_SAMPLEFORMAT_FLOAT64:                                  \
+        _AMBIX_PREFETCH_CONVERT(float64, in[i], expr);                  \
+        break;                                                          \
+      default:                                                          \
+        _AMBIX_PREFETCH_CONVERT(float32, in[i], expr);                  \
+        break;                                                          \
+      }                                                                 \
+      done+=got;                                                        \
+      if(got<want)                                                      \
+        break;                                                          \
+    }                                                                   \
+    return done;                                                        \
+  }
+
+/* scale to the integer range (as the backends do) */
+static inline float64_t _ambix_prefetch_toint(const _ambix_prefetch_t*p, float64_t v, float64_t scale) {
+  return p->truncate?floor(v*scale):(v*scale + ((v<0)?-0.5:0.5));
+}
+_AMBIX_PREFETCH_READF(int16, AMBIX_SAMPLEFORMAT_PCM16, _ambix_float_to_int16(_ambix_prefetch_toint(p, v, p->scale16)));
+_AMBIX_PREFETCH_READF(int32, AMBIX_SAMPLEFORMAT_PCM32, _ambix_float_to_int32(_ambix_prefetch_toint(p, v, p->scale32)));
+_AMBIX_PREFETCH_READF(float32, AMBIX_SAMPLEFORMAT_FLOAT32, (float32_t)v);
+_AMBIX_PREFETCH_READF(float64, AMBIX_SAMPLEFORMAT_FLOAT64, v);
+
+#else /* !_AMBIX_HAVE_PREFETCH */
+
+/* without threads (or atomics), AMBIX_PREFETCH simply has no effect */
+_ambix_prefetch_t*_ambix_prefetch_create(ambix_t*ambix, int64_t frames) {
+  return NULL;
+}
+void _ambix_prefetch_destroy(_ambix_prefetch_t*p) {
+}
+int64_t _ambix_prefetch_seek(_ambix_prefetch_t*p, int64_t frames, int whence) {
+  return -1;
+}
+void _ambix_prefetch_status(_ambix_prefetch_t*p, int64_t*available, int64_t*size, uint64_t*underruns) {
+}
+int64_t _ambix_prefetch_readf_int16(_ambix_prefetch_t*p, int16_t*data, int64_t frames) {
+  return -1;
+}
+int64_t _ambix_prefetch_readf_int32(_ambix_prefetch_t*p, int32_t*data, int64_t frames) {
+  return -1;
+}
+int64_t _ambix_prefetch_readf_float32(_ambix_prefetch_t*p, float32_t*data, int64_t frames) {
+  return -1;
+}
+int64_t _ambix_prefetch_readf_float64(_ambix_prefetch_t*p, float64_t*data, int64_t frames) {
+  return -1;
+}
+
+#endif /* _AMBIX_HAVE_PREFETCH */
@@ -47,6 +47,74 @@
 
 #include <ambix/ambix.h>
 
+/** @brief how an adaptor matrix is applied to the data */
+typedef enum {
+  /** generic matrix multiplication */
+  AMBIX_PLAN_DENSE = 0,
+  /** identity matrix: copy the channels */
+  AMBIX_PLAN_IDENTITY,
+  /** each output channel is a copy of a single input channel */
+  AMBIX_PLAN_PERMUTATION,
+  /** each channel is scaled by a gain */
+  AMBIX_PLAN_DIAGONAL,
+  /** each output channel is a scaled copy of a single input channel (e.g. FuMa) */
+  AMBIX_PLAN_GATHER,
+  /** square matrix made of independent blocks along the diagonal (e.g. per-order rotations) */
+  AMBIX_PLAN_BLOCKDIAGONAL
+} _ambix_plantype_t;
+
+/** @brief execution plan for an adaptor matrix, created by _ambix_matrixplan_init() */
+typedef struct {
+  /** the cheapest way to apply the matrix */
+  _ambix_plantype_t type;
+  /** the analysed matrix (used as is for AMBIX_PLAN_DENSE) */
+  const ambix_matrix_t*matrix;
+  /** dimensions of the matrix */
+  uint32_t rows, cols;
+  /** PERMUTATION/GATHER: input channel for each output channel */
+  uint32_t*index;
+  /** DIAGONAL/GATHER: gain for each output channel */
+  float32_t*gain;
+  /** BLOCKDIAGONAL: number of blocks */
+  uint32_t numblocks;
+  /** BLOCKDIAGONAL: first channel of each block (numblocks+1 entries) */
+  uint32_t*blocks;
+  /** BLOCKDIAGONAL: the coefficients of all blocks (each row-major), one after the other */
+  float32_t*coeffs;
+  /** fixed-point version of the coefficients used by the plan (the matrix, the gains or the blocks), or NULL */
+  int32_t*fixed;
+  /** number of fractional bits in fixed */
+  uint32_t fixedshift;
+  /** how to accumulate float data (set by the caller after _ambix_matrixplan_init()) */
+  ambix_precision_t precision;
+} _ambix_matrixplan_t;
+
+/** @brief a pool of worker threads (opaque) */
+typedef struct _ambix_threadpool_t_struct _ambix_threadpool_t;
+/** @brief a task to be run by the threadpool
+ * @param userdata the userdata passed to _ambix_threadpool_run()
+ * @param task the index of the task (0..numtasks-1)
+ */
+typedef void (*_ambix_threadfun_t)(void*userdata, uint32_t task);
+
+/** a background thread reading sample frames into a ringbuffer */
+typedef struct _ambix_prefetch_t_struct _ambix_prefetch_t;
+/** a background thread writing sample frames from a ringbuffer */
+typedef struct _ambix_writebehind_t_struct _ambix_writebehind_t;
+/** adaptor matrices handed over to the reading thread (see ambix_swap_adaptormatrix()) */
+typedef struct _ambix_matrixswap_t_struct _ambix_matrixswap_t;
+/** keyframes of a time-varying adaptor matrix (see ambix_add_keyframe()) */
+typedef struct _ambix_timeline_t_struct _ambix_timeline_t;
+/** @brief a crossfade between two adaptor plans */
+typedef struct {
+  /** the plan to fade out from (NULL for plain splitting) */
+  const _ambix_matrixplan_t*plan;
+  /** position within the crossfade, and its length (in frames; 0 if there's no crossfade) */
+  int64_t pos, length;
+} _ambix_matrixfade_t;
+/** @brief (synchronously) merge and write interleaved frames of a given sample type */
+typedef int64_t (*_ambix_writefun_t)(ambix_t*ambix, const void*ambidata, const void*otherdata, int64_t frames);
+
 /** this is for passing data about the opened ambix file between the host application and the library */
 struct ambix_t_struct {
   /** private data by the actual backend */
@@ -78,13 +146,32 @@ struct ambix_t_struct {
   ambix_matrix_t matrix2;
   /** whether to use the matrix(1), the finalmatrix(2), or no matrix when decoding */
   int use_matrix;
+  /** execution plan for the matrix in use */
+  _ambix_matrixplan_t matrixplan;
+  /** matrices swapped in while reading (or NULL) */
+  _ambix_matrixswap_t*matrixswap;
+  /** keyframes of the adaptor matrix (or NULL) */
+  _ambix_timeline_t*timeline;
 
   /** buffer for adaptor signals */
   void*adaptorbuffer;
   /** size of the adaptor buffer (in bytes) */
   uint64_t adaptorbuffersize;
+  /** the largest block ambix_readf()/ambix_writef() are prepared for */
+  int64_t maxblocksize;
   /** default adaptorbuffer size in frames */
 #define DEFAULT_ADAPTORBUFFER_SIZE 64
+  /** adaptorbuffer size (per thread) in bytes, beyond which requests are chunked */
+#define AMBIX_ADAPTORBUFFER_CHUNKSIZE (256*1024)
+
+  /** worker threads for applying the adaptor matrix (or NULL) */
+  _ambix_threadpool_t*threadpool;
+  /** how to accumulate when applying the adaptor matrix */
+  ambix_precision_t precision;
+  /** background reader (or NULL) */
+  _ambix_prefetch_t*prefetch;
+  /** background writer (or NULL) */
+  _ambix_writebehind_t*writebehind;
 
   /** ambisonics order of the full set */
   uint32_t ambisonics_order;
@@ -97,6 +184,8 @@ struct ambix_t_struct {
   uint32_t num_regions;
   /** storage for regions */
   ambix_region_t *regions;
+  /** whether markers and regions have yet to be read from the file */
+  int pendingMarkers;
 
   /** whether we already started reading samples */
   int startedReading;
@@ -105,6 +194,11 @@ struct ambix_t_struct {
 
   /** whether we have pending headers to write */
   int pendingHeaders;
+
+  /** called (with closedata) after the backend has been closed,
+   * to release whatever ambix_open_fd()/ambix_open_memory() allocated */
+  ambix_err_t (*closefun)(void*closedata);
+  void*closedata;
 };
 
 
@@ -119,6 +213,18 @@ struct ambix_t_struct {
  * @return errorcode indicating success
  */
 ambix_err_t	_ambix_open	(ambix_t*ambix, const char *path, const ambix_filemode_t mode, const ambix_info_t*ambixinfo);
+/** @brief Do open an ambix stream via callbacks
+ *
+ * same as _ambix_open(), but accessing the data via the callbacks in vio
+ *
+ * @param ambix a pointer to an allocated ambix structure, that get's filled by this call
+ * @param vio callbacks for accessing the data
+ * @param userdata passed to the callbacks
+ * @param mode open read/write
+ * @param ambixinfo struct to a valid ambixinfo structure
+ * @return errorcode indicating success
+ */
+ambix_err_t	_ambix_open_virtual	(ambix_t*ambix, const ambix_virtual_io_t*vio, void*userdata, const ambix_filemode_t mode, const ambix_info_t*ambixinfo);
 /** @brief Do close an ambix file
  *
  * this is implemented by the various backends (currently only libsndfile)
@@ -145,6 +251,20 @@ int64_t _ambix_seek (ambix_t* ambix, int64_t frames, int whence);
  */
 void*_ambix_get_sndfile	(ambix_t*ambix);
 
+/** @brief Get a pointer to the (memory mapped) sample data
+ *
+ * this is implemented by the various backends; backends that cannot map
+ * files into memory simply return NULL
+ *
+ * @param ambix a pointer to a valid ambix structure
+ * @param frames the number of frames requested; on return holds the number of
+ *        frames available at the returned address
+ * @return a pointer to the frame at the current position (advancing the
+ *         position by frames), or NULL if the file is not mapped or does not
+ *         hold native 32bit float samples
+ */
+const float32_t*_ambix_map_float32(ambix_t*ambix, int64_t*frames);
+
 /** @brief read 32bit float data from file
  * @param ambix a pointer to a valid ambix structure
  * @param data pointer to an float32_t array that can hold at least frames*channels values
@@ -188,15 +308,14 @@ int64_t _ambix_writef_int16   (ambix_t*ambix, const int16_t*data, int64_t frames
 /** @brief Get UUID for ambix
  * @param ambix version
  * @return a pointer to the UUID for the given version or NULL
- * @remark currently only one UUID is defined for the ambix format (version 1)
- *         future versions of the standard might add additional UUIDs
+ * @remark version 1 holds the adaptor matrix, version 2 the keyframes of a
+ *         time-varying adaptor matrix (stored in addition to the version 1 chunk)
  */
 const char* _ambix_getUUID(uint32_t version);
 /** @brief Check data for ambix UUID
  * @param data Array holding the UUID
  * @return ambix-version this UUID is associated with, or 0 on failure
- * @remark currently only one UUID is defined for the ambix format (version 1)
- *         future versions of the standard might add additional UUIDs
+ * @remark see _ambix_getUUID()
  */
 uint32_t _ambix_checkUUID(const char UUID[16]);
 /** @brief extract matrix from ambix UUID-chunk (v1)
@@ -217,6 +336,23 @@ ambix_matrix_t*_ambix_uuid1_to_matrix(const void*data, uint64_t datasize, ambix_
  *         then you allocate enough data (datasize bytes) and call the function again
  */
 uint64_t _ambix_matrix_to_uuid1(const ambix_matrix_t*matrix, void*data, int byteswap);
+/** @brief extract keyframes from ambix UUID-chunk (v2)
+ * @param data Array holding the payload data (excluding the UUID itself)
+ * @param datasize size of data
+ * @param matrix the (static) adaptor matrix of the file; the keyframes must have the same dimensions
+ * @param byteswap TRUE if data has to be byteswapped (e.g. when reading BIG_ENDIAN data on LITTLE_ENDIAN machines)
+ * @return a new timeline or NULL on failure
+ * @remark only use data from a uuid-chunk for which _ambix_checkUUID() returned '2'
+ */
+_ambix_timeline_t*_ambix_uuid2_to_timeline(const void*data, uint64_t datasize, const ambix_matrix_t*matrix, int byteswap);
+/** @brief generate UUID-chunk (v2) from keyframes
+ * @param timeline the keyframes to store in the chunk
+ * @param data pointer to memory to store the UUID-chunk in (or NULL)
+ * @param byteswap TRUE if data has to be byteswapped (e.g. when reading BIG_ENDIAN data on LITTLE_ENDIAN machines)
+ * @return datasize needed for the UUID-chunk
+ * @remark see _ambix_matrix_to_uuid1()
+ */
+uint64_t _ambix_timeline_to_uuid2(const _ambix_timeline_t*timeline, void*data, int byteswap);
 /** @brief write UUID chunk to file
  * @param ambix valid ambix handle
  * @param data pointer to memory holding the UUID-chunk
@@ -244,6 +380,15 @@ ambix_err_t _ambix_write_markersregions(ambix_t*ax);
  * @return error code indicating success
  */
 ambix_err_t _ambix_write_chunk(ambix_t*ax, uint32_t id, const void*data, int64_t datasize);
+/** @brief remove all chunks with the given id from the file
+ * @param ambix valid ambix handle
+ * @param id four-character code identifying the chunks
+ * @return error code indicating success
+ *
+ * @remark only supported for files opened with AMBIX_RDRW (where the chunks
+ * are replaced when closing the file)
+ */
+ambix_err_t _ambix_delete_chunks(ambix_t*ax, uint32_t id);
 /** @brief read general chunk to file
  * @param ambix valid ambix handle
  * @param id four-character code identifying the chunk
@@ -258,6 +403,62 @@ ambix_err_t _ambix_write_chunk(ambix_t*ax, uint32_t id, const void*data, int64_t
  */
 void* _ambix_read_chunk(ambix_t*ax, uint32_t id, uint32_t chunk_it, int64_t *datasize);
 
+/** CAF 'lpcm' format flags */
+#define AMBIX_CAF_FLAG_FLOAT 1
+#define AMBIX_CAF_FLAG_LITTLEENDIAN 2
+/** the maximum number of channels in a CAF file (the same as libsndfile's) */
+#define AMBIX_CAF_MAXCHANNELS 1024
+
+/** the sample format of a CAF file, as described by its 'desc' chunk */
+typedef struct _ambix_caf_desc_t {
+  float64_t samplerate;
+  ambix_sampleformat_t sampleformat;
+  /** number of channels */
+  uint32_t channels;
+  /** bytes per sample resp. per sample frame */
+  uint32_t samplesize, framesize;
+  /** whether the samples are stored big-endian */
+  int bigendian;
+} _ambix_caf_desc_t;
+
+/** @brief read a big-endian 32bit resp. 64bit number (as used by CAF) */
+uint32_t _ambix_caf_get32(const unsigned char*data);
+/** @see _ambix_caf_get32 */
+uint64_t _ambix_caf_get64(const unsigned char*data);
+/** @brief whether we are running on a big-endian machine */
+int _ambix_caf_host_bigendian(void);
+/** @brief bytes per sample of a sample format as stored in CAF files (or 0 if unsupported) */
+uint32_t _ambix_caf_samplesize(ambix_sampleformat_t format);
+/** @brief check the file header of a CAF file
+ * @param header the first 8 bytes of the file
+ * @return TRUE if this is a CAF (version 1) file
+ */
+int _ambix_caf_checkheader(const unsigned char header[8]);
+/** @brief parse the payload of a CAF 'desc' chunk
+ * @param data the first 32 bytes of the chunk's payload
+ * @param desc the sample format to fill in
+ * @return TRUE if the file holds (uncompressed) samples that libambix can read
+ * @remark besides the sample format, this checks that the frame size is
+ *         consistent (and doesn't overflow)
+ */
+int _ambix_caf_parsedesc(const unsigned char data[32], _ambix_caf_desc_t*desc);
+
+/** alignment (in bytes) of the coefficient block of matrices allocated by ambix_matrix_init() */
+#define AMBIX_MATRIX_ALIGNMENT 64
+
+/** @brief Get the coefficients of a matrix as a flat array
+ *
+ * Matrices allocated by ambix_matrix_init() store all coefficients row-by-row
+ * (with no padding) in a single, AMBIX_MATRIX_ALIGNMENT aligned block;
+ * mtx->data[r] merely points into that block.
+ *
+ * @param mtx the matrix to get the coefficients of
+ * @return pointer to rows*cols coefficients (A[0,0], A[0,1], .., A[rows-1, cols-1]),
+ *         or NULL if the matrix is empty or its rows are not stored contiguously
+ *         (e.g. because the matrix was assembled by the host application)
+ */
+float32_t*_ambix_matrix_data(const ambix_matrix_t*mtx);
+
 /** @brief Fill a matrix with byteswapped values
  *
  * Fill data into a properly initialized matrix
@@ -313,6 +514,36 @@ _ambix_matrix_multiply (const ambix_matrix_t *A, const ambix_matrix_t *B, ambix_
 ambix_matrix_t*
 _ambix_matrix_pinv(const ambix_matrix_t*matrix, ambix_matrix_t*pinv) ;
 
+/** @brief Compute a conversion matrix
+ *
+ * Fill a matrix with one of the conversion matrices (FuMa, SID, N3D,...),
+ * computing it from scratch.
+ *
+ * @param matrix the matrix to fill (might be resized)
+ *
+ * @param typ the conversion matrix to create
+ *
+ * @return pointer to the filled matrix, or NULL if the matrix could not be created
+ *
+ * @remark ambix_matrix_fill() caches the results (see _ambix_matrix_fill_cached())
+ */
+ambix_matrix_t*
+_ambix_matrix_generate(ambix_matrix_t*matrix, ambix_matrixtype_t typ);
+
+/** @brief Fill a matrix with a cached conversion matrix
+ *
+ * Like _ambix_matrix_generate(), but each conversion matrix is only computed
+ * once (per type and size) and copied from a (thread-safe) cache afterwards.
+ *
+ * @param matrix the matrix to fill (might be resized)
+ *
+ * @param typ the conversion matrix to create
+ *
+ * @return pointer to the filled matrix, or NULL if the matrix could not be created
+ */
+ambix_matrix_t*
+_ambix_matrix_fill_cached(ambix_matrix_t*matrix, ambix_matrixtype_t typ);
+
 /** @brief Invert a matrix using Gauss-Jordan
  *
  * Invert a square matrix using the Gauss-Jordan algorithm
@@ -341,6 +572,305 @@ _ambix_matrix_invert_gaussjordan(ambix_matrix_t*matrix, ambix_matrix_t*result, f
 ambix_matrix_t*
 _ambix_matrix_pinvert_cholesky(const ambix_matrix_t*matrix, ambix_matrix_t*result, float32_t tolerance);
 
+/** @brief Pseudo-invert a matrix using a rank-revealing QR decomposition
+ *
+ * Compute the (Moore-Penrose) pseudo-inverse of a matrix, using a Householder
+ * QR decomposition with column pivoting in double precision.
+ * Unlike the Cholesky based pseudo-inverse, this does not form the normal
+ * equations, and therefore stays accurate for large and ill-conditioned matrices.
+ *
+ * @param matrix the matrix to invert
+ * @param result the result matrix (if NULL one will be allocated for you)
+ * @return a pointer to the result matrix (or NULL on failure)
+ *
+ */
+ambix_matrix_t*
+_ambix_matrix_pinvert_qr(const ambix_matrix_t*matrix, ambix_matrix_t*result);
+
+/** @brief instruction sets for the matrix kernels */
+typedef enum {
+  /** portable C (the reference implementation) */
+  AMBIX_SIMD_NONE = 0,
+  /** x86 SSE2 */
+  AMBIX_SIMD_SSE2,
+  /** x86 AVX2 (with FMA) */
+  AMBIX_SIMD_AVX2,
+  /** x86 AVX-512F */
+  AMBIX_SIMD_AVX512,
+  /** AArch64 NEON */
+  AMBIX_SIMD_NEON,
+} _ambix_simd_t;
+
+/** @brief multiply a (flat) matrix with interleaved data
+ *
+ * dest[f*deststride+o] = sum_i(mtx[o*cols+i] * source[f*sourcestride+i])
+ * for all 0<=o<rows and 0<=f<frames
+ *
+ * @param dest the interleaved output buffer; only the first rows channels of each frame are written
+ * @param deststride number of channels (samples per frame) in dest
+ * @param mtx row-major matrix coefficients (as returned by _ambix_matrix_data())
+ * @param rows number of rows in the matrix (output channels)
+ * @param cols number of columns in the matrix (input channels)
+ * @param source the interleaved input buffer; only the first cols channels of each frame are read
+ * @param sourcestride number of channels (samples per frame) in source
+ * @param frames number of frames to process
+ */
+typedef void (*_ambix_mtxkernel_float32_t)(float32_t*dest, uint32_t deststride,
+                                           const float32_t*mtx, uint32_t rows, uint32_t cols,
+                                           const float32_t*source, uint32_t sourcestride,
+                                           int64_t frames);
+
+/** @brief multiply a fixed-point matrix with interleaved 16bit integer data
+ *
+ * like _ambix_mtxkernel_float32_t, but the matrix holds fixed-point coefficients
+ * with shift fractional bits (as created by _ambix_matrix_to_fixed()).
+ * products are accumulated in 64bit, and the result is rounded and saturated
+ * to the output range.
+ *
+ * @param shift number of fractional bits of the coefficients
+ * @see _ambix_mtxkernel_float32_t
+ */
+typedef void (*_ambix_mtxkernel_int16_t)(int16_t*dest, uint32_t deststride,
+                                         const int32_t*mtx, uint32_t rows, uint32_t cols, uint32_t shift,
+                                         const int16_t*source, uint32_t sourcestride,
+                                         int64_t frames);
+/** @brief multiply a fixed-point matrix with interleaved 32bit integer data
+ * @see _ambix_mtxkernel_int16_t
+ */
+typedef void (*_ambix_mtxkernel_int32_t)(int32_t*dest, uint32_t deststride,
+                                         const int32_t*mtx, uint32_t rows, uint32_t cols, uint32_t shift,
+                                         const int32_t*source, uint32_t sourcestride,
+                                         int64_t frames);
+
+/** @brief a set of matrix kernels for a given instruction set */
+typedef struct {
+  /** the instruction set the kernels are written for */
+  _ambix_simd_t simd;
+  /** accumulates in single precision (as used by the adaptors) */
+  _ambix_mtxkernel_float32_t mtxmul_float32;
+  /** accumulates in double precision (as used by ambix_matrix_multiply_float32()) */
+  _ambix_mtxkernel_float32_t mtxmul_float32_acc64;
+  /** fixed-point kernel for 16bit data */
+  _ambix_mtxkernel_int16_t mtxmul_int16;
+  /** fixed-point kernel for 32bit data */
+  _ambix_mtxkernel_int32_t mtxmul_int32;
+} _ambix_kernels_t;
+
+/* compile-time specialisation of the kernels:
+ * the kernel is written as an always-inlined body taking rows/cols as
+ * arguments; the specialised entry point calls it with constant dimensions
+ * for the square matrices of the full-set orders 1..7 (4, 9, 16, 25, 36, 49
+ * and 64 channels), so the compiler can resolve and unroll the channel loops.
+ * any other size uses the generic (runtime) dimensions.
+ */
+#if defined __GNUC__
+# define AMBIX_ALWAYS_INLINE inline __attribute__((always_inline))
+#elif defined _MSC_VER
+# define AMBIX_ALWAYS_INLINE __forceinline
+#else
+# define AMBIX_ALWAYS_INLINE inline
+#endif
+
+/* buffers that do not alias each other */
+#if defined __GNUC__
+# define AMBIX_RESTRICT __restrict__
+#elif defined _MSC_VER
+# define AMBIX_RESTRICT __restrict
+#else
+# define AMBIX_RESTRICT
+#endif
+
+#define _AMBIX_FULLSET_CASES(CASE, body)        \
+  CASE(body,  4);                               \
+  CASE(body,  9);                               \
+  CASE(body, 16);                               \
+  CASE(body, 25);                               \
+  CASE(body, 36);                               \
+  CASE(body, 49);                               \
+  CASE(body, 64)
+
+/** @brief define a float32 kernel 'name' (with the given storage class and attributes)
+ * that dispatches to specialisations of the always-inlined 'body' */
+#define _AMBIX_MTXKERNEL_SPECIALISE_FLOAT32(decl, name, body)           \
+  decl void name(float32_t*dest, uint32_t deststride,                   \
+                 const float32_t*mtx, uint32_t rows, uint32_t cols,     \
+                 const float32_t*source, uint32_t sourcestride,         \
+                 int64_t frames) {                                      \
+    if(rows==cols) {                                                    \
+      switch(rows) {                                                    \
+        _AMBIX_FULLSET_CASES(_AMBIX_MTXKERNEL_FLOAT32_CASE, body);      \
+      default: break;                                                   \
+      }                                                                 \
+    }                                                                   \
+    body(dest, deststride, mtx, rows, cols, source, sourcestride, frames); \
+  }
+#define _AMBIX_MTXKERNEL_FLOAT32_CASE(body, n)                          \
+  case n: body(dest, deststride, mtx, n, n, source, sourcestride, frames); return
+/** @see _AMBIX_MTXKERNEL_SPECIALISE_FLOAT32 (for the fixed-point kernels) */
+#define _AMBIX_MTXKERNEL_SPECIALISE_FIXED(decl, typ, name, body)        \
+  decl void name(typ##_t*dest, uint32_t deststride,                     \
+                 const int32_t*mtx, uint32_t rows, uint32_t cols, uint32_t shift, \
+                 const typ##_t*source, uint32_t sourcestride,           \
+                 int64_t frames) {                                      \
+    if(rows==cols) {                                                    \
+      switch(rows) {                                                    \
+        _AMBIX_FULLSET_CASES(_AMBIX_MTXKERNEL_FIXED_CASE, body);        \
+      default: break;                                                   \
+      }                                                                 \
+    }                                                                   \
+    body(dest, deststride, mtx, rows, cols, shift, source, sourcestride, frames); \
+  }
+#define _AMBIX_MTXKERNEL_FIXED_CASE(body, n)                            \
+  case n: body(dest, deststride, mtx, n, n, shift, source, sourcestride, frames); return
+
+/** @brief get the fastest matrix kernels supported by the running CPU
+ * @return the kernels; never NULL (falls back to the scalar reference implementation)
+ */
+const _ambix_kernels_t*_ambix_get_kernels(void);
+/** @brief get the matrix kernels for a specific instruction set
+ * @param simd the requested instruction set
+ * @return the kernels, or NULL if they are not compiled in or not supported by the running CPU
+ */
+const _ambix_kernels_t*_ambix_get_kernels_simd(_ambix_simd_t simd);
+/** @see _ambix_get_kernels_simd (for SSE2, AVX2 and AVX-512) */
+const _ambix_kernels_t*_ambix_get_kernels_x86(_ambix_simd_t simd);
+/** @see _ambix_get_kernels_simd (for NEON) */
+const _ambix_kernels_t*_ambix_get_kernels_neon(void);
+
+/** @brief scalar reference for _ambix_kernels_t.mtxmul_float32 */
+void _ambix_mtxmul_float32_scalar(float32_t*dest, uint32_t deststride,
+                                  const float32_t*mtx, uint32_t rows, uint32_t cols,
+                                  const float32_t*source, uint32_t sourcestride,
+                                  int64_t frames);
+/** @brief scalar reference for _ambix_kernels_t.mtxmul_float32_acc64 */
+void _ambix_mtxmul_float32_acc64_scalar(float32_t*dest, uint32_t deststride,
+                                        const float32_t*mtx, uint32_t rows, uint32_t cols,
+                                        const float32_t*source, uint32_t sourcestride,
+                                        int64_t frames);
+
+/** @brief compensated (Kahan-Babuska) summation of exact (double precision) products
+ * @see _ambix_mtxkernel_float32_t
+ */
+void _ambix_mtxmul_float32_kahan_scalar(float32_t*dest, uint32_t deststride,
+                                        const float32_t*mtx, uint32_t rows, uint32_t cols,
+                                        const float32_t*source, uint32_t sourcestride,
+                                        int64_t frames);
+/** @brief multiply a (flat) matrix with interleaved 64bit data, using compensated summation
+ * @see _ambix_mtxkernel_float32_t
+ */
+void _ambix_mtxmul_float64_kahan_scalar(float64_t*dest, uint32_t deststride,
+                                        const float32_t*mtx, uint32_t rows, uint32_t cols,
+                                        const float64_t*source, uint32_t sourcestride,
+                                        int64_t frames);
+/** @brief the (fastest) float32 kernel for a given precision
+ * @param precision the requested precision (the AMBIX_PRECISION_FLUSH_DENORMALS flag is ignored)
+ * @param fallback the precision to use for AMBIX_PRECISION_DEFAULT
+ * @return the kernel
+ */
+_ambix_mtxkernel_float32_t _ambix_get_mtxkernel_float32(ambix_precision_t precision, ambix_precision_t fallback);
+
+/** @brief the precision mode without the flags */
+#define _AMBIX_PRECISION_MODE(precision) ((precision) & ~AMBIX_PRECISION_FLUSH_DENORMALS)
+
+/** @brief the floating point environment, as saved by _ambix_denormals_disable() */
+typedef struct {
+  uint64_t state;
+} _ambix_fpstate_t;
+/** @brief make the calling thread treat denormal numbers as zero (FTZ/DAZ)
+ *
+ * this is a no-op on CPUs where we don't know how to do this
+ *
+ * @param saved where to store the previous state (for _ambix_denormals_restore())
+ */
+void _ambix_denormals_disable(_ambix_fpstate_t*saved);
+/** @brief restore the floating point environment saved by _ambix_denormals_disable() */
+void _ambix_denormals_restore(const _ambix_fpstate_t*saved);
+
+/** @brief scalar reference for _ambix_kernels_t.mtxmul_int16 */
+void _ambix_mtxmul_int16_scalar(int16_t*dest, uint32_t deststride,
+                                const int32_t*mtx, uint32_t rows, uint32_t cols, uint32_t shift,
+                                const int16_t*source, uint32_t sourcestride,
+                                int64_t frames);
+/** @brief scalar reference for _ambix_kernels_t.mtxmul_int32 */
+void _ambix_mtxmul_int32_scalar(int32_t*dest, uint32_t deststride,
+                                const int32_t*mtx, uint32_t rows, uint32_t cols, uint32_t shift,
+                                const int32_t*source, uint32_t sourcestride,
+                                int64_t frames);
+
+/** @brief apply a kernel in cache-sized tiles
+ *
+ * if the matrix does not fit into the L1 cache, it is split into blocks of
+ * rows, and the frames into tiles that fit into L2; each row block is then
+ * applied to a whole tile of frames before moving on.
+ * small matrices are passed to the kernel directly.
+ *
+ * @param kernel the kernel to apply (e.g. from _ambix_get_kernels())
+ * @see _ambix_mtxkernel_float32_t for the remaining arguments
+ */
+void _ambix_mtxmul_float32_tiled(_ambix_mtxkernel_float32_t kernel,
+                                 float32_t*dest, uint32_t deststride,
+                                 const float32_t*mtx, uint32_t rows, uint32_t cols,
+                                 const float32_t*source, uint32_t sourcestride,
+                                 int64_t frames);
+/** @see _ambix_mtxmul_float32_tiled */
+void _ambix_mtxmul_int16_tiled(_ambix_mtxkernel_int16_t kernel,
+                               int16_t*dest, uint32_t deststride,
+                               const int32_t*mtx, uint32_t rows, uint32_t cols, uint32_t shift,
+                               const int16_t*source, uint32_t sourcestride,
+                               int64_t frames);
+/** @see _ambix_mtxmul_float32_tiled */
+void _ambix_mtxmul_int32_tiled(_ambix_mtxkernel_int32_t kernel,
+                               int32_t*dest, uint32_t deststride,
+                               const int32_t*mtx, uint32_t rows, uint32_t cols, uint32_t shift,
+                               const int32_t*source, uint32_t sourcestride,
+                               int64_t frames);
+
+/** @brief convert matrix coefficients to fixed-point
+ *
+ * the number of fractional bits is chosen per matrix, so that the sum of the
+ * absolute values in each row stays below 2^31.
+ * this guarantees that accumulating the products of 32bit samples with the
+ * coefficients never overflows a 64bit integer.
+ * (for typical adaptor matrices this gives Q1.30 or Q2.29 coefficients)
+ *
+ * @param coeffs row-major matrix coefficients
+ * @param rows number of rows
+ * @param cols number of columns
+ * @param fixed array of rows*cols fixed-point coefficients to be filled
+ * @return the number of fractional bits, or -1 if the matrix cannot be represented
+ */
+int _ambix_matrix_to_fixed(const float32_t*coeffs, uint32_t rows, uint32_t cols, int32_t*fixed);
+
+/** @brief round a fixed-point accumulator and saturate it to 16bit */
+static inline int16_t _ambix_fixed_to_int16(int64_t acc, uint32_t shift) {
+  if(shift)
+    acc=(acc+((int64_t)1<<(shift-1)))>>shift;
+  if(acc>32767)return 32767;
+  if(acc<-32768)return -32768;
+  return (int16_t)acc;
+}
+/** @brief round a fixed-point accumulator and saturate it to 32bit */
+static inline int32_t _ambix_fixed_to_int32(int64_t acc, uint32_t shift) {
+  if(shift)
+    acc=(acc+((int64_t)1<<(shift-1)))>>shift;
+  if(acc>2147483647)return 2147483647;
+  if(acc<-2147483647-1)return -2147483647-1;
+  return (int32_t)acc;
+}
+
+/** @brief saturate a (floating point) sum to 16bit */
+static inline int16_t _ambix_float_to_int16(float64_t sum) {
+  if(sum>32767.)return 32767;
+  if(sum<-32768.)return -32768;
+  return (int16_t)sum;
+}
+/** @brief saturate a (floating point) sum to 32bit */
+static inline int32_t _ambix_float_to_int32(float64_t sum) {
+  if(sum>2147483647.)return 2147483647;
+  if(sum<-2147483648.)return -2147483647-1;
+  return (int32_t)sum;
+}
+
 /** @brief byte-swap 32bit data
  * @param n a 32bit chunk in the wrong byte order
  * @return byte-swapped data
@@ -387,12 +917,199 @@ void _ambix_swap8array(uint64_t*data, uint64_t datasize);
  * @return error code indicating success
  */
 ambix_err_t _ambix_adaptorbuffer_resize(ambix_t*ambix, uint64_t frames, uint16_t typesize);
+/** @brief the number of frames to process at once
+ *
+ * larger requests to ambix_readf()/ambix_writef() are processed in chunks of
+ * this size, so the adaptorbuffer does not grow with the size of the request
+ *
+ * @param ambix valid ambix handle
+ * @param typesize sizeof(sampletype)
+ * @return the maximum number of frames per chunk
+ */
+int64_t _ambix_adaptorbuffer_chunkframes(const ambix_t*ambix, uint16_t typesize);
 /** @brief free an adaptor buffer
  * @param ambix valid ambix handle
  * @return error code indicating success
  */
 ambix_err_t _ambix_adaptorbuffer_destroy(ambix_t*ambix);
 
+/** upper limit for the number of threads per handle */
+#define AMBIX_MAX_THREADS 256
+/** @brief get the number of online CPUs (at least 1) */
+uint32_t _ambix_num_cpus(void);
+/** @brief create a pool of worker threads
+ * @param numthreads total number of threads (including the calling thread)
+ * @return a new threadpool, or NULL if numthreads<2 or threads are not supported
+ */
+_ambix_threadpool_t*_ambix_threadpool_create(uint32_t numthreads);
+/** @brief stop all worker threads and free the pool
+ * @param pool the threadpool to destroy (may be NULL)
+ */
+void _ambix_threadpool_destroy(_ambix_threadpool_t*pool);
+/** @brief get the number of threads (including the calling thread) in the pool
+ * @param pool a threadpool, or NULL (which is a pool of 1 thread)
+ */
+uint32_t _ambix_threadpool_size(const _ambix_threadpool_t*pool);
+/** @brief run tasks in parallel and wait for them to finish
+ *
+ * calls fun(userdata, task) for all task in 0..numtasks-1; the calling thread
+ * participates in the work.
+ * if pool is NULL, the tasks are run sequentially.
+ *
+ * @param pool the threadpool to use (or NULL)
+ * @param fun the task function
+ * @param userdata the data passed to each task
+ * @param numtasks the number of tasks
+ */
+void _ambix_threadpool_run(_ambix_threadpool_t*pool, _ambix_threadfun_t fun, void*userdata, uint32_t numtasks);
+
+/** default size of the prefetch ring (in frames) */
+#define AMBIX_PREFETCH_FRAMES 32768
+/** @brief start reading the file in a background thread
+ * @param ambix the handle to read from (using the backend functions)
+ * @param frames the minimum size of the ring (in frames)
+ * @return a new prefetcher, or NULL if threads are not supported
+ */
+_ambix_prefetch_t*_ambix_prefetch_create(ambix_t*ambix, int64_t frames);
+/** @brief stop the background thread and free the prefetcher
+ * @param p the prefetcher to destroy (may be NULL)
+ */
+void _ambix_prefetch_destroy(_ambix_prefetch_t*p);
+/** @brief reposition the file (the ring is refilled in the background)
+ * @return the new position (or -1 on error)
+ */
+int64_t _ambix_prefetch_seek(_ambix_prefetch_t*p, int64_t frames, int whence);
+/** @brief get the fill state of the ring */
+void _ambix_prefetch_status(_ambix_prefetch_t*p, int64_t*available, int64_t*size, uint64_t*underruns);
+/** @brief read (raw) frames from the ring
+ *
+ * these are the counterparts of the backends' _ambix_readf_...() functions;
+ * they only block if the ring runs empty
+ */
+int64_t _ambix_prefetch_readf_int16(_ambix_prefetch_t*p, int16_t*data, int64_t frames);
+int64_t _ambix_prefetch_readf_int32(_ambix_prefetch_t*p, int32_t*data, int64_t frames);
+int64_t _ambix_prefetch_readf_float32(_ambix_prefetch_t*p, float32_t*data, int64_t frames);
+int64_t _ambix_prefetch_readf_float64(_ambix_prefetch_t*p, float64_t*data, int64_t frames);
+
+/** size of the write-behind ring (in bytes) */
+#define AMBIX_WRITEBEHIND_BYTES (4<<20)
+/** @brief start writing the file in a background thread
+ * @param ambix the handle to write to
+ * @param bytes the amount of memory for queueing frames
+ * @return a new writer, or NULL if threads are not supported
+ */
+_ambix_writebehind_t*_ambix_writebehind_create(ambix_t*ambix, uint64_t bytes);
+/** @brief write all pending frames, stop the background thread and free the writer
+ * @param wb the writer to destroy (may be NULL)
+ * @return an error if any frame could not be written
+ */
+ambix_err_t _ambix_writebehind_destroy(_ambix_writebehind_t*wb);
+/** @brief wait until all pending frames have been written
+ * @return an error if any frame could not be written
+ */
+ambix_err_t _ambix_writebehind_drain(_ambix_writebehind_t*wb);
+/** @brief set how to deal with a full ring */
+ambix_err_t _ambix_writebehind_setpolicy(_ambix_writebehind_t*wb, ambix_backpressure_t policy);
+/** @brief get the fill state of the ring */
+void _ambix_writebehind_status(_ambix_writebehind_t*wb, int64_t*queued, int64_t*highwater, uint64_t*overruns, uint64_t*dropped);
+/** @brief queue frames for writing
+ *
+ * copies the frames into the ring; the writer thread then calls
+ * writefun(ambix, ambi, extra, count) with interleaved ranges of the ring.
+ *
+ * @param wb the writer
+ * @param writefun the function that merges and writes frames of the given sample type
+ * @param typesize the size of a sample
+ * @param ambichannels the number of (interleaved) channels in ambidata
+ * @param extrachannels the number of (interleaved) channels in otherdata
+ * @param ambidata the ambisonics channels (interleaved, or an array of channel pointers)
+ * @param otherdata the extra channels (interleaved, or an array of channel pointers)
+ * @param planar whether ambidata/otherdata are arrays of channel pointers
+ * @param frames the number of frames to write
+ * @return the number of frames queued, or an error
+ */
+int64_t _ambix_writebehind_write(_ambix_writebehind_t*wb, _ambix_writefun_t writefun, uint16_t typesize,
+                                 uint32_t ambichannels, uint32_t extrachannels,
+                                 const void*ambidata, const void*otherdata, int planar, int64_t frames);
+
+/** @brief create the (empty) hand-over for swapping adaptor matrices
+ * @return a new hand-over, or NULL if atomics are not supported
+ */
+_ambix_matrixswap_t*_ambix_matrixswap_create(void);
+/** @brief free the hand-over and all matrices in it (may be NULL) */
+void _ambix_matrixswap_destroy(_ambix_matrixswap_t*swap);
+/** @brief drop all swapped matrices (the reader must not be running) */
+void _ambix_matrixswap_reset(_ambix_matrixswap_t*swap);
+/** @brief publish a new matrix for the reading thread (called from the control thread)
+ * @param swap the hand-over
+ * @param matrix the final matrix (including the adaptor matrix of the file);
+ *        the hand-over takes ownership (also on failure)
+ * @param crossfade the length of the crossfade from the old matrix (in frames)
+ * @return an errorcode indicating success
+ */
+ambix_err_t _ambix_matrixswap_publish(_ambix_matrixswap_t*swap, ambix_matrix_t*matrix, int64_t crossfade);
+/** @brief pick up a published matrix (called from the reading thread; never blocks nor allocates)
+ * @param swap the hand-over (may be NULL)
+ * @param base the plan to use, if no matrix has been swapped in (may be NULL)
+ * @param precision the precision for applying the plans
+ * @param[out] fade the crossfade in progress
+ * @return the plan to apply
+ */
+const _ambix_matrixplan_t*_ambix_matrixswap_acquire(_ambix_matrixswap_t*swap, const _ambix_matrixplan_t*base,
+                                                    ambix_precision_t precision, _ambix_matrixfade_t*fade);
+/** @brief move the crossfade forward, once 'frames' frames have been read */
+void _ambix_matrixswap_advance(_ambix_matrixswap_t*swap, int64_t frames);
+/** @brief whether a swapped matrix is (or is about to be) in use */
+int _ambix_matrixswap_active(_ambix_matrixswap_t*swap);
+
+/** the largest block that is read with a single (interpolated) matrix of a timeline */
+#define AMBIX_TIMELINE_BLOCKFRAMES 64
+/** @brief create an (empty) timeline for keyframes of the given dimensions
+ * @return a new timeline, or NULL on failure
+ */
+_ambix_timeline_t*_ambix_timeline_create(uint32_t rows, uint32_t cols);
+/** @brief free the timeline and all keyframes (may be NULL) */
+void _ambix_timeline_destroy(_ambix_timeline_t*timeline);
+/** @brief add a keyframe (keeping the keyframes sorted by frame)
+ * @param timeline the timeline
+ * @param frame the position of the keyframe
+ * @param matrix the matrix at that position (is copied)
+ * @return an errorcode indicating success
+ */
+ambix_err_t _ambix_timeline_add(_ambix_timeline_t*timeline, int64_t frame, const ambix_matrix_t*matrix);
+/** @brief the number of keyframes (0 if timeline is NULL) */
+uint32_t _ambix_timeline_size(const _ambix_timeline_t*timeline);
+/** @brief the dimensions of the keyframes (0 if timeline is NULL) */
+uint32_t _ambix_timeline_rows(const _ambix_timeline_t*timeline);
+/* @see _ambix_timeline_rows */
+uint32_t _ambix_timeline_cols(const _ambix_timeline_t*timeline);
+/** @brief get a keyframe
+ * @param timeline the timeline
+ * @param index the index of the keyframe (in the order of their positions)
+ * @param[out] frame the position of the keyframe (may be NULL)
+ * @return the matrix of the keyframe, or NULL if there is no such keyframe
+ */
+const ambix_matrix_t*_ambix_timeline_get(const _ambix_timeline_t*timeline, uint32_t index, int64_t*frame);
+/** @brief pre-multiply a matrix to all keyframes when reading (see ambix_set_adaptormatrix())
+ * @param timeline the timeline (may be NULL)
+ * @param matrix the matrix (is copied), or NULL to use the keyframes as they are
+ * @return an errorcode indicating success
+ */
+ambix_err_t _ambix_timeline_premultiply(_ambix_timeline_t*timeline, const ambix_matrix_t*matrix);
+/** @brief set the position of the next frame to be read */
+void _ambix_timeline_seek(_ambix_timeline_t*timeline, int64_t position);
+/** @brief move the position forward, once 'frames' frames have been read */
+void _ambix_timeline_advance(_ambix_timeline_t*timeline, int64_t frames);
+/** @brief get the (interpolated) matrix for the block at the current position
+ * @param timeline the timeline (may be NULL)
+ * @param precision the precision for applying the plan
+ * @param[in,out] frames the number of frames to read; reduced to the number of
+ *                frames that the plan may be used for
+ * @return the plan to apply (valid until the next call), or NULL if there are no keyframes
+ * @remark never allocates memory (so it can be used in AMBIX_REALTIME mode)
+ */
+const _ambix_matrixplan_t*_ambix_timeline_acquire(_ambix_timeline_t*timeline, ambix_precision_t precision, int64_t*frames);
+
 /** @brief extract ambisonics and non-ambisonics channels from interleaved (32bit floating point) data
  *
  * extract the first ambichannels channels from the source into dest_ambi
@@ -493,6 +1210,167 @@ ambix_err_t _ambix_mergeAdaptormatrix_int32(const int32_t*source1, const ambix_m
 ambix_err_t _ambix_mergeAdaptormatrix_int16(const int16_t*source1, const ambix_matrix_t*matrix, const int16_t*source2, uint32_t source2channels, int16_t*destination, int64_t frames);
 
 
+/** @brief analyse a matrix and find the cheapest way to apply it
+ *
+ * the matrix is only referenced (and must stay valid for as long as the plan is used)
+ *
+ * @param plan the plan to (re)initialize
+ * @param matrix the matrix to analyse
+ * @return error code indicating success
+ */
+ambix_err_t _ambix_matrixplan_init(_ambix_matrixplan_t*plan, const ambix_matrix_t*matrix);
+/** @brief create a DENSE plan for a matrix, without analysing it
+ * @param plan the plan to initialize (must not hold any memory)
+ * @param matrix the matrix to apply (must be contiguous, see _ambix_matrix_data())
+ * @remark this neither allocates memory nor needs _ambix_matrixplan_deinit(),
+ *         so it can be used for matrices that change with every block;
+ *         the integer types are converted to float for multiplying
+ */
+void _ambix_matrixplan_init_dense(_ambix_matrixplan_t*plan, const ambix_matrix_t*matrix);
+/** @brief free all memory held by a matrix plan
+ * @param plan the plan to free
+ */
+void _ambix_matrixplan_deinit(_ambix_matrixplan_t*plan);
+
+/** @brief apply a (non-dense) matrix plan to interleaved data
+ *
+ * multiplies each frame of plan.cols source channels with the matrix, yielding plan.rows destination channels
+ *
+ * @param plan the plan to apply
+ * @param dest the destination buffer
+ * @param deststride the distance between two frames in dest (in samples)
+ * @param source the source buffer
+ * @param sourcestride the distance between two frames in source (in samples)
+ * @param frames number of frames to process
+ * @return error code indicating success; AMBIX_ERR_INVALID_MATRIX if the plan must be applied as a dense matrix
+ * (via _ambix_splitAdaptormatrix_float32() resp. _ambix_mergeAdaptormatrix_float32())
+ */
+ambix_err_t _ambix_matrixplan_apply_float32(const _ambix_matrixplan_t*plan, float32_t*dest, uint32_t deststride, const float32_t*source, uint32_t sourcestride, int64_t frames);
+/* @see _ambix_matrixplan_apply_float32 */
+ambix_err_t _ambix_matrixplan_apply_float64(const _ambix_matrixplan_t*plan, float64_t*dest, uint32_t deststride, const float64_t*source, uint32_t sourcestride, int64_t frames);
+/* @see _ambix_matrixplan_apply_float32 */
+ambix_err_t _ambix_matrixplan_apply_int32(const _ambix_matrixplan_t*plan, int32_t*dest, uint32_t deststride, const int32_t*source, uint32_t sourcestride, int64_t frames);
+/* @see _ambix_matrixplan_apply_float32 */
+ambix_err_t _ambix_matrixplan_apply_int16(const _ambix_matrixplan_t*plan, int16_t*dest, uint32_t deststride, const int16_t*source, uint32_t sourcestride, int64_t frames);
+
+/** @brief extract ambisonics and non-ambisonics channels from interleaved data using a matrix plan
+ *
+ * like _ambix_splitAdaptormatrix_float32(), but uses the cheapest way to apply the matrix
+ */
+ambix_err_t _ambix_splitAdaptorplan_float32(const float32_t*source, uint32_t sourcechannels, const _ambix_matrixplan_t*plan, float32_t*dest_ambi, float32_t*dest_other, int64_t frames);
+/* @see _ambix_splitAdaptorplan_float32 */
+ambix_err_t _ambix_splitAdaptorplan_float64(const float64_t*source, uint32_t sourcechannels, const _ambix_matrixplan_t*plan, float64_t*dest_ambi, float64_t*dest_other, int64_t frames);
+/* @see _ambix_splitAdaptorplan_float32 */
+ambix_err_t _ambix_splitAdaptorplan_int32(const int32_t*source, uint32_t sourcechannels, const _ambix_matrixplan_t*plan, int32_t*dest_ambi, int32_t*dest_other, int64_t frames);
+/* @see _ambix_splitAdaptorplan_float32 */
+ambix_err_t _ambix_splitAdaptorplan_int16(const int16_t*source, uint32_t sourcechannels, const _ambix_matrixplan_t*plan, int16_t*dest_ambi, int16_t*dest_other, int64_t frames);
+
+/** @brief merge interleaved ambisonics and non-ambisonics channels into a single interleaved block using a matrix plan
+ *
+ * like _ambix_mergeAdaptormatrix_float32(), but uses the cheapest way to apply the matrix
+ */
+ambix_err_t _ambix_mergeAdaptorplan_float32(const float32_t*source1, const _ambix_matrixplan_t*plan, const float32_t*source2, uint32_t source2channels, float32_t*destination, int64_t frames);
+/* @see _ambix_mergeAdaptorplan_float32 */
+ambix_err_t _ambix_mergeAdaptorplan_float64(const float64_t*source1, const _ambix_matrixplan_t*plan, const float64_t*source2, uint32_t source2channels, float64_t*destination, int64_t frames);
+/* @see _ambix_mergeAdaptorplan_float32 */
+ambix_err_t _ambix_mergeAdaptorplan_int32(const int32_t*source1, const _ambix_matrixplan_t*plan, const int32_t*source2, uint32_t source2channels, int32_t*destination, int64_t frames);
+/* @see _ambix_mergeAdaptorplan_float32 */
+ambix_err_t _ambix_mergeAdaptorplan_int16(const int16_t*source1, const _ambix_matrixplan_t*plan, const int16_t*source2, uint32_t source2channels, int16_t*destination, int64_t frames);
+
+/** @brief extract ambisonics and non-ambisonics channels from interleaved data into planar buffers
+ *
+ * like _ambix_splitAdaptor_float32(), but writes each channel into a separate buffer
+ *
+ * @param source the interleaved source buffer
+ * @param sourcechannels number of channels in the source buffer
+ * @param ambichannels the first ambichannels channels are written to dest_ambi, the rest to dest_other
+ * @param dest_ambi ambichannels pointers to the per-channel ambisonics buffers
+ * @param dest_other (sourcechannels-ambichannels) pointers to the per-channel non-ambisonics buffers
+ * @param offset the first frame to write in the per-channel buffers
+ * @param frames number of frames to process
+ * @return error code indicating success
+ */
+ambix_err_t _ambix_splitAdaptor_planar_float32(const float32_t*source, uint32_t sourcechannels, uint32_t ambichannels, float32_t**dest_ambi, float32_t**dest_other, int64_t offset, int64_t frames);
+/* @see _ambix_splitAdaptor_planar_float32 */
+ambix_err_t _ambix_splitAdaptor_planar_float64(const float64_t*source, uint32_t sourcechannels, uint32_t ambichannels, float64_t**dest_ambi, float64_t**dest_other, int64_t offset, int64_t frames);
+/* @see _ambix_splitAdaptor_planar_float32 */
+ambix_err_t _ambix_splitAdaptor_planar_int32(const int32_t*source, uint32_t sourcechannels, uint32_t ambichannels, int32_t**dest_ambi, int32_t**dest_other, int64_t offset, int64_t frames);
+/* @see _ambix_splitAdaptor_planar_float32 */
+ambix_err_t _ambix_splitAdaptor_planar_int16(const int16_t*source, uint32_t sourcechannels, uint32_t ambichannels, int16_t**dest_ambi, int16_t**dest_other, int64_t offset, int64_t frames);
+
+/** @brief merge planar ambisonics and non-ambisonics channels into a single interleaved block
+ *
+ * like _ambix_mergeAdaptor_float32(), but reads each channel from a separate buffer
+ *
+ * @param offset the first frame to read from the per-channel buffers
+ */
+ambix_err_t _ambix_mergeAdaptor_planar_float32(float32_t*const*source1, uint32_t source1channels, float32_t*const*source2, uint32_t source2channels, int64_t offset, float32_t*destination, int64_t frames);
+/* @see _ambix_mergeAdaptor_planar_float32 */
+ambix_err_t _ambix_mergeAdaptor_planar_float64(float64_t*const*source1, uint32_t source1channels, float64_t*const*source2, uint32_t source2channels, int64_t offset, float64_t*destination, int64_t frames);
+/* @see _ambix_mergeAdaptor_planar_float32 */
+ambix_err_t _ambix_mergeAdaptor_planar_int32(int32_t*const*source1, uint32_t source1channels, int32_t*const*source2, uint32_t source2channels, int64_t offset, int32_t*destination, int64_t frames);
+/* @see _ambix_mergeAdaptor_planar_float32 */
+ambix_err_t _ambix_mergeAdaptor_planar_int16(int16_t*const*source1, uint32_t source1channels, int16_t*const*source2, uint32_t source2channels, int64_t offset, int16_t*destination, int64_t frames);
+
+/** @brief extract ambisonics and non-ambisonics channels from interleaved data into planar buffers using a matrix plan
+ *
+ * like _ambix_splitAdaptorplan_float32(), but writes each channel into a separate buffer
+ * (the matrix is applied blockwise into a small scratch buffer, from where the channels are scattered)
+ *
+ * @param offset the first frame to write in the per-channel buffers
+ */
+ambix_err_t _ambix_splitAdaptorplan_planar_float32(const float32_t*source, uint32_t sourcechannels, const _ambix_matrixplan_t*plan, float32_t**dest_ambi, float32_t**dest_other, int64_t offset, int64_t frames);
+/* @see _ambix_splitAdaptorplan_planar_float32 */
+ambix_err_t _ambix_splitAdaptorplan_planar_float64(const float64_t*source, uint32_t sourcechannels, const _ambix_matrixplan_t*plan, float64_t**dest_ambi, float64_t**dest_other, int64_t offset, int64_t frames);
+/* @see _ambix_splitAdaptorplan_planar_float32 */
+ambix_err_t _ambix_splitAdaptorplan_planar_int32(const int32_t*source, uint32_t sourcechannels, const _ambix_matrixplan_t*plan, int32_t**dest_ambi, int32_t**dest_other, int64_t offset, int64_t frames);
+/* @see _ambix_splitAdaptorplan_planar_float32 */
+ambix_err_t _ambix_splitAdaptorplan_planar_int16(const int16_t*source, uint32_t sourcechannels, const _ambix_matrixplan_t*plan, int16_t**dest_ambi, int16_t**dest_other, int64_t offset, int64_t frames);
+
+/** @brief merge planar ambisonics and non-ambisonics channels into a single interleaved block using a matrix plan
+ *
+ * like _ambix_mergeAdaptorplan_float32(), but reads each channel from a separate buffer
+ *
+ * @param offset the first frame to read from the per-channel buffers
+ */
+ambix_err_t _ambix_mergeAdaptorplan_planar_float32(float32_t*const*source1, const _ambix_matrixplan_t*plan, float32_t*const*source2, uint32_t source2channels, int64_t offset, float32_t*destination, int64_t frames);
+/* @see _ambix_mergeAdaptorplan_planar_float32 */
+ambix_err_t _ambix_mergeAdaptorplan_planar_float64(float64_t*const*source1, const _ambix_matrixplan_t*plan, float64_t*const*source2, uint32_t source2channels, int64_t offset, float64_t*destination, int64_t frames);
+/* @see _ambix_mergeAdaptorplan_planar_float32 */
+ambix_err_t _ambix_mergeAdaptorplan_planar_int32(int32_t*const*source1, const _ambix_matrixplan_t*plan, int32_t*const*source2, uint32_t source2channels, int64_t offset, int32_t*destination, int64_t frames);
+/* @see _ambix_mergeAdaptorplan_planar_float32 */
+ambix_err_t _ambix_mergeAdaptorplan_planar_int16(int16_t*const*source1, const _ambix_matrixplan_t*plan, int16_t*const*source2, uint32_t source2channels, int64_t offset, int16_t*destination, int64_t frames);
+
+/** @brief extract ambisonics and non-ambisonics channels, crossfading between two matrix plans
+ *
+ * like _ambix_splitAdaptorplan_float32(), but the ambisonics channels fade
+ * linearly from fade->plan (or no matrix at all, if that is NULL) to plan
+ *
+ * @param fade the outgoing plan, the position of the first frame within the crossfade and its length
+ */
+ambix_err_t _ambix_splitAdaptorfade_float32(const float32_t*source, uint32_t sourcechannels, const _ambix_matrixfade_t*fade, const _ambix_matrixplan_t*plan, float32_t*dest_ambi, float32_t*dest_other, int64_t frames);
+/* @see _ambix_splitAdaptorfade_float32 */
+ambix_err_t _ambix_splitAdaptorfade_float64(const float64_t*source, uint32_t sourcechannels, const _ambix_matrixfade_t*fade, const _ambix_matrixplan_t*plan, float64_t*dest_ambi, float64_t*dest_other, int64_t frames);
+/* @see _ambix_splitAdaptorfade_float32 */
+ambix_err_t _ambix_splitAdaptorfade_int32(const int32_t*source, uint32_t sourcechannels, const _ambix_matrixfade_t*fade, const _ambix_matrixplan_t*plan, int32_t*dest_ambi, int32_t*dest_other, int64_t frames);
+/* @see _ambix_splitAdaptorfade_float32 */
+ambix_err_t _ambix_splitAdaptorfade_int16(const int16_t*source, uint32_t sourcechannels, const _ambix_matrixfade_t*fade, const _ambix_matrixplan_t*plan, int16_t*dest_ambi, int16_t*dest_other, int64_t frames);
+
+/** @brief extract ambisonics and non-ambisonics channels into planar buffers, crossfading between two matrix plans
+ *
+ * like _ambix_splitAdaptorfade_float32(), but writes each channel into a separate buffer
+ *
+ * @param offset the first frame to write in the per-channel buffers
+ */
+ambix_err_t _ambix_splitAdaptorfade_planar_float32(const float32_t*source, uint32_t sourcechannels, const _ambix_matrixfade_t*fade, const _ambix_matrixplan_t*plan, float32_t**dest_ambi, float32_t**dest_other, int64_t offset, int64_t frames);
+/* @see _ambix_splitAdaptorfade_planar_float32 */
+ambix_err_t _ambix_splitAdaptorfade_planar_float64(const float64_t*source, uint32_t sourcechannels, const _ambix_matrixfade_t*fade, const _ambix_matrixplan_t*plan, float64_t**dest_ambi, float64_t**dest_other, int64_t offset, int64_t frames);
+/* @see _ambix_splitAdaptorfade_planar_float32 */
+ambix_err_t _ambix_splitAdaptorfade_planar_int32(const int32_t*source, uint32_t sourcechannels, const _ambix_matrixfade_t*fade, const _ambix_matrixplan_t*plan, int32_t**dest_ambi, int32_t**dest_other, int64_t offset, int64_t frames);
+/* @see _ambix_splitAdaptorfade_planar_float32 */
+ambix_err_t _ambix_splitAdaptorfade_planar_int16(const int16_t*source, uint32_t sourcechannels, const _ambix_matrixfade_t*fade, const _ambix_matrixplan_t*plan, int16_t**dest_ambi, int16_t**dest_other, int64_t offset, int64_t frames);
+
+
 /** @brief debugging printout for ambix_info_t
  * @param info an ambixinfo struct
  */
@@ -0,0 +1,157 @@
+/* probe.c -  read the header of an ambix file              -*- c -*-
+
+   Copyright © 2026 IOhannes m zmölnig <zmoelnig@iem.at>.
+         Institute of Electronic Music and Acoustics (IEM),
+         University of Music and Dramatic Arts, Graz
+
+   This file is part of libambix
+
+   libambix is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   libambix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+ * ambix_probe() parses the CAF chunk headers directly (independent of the
+ * backend, but with the same 'desc' parser as the native CAF backend):
+ * only the 'desc' and 'uuid' chunks are read, the 'data' chunk
+ * (and any other chunk) is skipped.
+ */
+
+#include "private.h"
+
+#ifdef HAVE_STDLIB_H
+# include <stdlib.h>
+#endif /* HAVE_STDLIB_H */
+#ifdef HAVE_STRING_H
+# include <string.h>
+#endif /* HAVE_STRING_H */
+#include <stdio.h>
+
+#ifdef _WIN32
+# define _probe_fseek _fseeki64
+# define _probe_ftell _ftelli64
+#else
+# define _probe_fseek fseeko
+# define _probe_ftell ftello
+#endif
+
+/* uuid chunks larger than this are not ambix chunks (a 1024x1024 matrix) */
+#define _PROBE_MAXUUIDSIZE (16+8+1024*1024*4)
+
+/* read an ambix uuid chunk (if it is one) */
+static int _probe_uuid(FILE*file, int64_t size, ambix_matrix_t*matrix, int swap) {
+  char*data=NULL;
+  int result=0;
+  if(size<=16 || size>_PROBE_MAXUUIDSIZE)
+    return 0;
+  data=(char*)malloc((size_t)size);
+  if(!data)
+    return 0;
+  /* only read the whole chunk if it is ours */
+  if(16 == fread(data, 1, 16, file) && 1==_ambix_checkUUID(data)
+     && 1 == fread(data+16, (size_t)size-16, 1, file))
+    result=(NULL != _ambix_uuid1_to_matrix(data+16, size-16, matrix, swap));
+  free(data);
+  return result;
+}
+
+ambix_err_t ambix_probe(const char*path, ambix_info_t*info, ambix_matrix_t*matrix) {
+  ambix_info_t realinfo;
+  ambix_matrix_t uuidmatrix;
+  unsigned char header[12];
+  FILE*file=NULL;
+  _ambix_caf_desc_t desc;
+  int64_t offset=8, filesize=-1, datasize=-1;
+  uint32_t channels;
+  int havedesc=0, haveuuid=0, swap=0;
+
+  if(!path || !info)
+    return AMBIX_ERR_INVALID_HANDLE;
+  file=fopen(path, "rb");
+  if(!file)
+    return AMBIX_ERR_INVALID_FILE;
+  /* no read-ahead: we only want the (few) bytes we ask for */
+  setvbuf(file, NULL, _IONBF, 0);
+  memset(&realinfo, 0, sizeof(realinfo));
+  memset(&uuidmatrix, 0, sizeof(uuidmatrix));
+
+  if(8 != fread(header, 1, 8, file) || !_ambix_caf_checkheader(header)) {
+    fclose(file);
+    return AMBIX_ERR_INVALID_FILE;
+  }
+  /* walk the chunk headers (the 'desc' chunk must be the first one) */
+  while(!_probe_fseek(file, offset, SEEK_SET) && 12 == fread(header, 1, 12, file)) {
+    const int64_t size=(int64_t)_ambix_caf_get64(header+4);
+    offset+=12;
+    if(!memcmp(header, "desc", 4)) {
+      unsigned char data[32];
+      if(size<32 || 32 != fread(data, 1, 32, file) || !_ambix_caf_parsedesc(data, &desc))
+        break;
+      /* chunks written by libambix use the byte order of the samples */
+      swap=(desc.bigendian != _ambix_caf_host_bigendian());
+      havedesc=1;
+    } else if(!memcmp(header, "data", 4)) {
+      /* a size of -1 means: up to the end of the file */
+      if(size<0) {
+        if(_probe_fseek(file, 0, SEEK_END))
+          break;
+        filesize=_probe_ftell(file);
+        datasize=filesize-offset-4;
+        break;
+      }
+      datasize=size-4;
+    } else if(!memcmp(header, "uuid", 4) && havedesc && !haveuuid) {
+      haveuuid=_probe_uuid(file, size, &uuidmatrix, swap);
+    }
+    if(size<0 || size > INT64_MAX-offset)
+      break;
+    offset+=size;
+  }
+  fclose(file);
+
+  if(!havedesc || datasize<0) {
+    ambix_matrix_deinit(&uuidmatrix);
+    return AMBIX_ERR_INVALID_FILE;
+  }
+  realinfo.samplerate=desc.samplerate;
+  realinfo.sampleformat=desc.sampleformat;
+  realinfo.frames=(uint64_t)(datasize/desc.framesize);
+
+  /* same as ambix_open() does */
+  channels=desc.channels;
+  realinfo.extrachannels=channels;
+  if(haveuuid) {
+    if(uuidmatrix.cols <= channels && ambix_is_fullset(uuidmatrix.rows)) {
+      realinfo.fileformat=AMBIX_EXTENDED;
+      realinfo.ambichannels=uuidmatrix.cols;
+      realinfo.extrachannels=channels-uuidmatrix.cols;
+      if(matrix && !ambix_matrix_copy(&uuidmatrix, matrix)) {
+        ambix_matrix_deinit(&uuidmatrix);
+        return AMBIX_ERR_UNKNOWN;
+      }
+    } else {
+      realinfo.fileformat=AMBIX_NONE;
+    }
+  } else if(ambix_is_fullset(channels)) {
+    realinfo.fileformat=AMBIX_BASIC;
+    realinfo.ambichannels=channels;
+    realinfo.extrachannels=0;
+  } else {
+    realinfo.fileformat=AMBIX_NONE;
+  }
+  ambix_matrix_deinit(&uuidmatrix);
+
+  memcpy(info, &realinfo, sizeof(realinfo));
+  return AMBIX_ERR_SUCCESS;
+}
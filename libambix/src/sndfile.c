@@ -45,6 +45,16 @@
 
 //#define DEBUG_SFINFO
 
+#if defined HAVE_SF_GET_CHUNK_ITERATOR
+/** all chunks of the file with a given id */
+typedef struct _sndfile_chunks {
+  /** four-character code identifying the chunks */
+  uint32_t id;
+  /** size and data of the chunks (in the order they appear in the file) */
+  SF_CHUNK_INFO*chunks;
+  uint32_t numchunks;
+} _sndfile_chunks_t;
+#endif
 
 typedef struct ambixsndfile_private_t {
   /** handle to the libsndfile object */
@@ -59,6 +69,14 @@ typedef struct ambixsndfile_private_t {
   uint32_t sf_numchunks;
 #elif defined HAVE_SF_UUID_INFO
 #endif
+#if defined HAVE_SF_GET_CHUNK_ITERATOR
+  /** index of the chunks read so far (one entry per chunk id) */
+  _sndfile_chunks_t*chunkindex;
+  uint32_t chunkindexsize;
+#endif
+  /** callbacks for streams opened with ambix_open_virtual() */
+  ambix_virtual_io_t vio;
+  void*viodata;
 }ambixsndfile_private_t;
 static inline ambixsndfile_private_t*PRIVATE(ambix_t*ax) { return ((ambixsndfile_private_t*)(ax->private_data)); }
 
@@ -116,55 +134,96 @@ sndfile2ambix_info(const SF_INFO*sfinfo, ambix_info_t*axinfo) {
   axinfo->sampleformat=sndfile2ambix_sampleformat(sfinfo->format & SF_FORMAT_SUBMASK);
 }
 
-static int
-read_uuidchunk(ambix_t*ax) {
-#if defined HAVE_SF_GET_CHUNK_ITERATOR && defined (HAVE_SF_CHUNK_INFO)
-  int                           err ;
-  SF_CHUNK_INFO chunk_info ;
-  SNDFILE*file=PRIVATE(ax)->sf_file;
-  SF_CHUNK_ITERATOR *iterator;
-  uint32_t chunkver=0;
-
-  const char*id="uuid";
-  memset (&chunk_info, 0, sizeof (chunk_info)) ;
-  snprintf (chunk_info.id, sizeof (chunk_info.id), "%s", id) ;
-  chunk_info.id_size = 4 ;
+#if defined HAVE_SF_GET_CHUNK_ITERATOR
+/* get all chunks with the given id.
+ * libsndfile can only iterate over the chunks from the beginning of the file,
+ * so looking up the n-th chunk is O(n); instead we collect all chunks of an id
+ * in a single pass (the first time the id is asked for), and keep them
+ * (chunks are small metadata) until the file is closed */
+static const _sndfile_chunks_t*
+get_chunks(ambix_t*ax, uint32_t id) {
+  ambixsndfile_private_t*priv=PRIVATE(ax);
+  _sndfile_chunks_t*index=NULL, *entry=NULL;
+  SF_CHUNK_INFO chunk_info;
+  SF_CHUNK_ITERATOR*iterator;
+  uint32_t i;
+  for(i=0; i<priv->chunkindexsize; i++) {
+    if(priv->chunkindex[i].id == id)
+      return priv->chunkindex+i;
+  }
 
-  for(iterator = sf_get_chunk_iterator (file, &chunk_info); NULL!=iterator; iterator=sf_next_chunk_iterator (iterator)) {
-    if(chunk_info.data)
-      free(chunk_info.data);
-    chunk_info.data=NULL;
+  index=(_sndfile_chunks_t*)realloc(priv->chunkindex, (priv->chunkindexsize+1)*sizeof(*index));
+  if(!index)
+    return NULL;
+  priv->chunkindex=index;
+  entry=index+priv->chunkindexsize;
+  priv->chunkindexsize++;
+  entry->id=id;
+  entry->chunks=NULL;
+  entry->numchunks=0;
 
-    err = sf_get_chunk_size (iterator, &chunk_info) ;
-    if(err != SF_ERR_NO_ERROR) {
+  memset (&chunk_info, 0, sizeof (chunk_info));
+  memcpy(chunk_info.id, &id, 4);
+  chunk_info.id_size = 4;
+  for(iterator = sf_get_chunk_iterator (priv->sf_file, &chunk_info); NULL!=iterator; iterator=sf_next_chunk_iterator (iterator)) {
+    SF_CHUNK_INFO info;
+    SF_CHUNK_INFO*chunks=NULL;
+    memset (&info, 0, sizeof (info));
+    if(SF_ERR_NO_ERROR != sf_get_chunk_size (iterator, &info) || !info.datalen)
       continue;
-    }
-
-    if(chunk_info.datalen<16) {
+    info.data = malloc (info.datalen);
+    if(!info.data)
+      break;
+    if(SF_ERR_NO_ERROR != sf_get_chunk_data (iterator, &info)) {
+      free(info.data);
       continue;
     }
-
-    chunk_info.data = malloc (chunk_info.datalen) ;
-    if(!chunk_info.data) {
-      return AMBIX_ERR_UNKNOWN;
-    }
-    err = sf_get_chunk_data (iterator, &chunk_info) ;
-    if(err != SF_ERR_NO_ERROR) {
-      continue;
+    chunks=(SF_CHUNK_INFO*)realloc(entry->chunks, (entry->numchunks+1)*sizeof(*chunks));
+    if(!chunks) {
+      free(info.data);
+      break;
     }
+    entry->chunks=chunks;
+    entry->chunks[entry->numchunks++]=info;
+  }
+  return entry;
+}
 
-    chunkver=_ambix_checkUUID((const char*)chunk_info.data);
-    if(1==chunkver) {
-      if(_ambix_uuid1_to_matrix(((const char*)chunk_info.data+16), chunk_info.datalen-16, &ax->matrix, ax->byteswap)) {
-        free(chunk_info.data);
-        return AMBIX_ERR_SUCCESS;
-      }
-    } else
-      continue;
+static void
+free_chunks(ambixsndfile_private_t*priv) {
+  uint32_t i, j;
+  for(i=0; i<priv->chunkindexsize; i++) {
+    for(j=0; j<priv->chunkindex[i].numchunks; j++)
+      free(priv->chunkindex[i].chunks[j].data);
+    free(priv->chunkindex[i].chunks);
   }
+  free(priv->chunkindex);
+  priv->chunkindex=NULL;
+  priv->chunkindexsize=0;
+}
+#endif /* HAVE_SF_GET_CHUNK_ITERATOR */
 
-  if(chunk_info.data)
-    free(chunk_info.data) ;
+static int
+read_uuidchunk(ambix_t*ax) {
+#if defined HAVE_SF_GET_CHUNK_ITERATOR && defined (HAVE_SF_CHUNK_INFO)
+  union {
+    char c[4];
+    uint32_t i;
+  } id = {{'u', 'u', 'i', 'd'}};
+  const _sndfile_chunks_t*uuids=get_chunks(ax, id.i);
+  uint32_t i;
+  if(!uuids)
+    return AMBIX_ERR_UNKNOWN;
+
+  for(i=0; i<uuids->numchunks; i++) {
+    const SF_CHUNK_INFO*chunk_info=uuids->chunks+i;
+    if(chunk_info->datalen<16)
+      continue;
+    if(1!=_ambix_checkUUID((const char*)chunk_info->data))
+      continue;
+    if(_ambix_uuid1_to_matrix(((const char*)chunk_info->data+16), chunk_info->datalen-16, &ax->matrix, ax->byteswap))
+      return AMBIX_ERR_SUCCESS;
+  }
   return AMBIX_ERR_UNKNOWN;
 
 #elif defined HAVE_SF_UUID_INFO
@@ -186,26 +245,84 @@ read_uuidchunk(ambix_t*ax) {
 
 
 
-ambix_err_t _ambix_open (ambix_t*ambix, const char *path, const ambix_filemode_t mode, const ambix_info_t*ambixinfo) {
-  int sfmode=0;
-  int caf=0;
-  int is_ambix=0;
-
+/* create the private data, and find out how libsndfile should open the file */
+static int _sndfile_prepare(ambix_t*ambix, const ambix_filemode_t mode, const ambix_info_t*ambixinfo) {
   ambix->private_data=calloc(1, sizeof(ambixsndfile_private_t));
+  if(!ambix->private_data)
+    return 0;
   ambix2sndfile_info(ambixinfo, &PRIVATE(ambix)->sf_info);
 
   if((mode & AMBIX_READ) && (mode & AMBIX_WRITE))
-    sfmode=     SFM_RDWR;
+    /* libsndfile cannot replace (or remove) chunks of existing files */
+    return 0;
   else if (mode & AMBIX_WRITE)
-    sfmode=     SFM_WRITE;
+    return SFM_WRITE;
   else if (mode & AMBIX_READ)
-    sfmode=     SFM_READ;
+    return SFM_READ;
+  return 0;
+}
+static ambix_err_t _sndfile_init(ambix_t*ambix);
+
+ambix_err_t _ambix_open (ambix_t*ambix, const char *path, const ambix_filemode_t mode, const ambix_info_t*ambixinfo) {
+  const int sfmode=_sndfile_prepare(ambix, mode, ambixinfo);
+  if(!sfmode)
+    return AMBIX_ERR_INVALID_FILE;
 
   PRIVATE(ambix)->sf_file=sf_open(path, sfmode, &PRIVATE(ambix)->sf_info) ;
   if(!PRIVATE(ambix)->sf_file)
     return AMBIX_ERR_INVALID_FILE;
+  return _sndfile_init(ambix);
+}
+
+/* forward libsndfile's virtual I/O to ours */
+static sf_count_t _sndfile_vio_filelen(void*user_data) {
+  ambixsndfile_private_t*priv=(ambixsndfile_private_t*)user_data;
+  return (sf_count_t)(priv->vio.get_filelen?priv->vio.get_filelen(priv->viodata):-1);
+}
+static sf_count_t _sndfile_vio_seek(sf_count_t offset, int whence, void*user_data) {
+  ambixsndfile_private_t*priv=(ambixsndfile_private_t*)user_data;
+  return (sf_count_t)(priv->vio.seek?priv->vio.seek(offset, whence, priv->viodata):-1);
+}
+static sf_count_t _sndfile_vio_read(void*ptr, sf_count_t count, void*user_data) {
+  ambixsndfile_private_t*priv=(ambixsndfile_private_t*)user_data;
+  return (sf_count_t)(priv->vio.read?priv->vio.read(ptr, count, priv->viodata):0);
+}
+static sf_count_t _sndfile_vio_write(const void*ptr, sf_count_t count, void*user_data) {
+  ambixsndfile_private_t*priv=(ambixsndfile_private_t*)user_data;
+  return (sf_count_t)(priv->vio.write?priv->vio.write(ptr, count, priv->viodata):0);
+}
+static sf_count_t _sndfile_vio_tell(void*user_data) {
+  ambixsndfile_private_t*priv=(ambixsndfile_private_t*)user_data;
+  return (sf_count_t)(priv->vio.tell?priv->vio.tell(priv->viodata):-1);
+}
+
+ambix_err_t _ambix_open_virtual(ambix_t*ambix, const ambix_virtual_io_t*vio, void*userdata,
+                                const ambix_filemode_t mode, const ambix_info_t*ambixinfo) {
+  static SF_VIRTUAL_IO sfvio = {
+    _sndfile_vio_filelen,
+    _sndfile_vio_seek,
+    _sndfile_vio_read,
+    _sndfile_vio_write,
+    _sndfile_vio_tell,
+  };
+  const int sfmode=_sndfile_prepare(ambix, mode, ambixinfo);
+  if(!sfmode)
+    return AMBIX_ERR_INVALID_FILE;
+
+  PRIVATE(ambix)->vio=*vio;
+  PRIVATE(ambix)->viodata=userdata;
+  PRIVATE(ambix)->sf_file=sf_open_virtual(&sfvio, sfmode, &PRIVATE(ambix)->sf_info, PRIVATE(ambix));
+  if(!PRIVATE(ambix)->sf_file)
+    return AMBIX_ERR_INVALID_FILE;
+  return _sndfile_init(ambix);
+}
+
+/* find out what kind of file libsndfile has opened for us */
+static ambix_err_t _sndfile_init(ambix_t*ambix) {
+  int caf=0;
+  int is_ambix=0;
 
-  memset(&ambix->realinfo, 0, sizeof(*ambixinfo));
+  memset(&ambix->realinfo, 0, sizeof(ambix->realinfo));
   sndfile2ambix_info(&PRIVATE(ambix)->sf_info, &ambix->realinfo);
 
   ambix->byteswap=(sf_command(PRIVATE(ambix)->sf_file, SFC_RAW_DATA_NEEDS_ENDSWAP, NULL, 0) == SF_TRUE);
@@ -309,6 +426,9 @@ ambix_err_t     _ambix_close    (ambix_t*ambix) {
   }
   free(PRIVATE(ambix)->sf_otherchunks);
 #endif
+#if defined HAVE_SF_GET_CHUNK_ITERATOR
+  free_chunks(PRIVATE(ambix));
+#endif
 
   free(PRIVATE(ambix));
   return AMBIX_ERR_SUCCESS;
@@ -335,6 +455,10 @@ int64_t _ambix_seek (ambix_t* ambix, int64_t frames, int bias) {
 void*_ambix_get_sndfile      (ambix_t*ambix) {
   return PRIVATE(ambix)->sf_file;
 }
+const float32_t*_ambix_map_float32(ambix_t*ambix, int64_t*frames) {
+  /* libsndfile does not give us access to its file descriptor */
+  return NULL;
+}
 int64_t _ambix_readf_int16   (ambix_t*ambix, int16_t*data, int64_t frames) {
   return (int64_t)sf_readf_short(PRIVATE(ambix)->sf_file, (short*)data, frames) ;
 }
@@ -437,40 +561,22 @@ ambix_err_t _ambix_write_chunk(ambix_t*ax, uint32_t id, const void*data, int64_t
 #endif
   return  AMBIX_ERR_UNKNOWN;
 }
+ambix_err_t _ambix_delete_chunks(ambix_t*ax, uint32_t id) {
+  return AMBIX_ERR_UNKNOWN;
+}
 void* _ambix_read_chunk(ambix_t*ax, uint32_t id, uint32_t chunk_it, int64_t *datasize) {
 #if defined HAVE_SF_GET_CHUNK_ITERATOR
-  int err;
-  SF_CHUNK_INFO	chunk_info;
-  SF_CHUNK_ITERATOR * iterator;
-  int i;
-  memset (&chunk_info, 0, sizeof (chunk_info));
-  memcpy(chunk_info.id, &id, 4);
-  chunk_info.id_size = 4;
-  iterator = sf_get_chunk_iterator (PRIVATE(ax)->sf_file, &chunk_info);
-  if (!iterator) {
-    *datasize = 0;
+  const _sndfile_chunks_t*chunks=get_chunks(ax, id);
+  void*data=NULL;
+  *datasize = 0;
+  if (!chunks || chunk_it >= chunks->numchunks)
     return NULL;
-  }
-  // jump to wanted iterator
-  for (i=0; i<chunk_it; i++) {
-    iterator = sf_next_chunk_iterator (iterator) ;
-    if (!iterator) {
-      *datasize = 0;
-      return NULL;
-    }
-  }
-  memset (&chunk_info, 0, sizeof (chunk_info));
-  err = sf_get_chunk_size (iterator, &chunk_info);
-  if (!chunk_info.datalen) {
-    *datasize = 0;
+  data = malloc (chunks->chunks[chunk_it].datalen); // has to be freed later by the caller!
+  if (!data)
     return NULL;
-  }
-  chunk_info.data = malloc (chunk_info.datalen); // has to be freed later by the caller!
-  err = sf_get_chunk_data (iterator, &chunk_info);
-
-  // free (chunk_info.data);
-  *datasize = chunk_info.datalen;
-  return chunk_info.data;
+  memcpy(data, chunks->chunks[chunk_it].data, chunks->chunks[chunk_it].datalen);
+  *datasize = chunks->chunks[chunk_it].datalen;
+  return data;
 #endif
   /* coverity[unreachable]: reachable in the case of sndfile without set_chunk */
   *datasize = 0;
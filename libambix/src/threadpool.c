@@ -0,0 +1,198 @@
+/* threadpool.c -  worker threads for parallel processing              -*- c -*-
+
+   Copyright © 2026 IOhannes m zmölnig <zmoelnig@iem.at>.
+         Institute of Electronic Music and Acoustics (IEM),
+         University of Music and Dramatic Arts, Graz
+
+   This file is part of libambix
+
+   libambix is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   libambix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+ * a minimal fork/join pool:
+ * _ambix_threadpool_run() hands out the tasks 0..numtasks-1 to the workers
+ * (and the calling thread, which takes part in the work), and returns once
+ * all of them are done.
+ * the tasks are expected to be coarse (a range of several hundred frames),
+ * so a single mutex protecting the task counter is good enough.
+ */
+
+#include "private.h"
+
+#ifdef HAVE_STDLIB_H
+# include <stdlib.h>
+#endif /* HAVE_STDLIB_H */
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif /* HAVE_UNISTD_H */
+#ifdef _WIN32
+# include <windows.h>
+#endif /* _WIN32 */
+
+uint32_t _ambix_num_cpus(void) {
+  long cpus=1;
+#if defined _WIN32
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  cpus=info.dwNumberOfProcessors;
+#elif defined HAVE_UNISTD_H && defined _SC_NPROCESSORS_ONLN
+  cpus=sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+  return (cpus>1)?(uint32_t)cpus:1;
+}
+
+#ifdef HAVE_PTHREADS
+#include <pthread.h>
+
+struct _ambix_threadpool_t_struct {
+  pthread_mutex_t mutex;
+  /** signalled when new tasks are available (or the workers should quit) */
+  pthread_cond_t work;
+  /** signalled when the last task has finished */
+  pthread_cond_t done;
+
+  pthread_t*threads;
+  uint32_t numthreads;
+
+  /* the current job */
+  _ambix_threadfun_t fun;
+  void*userdata;
+  uint32_t numtasks;
+  uint32_t nexttask;
+  uint32_t pendingtasks;
+
+  int quit;
+};
+
+/* run tasks until there are none left; must be called with the mutex held */
+static void _ambix_threadpool_work(_ambix_threadpool_t*pool) {
+  while(pool->nexttask < pool->numtasks) {
+    const uint32_t task=pool->nexttask++;
+    _ambix_threadfun_t fun=pool->fun;
+    void*userdata=pool->userdata;
+    pthread_mutex_unlock(&pool->mutex);
+    fun(userdata, task);
+    pthread_mutex_lock(&pool->mutex);
+    if(!--pool->pendingtasks)
+      pthread_cond_signal(&pool->done);
+  }
+}
+
+static void*_ambix_threadpool_worker(void*arg) {
+  _ambix_threadpool_t*pool=(_ambix_threadpool_t*)arg;
+  pthread_mutex_lock(&pool->mutex);
+  while(!pool->quit) {
+    _ambix_threadpool_work(pool);
+    if(!pool->quit)
+      pthread_cond_wait(&pool->work, &pool->mutex);
+  }
+  pthread_mutex_unlock(&pool->mutex);
+  return NULL;
+}
+
+_ambix_threadpool_t*_ambix_threadpool_create(uint32_t numthreads) {
+  _ambix_threadpool_t*pool=NULL;
+  uint32_t i;
+  if(numthreads<2)
+    return NULL;
+  pool=(_ambix_threadpool_t*)calloc(1, sizeof(*pool));
+  if(!pool)
+    return NULL;
+  /* the calling thread is a worker as well */
+  pool->threads=(pthread_t*)calloc(numthreads-1, sizeof(*pool->threads));
+  if(!pool->threads) {
+    free(pool);
+    return NULL;
+  }
+  pthread_mutex_init(&pool->mutex, NULL);
+  pthread_cond_init(&pool->work, NULL);
+  pthread_cond_init(&pool->done, NULL);
+  for(i=0; i<numthreads-1; i++) {
+    if(pthread_create(pool->threads+i, NULL, _ambix_threadpool_worker, pool))
+      break;
+    pool->numthreads++;
+  }
+  if(!pool->numthreads) {
+    _ambix_threadpool_destroy(pool);
+    return NULL;
+  }
+  return pool;
+}
+
+void _ambix_threadpool_destroy(_ambix_threadpool_t*pool) {
+  uint32_t i;
+  if(!pool)
+    return;
+  pthread_mutex_lock(&pool->mutex);
+  pool->quit=1;
+  pthread_cond_broadcast(&pool->work);
+  pthread_mutex_unlock(&pool->mutex);
+  for(i=0; i<pool->numthreads; i++)
+    pthread_join(pool->threads[i], NULL);
+
+  pthread_cond_destroy(&pool->done);
+  pthread_cond_destroy(&pool->work);
+  pthread_mutex_destroy(&pool->mutex);
+  free(pool->threads);
+  free(pool);
+}
+
+uint32_t _ambix_threadpool_size(const _ambix_threadpool_t*pool) {
+  return pool?(pool->numthreads+1):1;
+}
+
+void _ambix_threadpool_run(_ambix_threadpool_t*pool, _ambix_threadfun_t fun, void*userdata, uint32_t numtasks) {
+  uint32_t i;
+  if(!pool || numtasks<2) {
+    for(i=0; i<numtasks; i++)
+      fun(userdata, i);
+    return;
+  }
+  pthread_mutex_lock(&pool->mutex);
+  pool->fun=fun;
+  pool->userdata=userdata;
+  pool->numtasks=numtasks;
+  pool->nexttask=0;
+  pool->pendingtasks=numtasks;
+  pthread_cond_broadcast(&pool->work);
+
+  _ambix_threadpool_work(pool);
+  while(pool->pendingtasks)
+    pthread_cond_wait(&pool->done, &pool->mutex);
+
+  pool->numtasks=pool->nexttask=0;
+  pool->fun=NULL;
+  pool->userdata=NULL;
+  pthread_mutex_unlock(&pool->mutex);
+}
+
+#else /* !HAVE_PTHREADS */
+
+_ambix_threadpool_t*_ambix_threadpool_create(uint32_t numthreads) {
+  return NULL;
+}
+void _ambix_threadpool_destroy(_ambix_threadpool_t*pool) {
+}
+uint32_t _ambix_threadpool_size(const _ambix_threadpool_t*pool) {
+  return 1;
+}
+void _ambix_threadpool_run(_ambix_threadpool_t*pool, _ambix_threadfun_t fun, void*userdata, uint32_t numtasks) {
+  uint32_t i;
+  for(i=0; i<numtasks; i++)
+    fun(userdata, i);
+}
+
+#endif /* HAVE_PTHREADS */
@@ -111,6 +111,7 @@ void _ambix_print_ambix(const ambix_t*ambix) {
   printf("  matrix2\t:\n");
   _ambix_print_matrix(&ambix->matrix2);
   printf("  use_matrix\t: %d\n", ambix->use_matrix);
+  printf("  matrixplan\t: %d\n", ambix->matrixplan.type);
   printf("  adaptorbuffer\t: %p\n", ambix->adaptorbuffer);
   printf("  adaptorbuffersize\t: %d\n", (int)(ambix->adaptorbuffersize));
   printf("  ambisonics_order\t: %d\n", ambix->ambisonics_order);
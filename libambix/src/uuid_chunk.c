@@ -80,12 +80,18 @@ static const char _ambix_uuid_v1_[]="IEM.AT/AMBIX/XML";
  * that's a better UUID, based on a SHA1-hash of "http://ambisonics.iem.at/xchange/format/1.0"
  */
 static const char _ambix_uuid_v1[]={0x1a, 0xd3, 0x18, 0xc3, 0x00, 0xe5, 0x55, 0x76, 0xbe, 0x2d, 0x0d, 0xca, 0x24, 0x60, 0xbc, 0x89};
+/*
+ * "http://ambisonics.iem.at/xchange/format/2.0": keyframes of a time-varying adaptor matrix
+ */
+static const char _ambix_uuid_v2[]={0x7c, 0x44, 0x91, 0x94, 0x05, 0xe1, 0x58, 0xe4, 0x94, 0x63, 0xd0, 0xf8, 0xf2, 0xa1, 0xed, 0x0f};
 const char* _ambix_getUUID(uint32_t version) {
   switch(version) {
   default:
     break;
   case 1:
     return _ambix_uuid_v1;
+  case 2:
+    return _ambix_uuid_v2;
   }
   return NULL;
 }
@@ -94,6 +100,8 @@ uint32_t
 _ambix_checkUUID(const char data[16]) {
   if(!memcmp(data, _ambix_uuid_v1, 16))
     return 1;
+  if(!memcmp(data, _ambix_uuid_v2, 16))
+    return 2;
   /* compat mode: old AMBIXv1 UUID */
   if(!memcmp(data, _ambix_uuid_v1_, 16))
     return 1;
@@ -197,9 +205,14 @@ _ambix_matrix_to_uuid1(const ambix_matrix_t*matrix, void*vdata, int swap) {
     memcpy(cdata+index, &cols, sizeof(uint32_t));
     index+=sizeof(uint32_t);
 
-    for(r=0; r<rows; r++) {
-      memcpy(cdata+index, mtx[r], cols*sizeof(float32_t));
-      index+=cols*sizeof(float32_t);
+    if(_ambix_matrix_data(matrix)) {
+      memcpy(cdata+index, _ambix_matrix_data(matrix), elements*sizeof(float32_t));
+      index+=elements*sizeof(float32_t);
+    } else {
+      for(r=0; r<rows; r++) {
+        memcpy(cdata+index, mtx[r], cols*sizeof(float32_t));
+        index+=cols*sizeof(float32_t);
+      }
     }
 
     if(swap) {
@@ -208,3 +221,110 @@ _ambix_matrix_to_uuid1(const ambix_matrix_t*matrix, void*vdata, int swap) {
   }
   return datasize;
 }
+
+
+/* the v2 chunk (keyframes) is:
+ *   uint32_t rows, cols;    (same as the adaptor matrix in the v1 chunk)
+ *   uint32_t count;         (number of keyframes)
+ *   uint32_t reserved;      (0; keeps the index 8-byte aligned)
+ *   int64_t frames[count];  (the position of each keyframe, ascending)
+ *   float32_t data[count][rows][cols];
+ * the positions come first, so they can be searched without touching the matrices.
+ * all values use the same byte order as the v1 chunk.
+ */
+#define _AMBIX_UUID2_HEADERSIZE (4*sizeof(uint32_t))
+
+_ambix_timeline_t*
+_ambix_uuid2_to_timeline(const void*vdata, uint64_t datasize, const ambix_matrix_t*matrix, int swap) {
+  const char*cdata=(const char*)vdata;
+  _ambix_timeline_t*timeline=NULL;
+  ambix_matrix_t*key=NULL;
+  uint32_t header[4];
+  uint64_t elements, i;
+  int64_t last=0;
+
+  if(!matrix || datasize<_AMBIX_UUID2_HEADERSIZE)
+    return NULL;
+  memcpy(header, cdata, sizeof(header));
+  if(swap)
+    _ambix_swap4array(header, 4);
+  /* the keyframes replace the adaptor matrix, so they must fit */
+  if(header[0] != matrix->rows || header[1] != matrix->cols || !header[2])
+    return NULL;
+  elements=(uint64_t)header[0]*header[1];
+  if((datasize-_AMBIX_UUID2_HEADERSIZE)/(sizeof(int64_t)+elements*sizeof(float32_t)) < header[2])
+    return NULL;
+
+  timeline=_ambix_timeline_create(header[0], header[1]);
+  key=ambix_matrix_init(header[0], header[1], NULL);
+  if(!timeline || !key)
+    goto cleanup;
+  for(i=0; i<header[2]; i++) {
+    const char*keydata=cdata+_AMBIX_UUID2_HEADERSIZE+header[2]*sizeof(int64_t)+i*elements*sizeof(float32_t);
+    uint64_t frame;
+    ambix_err_t err;
+    memcpy(&frame, cdata+_AMBIX_UUID2_HEADERSIZE+i*sizeof(int64_t), sizeof(frame));
+    if(swap)
+      frame=swap8(frame);
+    /* the index must be sorted, else we cannot search it */
+    if((int64_t)frame<last)
+      goto cleanup;
+    last=(int64_t)frame;
+    if(swap)
+      err=_ambix_matrix_fill_data_byteswapped(key, (const number32_t*)keydata);
+    else
+      err=ambix_matrix_fill_data(key, (const float32_t*)keydata);
+    if(AMBIX_ERR_SUCCESS != err || AMBIX_ERR_SUCCESS != _ambix_timeline_add(timeline, last, key))
+      goto cleanup;
+  }
+  ambix_matrix_destroy(key);
+  return timeline;
+
+ cleanup:
+  if(key)
+    ambix_matrix_destroy(key);
+  _ambix_timeline_destroy(timeline);
+  return NULL;
+}
+
+uint64_t
+_ambix_timeline_to_uuid2(const _ambix_timeline_t*timeline, void*vdata, int swap) {
+  char*cdata=(char*)vdata;
+  const char*uuid=_ambix_getUUID(2);
+  const uint32_t count=_ambix_timeline_size(timeline);
+  uint32_t header[4];
+  uint64_t elements, datasize, i;
+  if(!uuid || !count)
+    return 0;
+  header[0]=_ambix_timeline_rows(timeline);
+  header[1]=_ambix_timeline_cols(timeline);
+  header[2]=count;
+  header[3]=0;
+  elements=(uint64_t)header[0]*header[1];
+  datasize=16+_AMBIX_UUID2_HEADERSIZE+count*(sizeof(int64_t)+elements*sizeof(float32_t));
+
+  if(cdata) {
+    char*index=cdata+16+_AMBIX_UUID2_HEADERSIZE;
+    char*data=index+count*sizeof(int64_t);
+    memcpy(cdata, uuid, 16);
+    if(swap)
+      _ambix_swap4array(header, 4);
+    memcpy(cdata+16, header, sizeof(header));
+    for(i=0; i<count; i++) {
+      int64_t frame=0;
+      const ambix_matrix_t*key=_ambix_timeline_get(timeline, (uint32_t)i, &frame);
+      uint64_t uframe=(uint64_t)frame;
+      uint32_t r;
+      if(swap)
+        uframe=swap8(uframe);
+      memcpy(index+i*sizeof(int64_t), &uframe, sizeof(uframe));
+      for(r=0; r<key->rows; r++) {
+        memcpy(data, key->data[r], key->cols*sizeof(float32_t));
+        if(swap)
+          _ambix_swap4array((uint32_t*)data, key->cols);
+        data+=key->cols*sizeof(float32_t);
+      }
+    }
+  }
+  return datasize;
+}
@@ -0,0 +1,271 @@
+/* virtualio.c -  open ambix streams on file descriptors and memory   -*- c -*-
+
+   Copyright © 2026 IOhannes m zmölnig <zmoelnig@iem.at>.
+         Institute of Electronic Music and Acoustics (IEM),
+         University of Music and Dramatic Arts, Graz
+
+   This file is part of libambix
+
+   libambix is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   libambix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+ * ambix_open_fd() and ambix_open_memory() are thin wrappers around
+ * ambix_open_virtual(): they provide the callbacks, and release their state
+ * (via ambix_t::closefun) once the backend has closed the stream.
+ */
+
+#include "private.h"
+
+#ifdef HAVE_STDLIB_H
+# include <stdlib.h>
+#endif /* HAVE_STDLIB_H */
+#ifdef HAVE_STRING_H
+# include <string.h>
+#endif /* HAVE_STRING_H */
+#include <stdio.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+# include <io.h>
+# define _vio_read _read
+# define _vio_write _write
+# define _vio_lseek _lseeki64
+# define _vio_close _close
+# define _vio_fstat _fstat64
+typedef struct __stat64 _vio_stat_t;
+typedef unsigned int _vio_size_t;
+# ifndef S_ISREG
+#  define S_ISREG(mode) (((mode) & _S_IFMT) == _S_IFREG)
+# endif
+#else
+# include <unistd.h>
+# define _vio_read read
+# define _vio_write write
+# define _vio_lseek lseek
+# define _vio_close close
+# define _vio_fstat fstat
+typedef struct stat _vio_stat_t;
+typedef size_t _vio_size_t;
+#endif
+
+/* never ask the OS for more than this at once */
+#define _VIO_MAXIO (1<<30)
+
+/* ------------------------------ file descriptors ------------------------------ */
+typedef struct _vio_fd_t {
+  int fd;
+  int close_desc;
+} _vio_fd_t;
+
+static int64_t _vio_fd_filelen(void*userdata) {
+  _vio_fd_t*x=(_vio_fd_t*)userdata;
+  _vio_stat_t st;
+  if(_vio_fstat(x->fd, &st))
+    return -1;
+  /* pipes, sockets,... have no length */
+  if(!S_ISREG(st.st_mode))
+    return -1;
+  return (int64_t)st.st_size;
+}
+static int64_t _vio_fd_seek(int64_t offset, int whence, void*userdata) {
+  _vio_fd_t*x=(_vio_fd_t*)userdata;
+  return (int64_t)_vio_lseek(x->fd, offset, whence);
+}
+static int64_t _vio_fd_read(void*ptr, int64_t count, void*userdata) {
+  _vio_fd_t*x=(_vio_fd_t*)userdata;
+  int64_t got;
+  if(count>_VIO_MAXIO)
+    count=_VIO_MAXIO;
+  do {
+    got=(int64_t)_vio_read(x->fd, ptr, (_vio_size_t)count);
+  } while(got<0 && EINTR == errno);
+  return (got<0)?0:got;
+}
+static int64_t _vio_fd_write(const void*ptr, int64_t count, void*userdata) {
+  _vio_fd_t*x=(_vio_fd_t*)userdata;
+  int64_t got;
+  if(count>_VIO_MAXIO)
+    count=_VIO_MAXIO;
+  do {
+    got=(int64_t)_vio_write(x->fd, ptr, (_vio_size_t)count);
+  } while(got<0 && EINTR == errno);
+  return (got<0)?0:got;
+}
+static int64_t _vio_fd_tell(void*userdata) {
+  return _vio_fd_seek(0, SEEK_CUR, userdata);
+}
+static ambix_err_t _vio_fd_close(void*userdata) {
+  _vio_fd_t*x=(_vio_fd_t*)userdata;
+  ambix_err_t res=AMBIX_ERR_SUCCESS;
+  if(x->close_desc && _vio_close(x->fd))
+    res=AMBIX_ERR_UNKNOWN;
+  free(x);
+  return res;
+}
+
+ambix_t*ambix_open_fd(int fd, const ambix_filemode_t mode, ambix_info_t*ambixinfo, int close_desc) {
+  static const ambix_virtual_io_t vio = {
+    _vio_fd_filelen,
+    _vio_fd_seek,
+    _vio_fd_read,
+    _vio_fd_write,
+    _vio_fd_tell,
+  };
+  ambix_t*ambix=NULL;
+  _vio_fd_t*x=NULL;
+  if(fd<0)
+    return NULL;
+  x=(_vio_fd_t*)calloc(1, sizeof(*x));
+  if(!x)
+    return NULL;
+  x->fd=fd;
+  x->close_desc=close_desc;
+  ambix=ambix_open_virtual(&vio, mode, ambixinfo, x);
+  if(!ambix) {
+    /* the caller still owns the descriptor */
+    free(x);
+    return NULL;
+  }
+  ambix->closefun=_vio_fd_close;
+  ambix->closedata=x;
+  return ambix;
+}
+
+/* ------------------------------ memory ------------------------------ */
+typedef struct _vio_mem_t {
+  unsigned char*data;
+  int64_t size;
+  int64_t capacity;
+  int64_t position;
+  /* where to return the data when closing (NULL if read-only) */
+  void**userdata;
+  int64_t*usersize;
+} _vio_mem_t;
+
+static int64_t _vio_mem_filelen(void*userdata) {
+  return ((_vio_mem_t*)userdata)->size;
+}
+static int64_t _vio_mem_seek(int64_t offset, int whence, void*userdata) {
+  _vio_mem_t*x=(_vio_mem_t*)userdata;
+  switch(whence) {
+  case SEEK_CUR: offset+=x->position; break;
+  case SEEK_END: offset+=x->size; break;
+  default: break;
+  }
+  if(offset<0)
+    return -1;
+  x->position=offset;
+  return offset;
+}
+static int64_t _vio_mem_read(void*ptr, int64_t count, void*userdata) {
+  _vio_mem_t*x=(_vio_mem_t*)userdata;
+  if(count > x->size - x->position)
+    count=x->size - x->position;
+  if(count<=0)
+    return 0;
+  memcpy(ptr, x->data + x->position, (size_t)count);
+  x->position+=count;
+  return count;
+}
+static int64_t _vio_mem_write(const void*ptr, int64_t count, void*userdata) {
+  _vio_mem_t*x=(_vio_mem_t*)userdata;
+  const int64_t end=x->position+count;
+  if(count<=0)
+    return 0;
+  if(end > x->capacity) {
+    /* grow geometrically, so appending sample data is amortized O(1) */
+    int64_t capacity=(x->capacity>0)?x->capacity:4096;
+    unsigned char*data;
+    while(capacity<end)
+      capacity*=2;
+    if((uint64_t)capacity > (uint64_t)((size_t)-1))
+      return 0;
+    data=(unsigned char*)realloc(x->data, (size_t)capacity);
+    if(!data)
+      return 0;
+    x->data=data;
+    x->capacity=capacity;
+  }
+  /* seeking beyond the end leaves a hole */
+  if(x->position > x->size)
+    memset(x->data + x->size, 0, (size_t)(x->position - x->size));
+  memcpy(x->data + x->position, ptr, (size_t)count);
+  x->position=end;
+  if(end > x->size)
+    x->size=end;
+  return count;
+}
+static int64_t _vio_mem_tell(void*userdata) {
+  return ((_vio_mem_t*)userdata)->position;
+}
+static ambix_err_t _vio_mem_close(void*userdata) {
+  _vio_mem_t*x=(_vio_mem_t*)userdata;
+  if(x->userdata) {
+    *x->userdata=x->data;
+    *x->usersize=x->size;
+  }
+  free(x);
+  return AMBIX_ERR_SUCCESS;
+}
+
+ambix_t*ambix_open_memory(void**data, int64_t*size, const ambix_filemode_t mode, ambix_info_t*ambixinfo) {
+  static const ambix_virtual_io_t vio_read = {
+    _vio_mem_filelen,
+    _vio_mem_seek,
+    _vio_mem_read,
+    NULL,
+    _vio_mem_tell,
+  };
+  static const ambix_virtual_io_t vio_write = {
+    _vio_mem_filelen,
+    _vio_mem_seek,
+    _vio_mem_read,
+    _vio_mem_write,
+    _vio_mem_tell,
+  };
+  ambix_t*ambix=NULL;
+  _vio_mem_t*x=NULL;
+  if(!data || !size)
+    return NULL;
+  x=(_vio_mem_t*)calloc(1, sizeof(*x));
+  if(!x)
+    return NULL;
+  if(AMBIX_READ & mode) {
+    if(!*data || *size<0) {
+      free(x);
+      return NULL;
+    }
+    x->data=(unsigned char*)*data;
+    x->size=x->capacity=*size;
+  }
+  if(AMBIX_WRITE & mode) {
+    x->userdata=data;
+    x->usersize=size;
+  }
+  ambix=ambix_open_virtual((AMBIX_WRITE & mode)?&vio_write:&vio_read, mode, ambixinfo, x);
+  if(!ambix) {
+    /* only free what we allocated ourselves */
+    if(!(AMBIX_READ & mode))
+      free(x->data);
+    free(x);
+    return NULL;
+  }
+  ambix->closefun=_vio_mem_close;
+  ambix->closedata=x;
+  return ambix;
+}
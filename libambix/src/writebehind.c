@@ -0,0 +1,373 @@
+/* writebehind.c -  writing sample data in a background thread              -*- c -*-
+
+   Copyright © 2026 IOhannes m zmölnig <zmoelnig@iem.at>.
+         Institute of Electronic Music and Acoustics (IEM),
+         University of Music and Dramatic Arts, Graz
+
+   This file is part of libambix
+
+   libambix is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   libambix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+ * with AMBIX_WRITEBEHIND, ambix_writef() only copies the caller's data into
+ * a ringbuffer; a writer thread applies the adaptor matrix and writes the
+ * frames to disk.
+ *
+ * the ring is a fixed block of memory (allocated when opening the file).
+ * it is split into two rings (for the ambisonics resp. the extra channels)
+ * that share the same indices, so the writer thread can hand contiguous
+ * ranges of both straight to the (synchronous) writef function.
+ * the rings hold samples of the type the caller writes; if the caller
+ * switches to another type, the rings are drained first.
+ *
+ * as with the prefetcher, the ring is single-producer/single-consumer and
+ * the writer thread polls while the ring is empty; only if the ring is full
+ * (and the back-pressure policy says so), the caller has to wait.
+ */
+
+#include "private.h"
+
+#ifdef HAVE_STDLIB_H
+# include <stdlib.h>
+#endif /* HAVE_STDLIB_H */
+#ifdef HAVE_STRING_H
+# include <string.h>
+#endif /* HAVE_STRING_H */
+
+#if defined HAVE_PTHREADS && defined HAVE_STDATOMIC_H && !defined __STDC_NO_ATOMICS__
+# define _AMBIX_HAVE_WRITEBEHIND 1
+#endif
+
+#ifdef _AMBIX_HAVE_WRITEBEHIND
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/time.h>
+
+/* maximum number of frames written to the file at once */
+#define _AMBIX_WRITEBEHIND_CHUNK 4096
+/* how often the writer thread checks for new data */
+#define _AMBIX_WRITEBEHIND_POLL_MS 5
+
+struct _ambix_writebehind_t_struct {
+  ambix_t*ambix;
+  ambix_backpressure_t policy;
+  /** whether the producer must never wait (AMBIX_REALTIME) */
+  int realtime;
+
+  /** the memory holding both rings */
+  unsigned char*memory;
+  size_t memorysize;
+
+  /* the current layout of the rings (only changed while they are empty) */
+  _ambix_writefun_t writefun;
+  size_t typesize;
+  uint32_t ambichannels, extrachannels;
+  unsigned char*ambiring, *extraring;
+  /** size of the rings in frames (a power of 2) */
+  size_t size;
+
+  /** total number of frames written into resp. read from the ring */
+  atomic_size_t head, tail;
+  /** whether the writer thread failed to write */
+  atomic_int error;
+  /** whether the producer is waiting for the writer thread */
+  atomic_int waiting;
+  atomic_int quit;
+
+  atomic_int_fast64_t highwater;
+  atomic_uint_fast64_t overruns;
+  atomic_uint_fast64_t dropped;
+
+  pthread_mutex_t mutex;
+  /** wakes the writer thread */
+  pthread_cond_t wakeup;
+  /** wakes the producer (when it is waiting for space) */
+  pthread_cond_t space;
+  pthread_t thread;
+};
+
+static void _ambix_writebehind_sleep(_ambix_writebehind_t*wb) {
+  struct timeval now;
+  struct timespec timeout;
+  gettimeofday(&now, NULL);
+  timeout.tv_sec=now.tv_sec;
+  timeout.tv_nsec=now.tv_usec*1000 + _AMBIX_WRITEBEHIND_POLL_MS*1000000L;
+  if(timeout.tv_nsec>=1000000000L) {
+    timeout.tv_sec++;
+    timeout.tv_nsec-=1000000000L;
+  }
+  pthread_mutex_lock(&wb->mutex);
+  if(!atomic_load(&wb->quit) && !atomic_load(&wb->waiting))
+    pthread_cond_timedwait(&wb->wakeup, &wb->mutex, &timeout);
+  pthread_mutex_unlock(&wb->mutex);
+}
+
+static void*_ambix_writebehind_thread(void*arg) {
+  _ambix_writebehind_t*wb=(_ambix_writebehind_t*)arg;
+  for(;;) {
+    const size_t tail=atomic_load(&wb->tail);
+    const size_t queued=atomic_load(&wb->head) - tail;
+    size_t offset, count;
+    if(!queued) {
+      /* only quit once everything has been written */
+      if(atomic_load(&wb->quit))
+        break;
+      _ambix_writebehind_sleep(wb);
+      continue;
+    }
+    offset=tail & (wb->size-1);
+    count=wb->size - offset;
+    if(count>queued)count=queued;
+    if(count>_AMBIX_WRITEBEHIND_CHUNK)count=_AMBIX_WRITEBEHIND_CHUNK;
+
+    if(!atomic_load(&wb->error)) {
+      const int64_t written=wb->writefun(wb->ambix,
+                                         wb->ambiring + offset*wb->ambichannels*wb->typesize,
+                                         wb->extraring + offset*wb->extrachannels*wb->typesize,
+                                         (int64_t)count);
+      if(written != (int64_t)count)
+        atomic_store(&wb->error, 1);
+    }
+    atomic_store(&wb->tail, tail+count);
+    if(atomic_load(&wb->waiting)) {
+      pthread_mutex_lock(&wb->mutex);
+      pthread_cond_broadcast(&wb->space);
+      pthread_mutex_unlock(&wb->mutex);
+    }
+  }
+  return NULL;
+}
+
+_ambix_writebehind_t*_ambix_writebehind_create(ambix_t*ambix, uint64_t bytes) {
+  _ambix_writebehind_t*wb=(_ambix_writebehind_t*)calloc(1, sizeof(*wb));
+  if(!wb)
+    return NULL;
+  wb->ambix=ambix;
+  wb->realtime=!!(AMBIX_REALTIME & ambix->filemode);
+  wb->policy=wb->realtime?AMBIX_BACKPRESSURE_DROP:AMBIX_BACKPRESSURE_BLOCK;
+  wb->memory=(unsigned char*)malloc(bytes);
+  wb->memorysize=bytes;
+  if(!wb->memory) {
+    free(wb);
+    return NULL;
+  }
+  atomic_init(&wb->head, 0);
+  atomic_init(&wb->tail, 0);
+  atomic_init(&wb->error, 0);
+  atomic_init(&wb->waiting, 0);
+  atomic_init(&wb->quit, 0);
+  atomic_init(&wb->highwater, 0);
+  atomic_init(&wb->overruns, 0);
+  atomic_init(&wb->dropped, 0);
+  pthread_mutex_init(&wb->mutex, NULL);
+  pthread_cond_init(&wb->wakeup, NULL);
+  pthread_cond_init(&wb->space, NULL);
+  if(pthread_create(&wb->thread, NULL, _ambix_writebehind_thread, wb)) {
+    pthread_cond_destroy(&wb->space);
+    pthread_cond_destroy(&wb->wakeup);
+    pthread_mutex_destroy(&wb->mutex);
+    free(wb->memory);
+    free(wb);
+    return NULL;
+  }
+  return wb;
+}
+
+/* wait until the writer thread has freed at least 'frames' frames */
+static void _ambix_writebehind_wait(_ambix_writebehind_t*wb, size_t frames) {
+  pthread_mutex_lock(&wb->mutex);
+  atomic_store(&wb->waiting, 1);
+  while(wb->size - (atomic_load(&wb->head) - atomic_load(&wb->tail)) < frames) {
+    pthread_cond_broadcast(&wb->wakeup);
+    pthread_cond_wait(&wb->space, &wb->mutex);
+  }
+  atomic_store(&wb->waiting, 0);
+  pthread_mutex_unlock(&wb->mutex);
+}
+
+ambix_err_t _ambix_writebehind_drain(_ambix_writebehind_t*wb) {
+  if(wb->size)
+    _ambix_writebehind_wait(wb, wb->size);
+  return atomic_load(&wb->error)?AMBIX_ERR_UNKNOWN:AMBIX_ERR_SUCCESS;
+}
+
+ambix_err_t _ambix_writebehind_destroy(_ambix_writebehind_t*wb) {
+  ambix_err_t res;
+  if(!wb)
+    return AMBIX_ERR_SUCCESS;
+  /* the writer thread flushes the ring before quitting */
+  pthread_mutex_lock(&wb->mutex);
+  atomic_store(&wb->quit, 1);
+  pthread_cond_broadcast(&wb->wakeup);
+  pthread_mutex_unlock(&wb->mutex);
+  pthread_join(wb->thread, NULL);
+  res=atomic_load(&wb->error)?AMBIX_ERR_UNKNOWN:AMBIX_ERR_SUCCESS;
+
+  pthread_cond_destroy(&wb->space);
+  pthread_cond_destroy(&wb->wakeup);
+  pthread_mutex_destroy(&wb->mutex);
+  free(wb->memory);
+  free(wb);
+  return res;
+}
+
+ambix_err_t _ambix_writebehind_setpolicy(_ambix_writebehind_t*wb, ambix_backpressure_t policy) {
+  switch(policy) {
+  case AMBIX_BACKPRESSURE_BLOCK:
+  case AMBIX_BACKPRESSURE_DROP:
+  case AMBIX_BACKPRESSURE_ERROR:
+    wb->policy=policy;
+    return AMBIX_ERR_SUCCESS;
+  default:
+    break;
+  }
+  return AMBIX_ERR_UNKNOWN;
+}
+
+void _ambix_writebehind_status(_ambix_writebehind_t*wb, int64_t*queued, int64_t*highwater, uint64_t*overruns, uint64_t*dropped) {
+  if(queued)
+    *queued=(int64_t)(atomic_load(&wb->head) - atomic_load(&wb->tail));
+  if(highwater)
+    *highwater=(int64_t)atomic_load(&wb->highwater);
+  if(overruns)
+    *overruns=(uint64_t)atomic_load(&wb->overruns);
+  if(dropped)
+    *dropped=(uint64_t)atomic_load(&wb->dropped);
+}
+
+/* (re)arrange the rings for the given sample type; must only be called while they are empty */
+static int _ambix_writebehind_layout(_ambix_writebehind_t*wb, _ambix_writefun_t writefun, uint16_t typesize,
+                                     uint32_t ambichannels, uint32_t extrachannels) {
+  const size_t framesize=(ambichannels+extrachannels)*typesize;
+  size_t size=1;
+  if(!framesize || wb->memorysize/framesize < 1)
+    return 0;
+  while(size*2 <= wb->memorysize/framesize)
+    size*=2;
+  wb->writefun=writefun;
+  wb->typesize=typesize;
+  wb->ambichannels=ambichannels;
+  wb->extrachannels=extrachannels;
+  wb->ambiring=wb->memory;
+  wb->extraring=wb->memory + size*ambichannels*typesize;
+  wb->size=size;
+  return 1;
+}
+
+/* copy frames [from, from+count) of the caller's data to the ring (starting at ring frame 'offset') */
+static void _ambix_writebehind_copy(unsigned char*ring, const void*data, int planar, uint32_t channels, size_t typesize,
+                                    size_t offset, int64_t from, size_t count) {
+  unsigned char*dest=ring + offset*channels*typesize;
+  uint32_t c;
+  if(!channels)
+    return;
+  if(!data) {
+    memset(dest, 0, count*channels*typesize);
+  } else if(!planar) {
+    memcpy(dest, (const unsigned char*)data + from*channels*typesize, count*channels*typesize);
+  } else {
+    const unsigned char*const*channeldata=(const unsigned char*const*)data;
+    for(c=0; c<channels; c++) {
+      const unsigned char*src=channeldata[c] + from*typesize;
+      unsigned char*dst=dest + c*typesize;
+      size_t i;
+      for(i=0; i<count; i++, src+=typesize, dst+=channels*typesize)
+        memcpy(dst, src, typesize);
+    }
+  }
+}
+
+int64_t _ambix_writebehind_write(_ambix_writebehind_t*wb, _ambix_writefun_t writefun, uint16_t typesize,
+                                 uint32_t ambichannels, uint32_t extrachannels,
+                                 const void*ambidata, const void*otherdata, int planar, int64_t frames) {
+  int64_t done=0;
+  int overrun=0;
+  if(atomic_load(&wb->error))
+    return AMBIX_ERR_UNKNOWN;
+  if(frames<=0)
+    return 0;
+  if(writefun!=wb->writefun || typesize!=wb->typesize
+     || ambichannels!=wb->ambichannels || extrachannels!=wb->extrachannels) {
+    /* changing the layout means waiting for the queue to drain */
+    if(wb->realtime && wb->size)
+      return AMBIX_ERR_UNKNOWN;
+    _ambix_writebehind_drain(wb);
+    if(!_ambix_writebehind_layout(wb, writefun, typesize, ambichannels, extrachannels))
+      return AMBIX_ERR_UNKNOWN;
+  }
+
+  while(done<frames) {
+    const size_t head=atomic_load(&wb->head);
+    const size_t space=wb->size - (head - atomic_load(&wb->tail));
+    const size_t offset=head & (wb->size-1);
+    size_t count=(size_t)(frames-done);
+    size_t queued;
+    if(wb->policy != AMBIX_BACKPRESSURE_BLOCK) {
+      /* all or nothing */
+      if(space < (size_t)frames) {
+        atomic_fetch_add(&wb->overruns, 1);
+        if(AMBIX_BACKPRESSURE_ERROR == wb->policy)
+          return AMBIX_ERR_UNKNOWN;
+        atomic_fetch_add(&wb->dropped, (uint64_t)frames);
+        return frames;
+      }
+    } else if(space < count && space < wb->size) {
+      /* wait until the block (or at least a full ring) fits */
+      if(!overrun) {
+        atomic_fetch_add(&wb->overruns, 1);
+        overrun=1;
+      }
+      _ambix_writebehind_wait(wb, (count<wb->size)?count:wb->size);
+      continue;
+    }
+    if(count>space)count=space;
+    if(count>wb->size-offset)count=wb->size-offset;
+    _ambix_writebehind_copy(wb->ambiring, ambidata, planar, ambichannels, typesize, offset, done, count);
+    _ambix_writebehind_copy(wb->extraring, otherdata, planar, extrachannels, typesize, offset, done, count);
+    atomic_store(&wb->head, head+count);
+    done+=count;
+
+    queued=head+count - atomic_load(&wb->tail);
+    if((int64_t)queued > atomic_load(&wb->highwater))
+      atomic_store(&wb->highwater, (int64_t)queued);
+  }
+  return done;
+}
+
+#else /* !_AMBIX_HAVE_WRITEBEHIND */
+
+/* without threads (or atomics), AMBIX_WRITEBEHIND simply has no effect */
+_ambix_writebehind_t*_ambix_writebehind_create(ambix_t*ambix, uint64_t bytes) {
+  return NULL;
+}
+ambix_err_t _ambix_writebehind_destroy(_ambix_writebehind_t*wb) {
+  return AMBIX_ERR_SUCCESS;
+}
+ambix_err_t _ambix_writebehind_drain(_ambix_writebehind_t*wb) {
+  return AMBIX_ERR_SUCCESS;
+}
+ambix_err_t _ambix_writebehind_setpolicy(_ambix_writebehind_t*wb, ambix_backpressure_t policy) {
+  return AMBIX_ERR_UNKNOWN;
+}
+void _ambix_writebehind_status(_ambix_writebehind_t*wb, int64_t*queued, int64_t*highwater, uint64_t*overruns, uint64_t*dropped) {
+}
+int64_t _ambix_writebehind_write(_ambix_writebehind_t*wb, _ambix_writefun_t writefun, uint16_t typesize,
+                                 uint32_t ambichannels, uint32_t extrachannels,
+                                 const void*ambidata, const void*otherdata, int planar, int64_t frames) {
+  return AMBIX_ERR_UNKNOWN;
+}
+
+#endif /* _AMBIX_HAVE_WRITEBEHIND */
@@ -12,7 +12,7 @@ int main()
   fail_if(NULL==ambix, __LINE__, "File was not open");
   sndfile = ambix_get_sndfile (ambix);
 
-#ifdef HAVE_SNDFILE
+#if defined(HAVE_SNDFILE) && !defined(WITH_NATIVE_CAF)
 #warning LATER: skip, once we have multiple (working) backends
   /* there is no need to use libsndfile even if libsndfile is present */
   fail_if(NULL==sndfile, __LINE__, "no sndfile handle despite using libsndfile");
@@ -0,0 +1,210 @@
+/* chunked - test reading/writing large blocks in bounded memory
+
+   Copyright © 2026 IOhannes m zmölnig <zmoelnig@iem.at>.
+         Institute of Electronic Music and Acoustics (IEM),
+         University of Music and Dramatic Arts, Graz
+
+   This file is part of libambix
+
+   libambix is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   libambix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "common.h"
+
+#ifdef AMBIX_INTERNAL
+/* libambix's private header (only available in debug builds) */
+# include "private.h"
+#endif
+
+#include <string.h>
+
+#define FULLCHANNELS 16
+#define AMBICHANNELS 9
+#define EXTRACHANNELS 2
+/* a block size that is certainly not a multiple of the internal chunks */
+#define SMALLBLOCK 1000
+
+/* the adaptorbuffer must not grow beyond a chunk (per thread) */
+static void check_buffersize(const ambix_t*ambix, int line) {
+#ifdef AMBIX_INTERNAL
+  const uint32_t threads=_ambix_threadpool_size(ambix->threadpool);
+  fail_if((ambix->adaptorbuffersize > (uint64_t)AMBIX_ADAPTORBUFFER_CHUNKSIZE*threads), line,
+          "adaptorbuffer grew to %lu bytes", (unsigned long)ambix->adaptorbuffersize);
+#endif
+}
+
+/* write an EXTENDED file via the BASIC api (in one go, or in small blocks) */
+static void write_file(const char*path, ambixtest_presentationformat_t fmt, ambix_sampleformat_t format,
+                       const ambix_matrix_t*matrix, uint32_t threads,
+                       const void*ambidata, const void*otherdata, int64_t frames, int64_t blocksize) {
+  ambix_info_t info;
+  ambix_t*ambix=NULL;
+  int64_t err64, done;
+
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_BASIC;
+  info.ambichannels=matrix->cols;
+  info.extrachannels=EXTRACHANNELS;
+  info.samplerate=44100;
+  info.sampleformat=format;
+  ambix=ambix_open(path, AMBIX_WRITE, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't create ambix file '%s' for writing", path);
+  /* without thread support, this just uses a single thread */
+  ambix_set_threads(ambix, threads);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_set_adaptormatrix(ambix, matrix)), __LINE__, "failed setting adaptor matrix");
+  for(done=0; done<frames; done+=err64) {
+    int64_t count=(frames-done<blocksize)?(frames-done):blocksize;
+    err64=ambixtest_writef(ambix, fmt, ambidata, done*FULLCHANNELS, otherdata, done*EXTRACHANNELS, count);
+    fail_if((err64!=count), __LINE__, "wrote only %d frames of %d", (int)err64, (int)count);
+  }
+  check_buffersize(ambix, __LINE__);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+}
+
+/* reconstruct the full set (in one go, or in small blocks) */
+static void read_file(const char*path, ambixtest_presentationformat_t fmt, uint32_t threads,
+                      void*ambidata, void*otherdata, int64_t frames, int64_t blocksize) {
+  ambix_info_t info;
+  ambix_t*ambix=NULL;
+  int64_t err64, done;
+
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_BASIC;
+  ambix=ambix_open(path, AMBIX_READ, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path);
+  /* without thread support, this just uses a single thread */
+  ambix_set_threads(ambix, threads);
+  for(done=0; done<frames; done+=err64) {
+    int64_t count=(frames-done<blocksize)?(frames-done):blocksize;
+    err64=ambixtest_readf(ambix, fmt, ambidata, done*FULLCHANNELS, otherdata, done*EXTRACHANNELS, count);
+    fail_if((err64!=count), __LINE__, "read only %d frames of %d", (int)err64, (int)count);
+  }
+  /* reading beyond the end of the file returns a short count */
+  err64=ambixtest_readf(ambix, fmt, ambidata, 0, otherdata, 0, frames);
+  fail_if((0!=err64), __LINE__, "read %d frames beyond the end of the file", (int)err64);
+  check_buffersize(ambix, __LINE__);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+}
+
+/* the results must not depend on how the data is split into blocks */
+static void check_chunked(const char*path, ambixtest_presentationformat_t fmt, ambix_sampleformat_t format,
+                          uint32_t threads) {
+  const int64_t frames=100000+17;
+  const size_t ambisize=frames*FULLCHANNELS*data_size(fmt);
+  const size_t othersize=frames*EXTRACHANNELS*data_size(fmt);
+  ambix_matrix_t*matrix=ambix_matrix_init(FULLCHANNELS, AMBICHANNELS, NULL);
+  void*ambidata=data_sine(fmt, frames, FULLCHANNELS, 1000);
+  void*otherdata=data_ramp(fmt, frames, EXTRACHANNELS);
+  void*resultambi1=data_calloc(fmt, frames*FULLCHANNELS);
+  void*resultambiN=data_calloc(fmt, frames*FULLCHANNELS);
+  void*resultother1=data_calloc(fmt, frames*EXTRACHANNELS);
+  void*resultotherN=data_calloc(fmt, frames*EXTRACHANNELS);
+  uint32_t r, c;
+  STARTTEST("format=%d, datafmt=%d, threads=%d\n", format, fmt, threads);
+
+  for(r=0; r<FULLCHANNELS; r++)
+    for(c=0; c<AMBICHANNELS; c++)
+      matrix->data[r][c]=(float32_t)(((r*AMBICHANNELS+c)*7919)%101)/101. - 0.5;
+
+  /* small blocks vs. a single huge block */
+  write_file(path, fmt, format, matrix, threads, ambidata, otherdata, frames, SMALLBLOCK);
+  read_file(path, fmt, threads, resultambi1, resultother1, frames, SMALLBLOCK);
+  write_file(path, fmt, format, matrix, threads, ambidata, otherdata, frames, frames);
+  read_file(path, fmt, threads, resultambiN, resultotherN, frames, frames);
+
+  fail_if(memcmp(resultambi1, resultambiN, ambisize), __LINE__, "ambisonics data differs for a single block");
+  fail_if(memcmp(resultother1, resultotherN, othersize), __LINE__, "extra channels differ for a single block");
+
+  ambix_matrix_destroy(matrix);
+  free(ambidata);
+  free(otherdata);
+  free(resultambi1); free(resultambiN);
+  free(resultother1); free(resultotherN);
+  ambixtest_rmfile(path);
+  STOPTEST("format=%d, datafmt=%d, threads=%d\n", format, fmt, threads);
+}
+
+/* a huge planar block is split at the same frames for all channels */
+static void check_planar(const char*path) {
+  const int64_t frames=100000+17;
+  float32_t*ambidata=(float32_t*)data_sine(FLOAT32, frames, FULLCHANNELS, 1000);
+  float32_t*otherdata=(float32_t*)data_ramp(FLOAT32, frames, EXTRACHANNELS);
+  float32_t*resultambi=(float32_t*)data_calloc(FLOAT32, frames*FULLCHANNELS);
+  float32_t*resultother=(float32_t*)data_calloc(FLOAT32, frames*EXTRACHANNELS);
+  ambix_matrix_t*matrix=ambix_matrix_init(FULLCHANNELS, FULLCHANNELS, NULL);
+  float32_t*ambiplanar[FULLCHANNELS], *otherplanar[EXTRACHANNELS];
+  float32_t*resultambiplanar[FULLCHANNELS], *resultotherplanar[EXTRACHANNELS];
+  ambix_info_t info;
+  ambix_t*ambix=NULL;
+  int64_t err64;
+  uint32_t c;
+  STARTTEST("\n");
+  ambix_matrix_fill(matrix, AMBIX_MATRIX_IDENTITY);
+  for(c=0; c<FULLCHANNELS; c++) {
+    ambiplanar[c]=ambidata+c*frames;
+    resultambiplanar[c]=resultambi+c*frames;
+  }
+  for(c=0; c<EXTRACHANNELS; c++) {
+    otherplanar[c]=otherdata+c*frames;
+    resultotherplanar[c]=resultother+c*frames;
+  }
+
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_EXTENDED;
+  info.ambichannels=FULLCHANNELS;
+  info.extrachannels=EXTRACHANNELS;
+  info.samplerate=44100;
+  info.sampleformat=AMBIX_SAMPLEFORMAT_FLOAT32;
+  ambix=ambix_open(path, AMBIX_WRITE, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't create ambix file '%s' for writing", path);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_set_adaptormatrix(ambix, matrix)), __LINE__, "failed setting adaptor matrix");
+  err64=ambix_writef_float32_planar(ambix, ambiplanar, otherplanar, frames);
+  fail_if((err64!=frames), __LINE__, "wrote only %d frames of %d", (int)err64, (int)frames);
+  check_buffersize(ambix, __LINE__);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_EXTENDED;
+  ambix=ambix_open(path, AMBIX_READ, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path);
+  err64=ambix_readf_float32_planar(ambix, resultambiplanar, resultotherplanar, frames);
+  fail_if((err64!=frames), __LINE__, "read only %d frames of %d", (int)err64, (int)frames);
+  check_buffersize(ambix, __LINE__);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+  fail_if(memcmp(ambidata, resultambi, frames*FULLCHANNELS*sizeof(float32_t)), __LINE__, "planar ambisonics data differs");
+  fail_if(memcmp(otherdata, resultother, frames*EXTRACHANNELS*sizeof(float32_t)), __LINE__, "planar extra channels differ");
+
+  free(ambidata);
+  free(otherdata);
+  free(resultambi);
+  free(resultother);
+  ambix_matrix_destroy(matrix);
+  ambixtest_rmfile(path);
+  STOPTEST("\n");
+}
+
+int main(int argc, char**argv) {
+  const char*path=FILENAME_MAIN;
+
+  check_chunked(path, FLOAT32, AMBIX_SAMPLEFORMAT_FLOAT32, 1);
+  check_chunked(path, FLOAT64, AMBIX_SAMPLEFORMAT_FLOAT64, 1);
+  check_chunked(path, INT32, AMBIX_SAMPLEFORMAT_PCM32, 1);
+  check_chunked(path, INT16, AMBIX_SAMPLEFORMAT_PCM16, 1);
+  check_chunked(path, FLOAT32, AMBIX_SAMPLEFORMAT_FLOAT32, 4);
+  check_planar(path);
+
+  return pass();
+}
@@ -108,6 +108,28 @@ int main(int argc, char**argv) {
   fail_if(memcmp(&region_1, region_1_retr, sizeof(ambix_region_t)), __LINE__, "Region 1 does not match");
   fail_if(memcmp(&region_2, region_2_retr, sizeof(ambix_region_t)), __LINE__, "Region 2 does not match");
   fail_if(memcmp(&region_3, region_3_retr, sizeof(ambix_region_t)), __LINE__, "Region 3 does not match");
+  ambix_close(ambix);
+
+  /* markers are only read when needed: reading samples first must not interfere */
+  memset(&info, 0, sizeof(info));
+  ambix=ambix_open(markerfile, AMBIX_READ, &info);
+  fail_if(NULL==ambix, __LINE__, "File was not open");
+  err64=ambix_readf_float32(ambix, data, NULL, frames/2);
+  fail_if(frames/2!=err64, __LINE__, "Could not read samples");
+  region_2_retr=ambix_get_region(ambix, 1);
+  fail_if(region_2_retr==NULL, __LINE__, "Could not retrieve region 2 after reading");
+  fail_if(memcmp(&region_2, region_2_retr, sizeof(ambix_region_t)), __LINE__, "Region 2 does not match after reading");
+  err64=ambix_readf_float32(ambix, data, NULL, frames);
+  fail_if(frames-frames/2!=err64, __LINE__, "Could not read remaining samples");
+  ambix_close(ambix);
+
+  /* deleting markers before they are read */
+  memset(&info, 0, sizeof(info));
+  ambix=ambix_open(markerfile, AMBIX_READ, &info);
+  fail_if(NULL==ambix, __LINE__, "File was not open");
+  fail_if(0!=ambix_delete_markers(ambix), __LINE__, "Could not delete markers");
+  fail_if(0!=ambix_get_num_markers(ambix), __LINE__, "Deleted markers came back");
+  fail_if(3!=ambix_get_num_regions(ambix), __LINE__, "Regions got lost");
 
   if(data)
     free(data);
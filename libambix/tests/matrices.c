@@ -149,6 +149,32 @@ void check_nomatrix(const char*name, ambix_matrixtype_t typ, uint32_t rows, uint
 }
 
 
+/* repeated fills must yield the same matrix, regardless of what the caller
+ * did with the previous result */
+void check_cached(const char*name, ambix_matrixtype_t typ, uint32_t rows, uint32_t cols) {
+  ambix_matrix_t*first=NULL, *second=NULL;
+  float32_t errf=0.f;
+  float32_t eps=1e-20;
+  uint32_t r, c;
+
+  STARTTEST("%s\n", name);
+
+  first=ambix_matrix_init(rows, cols, first);
+  second=ambix_matrix_init(rows, cols, second);
+  skip_if(NULL==first || NULL==second, __LINE__, "couldn't create matrices");
+  fail_if((first!=ambix_matrix_fill(first, typ)), __LINE__, "matrix_fill did not return matrix %p", first);
+  for(r=0; r<first->rows; r++)
+    for(c=0; c<first->cols; c++)
+      first->data[r][c]+=1.f;
+  fail_if((second!=ambix_matrix_fill(second, typ)), __LINE__, "matrix_fill did not return matrix %p", second);
+  fail_if((first!=ambix_matrix_fill(first, typ)), __LINE__, "matrix_fill did not return matrix %p", first);
+  errf=matrix_check_diff(name, first, second);
+  fail_if(!(errf<eps), __LINE__, "refilled matrices differ by %f", errf);
+
+  ambix_matrix_destroy(first);
+  ambix_matrix_destroy(second);
+}
+
 int main(int argc, char**argv) {
   uint32_t r, c, o;
   char name[64];
@@ -196,6 +222,21 @@ int main(int argc, char**argv) {
   check_nomatrix("sn3d->n3d [ 7, 7]", AMBIX_MATRIX_TO_N3D,  7,  7);
   check_nomatrix("nada[ 4, 4]", AMBIX_MATRIX_INVALID,  4,  4);
 
+  check_cached("FuMa[16,11]", AMBIX_MATRIX_FUMA, 16, 11);
+  check_cached("MaFu[11,16]", AMBIX_MATRIX_TO_FUMA, 11, 16);
+  /* more matrices than the cache holds */
+  for(o=0; o<18; o++) {
+    const uint32_t channels=(o+1)*(o+1);
+    snprintf(name, 63, "sid2acn[%d, %d]", channels, channels);
+    check_cached(name, AMBIX_MATRIX_SID, channels, channels);
+    snprintf(name, 63, "acn2sid[%d, %d]", channels, channels);
+    check_cached(name, AMBIX_MATRIX_TO_SID, channels, channels);
+    snprintf(name, 63, "n3d->sn3d[%d, %d]", channels, channels);
+    check_cached(name, AMBIX_MATRIX_N3D, channels, channels);
+    snprintf(name, 63, "sn3d->n3d[%d, %d]", channels, channels);
+    check_cached(name, AMBIX_MATRIX_TO_N3D, channels, channels);
+  }
+
   STOPTEST("matrices\n");
 
   check_inversion("FuMa[ 1, 1]", AMBIX_MATRIX_FUMA,  1,  1);
@@ -0,0 +1,111 @@
+#include "common.h"
+
+/* libambix's private header */
+#include "private.h"
+
+#include <math.h>
+
+static float32_t frand(void) {
+  return ((float32_t)rand())/((float32_t)RAND_MAX) * 2.f - 1.f;
+}
+
+/* compare the plan against the dense split/merge */
+static void check_plan(const char*name, const ambix_matrix_t*mtx, _ambix_plantype_t type) {
+  const int64_t frames=29;
+  const uint32_t extra=2;
+  const uint32_t rows=mtx->rows, cols=mtx->cols;
+  const float32_t eps=1e-5;
+  _ambix_matrixplan_t plan;
+  float32_t*source=calloc(frames*(cols+extra), sizeof(float32_t));
+  float32_t*ambi=calloc(frames*rows, sizeof(float32_t));
+  float32_t*other=calloc(frames*extra, sizeof(float32_t));
+  float32_t*ambiref=calloc(frames*rows, sizeof(float32_t));
+  float32_t*otherref=calloc(frames*extra, sizeof(float32_t));
+  float32_t*merged=calloc(frames*(rows+extra), sizeof(float32_t));
+  float32_t*mergedref=calloc(frames*(rows+extra), sizeof(float32_t));
+  int16_t*source16=calloc(frames*(cols+extra), sizeof(int16_t));
+  int16_t*ambi16=calloc(frames*rows, sizeof(int16_t));
+  int16_t*other16=calloc(frames*extra, sizeof(int16_t));
+  int16_t*ambiref16=calloc(frames*rows, sizeof(int16_t));
+  int16_t*otherref16=calloc(frames*extra, sizeof(int16_t));
+  float32_t diff=0.;
+  uint32_t i;
+  STARTTEST("%s\n", name);
+  memset(&plan, 0, sizeof(plan));
+  for(i=0; i<frames*(cols+extra); i++) {
+    source[i]=frand();
+    source16[i]=(int16_t)(source[i]*8192);
+  }
+
+  fail_if(AMBIX_ERR_SUCCESS!=_ambix_matrixplan_init(&plan, mtx), __LINE__, "%s: analysing matrix failed", name);
+  fail_if(type!=plan.type, __LINE__, "%s: got plan %d, expected %d", name, plan.type, type);
+
+  /* reading */
+  fail_if(AMBIX_ERR_SUCCESS!=_ambix_splitAdaptorplan_float32(source, cols+extra, &plan, ambi, other, frames), __LINE__, "%s: split failed", name);
+  _ambix_splitAdaptormatrix_float32(source, cols+extra, mtx, ambiref, otherref, frames);
+  for(i=0; i<frames*rows; i++)
+    diff+=fabsf(ambi[i]-ambiref[i]);
+  for(i=0; i<frames*extra; i++)
+    diff+=fabsf(other[i]-otherref[i]);
+  fail_if(diff>eps, __LINE__, "%s: split differs by %g>%g", name, diff, eps);
+
+  fail_if(AMBIX_ERR_SUCCESS!=_ambix_splitAdaptorplan_int16(source16, cols+extra, &plan, ambi16, other16, frames), __LINE__, "%s: split16 failed", name);
+  _ambix_splitAdaptormatrix_int16(source16, cols+extra, mtx, ambiref16, otherref16, frames);
+  for(i=0; i<frames*rows; i++)
+    fail_if(abs(ambi16[i]-ambiref16[i])>1, __LINE__, "%s: split16[%d] %d!=%d", name, i, ambi16[i], ambiref16[i]);
+  fail_if(memcmp(other16, otherref16, frames*extra*sizeof(int16_t)), __LINE__, "%s: split16 extra channels differ", name);
+
+  /* writing */
+  fail_if(AMBIX_ERR_SUCCESS!=_ambix_mergeAdaptorplan_float32(source, &plan, other, extra, merged, frames), __LINE__, "%s: merge failed", name);
+  _ambix_mergeAdaptormatrix_float32(source, mtx, other, extra, mergedref, frames);
+  diff=0.;
+  for(i=0; i<frames*(rows+extra); i++)
+    diff+=fabsf(merged[i]-mergedref[i]);
+  fail_if(diff>eps, __LINE__, "%s: merge differs by %g>%g", name, diff, eps);
+
+  _ambix_matrixplan_deinit(&plan);
+  free(source); free(ambi); free(other); free(ambiref); free(otherref);
+  free(merged); free(mergedref);
+  free(source16); free(ambi16); free(other16); free(ambiref16); free(otherref16);
+  STOPTEST("%s\n", name);
+}
+
+int main(int argc, char**argv) {
+  const float32_t route[]={3, 1, 0, 2, 8, 4, 7, 6, 5};
+  const float32_t gains[]={1, .5, .5, .5, 2, 2, 2, 2, 2};
+  const uint32_t orders[]={1, 3, 5, 7};
+  ambix_matrix_t*mtx=NULL;
+  uint32_t r, c, o, offset;
+
+  mtx=ambix_matrix_init(9, 9, mtx);
+  check_plan("identity", ambix_matrix_fill(mtx, AMBIX_MATRIX_IDENTITY), AMBIX_PLAN_IDENTITY);
+  check_plan("N3D", ambix_matrix_fill(mtx, AMBIX_MATRIX_N3D), AMBIX_PLAN_DIAGONAL);
+  check_plan("toSID", ambix_matrix_fill(mtx, AMBIX_MATRIX_TO_SID), AMBIX_PLAN_PERMUTATION);
+  check_plan("toFuMa", ambix_matrix_fill(mtx, AMBIX_MATRIX_TO_FUMA), AMBIX_PLAN_GATHER);
+  check_plan("router", _matrix_router(mtx, route, 9, 0), AMBIX_PLAN_PERMUTATION);
+  check_plan("diag", _matrix_diag(mtx, gains, 9), AMBIX_PLAN_DIAGONAL);
+  check_plan("zero", ambix_matrix_fill(mtx, AMBIX_MATRIX_ZERO), AMBIX_PLAN_DIAGONAL);
+  check_plan("one", ambix_matrix_fill(mtx, AMBIX_MATRIX_ONE), AMBIX_PLAN_DENSE);
+
+  /* selecting a subset of channels */
+  mtx=ambix_matrix_init(4, 9, mtx);
+  for(r=0; r<mtx->rows; r++)
+    mtx->data[r][2*r]=1.;
+  check_plan("select4x9", mtx, AMBIX_PLAN_PERMUTATION);
+  mtx->data[3][7]=-.5;
+  check_plan("dense4x9", mtx, AMBIX_PLAN_DENSE);
+
+  /* per-order rotation */
+  mtx=ambix_matrix_init(16, 16, mtx);
+  for(o=0, offset=0; o<sizeof(orders)/sizeof(*orders); offset+=orders[o], o++) {
+    for(r=0; r<orders[o]; r++)
+      for(c=0; c<orders[o]; c++)
+        mtx->data[offset+r][offset+c]=frand();
+  }
+  check_plan("blockdiagonal", mtx, AMBIX_PLAN_BLOCKDIAGONAL);
+  mtx->data[15][0]=1.;
+  check_plan("dense16x16", mtx, AMBIX_PLAN_DENSE);
+
+  ambix_matrix_destroy(mtx);
+  return pass();
+}
@@ -22,6 +22,7 @@
 */
 
 #include "common.h"
+#include <math.h>
 #include <string.h>
 #include <stdlib.h>
 
@@ -184,6 +185,65 @@ void mtxinverse_tests(float32_t eps) {
   free(transposedata);
   STOPTEST("\n");
 }
+/* the Moore-Penrose conditions A*P*A=A and P*A*P=P, relative to max|A| resp. max|P| */
+static double mtxpinv_residual(const ambix_matrix_t*A, const ambix_matrix_t*P) {
+  ambix_matrix_t*AP=ambix_matrix_multiply(A, P, NULL);
+  ambix_matrix_t*PA=ambix_matrix_multiply(P, A, NULL);
+  double maxA=0., maxP=0., errA=0., errP=0.;
+  uint32_t r, c, i;
+  fail_if((NULL==AP || NULL==PA), __LINE__, "cannot multiply matrix with its pseudo-inverse");
+  for(r=0; r<A->rows; r++)
+    for(c=0; c<A->cols; c++) {
+      double sum=0.;
+      for(i=0; i<A->rows; i++)
+        sum+=(double)AP->data[r][i]*A->data[i][c];
+      if(fabs(A->data[r][c])>maxA)maxA=fabs(A->data[r][c]);
+      if(fabs(sum-A->data[r][c])>errA)errA=fabs(sum-A->data[r][c]);
+    }
+  for(r=0; r<P->rows; r++)
+    for(c=0; c<P->cols; c++) {
+      double sum=0.;
+      for(i=0; i<P->cols; i++)
+        sum+=(double)P->data[r][i]*AP->data[i][c];
+      if(fabs(P->data[r][c])>maxP)maxP=fabs(P->data[r][c]);
+      if(fabs(sum-P->data[r][c])>errP)errP=fabs(sum-P->data[r][c]);
+    }
+  ambix_matrix_destroy(AP);
+  ambix_matrix_destroy(PA);
+  if(maxA>0.)errA/=maxA;
+  if(maxP>0.)errP/=maxP;
+  return (errA>errP)?errA:errP;
+}
+/* pseudo-invert a [rows x cols] matrix of the given rank,
+ * whose columns are scaled down to 'dynamics' (to make it ill-conditioned) */
+void mtxpinv_large_tests(uint32_t rows, uint32_t cols, uint32_t rank, double dynamics, double eps) {
+  ambix_matrix_t *left=ambix_matrix_init(rows, rank, NULL);
+  ambix_matrix_t *right=ambix_matrix_init(rank, cols, NULL);
+  ambix_matrix_t *mtx=NULL, *pinv=NULL;
+  double err;
+  uint32_t r, c;
+  STARTTEST("[%dx%d] rank=%d dynamics=%g\n", rows, cols, rank, dynamics);
+  for(r=0; r<rows; r++)
+    for(c=0; c<rank; c++)
+      left->data[r][c]=(float32_t)(((r*rank+c)*7919)%1009)/1009.f - 0.5f;
+  for(r=0; r<rank; r++)
+    for(c=0; c<cols; c++)
+      right->data[r][c]=(float32_t)((((r*cols+c)*104729)%1013)/1013. - 0.5) * pow(dynamics, (double)c/cols);
+  mtx=ambix_matrix_multiply(left, right, NULL);
+  fail_if((NULL==mtx), __LINE__, "couldn't create [%dx%d] matrix", rows, cols);
+
+  pinv=ambix_matrix_pinv(mtx, NULL);
+  fail_if((NULL==pinv), __LINE__, "could not pseudo-invert [%dx%d] matrix", rows, cols);
+  fail_if((pinv->rows!=cols || pinv->cols!=rows), __LINE__, "pseudo-inverse is [%dx%d]", pinv->rows, pinv->cols);
+  err=mtxpinv_residual(mtx, pinv);
+  fail_if(!(err<eps), __LINE__, "pseudo-inverse residual %g (>%g)", err, eps);
+
+  ambix_matrix_destroy(pinv);
+  ambix_matrix_destroy(mtx);
+  ambix_matrix_destroy(right);
+  ambix_matrix_destroy(left);
+  STOPTEST("\n");
+}
 void mtxmul_tests(float32_t eps) {
   float32_t errf;
   ambix_matrix_t *left=NULL, *right=NULL, *result, *testresult;
@@ -229,6 +289,64 @@ void mtxmul_tests(float32_t eps) {
   ambix_matrix_destroy(testresult);
   STOPTEST("\n");
 }
+/* the (blocked) multiplication must yield exactly the result of the naive loop */
+void mtxmul_blocked_tests(uint32_t rows, uint32_t common, uint32_t cols) {
+  ambix_matrix_t *left, *right, *result;
+  ambix_matrix_t hostright;
+  float32_t**hostrows;
+  uint32_t r, c, i;
+  STARTTEST("[%dx%d]*[%dx%d]\n", rows, common, common, cols);
+  left=ambix_matrix_init(rows, common, NULL);
+  right=ambix_matrix_init(common, cols, NULL);
+  for(r=0; r<rows; r++)
+    for(i=0; i<common; i++)
+      left->data[r][i]=(float32_t)(((r*common+i)*7919)%1009)/1009.f - 0.5f;
+  for(i=0; i<common; i++)
+    for(c=0; c<cols; c++)
+      right->data[i][c]=(float32_t)(((i*cols+c)*104729)%1013)/1013.f - 0.5f;
+
+  /* a host-assembled (non-contiguous) copy of the right-hand matrix */
+  hostrows=(float32_t**)calloc(common, sizeof(*hostrows));
+  for(i=0; i<common; i++) {
+    hostrows[i]=(float32_t*)calloc(cols, sizeof(float32_t));
+    memcpy(hostrows[i], right->data[i], cols*sizeof(float32_t));
+  }
+  hostright.rows=common;
+  hostright.cols=cols;
+  hostright.data=hostrows;
+
+  result=ambix_matrix_multiply(left, right, NULL);
+  fail_if((NULL==result), __LINE__, "multiply into NULL did not create matrix");
+  fail_if((result->rows!=rows || result->cols!=cols), __LINE__, "result is %dx%d", result->rows, result->cols);
+  for(r=0; r<rows; r++)
+    for(c=0; c<cols; c++) {
+      double sum=0.;
+      for(i=0; i<common; i++) {
+        const float32_t prod=left->data[r][i]*right->data[i][c];
+        sum+=prod;
+      }
+      fail_if(((float32_t)sum!=result->data[r][c]), __LINE__, "result[%d][%d]=%g != %g", r, c, result->data[r][c], (float32_t)sum);
+    }
+
+  fail_if((result!=ambix_matrix_multiply(left, &hostright, result)), __LINE__, "multiply into existing matrix returned new matrix");
+  for(r=0; r<rows; r++)
+    for(c=0; c<cols; c++) {
+      double sum=0.;
+      for(i=0; i<common; i++) {
+        const float32_t prod=left->data[r][i]*right->data[i][c];
+        sum+=prod;
+      }
+      fail_if(((float32_t)sum!=result->data[r][c]), __LINE__, "host result[%d][%d]=%g != %g", r, c, result->data[r][c], (float32_t)sum);
+    }
+
+  for(i=0; i<common; i++)
+    free(hostrows[i]);
+  free(hostrows);
+  ambix_matrix_destroy(left);
+  ambix_matrix_destroy(right);
+  ambix_matrix_destroy(result);
+  STOPTEST("\n");
+}
 void mtxmul_eye_tests(float32_t eps) {
   float32_t errf;
   ambix_matrix_t *left, *result, *eye;
@@ -347,6 +465,45 @@ void datamul_eye_tests(float32_t eps) {
   STOPTEST("\n");
 }
 
+/* integer multiplication rounds to the nearest integer and saturates */
+#define DATAMUL_INT_TESTS(typ, minval, maxval)                          \
+  void datamul_##typ##_tests(void) {                                    \
+    const float32_t coeffs[]={ 0.5, 0.25, -1.0,                         \
+                               2.0, 2.0,   0.0 };                       \
+    const int64_t frames=300;                                           \
+    const uint32_t rows=2, cols=3;                                      \
+    typ##_t*inputdata =(typ##_t*)calloc(frames*cols, sizeof(typ##_t)); \
+    typ##_t*outputdata=(typ##_t*)calloc(frames*rows, sizeof(typ##_t)); \
+    ambix_matrix_t*mtx=ambix_matrix_init(rows, cols, NULL);             \
+    int saturated=0;                                                    \
+    uint32_t r, c;                                                      \
+    int64_t f;                                                          \
+    STARTTEST("\n");                                                    \
+    ambix_matrix_fill_data(mtx, coeffs);                                \
+    for(f=0; f<frames*cols; f++)                                        \
+      inputdata[f]=(typ##_t)(minval+(maxval-minval)/(frames*cols)*f + f%3); \
+    fail_if(AMBIX_ERR_SUCCESS!=ambix_matrix_multiply_##typ(outputdata, mtx, inputdata, frames), __LINE__, \
+            "data multiplication failed");                              \
+    for(r=0; r<rows; r++) {                                             \
+      for(f=0; f<frames; f++) {                                         \
+        double sum=0.;                                                  \
+        for(c=0; c<cols; c++)                                           \
+          sum+=coeffs[r*cols+c]*(double)inputdata[c*frames+f];          \
+        sum=floor(sum+0.5);                                             \
+        if(sum>maxval){sum=maxval; saturated++;}                        \
+        if(sum<minval){sum=minval; saturated++;}                        \
+        fail_if(sum!=outputdata[r*frames+f], __LINE__, "output[%d][%d]=%g != %g", r, (int)f, (double)outputdata[r*frames+f], sum); \
+      }                                                                 \
+    }                                                                   \
+    fail_if(!saturated, __LINE__, "test data does not saturate");       \
+    ambix_matrix_destroy(mtx);                                          \
+    free(inputdata);                                                    \
+    free(outputdata);                                                   \
+    STOPTEST("\n");                                                     \
+  }
+DATAMUL_INT_TESTS(int16, -32768., 32767.)
+DATAMUL_INT_TESTS(int32, -2147483648., 2147483647.)
+
 void datamul_4_2_tests(uint32_t chunksize, float32_t eps) {
   uint32_t r, c, rows, cols;
   float32_t errf;
@@ -580,21 +737,81 @@ void create_tests(float32_t eps) {
   STOPTEST("\n");
 }
 
+void layout_tests(uint32_t rows, uint32_t cols) {
+  ambix_matrix_t*mtx=NULL;
+  uint32_t r;
+  STARTTEST("[%dx%d]\n", rows, cols);
+
+  mtx=ambix_matrix_init(rows, cols, mtx);
+  fail_if((mtx==NULL), __LINE__, "failed to create matrix");
+  /* coefficients are a single aligned row-by-row block */
+  fail_if((((uintptr_t)mtx->data[0]) % 64), __LINE__, "matrix data %p is not 64-byte aligned", mtx->data[0]);
+  for(r=0; r<rows; r++) {
+    fail_if((mtx->data[r] != mtx->data[0]+r*cols), __LINE__, "matrix row#%d is not contiguous", r);
+  }
+  ambix_matrix_destroy(mtx);
+  STOPTEST("\n");
+}
+
+
+/* matrices assembled by the host (with separately allocated rows) */
+void hostmatrix_tests(uint32_t rows, uint32_t cols) {
+  ambix_matrix_t*mtx=(ambix_matrix_t*)calloc(1, sizeof(*mtx));
+  ambix_matrix_t*copy=NULL;
+  float32_t errf;
+  uint32_t r, c;
+  STARTTEST("[%dx%d]\n", rows, cols);
+
+  mtx->rows=rows;
+  mtx->cols=cols;
+  mtx->data=(float32_t**)malloc(rows*sizeof(*mtx->data));
+  for(r=0; r<rows; r++) {
+    mtx->data[r]=(float32_t*)malloc(cols*sizeof(**mtx->data));
+    for(c=0; c<cols; c++)
+      mtx->data[r][c]=(float32_t)(r*cols+c);
+  }
+  copy=ambix_matrix_copy(mtx, NULL);
+  fail_if((copy==NULL), __LINE__, "failed to copy host matrix");
+  errf=matrix_diff(__LINE__, mtx, copy, 0.);
+  fail_if((errf>0.), __LINE__, "copying host matrix differs by %f", errf);
+  /* the rows are freed along with the matrix */
+  ambix_matrix_destroy(mtx);
+  ambix_matrix_destroy(copy);
+  STOPTEST("\n");
+}
 
 
 int main(int argc, char**argv) {
 #if 1
   create_tests(1e-7);
+  layout_tests(1, 1);
+  layout_tests(4, 3);
+  layout_tests(64, 64);
+  hostmatrix_tests(1, 1);
+  hostmatrix_tests(4, 3);
   mtx_copy(1e-7);
   mtx_diff(1e-1);
   mtx_diff(1e-7);
   mtxmul_tests(1e-7);
   mtxmul_eye_tests(1e-7);
+  mtxmul_blocked_tests(1, 1, 1);
+  mtxmul_blocked_tests(3, 5, 7);
+  mtxmul_blocked_tests(16, 64, 64);
+  mtxmul_blocked_tests(121, 121, 121);
+  mtxmul_blocked_tests(130, 67, 200);
   datamul_tests(1e-7);
   datamul_eye_tests(1e-7);
 #endif
   datamul_4_2_tests(1024, 1e-7);
+  datamul_int16_tests();
+  datamul_int32_tests();
   mtxinverse_tests(3e-5);
+  mtxpinv_large_tests(25, 25, 25, 1., 1e-4);
+  mtxpinv_large_tests(121, 100, 100, 1., 1e-4);
+  mtxpinv_large_tests(100, 121, 100, 1., 1e-4);
+  mtxpinv_large_tests(64, 49, 49, 1e-3, 1e-4);
+  mtxpinv_large_tests(256, 256, 256, 1., 1e-3);
+  mtxpinv_large_tests(200, 256, 150, 1., 1e-4);
 
   return pass();
 }
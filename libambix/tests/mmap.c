@@ -0,0 +1,172 @@
+/* mmap - test reading memory-mapped files
+
+   Copyright © 2026 IOhannes m zmölnig <zmoelnig@iem.at>.
+         Institute of Electronic Music and Acoustics (IEM),
+         University of Music and Dramatic Arts, Graz
+
+   This file is part of libambix
+
+   libambix is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   libambix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "common.h"
+#include <string.h>
+
+static ambix_t*open_read(const char*path, ambix_filemode_t mode, ambix_fileformat_t fileformat) {
+  ambix_info_t info;
+  ambix_t*ambix=NULL;
+  memset(&info, 0, sizeof(info));
+  info.fileformat=fileformat;
+  ambix=ambix_open(path, mode, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path);
+  return ambix;
+}
+
+/* read the entire file in small blocks */
+static void*read_blocks(ambix_t*ambix, ambixtest_presentationformat_t fmt, uint32_t ambichannels, uint32_t extrachannels, int64_t frames) {
+  const int64_t blocksize=1000;
+  const size_t size=data_size(fmt);
+  char*ambidata=(char*)data_calloc(fmt, frames*ambichannels);
+  char*otherdata=(char*)data_calloc(fmt, frames*extrachannels+1);
+  char*result=(char*)data_calloc(fmt, frames*(ambichannels+extrachannels));
+  int64_t f, got;
+  for(f=0; f<frames; f+=got) {
+    got=ambixtest_readf(ambix, fmt, ambidata, f*ambichannels, otherdata, f*extrachannels, blocksize);
+    fail_if((got<=0), __LINE__, "reading frame %d returned %d", (int)f, (int)got);
+  }
+  fail_if((f!=frames), __LINE__, "read %d frames (expected %d)", (int)f, (int)frames);
+  fail_if((ambixtest_readf(ambix, fmt, ambidata, 0, otherdata, 0, blocksize)!=0), __LINE__, "read beyond end of file");
+  memcpy(result, ambidata, frames*ambichannels*size);
+  memcpy(result+frames*ambichannels*size, otherdata, frames*extrachannels*size);
+  free(ambidata);
+  free(otherdata);
+  return result;
+}
+
+/* reading with AMBIX_MMAP must give the same results as without */
+static void check_mmap(const char*path, ambix_sampleformat_t format, int use_matrix) {
+  const uint32_t fullambichannels=16, rawambichannels=use_matrix?9:16, extrachannels=use_matrix?2:0;
+  const uint32_t rawchannels=rawambichannels+extrachannels;
+  const int64_t frames=20000+17;
+  const ambix_fileformat_t rawformat=use_matrix?AMBIX_EXTENDED:AMBIX_BASIC;
+  const ambixtest_presentationformat_t fmts[]={INT16, FLOAT32, FLOAT64};
+  ambix_matrix_t*matrix=NULL;
+  float32_t*ambidata=(float32_t*)data_sine(FLOAT32, frames, fullambichannels, 1000);
+  float32_t*otherdata=(float32_t*)data_ramp(FLOAT32, frames, extrachannels);
+  float32_t*rawdata=NULL;
+  const float32_t*mapped=NULL;
+  ambix_info_t info;
+  ambix_t*ambix=NULL;
+  int64_t err64, f;
+  unsigned int i;
+  STARTTEST("format=%d, matrix=%d\n", format, use_matrix);
+
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_BASIC;
+  info.ambichannels=use_matrix?rawambichannels:fullambichannels;
+  info.extrachannels=extrachannels;
+  info.samplerate=44100;
+  info.sampleformat=format;
+  fail_if((NULL!=ambix_open(path, AMBIX_WRITE|AMBIX_MMAP, &info)), __LINE__, "opened '%s' for writing in mmap-mode", path);
+  ambix=ambix_open(path, AMBIX_WRITE, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't create ambix file '%s' for writing", path);
+  if(use_matrix) {
+    uint32_t r, c;
+    matrix=ambix_matrix_init(fullambichannels, rawambichannels, NULL);
+    for(r=0; r<fullambichannels; r++)
+      for(c=0; c<rawambichannels; c++)
+        matrix->data[r][c]=(float32_t)(((r*rawambichannels+c)*7919)%101)/101. - 0.5;
+    fail_if((AMBIX_ERR_SUCCESS!=ambix_set_adaptormatrix(ambix, matrix)), __LINE__, "failed setting adaptor matrix");
+  }
+  err64=ambix_writef_float32(ambix, ambidata, otherdata, frames);
+  fail_if((err64!=frames), __LINE__, "wrote only %d frames of %d", (int)err64, (int)frames);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+  /* the adaptor matrix is applied to the mapped data just the same */
+  for(i=0; i<sizeof(fmts)/sizeof(*fmts); i++) {
+    const size_t size=data_size(fmts[i]);
+    void*expected=NULL, *result=NULL;
+    ambix=open_read(path, AMBIX_READ, AMBIX_BASIC);
+    expected=read_blocks(ambix, fmts[i], fullambichannels, extrachannels, frames);
+    fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+    ambix=open_read(path, AMBIX_READ|AMBIX_MMAP, AMBIX_BASIC);
+    result=read_blocks(ambix, fmts[i], fullambichannels, extrachannels, frames);
+    fail_if(memcmp(expected, result, frames*(fullambichannels+extrachannels)*size), __LINE__, "mmap'ed data (fmt=%d) differs", fmts[i]);
+    if(use_matrix)
+      fail_if((ambix_map_frames(ambix, &mapped, 1)>=0), __LINE__, "mapped frames that need an adaptor matrix");
+    fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+    free(expected);
+    free(result);
+  }
+
+  /* zero-copy access to the raw frames */
+  ambix=open_read(path, AMBIX_READ, rawformat);
+  rawdata=(float32_t*)data_calloc(FLOAT32, frames*rawchannels);
+  err64=ambix_readf_float32(ambix, rawdata, rawdata+frames*rawambichannels, frames);
+  fail_if((err64!=frames), __LINE__, "read only %d raw frames of %d", (int)err64, (int)frames);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+  ambix=open_read(path, AMBIX_READ, rawformat);
+  fail_if((ambix_map_frames(ambix, &mapped, 1)>=0), __LINE__, "mapped frames without AMBIX_MMAP");
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+  ambix=open_read(path, AMBIX_READ|AMBIX_MMAP, rawformat);
+  err64=ambix_map_frames(ambix, &mapped, 4096);
+  if(AMBIX_SAMPLEFORMAT_FLOAT32 != format) {
+    fail_if((err64>=0), __LINE__, "mapped non-float frames");
+  } else if(err64<0) {
+    printf("backend does not support mapping files\n");
+  } else {
+    for(f=0; err64>0; f+=err64, err64=ambix_map_frames(ambix, &mapped, 4096)) {
+      int64_t frame;
+      uint32_t c;
+      for(frame=0; frame<err64; frame++) {
+        for(c=0; c<rawambichannels; c++)
+          fail_if((mapped[frame*rawchannels+c]!=rawdata[(f+frame)*rawambichannels+c]), __LINE__, "mapped frame %d[%d] differs", (int)(f+frame), c);
+        for(c=0; c<extrachannels; c++)
+          fail_if((mapped[frame*rawchannels+rawambichannels+c]!=rawdata[frames*rawambichannels+(f+frame)*extrachannels+c]), __LINE__, "mapped extra frame %d[%d] differs", (int)(f+frame), c);
+      }
+    }
+    fail_if((err64<0), __LINE__, "mapping frames failed with %d", (int)err64);
+    fail_if((f!=frames), __LINE__, "mapped %d frames (expected %d)", (int)f, (int)frames);
+
+    /* random access */
+    fail_if((ambix_seek(ambix, 1234, SEEK_SET)!=1234), __LINE__, "couldn't seek");
+    fail_if((ambix_map_frames(ambix, &mapped, 10)!=10), __LINE__, "couldn't map 10 frames");
+    fail_if((mapped[0]!=rawdata[1234*rawambichannels]), __LINE__, "mapped wrong frame after seeking");
+    fail_if((ambix_seek(ambix, -1, SEEK_END)!=frames-1), __LINE__, "couldn't seek to end");
+    fail_if((ambix_map_frames(ambix, &mapped, 10)!=1), __LINE__, "mapped beyond the end of file");
+  }
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+  ambixtest_rmfile(path);
+  free(ambidata);
+  free(otherdata);
+  free(rawdata);
+  if(matrix)
+    ambix_matrix_destroy(matrix);
+  STOPTEST("format=%d, matrix=%d\n", format, use_matrix);
+}
+
+int main(int argc, char**argv) {
+  const char*path=FILENAME_MAIN;
+  check_mmap(path, AMBIX_SAMPLEFORMAT_FLOAT32, 0);
+  check_mmap(path, AMBIX_SAMPLEFORMAT_FLOAT32, 1);
+  check_mmap(path, AMBIX_SAMPLEFORMAT_PCM24, 0);
+  check_mmap(path, AMBIX_SAMPLEFORMAT_PCM16, 1);
+  check_mmap(path, AMBIX_SAMPLEFORMAT_FLOAT64, 0);
+  return pass();
+}
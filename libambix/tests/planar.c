@@ -0,0 +1,234 @@
+/* planar - test reading/writing per-channel buffers
+
+   Copyright © 2026 IOhannes m zmölnig <zmoelnig@iem.at>.
+         Institute of Electronic Music and Acoustics (IEM),
+         University of Music and Dramatic Arts, Graz
+
+   This file is part of libambix
+
+   libambix is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   libambix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "common.h"
+#include <string.h>
+
+static int64_t planar_readf(ambix_t*ambix, ambixtest_presentationformat_t fmt,
+                            void**ambidata, void**otherdata, int64_t frames) {
+  switch(fmt) {
+  case INT16:
+    return ambix_readf_int16_planar(ambix, (int16_t**)ambidata, (int16_t**)otherdata, frames);
+  case INT32:
+    return ambix_readf_int32_planar(ambix, (int32_t**)ambidata, (int32_t**)otherdata, frames);
+  case FLOAT32:
+    return ambix_readf_float32_planar(ambix, (float32_t**)ambidata, (float32_t**)otherdata, frames);
+  case FLOAT64:
+    return ambix_readf_float64_planar(ambix, (float64_t**)ambidata, (float64_t**)otherdata, frames);
+  default:
+    break;
+  }
+  return -1;
+}
+static int64_t planar_writef(ambix_t*ambix, ambixtest_presentationformat_t fmt,
+                             void**ambidata, void**otherdata, int64_t frames) {
+  switch(fmt) {
+  case INT16:
+    return ambix_writef_int16_planar(ambix, (int16_t**)ambidata, (int16_t**)otherdata, frames);
+  case INT32:
+    return ambix_writef_int32_planar(ambix, (int32_t**)ambidata, (int32_t**)otherdata, frames);
+  case FLOAT32:
+    return ambix_writef_float32_planar(ambix, (float32_t**)ambidata, (float32_t**)otherdata, frames);
+  case FLOAT64:
+    return ambix_writef_float64_planar(ambix, (float64_t**)ambidata, (float64_t**)otherdata, frames);
+  default:
+    break;
+  }
+  return -1;
+}
+
+/* per-channel pointers into a (non-interleaved) buffer */
+static void**planar_channels(ambixtest_presentationformat_t fmt, void*data, uint32_t channels, int64_t frames) {
+  void**result=(void**)calloc(channels+1, sizeof(void*));
+  uint32_t c;
+  for(c=0; c<channels; c++)
+    result[c]=(char*)data+c*frames*data_size(fmt);
+  return result;
+}
+static void*deinterleave(ambixtest_presentationformat_t fmt, const void*data, uint32_t channels, int64_t frames) {
+  const size_t size=data_size(fmt);
+  char*result=(char*)data_calloc(fmt, frames*channels);
+  int64_t f;
+  uint32_t c;
+  for(f=0; f<frames; f++)
+    for(c=0; c<channels; c++)
+      memcpy(result+(c*frames+f)*size, (const char*)data+(f*channels+c)*size, size);
+  return result;
+}
+
+static ambix_t*open_write(const char*path, ambix_sampleformat_t format,
+                          const ambix_matrix_t*matrix, uint32_t ambichannels, uint32_t extrachannels,
+                          uint32_t threads) {
+  ambix_info_t info;
+  ambix_t*ambix=NULL;
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_BASIC;
+  info.ambichannels=matrix?matrix->cols:ambichannels;
+  info.extrachannels=extrachannels;
+  info.samplerate=44100;
+  info.sampleformat=format;
+  ambix=ambix_open(path, AMBIX_WRITE, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't create ambix file '%s' for writing", path);
+  if(matrix)
+    fail_if((AMBIX_ERR_SUCCESS!=ambix_set_adaptormatrix(ambix, matrix)), __LINE__, "failed setting adaptor matrix");
+  if(threads>1 && AMBIX_ERR_SUCCESS!=ambix_set_threads(ambix, threads))
+    printf("couldn't use %d threads\n", threads);
+  return ambix;
+}
+static ambix_t*open_read(const char*path, ambix_fileformat_t fileformat, uint32_t threads) {
+  ambix_info_t info;
+  ambix_t*ambix=NULL;
+  memset(&info, 0, sizeof(info));
+  info.fileformat=fileformat;
+  ambix=ambix_open(path, AMBIX_READ, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path);
+  if(threads>1 && AMBIX_ERR_SUCCESS!=ambix_set_threads(ambix, threads))
+    printf("couldn't use %d threads\n", threads);
+  return ambix;
+}
+
+/* planar and interleaved I/O must yield exactly the same data */
+static void check_planar(const char*path1, const char*path2,
+                         ambixtest_presentationformat_t fmt, ambix_sampleformat_t format,
+                         int use_matrix, uint32_t threads) {
+  /* BASIC files (without an adaptor matrix) cannot have extra channels */
+  const uint32_t fullambichannels=16, rawambichannels=use_matrix?9:16, extrachannels=use_matrix?2:0;
+  const int64_t frames=20000+17;
+  const ambix_fileformat_t rawformat=use_matrix?AMBIX_EXTENDED:AMBIX_BASIC;
+  const size_t size=data_size(fmt);
+  ambix_matrix_t*matrix=NULL;
+  void*ambidata=data_sine(fmt, frames, fullambichannels, 1000);
+  void*otherdata=data_ramp(fmt, frames, extrachannels);
+  void*planarambi=deinterleave(fmt, ambidata, fullambichannels, frames);
+  void*planarother=deinterleave(fmt, otherdata, extrachannels, frames);
+  void**ambichannels=planar_channels(fmt, planarambi, fullambichannels, frames);
+  void**otherchannels=planar_channels(fmt, planarother, extrachannels, frames);
+  void*result1=data_calloc(fmt, frames*(rawambichannels+extrachannels));
+  void*result2=data_calloc(fmt, frames*(rawambichannels+extrachannels));
+  void*resultambi=data_calloc(fmt, frames*fullambichannels);
+  void*resultother=data_calloc(fmt, frames*extrachannels);
+  ambix_t*ambix=NULL;
+  int64_t err64;
+  STARTTEST("format=%d, datafmt=%d, matrix=%d, threads=%d\n", format, fmt, use_matrix, threads);
+
+  if(use_matrix) {
+    uint32_t r, c;
+    matrix=ambix_matrix_init(fullambichannels, rawambichannels, NULL);
+    for(r=0; r<fullambichannels; r++)
+      for(c=0; c<rawambichannels; c++)
+        matrix->data[r][c]=(float32_t)(((r*rawambichannels+c)*7919)%101)/101. - 0.5;
+  }
+
+  /* write the same data interleaved and planar */
+  ambix=open_write(path1, format, matrix, fullambichannels, extrachannels, threads);
+  err64=ambixtest_writef(ambix, fmt, ambidata, 0, otherdata, 0, frames);
+  fail_if((err64!=frames), __LINE__, "wrote only %d interleaved frames of %d", (int)err64, (int)frames);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+  ambix=open_write(path2, format, matrix, fullambichannels, extrachannels, threads);
+  err64=planar_writef(ambix, fmt, ambichannels, otherchannels, frames);
+  fail_if((err64!=frames), __LINE__, "wrote only %d planar frames of %d", (int)err64, (int)frames);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+  /* compare what ended up on disk */
+  ambix=open_read(path1, rawformat, 1);
+  err64=ambixtest_readf(ambix, fmt, result1, 0, result1, frames*rawambichannels, frames);
+  fail_if((err64!=frames), __LINE__, "read only %d frames of %d", (int)err64, (int)frames);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+  ambix=open_read(path2, rawformat, 1);
+  err64=ambixtest_readf(ambix, fmt, result2, 0, result2, frames*rawambichannels, frames);
+  fail_if((err64!=frames), __LINE__, "read only %d frames of %d", (int)err64, (int)frames);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+  fail_if(memcmp(result1, result2, frames*(rawambichannels+extrachannels)*size), __LINE__, "planar writing differs from interleaved writing");
+
+  /* read the full set interleaved and planar */
+  ambix=open_read(path1, AMBIX_BASIC, threads);
+  err64=ambixtest_readf(ambix, fmt, resultambi, 0, resultother, 0, frames);
+  fail_if((err64!=frames), __LINE__, "read only %d interleaved frames of %d", (int)err64, (int)frames);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+  free(planarambi);
+  free(planarother);
+  planarambi=deinterleave(fmt, resultambi, fullambichannels, frames);
+  planarother=deinterleave(fmt, resultother, extrachannels, frames);
+  memset(resultambi, 0, frames*fullambichannels*size);
+  memset(resultother, 0, frames*extrachannels*size);
+  free(ambichannels);
+  free(otherchannels);
+  ambichannels=planar_channels(fmt, resultambi, fullambichannels, frames);
+  otherchannels=planar_channels(fmt, resultother, extrachannels, frames);
+
+  ambix=open_read(path1, AMBIX_BASIC, threads);
+  err64=planar_readf(ambix, fmt, ambichannels, otherchannels, frames);
+  fail_if((err64!=frames), __LINE__, "read only %d planar frames of %d", (int)err64, (int)frames);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+  fail_if(memcmp(planarambi, resultambi, frames*fullambichannels*size), __LINE__, "planar ambisonics data differs from interleaved");
+  fail_if(memcmp(planarother, resultother, frames*extrachannels*size), __LINE__, "planar extra channels differ from interleaved");
+
+  /* read the reduced set planar */
+  if(use_matrix) {
+    free(planarambi);
+    planarambi=deinterleave(fmt, result1, rawambichannels, frames);
+    free(planarother);
+    planarother=deinterleave(fmt, (char*)result1+frames*rawambichannels*size, extrachannels, frames);
+    free(ambichannels);
+    ambichannels=planar_channels(fmt, resultambi, rawambichannels, frames);
+
+    ambix=open_read(path2, AMBIX_EXTENDED, threads);
+    err64=planar_readf(ambix, fmt, ambichannels, otherchannels, frames);
+    fail_if((err64!=frames), __LINE__, "read only %d planar frames of %d", (int)err64, (int)frames);
+    fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+    fail_if(memcmp(planarambi, resultambi, frames*rawambichannels*size), __LINE__, "planar reading of the reduced set differs");
+    fail_if(memcmp(planarother, resultother, frames*extrachannels*size), __LINE__, "planar reading of the extra channels differs");
+  }
+
+  if(matrix)
+    ambix_matrix_destroy(matrix);
+  free(ambidata); free(otherdata);
+  free(planarambi); free(planarother);
+  free(ambichannels); free(otherchannels);
+  free(result1); free(result2);
+  free(resultambi); free(resultother);
+  ambixtest_rmfile(path1);
+  ambixtest_rmfile(path2);
+  STOPTEST("format=%d, datafmt=%d, matrix=%d, threads=%d\n", format, fmt, use_matrix, threads);
+}
+
+int main(int argc, char**argv) {
+  const char*path1=FILENAME_MAIN;
+  const char*path2=FILENAME_MAIN;
+
+  check_planar(path1, path2, FLOAT32, AMBIX_SAMPLEFORMAT_FLOAT32, 0, 1);
+  check_planar(path1, path2, FLOAT32, AMBIX_SAMPLEFORMAT_FLOAT32, 1, 1);
+  check_planar(path1, path2, FLOAT32, AMBIX_SAMPLEFORMAT_FLOAT32, 1, 4);
+  check_planar(path1, path2, FLOAT64, AMBIX_SAMPLEFORMAT_FLOAT64, 0, 1);
+  check_planar(path1, path2, FLOAT64, AMBIX_SAMPLEFORMAT_FLOAT64, 1, 1);
+  check_planar(path1, path2, INT32, AMBIX_SAMPLEFORMAT_PCM32, 1, 1);
+  check_planar(path1, path2, INT16, AMBIX_SAMPLEFORMAT_PCM16, 0, 1);
+  check_planar(path1, path2, INT16, AMBIX_SAMPLEFORMAT_PCM16, 1, 3);
+
+  return pass();
+}
@@ -0,0 +1,240 @@
+/* precision - test the precision modes of the matrix kernels
+
+   Copyright © 2026 IOhannes m zmölnig <zmoelnig@iem.at>.
+         Institute of Electronic Music and Acoustics (IEM),
+         University of Music and Dramatic Arts, Graz
+
+   This file is part of libambix
+
+   libambix is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   libambix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "common.h"
+#include <string.h>
+#include <math.h>
+#include <float.h>
+
+#define FRAMES 1000
+#define FULLCHANNELS 16
+#define AMBICHANNELS 9
+
+static const ambix_precision_t modes[] = {
+  AMBIX_PRECISION_DEFAULT,
+  AMBIX_PRECISION_FAST,
+  AMBIX_PRECISION_DOUBLE,
+  AMBIX_PRECISION_KAHAN,
+};
+
+static float32_t frand(void) {
+  return ((float32_t)rand())/((float32_t)RAND_MAX) * 2.f - 1.f;
+}
+
+/* a (nearly) exact reference, using compensated long double sums */
+static long double dot_reference(const float32_t*row, const float32_t*src, uint32_t cols) {
+  long double sum=0., comp=0.;
+  uint32_t i;
+  for(i=0; i<cols; i++) {
+    const long double term=(long double)row[i]*src[i];
+    const long double t=sum+term;
+    if(fabsl(sum)>=fabsl(term))
+      comp+=(sum-t)+term;
+    else
+      comp+=(term-t)+sum;
+    sum=t;
+  }
+  return sum+comp;
+}
+
+/* large terms that (almost) cancel each other out */
+static void check_cancellation(void) {
+  const uint32_t channels=121;
+  const int64_t frames=64;
+  ambix_matrix_t*matrix=ambix_matrix_init(1, channels, NULL);
+  float32_t*source=(float32_t*)data_calloc(FLOAT32, channels*frames);
+  float32_t*dest=(float32_t*)data_calloc(FLOAT32, frames);
+  float32_t maxerr[sizeof(modes)/sizeof(*modes)];
+  unsigned int m;
+  int64_t f;
+  uint32_t c;
+  STARTTEST("\n");
+  for(c=0; c<channels; c++)
+    matrix->data[0][c]=(c%2)?1.f:-1.f;
+  for(f=0; f<frames; f++) {
+    for(c=0; c<channels; c+=2) {
+      const float32_t big=frand()*1e7f;
+      source[f*channels+c]=big;
+      if(c+1<channels)
+        source[f*channels+c+1]=big+frand();
+    }
+  }
+
+  for(m=0; m<sizeof(modes)/sizeof(*modes); m++) {
+    maxerr[m]=0.;
+    fail_if((AMBIX_ERR_SUCCESS!=ambix_matrix_multiply_float32_precision(dest, matrix, source, frames, modes[m])),
+            __LINE__, "multiplying with precision %d failed", modes[m]);
+    for(f=0; f<frames; f++) {
+      const long double ref=dot_reference(matrix->data[0], source+f*channels, channels);
+      const float32_t err=(float32_t)fabsl(dest[f]-ref);
+      /* allow for rounding the result to float */
+      const float32_t ulp=(float32_t)fabsl(ref)*FLT_EPSILON;
+      if(err-ulp>maxerr[m])
+        maxerr[m]=err-ulp;
+    }
+  }
+  /* the compensated sum is (almost) exact */
+  fail_if((maxerr[3]>0.), __LINE__, "compensated summation is off by %g", maxerr[3]);
+  /* the double sum cannot be worse than the float sum */
+  fail_if((maxerr[2]>maxerr[1]), __LINE__, "double precision is off by %g (single precision: %g)", maxerr[2], maxerr[1]);
+  /* AMBIX_PRECISION_DEFAULT is double precision for ambix_matrix_multiply_float32() */
+  fail_if((maxerr[0]!=maxerr[2]), __LINE__, "default precision is off by %g (double precision: %g)", maxerr[0], maxerr[2]);
+
+  ambix_matrix_destroy(matrix);
+  free(source);
+  free(dest);
+  STOPTEST("\n");
+}
+
+/* denormals can be flushed to zero */
+static void check_denormals(void) {
+  const int64_t frames=64;
+  ambix_matrix_t*matrix=ambix_matrix_init(4, 4, NULL);
+  float32_t*source=(float32_t*)data_calloc(FLOAT32, 4*frames);
+  float32_t*dest=(float32_t*)data_calloc(FLOAT32, 4*frames);
+  volatile float32_t tiny=FLT_MIN;
+  int64_t i;
+  STARTTEST("\n");
+  ambix_matrix_fill(matrix, AMBIX_MATRIX_IDENTITY);
+  for(i=0; i<4*frames; i++)
+    source[i]=FLT_MIN/4.f;
+  if(0.f==source[0]) {
+    /* no denormals on this platform */
+    ambix_matrix_destroy(matrix);
+    free(source);
+    free(dest);
+    STOPTEST("\n");
+    return;
+  }
+
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_matrix_multiply_float32_precision(dest, matrix, source, frames, AMBIX_PRECISION_FAST)),
+          __LINE__, "multiplying denormals failed");
+  fail_if((dest[0]!=source[0]), __LINE__, "denormal %g became %g", source[0], dest[0]);
+
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_matrix_multiply_float32_precision(dest, matrix, source, frames,
+                                                                    AMBIX_PRECISION_FAST|AMBIX_PRECISION_FLUSH_DENORMALS)),
+          __LINE__, "multiplying denormals failed");
+#if defined __x86_64__ || defined _M_X64 || defined __aarch64__
+  for(i=0; i<4*frames; i++)
+    fail_if((0.f!=dest[i]), __LINE__, "denormal[%d] was not flushed: %g", (int)i, dest[i]);
+#endif
+  /* the floating point environment has been restored */
+  tiny/=4.f;
+  fail_if((0.f==tiny), __LINE__, "denormals are still flushed to zero");
+
+  ambix_matrix_destroy(matrix);
+  free(source);
+  free(dest);
+  STOPTEST("\n");
+}
+
+/* the adaptor matrix is applied with the precision of the handle */
+static void check_handle(const char*path, ambixtest_presentationformat_t fmt, ambix_sampleformat_t format) {
+  ambix_matrix_t*matrix=ambix_matrix_init(FULLCHANNELS, AMBICHANNELS, NULL);
+  void*rawdata=data_sine(fmt, FRAMES, AMBICHANNELS, 100);
+  void*ambidata=data_calloc(fmt, FRAMES*FULLCHANNELS);
+  void*refdata=data_calloc(fmt, FRAMES*FULLCHANNELS);
+  ambix_info_t info;
+  ambix_t*ambix=NULL;
+  int64_t err64;
+  uint32_t r, c;
+  unsigned int m;
+  STARTTEST("format=%d\n", format);
+  for(r=0; r<FULLCHANNELS; r++)
+    for(c=0; c<AMBICHANNELS; c++)
+      matrix->data[r][c]=frand();
+
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_EXTENDED;
+  info.ambichannels=AMBICHANNELS;
+  info.samplerate=44100;
+  info.sampleformat=format;
+  ambix=ambix_open(path, AMBIX_WRITE, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't create ambix file '%s' for writing", path);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_set_adaptormatrix(ambix, matrix)), __LINE__, "failed setting adaptor matrix");
+  err64=ambixtest_writef(ambix, fmt, rawdata, 0, NULL, 0, FRAMES);
+  fail_if((FRAMES!=err64), __LINE__, "wrote only %d frames of %d", (int)err64, FRAMES);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+  for(m=0; m<sizeof(modes)/sizeof(*modes); m++) {
+    /* AMBIX_PRECISION_DEFAULT is single precision for the adaptor matrix */
+    const ambix_precision_t precision=modes[m]?modes[m]:AMBIX_PRECISION_FAST;
+    memset(&info, 0, sizeof(info));
+    info.fileformat=AMBIX_BASIC;
+    ambix=ambix_open(path, AMBIX_READ, &info);
+    fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path);
+    fail_if((AMBIX_ERR_SUCCESS!=ambix_set_precision(ambix, modes[m]|AMBIX_PRECISION_FLUSH_DENORMALS)),
+            __LINE__, "couldn't set precision %d", modes[m]);
+    err64=ambixtest_readf(ambix, fmt, ambidata, 0, NULL, 0, FRAMES);
+    fail_if((FRAMES!=err64), __LINE__, "read only %d frames of %d", (int)err64, FRAMES);
+    fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+    if(FLOAT32==fmt)
+      ambix_matrix_multiply_float32_precision(refdata, matrix, rawdata, FRAMES, precision);
+    else
+      ambix_matrix_multiply_float64_precision(refdata, matrix, rawdata, FRAMES, precision);
+    fail_if(memcmp(ambidata, refdata, FRAMES*FULLCHANNELS*data_size(fmt)), __LINE__,
+            "reading with precision %d differs from ambix_matrix_multiply()", modes[m]);
+  }
+
+  ambix_matrix_destroy(matrix);
+  free(rawdata);
+  free(ambidata);
+  free(refdata);
+  ambixtest_rmfile(path);
+  STOPTEST("format=%d\n", format);
+}
+
+static void check_invalid(const char*path) {
+  ambix_info_t info;
+  ambix_t*ambix=NULL;
+  float32_t data[4]={0.};
+  ambix_matrix_t*matrix=ambix_matrix_init(2, 2, NULL);
+  STARTTEST("\n");
+  fail_if((AMBIX_ERR_INVALID_HANDLE!=ambix_set_precision(NULL, AMBIX_PRECISION_FAST)), __LINE__, "set precision on NULL handle");
+  fail_if((AMBIX_ERR_SUCCESS==ambix_matrix_multiply_float32_precision(data, matrix, data, 2, (ambix_precision_t)42)),
+          __LINE__, "multiplied with invalid precision");
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_BASIC;
+  info.ambichannels=4;
+  info.samplerate=44100;
+  info.sampleformat=AMBIX_SAMPLEFORMAT_FLOAT32;
+  ambix=ambix_open(path, AMBIX_WRITE, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't create ambix file '%s' for writing", path);
+  fail_if((AMBIX_ERR_SUCCESS==ambix_set_precision(ambix, (ambix_precision_t)42)), __LINE__, "set invalid precision");
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_set_precision(ambix, AMBIX_PRECISION_FLUSH_DENORMALS)), __LINE__, "couldn't flush denormals");
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+  ambix_matrix_destroy(matrix);
+  ambixtest_rmfile(path);
+  STOPTEST("\n");
+}
+
+int main(int argc, char**argv) {
+  const char*path=FILENAME_MAIN;
+  check_cancellation();
+  check_denormals();
+  check_handle(path, FLOAT32, AMBIX_SAMPLEFORMAT_FLOAT32);
+  check_handle(path, FLOAT64, AMBIX_SAMPLEFORMAT_FLOAT64);
+  check_invalid(path);
+  return pass();
+}
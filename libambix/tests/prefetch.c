@@ -0,0 +1,252 @@
+/* prefetch - test reading files in a background thread
+
+   Copyright © 2026 IOhannes m zmölnig <zmoelnig@iem.at>.
+         Institute of Electronic Music and Acoustics (IEM),
+         University of Music and Dramatic Arts, Graz
+
+   This file is part of libambix
+
+   libambix is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   libambix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "common.h"
+#include <string.h>
+#include <math.h>
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif
+
+static ambix_t*open_read(const char*path, ambix_filemode_t mode) {
+  ambix_info_t info;
+  ambix_t*ambix=NULL;
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_BASIC;
+  ambix=ambix_open(path, mode, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path);
+  return ambix;
+}
+
+/* wait (a bit) for the reader thread to fill the ring */
+static int64_t wait_for_prefetch(ambix_t*ambix, int64_t frames) {
+  int64_t available=0;
+  int i;
+  for(i=0; i<1000; i++) {
+    if(AMBIX_ERR_SUCCESS!=ambix_get_prefetch(ambix, &available, NULL, NULL))
+      return -1;
+    if(available>=frames)
+      break;
+#ifdef HAVE_UNISTD_H
+    usleep(1000);
+#endif
+  }
+  return available;
+}
+
+static void check_prefetch(const char*path, ambix_sampleformat_t format, int use_matrix) {
+  const uint32_t fullambichannels=16, rawambichannels=use_matrix?9:16, extrachannels=use_matrix?2:0;
+  const uint32_t channels=fullambichannels+extrachannels;
+  /* more than fits into the ring */
+  const int64_t frames=100000+17;
+  const int64_t blocksizes[]={64, 1000, 40000};
+  ambix_matrix_t*matrix=NULL;
+  float32_t*ambidata=(float32_t*)data_sine(FLOAT32, frames, fullambichannels, 1000);
+  float32_t*otherdata=(float32_t*)data_ramp(FLOAT32, frames, extrachannels);
+  float32_t*expected=(float32_t*)data_calloc(FLOAT32, frames*channels);
+  float32_t*result=(float32_t*)data_calloc(FLOAT32, frames*channels);
+  int16_t*expected16=(int16_t*)data_calloc(INT16, frames*channels);
+  int16_t*result16=(int16_t*)data_calloc(INT16, frames*channels);
+  ambix_info_t info;
+  ambix_t*ambix=NULL;
+  int64_t err64, f, available, size;
+  uint64_t underruns, underruns2;
+  int prefetching;
+  unsigned int i;
+  STARTTEST("format=%d, matrix=%d\n", format, use_matrix);
+
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_BASIC;
+  info.ambichannels=use_matrix?rawambichannels:fullambichannels;
+  info.extrachannels=extrachannels;
+  info.samplerate=44100;
+  info.sampleformat=format;
+  fail_if((NULL!=ambix_open(path, AMBIX_WRITE|AMBIX_PREFETCH, &info)), __LINE__, "opened '%s' for writing in prefetch-mode", path);
+  ambix=ambix_open(path, AMBIX_WRITE, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't create ambix file '%s' for writing", path);
+  if(use_matrix) {
+    uint32_t r, c;
+    matrix=ambix_matrix_init(fullambichannels, rawambichannels, NULL);
+    for(r=0; r<fullambichannels; r++)
+      for(c=0; c<rawambichannels; c++)
+        matrix->data[r][c]=(float32_t)(((r*rawambichannels+c)*7919)%101)/101. - 0.5;
+    fail_if((AMBIX_ERR_SUCCESS!=ambix_set_adaptormatrix(ambix, matrix)), __LINE__, "failed setting adaptor matrix");
+  }
+  err64=ambix_writef_float32(ambix, ambidata, otherdata, frames);
+  fail_if((err64!=frames), __LINE__, "wrote only %d frames of %d", (int)err64, (int)frames);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+  /* reference data */
+  ambix=open_read(path, AMBIX_READ);
+  fail_if((AMBIX_ERR_SUCCESS==ambix_get_prefetch(ambix, NULL, NULL, NULL)), __LINE__, "got prefetch state without AMBIX_PREFETCH");
+  err64=ambix_readf_float32(ambix, expected, expected+frames*fullambichannels, frames);
+  fail_if((err64!=frames), __LINE__, "read only %d frames of %d", (int)err64, (int)frames);
+  fail_if((ambix_seek(ambix, 0, SEEK_SET)!=0), __LINE__, "couldn't rewind");
+  err64=ambix_readf_int16(ambix, expected16, expected16+frames*fullambichannels, frames);
+  fail_if((err64!=frames), __LINE__, "read only %d int16 frames of %d", (int)err64, (int)frames);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+  /* read everything in blocks */
+  for(i=0; i<sizeof(blocksizes)/sizeof(*blocksizes); i++) {
+    float32_t*ambiresult=result, *otherresult=result+frames*fullambichannels;
+    memset(result, 0, frames*channels*sizeof(*result));
+    ambix=open_read(path, AMBIX_READ|AMBIX_PREFETCH);
+    for(f=0; f<frames; f+=err64) {
+      err64=ambix_readf_float32(ambix, ambiresult+f*fullambichannels, otherresult+f*extrachannels, blocksizes[i]);
+      fail_if((err64<=0), __LINE__, "reading frame %d returned %d", (int)f, (int)err64);
+    }
+    fail_if((f!=frames), __LINE__, "read %d frames (expected %d)", (int)f, (int)frames);
+    fail_if((ambix_readf_float32(ambix, ambiresult, otherresult, 1)!=0), __LINE__, "read beyond the end of the file");
+    fail_if(memcmp(expected, result, frames*channels*sizeof(*result)), __LINE__, "prefetched data differs (blocksize=%d)", (int)blocksizes[i]);
+    fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+  }
+
+  /* other sample types are converted from the ring */
+  ambix=open_read(path, AMBIX_READ|AMBIX_PREFETCH);
+  err64=ambix_readf_int16(ambix, result16, result16+frames*fullambichannels, frames);
+  fail_if((err64!=frames), __LINE__, "read only %d int16 frames of %d", (int)err64, (int)frames);
+  fail_if(memcmp(expected16, result16, frames*channels*sizeof(*result16)), __LINE__, "prefetched int16 data differs");
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+  /* seeking */
+  ambix=open_read(path, AMBIX_READ|AMBIX_PREFETCH);
+  prefetching=(AMBIX_ERR_SUCCESS==ambix_get_prefetch(ambix, &available, &size, &underruns));
+  if(prefetching) {
+    fail_if((size<1 || available<0 || available>size), __LINE__, "invalid prefetch state %d/%d", (int)available, (int)size);
+    fail_if((underruns!=0), __LINE__, "%d underruns before reading", (int)underruns);
+  } else {
+    printf("prefetching is not supported\n");
+  }
+  for(i=0; i<10; i++) {
+    const int64_t position=(i*7919*13)%frames;
+    const int64_t count=(frames-position<500)?(frames-position):500;
+    float32_t*ambiresult=result, *otherresult=result+count*fullambichannels;
+    uint32_t c;
+    fail_if((ambix_seek(ambix, position, SEEK_SET)!=position), __LINE__, "couldn't seek to %d", (int)position);
+    if(i&1)
+      wait_for_prefetch(ambix, count);
+    err64=ambix_readf_float32(ambix, ambiresult, otherresult, count);
+    fail_if((err64!=count), __LINE__, "read %d frames at %d (expected %d)", (int)err64, (int)position, (int)count);
+    for(c=0; c<count*fullambichannels; c++)
+      fail_if((ambiresult[c]!=expected[position*fullambichannels+c]), __LINE__, "wrong sample after seeking to %d", (int)position);
+    for(c=0; c<count*extrachannels; c++)
+      fail_if((otherresult[c]!=expected[frames*fullambichannels+position*extrachannels+c]), __LINE__, "wrong extra sample after seeking to %d", (int)position);
+    fail_if((ambix_seek(ambix, 0, SEEK_CUR)!=position+count), __LINE__, "wrong position after reading");
+  }
+
+  /* a filled ring can be read without waiting */
+  fail_if((ambix_seek(ambix, 0, SEEK_SET)!=0), __LINE__, "couldn't rewind");
+  if(prefetching) {
+    available=wait_for_prefetch(ambix, 1000);
+    fail_if((available<1000), __LINE__, "ring is not filling up (%d frames)", (int)available);
+    ambix_get_prefetch(ambix, NULL, NULL, &underruns);
+    err64=ambix_readf_float32(ambix, result, result+1000*fullambichannels, 1000);
+    fail_if((err64!=1000), __LINE__, "read only %d frames of 1000", (int)err64);
+    ambix_get_prefetch(ambix, NULL, NULL, &underruns2);
+    fail_if((underruns2!=underruns), __LINE__, "reading from a filled ring was an underrun");
+  }
+
+  /* seeking to the very end */
+  fail_if((ambix_seek(ambix, 0, SEEK_END)!=frames), __LINE__, "couldn't seek to the end");
+  fail_if((ambix_readf_float32(ambix, result, result+frames*fullambichannels, 10)!=0), __LINE__, "read beyond the end of the file");
+  fail_if((ambix_seek(ambix, 1, SEEK_END)>=0), __LINE__, "seeked beyond the end of the file");
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+  ambixtest_rmfile(path);
+  free(ambidata);
+  free(otherdata);
+  free(expected);
+  free(result);
+  free(expected16);
+  free(result16);
+  if(matrix)
+    ambix_matrix_destroy(matrix);
+  STOPTEST("format=%d, matrix=%d\n", format, use_matrix);
+}
+
+/* samples that do not fit into a float32 must not lose any precision */
+static void check_exact(const char*path, ambix_sampleformat_t format, ambixtest_presentationformat_t fmt) {
+  const uint32_t channels=4;
+  const int64_t frames=100000+17;
+  const ambixtest_presentationformat_t fmts[]={INT16, INT32, FLOAT32, FLOAT64};
+  void*data=data_calloc(fmt, frames*channels);
+  void*expected=data_calloc(FLOAT64, frames*channels);
+  void*result=data_calloc(FLOAT64, frames*channels);
+  ambix_info_t info;
+  ambix_t*ambix=NULL;
+  int64_t err64, i;
+  unsigned int f;
+  STARTTEST("format=%d\n", format);
+
+  for(i=0; i<frames*channels; i++) {
+    if(INT32==fmt)
+      ((int32_t*)data)[i]=(int32_t)((uint32_t)i*2654435761u);
+    else
+      ((float64_t*)data)[i]=0.5*sin(0.001*(float64_t)i)+1e-12;
+  }
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_BASIC;
+  info.ambichannels=channels;
+  info.samplerate=44100;
+  info.sampleformat=format;
+  ambix=ambix_open(path, AMBIX_WRITE, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't create ambix file '%s' for writing", path);
+  err64=ambixtest_writef(ambix, fmt, data, 0, NULL, 0, frames);
+  fail_if((err64!=frames), __LINE__, "wrote only %d frames of %d", (int)err64, (int)frames);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+  for(f=0; f<sizeof(fmts)/sizeof(*fmts); f++) {
+    const size_t size=frames*channels*data_size(fmts[f]);
+    ambix=open_read(path, AMBIX_READ);
+    err64=ambixtest_readf(ambix, fmts[f], expected, 0, NULL, 0, frames);
+    fail_if((err64!=frames), __LINE__, "read only %d frames of %d", (int)err64, (int)frames);
+    fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+    /* the file's own sample type reads back what was written */
+    if(fmts[f]==fmt)
+      fail_if(memcmp(data, expected, size), __LINE__, "file does not hold the written data");
+
+    memset(result, 0, size);
+    ambix=open_read(path, AMBIX_READ|AMBIX_PREFETCH);
+    err64=ambixtest_readf(ambix, fmts[f], result, 0, NULL, 0, frames);
+    fail_if((err64!=frames), __LINE__, "read only %d prefetched frames of %d", (int)err64, (int)frames);
+    fail_if(memcmp(expected, result, size), __LINE__, "prefetched data differs (type=%d)", fmts[f]);
+    fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+  }
+
+  ambixtest_rmfile(path);
+  free(data);
+  free(expected);
+  free(result);
+  STOPTEST("format=%d\n", format);
+}
+
+int main(int argc, char**argv) {
+  const char*path=FILENAME_MAIN;
+  check_prefetch(path, AMBIX_SAMPLEFORMAT_FLOAT32, 0);
+  check_prefetch(path, AMBIX_SAMPLEFORMAT_FLOAT32, 1);
+  check_prefetch(path, AMBIX_SAMPLEFORMAT_PCM24, 1);
+  check_prefetch(path, AMBIX_SAMPLEFORMAT_PCM16, 0);
+  check_exact(path, AMBIX_SAMPLEFORMAT_FLOAT64, FLOAT64);
+  check_exact(path, AMBIX_SAMPLEFORMAT_PCM32, INT32);
+  return pass();
+}
@@ -0,0 +1,141 @@
+/* probe - test reading the format of files without opening them
+
+   Copyright © 2026 IOhannes m zmölnig <zmoelnig@iem.at>.
+         Institute of Electronic Music and Acoustics (IEM),
+         University of Music and Dramatic Arts, Graz
+
+   This file is part of libambix
+
+   libambix is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   libambix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "common.h"
+#include <string.h>
+
+static void check_probe(const char*path, ambix_fileformat_t format, ambix_sampleformat_t sampleformat,
+                        uint32_t ambichannels, uint32_t extrachannels) {
+  const int64_t frames=1000+17;
+  const uint32_t fullambichannels=(AMBIX_EXTENDED==format)?16:ambichannels;
+  ambix_matrix_t*matrix=NULL, *probed=NULL;
+  float32_t*ambidata=(float32_t*)data_sine(FLOAT32, frames, fullambichannels, 100);
+  float32_t*otherdata=(float32_t*)data_ramp(FLOAT32, frames, extrachannels);
+  ambix_info_t info, expected, result;
+  ambix_t*ambix=NULL;
+  int64_t err64;
+  STARTTEST("format=%d, sampleformat=%d, channels=%d+%d\n", format, sampleformat, ambichannels, extrachannels);
+
+  memset(&info, 0, sizeof(info));
+  info.fileformat=format;
+  info.ambichannels=ambichannels;
+  info.extrachannels=extrachannels;
+  info.samplerate=44100;
+  info.sampleformat=sampleformat;
+  ambix=ambix_open(path, AMBIX_WRITE, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't create ambix file '%s' for writing", path);
+  if(AMBIX_EXTENDED==format) {
+    uint32_t r, c;
+    matrix=ambix_matrix_init(fullambichannels, ambichannels, NULL);
+    for(r=0; r<fullambichannels; r++)
+      for(c=0; c<ambichannels; c++)
+        matrix->data[r][c]=(float32_t)(((r*ambichannels+c)*7919)%101)/101. - 0.5;
+    fail_if((AMBIX_ERR_SUCCESS!=ambix_set_adaptormatrix(ambix, matrix)), __LINE__, "failed setting adaptor matrix");
+  }
+  err64=ambix_writef_float32(ambix, (AMBIX_NONE==format)?NULL:ambidata, otherdata, frames);
+  fail_if((err64!=frames), __LINE__, "wrote only %d frames of %d", (int)err64, (int)frames);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+  /* reference */
+  memset(&expected, 0, sizeof(expected));
+  ambix=ambix_open(path, AMBIX_READ, &expected);
+  fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path);
+
+  /* probing */
+  probed=ambix_matrix_init(0, 0, NULL);
+  memset(&result, 0xFF, sizeof(result));
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_probe(path, &result, probed)), __LINE__, "couldn't probe '%s'", path);
+  fail_if((result.fileformat!=expected.fileformat), __LINE__, "probed fileformat %d (expected %d)", result.fileformat, expected.fileformat);
+  fail_if((result.fileformat!=format), __LINE__, "probed fileformat %d (written %d)", result.fileformat, format);
+  fail_if((result.frames!=expected.frames), __LINE__, "probed %d frames (expected %d)", (int)result.frames, (int)expected.frames);
+  fail_if((result.samplerate!=expected.samplerate), __LINE__, "probed samplerate %g (expected %g)", result.samplerate, expected.samplerate);
+  fail_if((result.sampleformat!=expected.sampleformat), __LINE__, "probed sampleformat %d (expected %d)", result.sampleformat, expected.sampleformat);
+  fail_if((result.ambichannels!=expected.ambichannels), __LINE__, "probed %d ambichannels (expected %d)", result.ambichannels, expected.ambichannels);
+  fail_if((result.extrachannels!=expected.extrachannels), __LINE__, "probed %d extrachannels (expected %d)", result.extrachannels, expected.extrachannels);
+  if(AMBIX_EXTENDED==format) {
+    float32_t errf=matrix_diff(__LINE__, ambix_get_adaptormatrix(ambix), probed, 1e-7);
+    fail_if((errf>1e-7), __LINE__, "probed matrix differs by %g", errf);
+    /* the matrix is optional */
+    fail_if((AMBIX_ERR_SUCCESS!=ambix_probe(path, &result, NULL)), __LINE__, "couldn't probe '%s' without matrix", path);
+  } else {
+    fail_if((probed->rows || probed->cols), __LINE__, "got a %dx%d matrix for a non-extended file", probed->rows, probed->cols);
+  }
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+  ambixtest_rmfile(path);
+  free(ambidata);
+  free(otherdata);
+  ambix_matrix_destroy(probed);
+  if(matrix)
+    ambix_matrix_destroy(matrix);
+  STOPTEST("format=%d, sampleformat=%d, channels=%d+%d\n", format, sampleformat, ambichannels, extrachannels);
+}
+
+static void check_invalid(const char*path) {
+  ambix_info_t info;
+  FILE*file=NULL;
+  STARTTEST("\n");
+  memset(&info, 0, sizeof(info));
+  ambixtest_rmfile(path);
+  fail_if((AMBIX_ERR_INVALID_FILE!=ambix_probe(path, &info, NULL)), __LINE__, "probed non-existing file '%s'", path);
+  fail_if((AMBIX_ERR_SUCCESS==ambix_probe(path, NULL, NULL)), __LINE__, "probed without info");
+
+  file=fopen(path, "wb");
+  fail_if((NULL==file), __LINE__, "couldn't create '%s'", path);
+  fprintf(file, "RIFF....WAVEfmt this is not a CAF file");
+  fclose(file);
+  fail_if((AMBIX_ERR_INVALID_FILE!=ambix_probe(path, &info, NULL)), __LINE__, "probed non-CAF file '%s'", path);
+
+  /* a truncated header */
+  file=fopen(path, "wb");
+  fail_if((NULL==file), __LINE__, "couldn't create '%s'", path);
+  fwrite("caff\0\1\0\0desc", 1, 12, file);
+  fclose(file);
+  fail_if((AMBIX_ERR_INVALID_FILE!=ambix_probe(path, &info, NULL)), __LINE__, "probed truncated file '%s'", path);
+
+  /* 0x40000000 channels of 32bit (so the frame size overflows to 0) */
+  file=fopen(path, "wb");
+  fail_if((NULL==file), __LINE__, "couldn't create '%s'", path);
+  fwrite("caff\0\1\0\0"
+         "desc\0\0\0\0\0\0\0\x20"
+         "\x40\xE5\x88\x80\0\0\0\0" "lpcm" "\0\0\0\0"
+         "\0\0\0\0" "\0\0\0\1" "\x40\0\0\0" "\0\0\0\x20"
+         "data\0\0\0\0\0\0\0\x14"
+         "\0\0\0\0", 1, 8+12+32+12+4, file);
+  fwrite("0123456789abcdef", 1, 16, file);
+  fclose(file);
+  fail_if((AMBIX_ERR_INVALID_FILE!=ambix_probe(path, &info, NULL)), __LINE__, "probed file with broken 'desc' chunk '%s'", path);
+  ambixtest_rmfile(path);
+  STOPTEST("\n");
+}
+
+int main(int argc, char**argv) {
+  const char*path=FILENAME_MAIN;
+  check_probe(path, AMBIX_BASIC, AMBIX_SAMPLEFORMAT_FLOAT32, 16, 0);
+  check_probe(path, AMBIX_BASIC, AMBIX_SAMPLEFORMAT_PCM16, 4, 0);
+  check_probe(path, AMBIX_EXTENDED, AMBIX_SAMPLEFORMAT_PCM24, 9, 2);
+  check_probe(path, AMBIX_EXTENDED, AMBIX_SAMPLEFORMAT_FLOAT64, 9, 0);
+  check_probe(path, AMBIX_NONE, AMBIX_SAMPLEFORMAT_PCM32, 0, 5);
+  check_invalid(path);
+  return pass();
+}
@@ -0,0 +1,354 @@
+/* rdrw - test editing the chunks of existing files in place
+
+   Copyright © 2026 IOhannes m zmölnig <zmoelnig@iem.at>.
+         Institute of Electronic Music and Acoustics (IEM),
+         University of Music and Dramatic Arts, Graz
+
+   This file is part of libambix
+
+   libambix is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   libambix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "common.h"
+#include <string.h>
+#include <stdio.h>
+
+#define FRAMES (4096+17)
+#define AMBICHANNELS 9
+#define EXTRACHANNELS 2
+
+static long filesize(const char*path) {
+  long size=-1;
+  FILE*file=fopen(path, "rb");
+  if(!file)
+    return -1;
+  if(!fseek(file, 0, SEEK_END))
+    size=ftell(file);
+  fclose(file);
+  return size;
+}
+
+static ambix_matrix_t*make_matrix(uint32_t rows, uint32_t cols, float32_t offset) {
+  ambix_matrix_t*matrix=ambix_matrix_init(rows, cols, NULL);
+  uint32_t r, c;
+  for(r=0; r<rows; r++)
+    for(c=0; c<cols; c++)
+      matrix->data[r][c]=(float32_t)(((r*cols+c)*7919)%101)/101. - offset;
+  return matrix;
+}
+
+static void add_marker(ambix_t*ambix, float64_t position, const char*name) {
+  ambix_marker_t marker;
+  memset(&marker, 0, sizeof(marker));
+  marker.position=position;
+  strncpy(marker.name, name, sizeof(marker.name)-1);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_add_marker(ambix, &marker)), __LINE__, "couldn't add marker '%s'", name);
+}
+static void add_region(ambix_t*ambix, float64_t start, float64_t stop, const char*name) {
+  ambix_region_t region;
+  memset(&region, 0, sizeof(region));
+  region.start_position=start;
+  region.end_position=stop;
+  strncpy(region.name, name, sizeof(region.name)-1);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_add_region(ambix, &region)), __LINE__, "couldn't add region '%s'", name);
+}
+
+/* write an EXTENDED file with a few markers and regions */
+static void write_file(const char*path, const ambix_matrix_t*matrix, const float32_t*ambidata, const float32_t*otherdata) {
+  ambix_info_t info;
+  ambix_t*ambix=NULL;
+  int64_t err64;
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_EXTENDED;
+  info.ambichannels=AMBICHANNELS;
+  info.extrachannels=EXTRACHANNELS;
+  info.samplerate=48000;
+  info.sampleformat=AMBIX_SAMPLEFORMAT_FLOAT32;
+  ambix=ambix_open(path, AMBIX_WRITE, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't create ambix file '%s' for writing", path);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_set_adaptormatrix(ambix, matrix)), __LINE__, "failed setting adaptor matrix");
+  add_marker(ambix, 1., "marker #1");
+  add_marker(ambix, 2., "marker #2");
+  add_marker(ambix, 3., "marker #3");
+  add_region(ambix, 10., 20., "region #1");
+  add_region(ambix, 30., 40., "region #2");
+  err64=ambix_writef_float32(ambix, ambidata, otherdata, FRAMES);
+  fail_if((err64!=FRAMES), __LINE__, "wrote only %d frames of %d", (int)err64, (int)FRAMES);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+}
+
+/* check that the samples are still what we wrote */
+static void check_data(const char*path, const ambix_matrix_t*matrix, const float32_t*ambidata, const float32_t*otherdata) {
+  float32_t*ambiresult=(float32_t*)data_calloc(FLOAT32, FRAMES*AMBICHANNELS);
+  float32_t*otherresult=(float32_t*)data_calloc(FLOAT32, FRAMES*EXTRACHANNELS);
+  ambix_info_t info;
+  ambix_t*ambix=NULL;
+  float32_t diff;
+  int64_t err64;
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_EXTENDED;
+  ambix=ambix_open(path, AMBIX_READ, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path);
+  fail_if((FRAMES!=info.frames), __LINE__, "file has %d frames (expected %d)", (int)info.frames, FRAMES);
+  fail_if((AMBICHANNELS!=info.ambichannels), __LINE__, "file has %d ambichannels", info.ambichannels);
+  fail_if((EXTRACHANNELS!=info.extrachannels), __LINE__, "file has %d extrachannels", info.extrachannels);
+  diff=matrix_diff(__LINE__, ambix_get_adaptormatrix(ambix), matrix, 1e-7);
+  fail_if((diff>1e-7), __LINE__, "adaptor matrix differs by %g", diff);
+  err64=ambix_readf_float32(ambix, ambiresult, otherresult, FRAMES);
+  fail_if((err64!=FRAMES), __LINE__, "read only %d frames of %d", (int)err64, (int)FRAMES);
+  diff=data_diff(__LINE__, FLOAT32, ambidata, ambiresult, FRAMES*AMBICHANNELS, 0.);
+  fail_if((diff>0.), __LINE__, "ambisonics data differs by %g", diff);
+  diff=data_diff(__LINE__, FLOAT32, otherdata, otherresult, FRAMES*EXTRACHANNELS, 0.);
+  fail_if((diff>0.), __LINE__, "extra data differs by %g", diff);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+  free(ambiresult);
+  free(otherresult);
+}
+
+static void check_edit(const char*path) {
+  float32_t*ambidata=(float32_t*)data_sine(FLOAT32, FRAMES, AMBICHANNELS, 100);
+  float32_t*otherdata=(float32_t*)data_ramp(FLOAT32, FRAMES, EXTRACHANNELS);
+  float32_t*buffer=(float32_t*)data_calloc(FLOAT32, FRAMES*(AMBICHANNELS+EXTRACHANNELS));
+  ambix_matrix_t*matrix=make_matrix(16, AMBICHANNELS, 0.5);
+  ambix_matrix_t*matrix2=make_matrix(16, AMBICHANNELS, 0.25);
+  ambix_matrix_t*badmatrix=make_matrix(16, AMBICHANNELS+1, 0.25);
+  ambix_info_t info;
+  ambix_t*ambix=NULL;
+  ambix_marker_t*marker;
+  long size, editedsize;
+  int i;
+  STARTTEST("\n");
+
+  write_file(path, matrix, ambidata, otherdata);
+  size=filesize(path);
+
+  /* opening and closing without changes leaves the file alone */
+  memset(&info, 0, sizeof(info));
+  ambix=ambix_open(path, AMBIX_RDRW, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for read/write", path);
+  fail_if((AMBIX_EXTENDED!=info.fileformat), __LINE__, "RDRW file has format %d", info.fileformat);
+  fail_if((3!=ambix_get_num_markers(ambix)), __LINE__, "RDRW file has %d markers", ambix_get_num_markers(ambix));
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+  fail_if((size!=filesize(path)), __LINE__, "unmodified file changed its size from %ld to %ld", size, filesize(path));
+
+  /* edit the markers, regions and adaptor matrix */
+  memset(&info, 0, sizeof(info));
+  ambix=ambix_open(path, AMBIX_RDRW, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for read/write", path);
+  /* samples can be read, but not written */
+  fail_if((ambix_readf_float32(ambix, buffer, buffer+FRAMES*AMBICHANNELS, 16)!=16), __LINE__, "couldn't read from RDRW file");
+  fail_if((ambix_writef_float32(ambix, ambidata, otherdata, 16)>=0), __LINE__, "could write samples to RDRW file");
+  fail_if((AMBIX_ERR_SUCCESS==ambix_set_adaptormatrix(ambix, badmatrix)), __LINE__, "could set matrix with wrong number of channels");
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_set_adaptormatrix(ambix, matrix2)), __LINE__, "couldn't replace adaptor matrix");
+  add_marker(ambix, 4., "a new marker");
+  marker=ambix_get_marker(ambix, 0);
+  fail_if((NULL==marker), __LINE__, "couldn't get marker #0");
+  strncpy(marker->name, "a renamed marker", sizeof(marker->name)-1);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_delete_regions(ambix)), __LINE__, "couldn't delete regions");
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+  memset(&info, 0, sizeof(info));
+  ambix=ambix_open(path, AMBIX_READ, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path);
+  fail_if((4!=ambix_get_num_markers(ambix)), __LINE__, "edited file has %d markers", ambix_get_num_markers(ambix));
+  fail_if((0!=ambix_get_num_regions(ambix)), __LINE__, "edited file has %d regions", ambix_get_num_regions(ambix));
+  marker=ambix_get_marker(ambix, 0);
+  fail_if((NULL==marker || strcmp(marker->name, "a renamed marker")), __LINE__, "marker #0 was not renamed");
+  marker=ambix_get_marker(ambix, 3);
+  fail_if((NULL==marker || strcmp(marker->name, "a new marker") || 4.!=marker->position), __LINE__, "marker #3 was not added");
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+  check_data(path, matrix2, ambidata, otherdata);
+
+  /* repeated edits of the same size reuse the space in the file */
+  editedsize=filesize(path);
+  for(i=0; i<8; i++) {
+    memset(&info, 0, sizeof(info));
+    ambix=ambix_open(path, AMBIX_RDRW, &info);
+    fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for read/write", path);
+    fail_if((AMBIX_ERR_SUCCESS!=ambix_set_adaptormatrix(ambix, (i%2)?matrix2:matrix)), __LINE__, "couldn't replace adaptor matrix");
+    marker=ambix_get_marker(ambix, 1);
+    fail_if((NULL==marker), __LINE__, "couldn't get marker #1");
+    marker->position=100.+i;
+    fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+  }
+  fail_if((editedsize!=filesize(path)), __LINE__, "repeated edits grew file from %ld to %ld", editedsize, filesize(path));
+  check_data(path, matrix2, ambidata, otherdata);
+
+  /* deleting all markers */
+  memset(&info, 0, sizeof(info));
+  ambix=ambix_open(path, AMBIX_RDRW, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for read/write", path);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_delete_markers(ambix)), __LINE__, "couldn't delete markers");
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+  memset(&info, 0, sizeof(info));
+  ambix=ambix_open(path, AMBIX_READ, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path);
+  fail_if((0!=ambix_get_num_markers(ambix)), __LINE__, "file still has %d markers", ambix_get_num_markers(ambix));
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+  check_data(path, matrix2, ambidata, otherdata);
+
+  ambixtest_rmfile(path);
+  ambix_matrix_destroy(matrix);
+  ambix_matrix_destroy(matrix2);
+  ambix_matrix_destroy(badmatrix);
+  free(ambidata);
+  free(otherdata);
+  free(buffer);
+  STOPTEST("\n");
+}
+
+/* files written by others might not have the size of the 'data' chunk set */
+static void check_opendata(const char*path) {
+  float32_t*ambidata=(float32_t*)data_sine(FLOAT32, FRAMES, AMBICHANNELS, 100);
+  float32_t*otherdata=(float32_t*)data_ramp(FLOAT32, FRAMES, EXTRACHANNELS);
+  ambix_matrix_t*matrix=make_matrix(16, AMBICHANNELS, 0.5);
+  const unsigned char unknown[8]={0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+  unsigned char header[12];
+  ambix_info_t info;
+  ambix_t*ambix=NULL;
+  FILE*file=NULL;
+  long offset=8;
+  STARTTEST("\n");
+
+  write_file(path, matrix, ambidata, otherdata);
+  /* all chunks were written before the 'data' chunk: pretend that its size is unknown */
+  file=fopen(path, "r+b");
+  fail_if((NULL==file), __LINE__, "couldn't open '%s'", path);
+  while(!fseek(file, offset, SEEK_SET) && 12==fread(header, 1, 12, file)) {
+    long size=0;
+    int i;
+    for(i=0; i<8; i++)
+      size=(size<<8) | header[4+i];
+    if(!memcmp(header, "data", 4)) {
+      fseek(file, offset+4, SEEK_SET);
+      fwrite(unknown, 1, sizeof(unknown), file);
+      break;
+    }
+    offset+=12+size;
+  }
+  fclose(file);
+
+  memset(&info, 0, sizeof(info));
+  ambix=ambix_open(path, AMBIX_RDRW, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for read/write", path);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_delete_markers(ambix)), __LINE__, "couldn't delete markers");
+  add_marker(ambix, 5., "a marker with a much longer name, that won't fit into the old chunk");
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+  /* the markers have been appended after the (now properly terminated) 'data' chunk */
+  memset(&info, 0, sizeof(info));
+  ambix=ambix_open(path, AMBIX_READ, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path);
+  fail_if((1!=ambix_get_num_markers(ambix)), __LINE__, "file has %d markers", ambix_get_num_markers(ambix));
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+  check_data(path, matrix, ambidata, otherdata);
+
+  ambixtest_rmfile(path);
+  ambix_matrix_destroy(matrix);
+  free(ambidata);
+  free(otherdata);
+  STOPTEST("\n");
+}
+
+/* a BASIC file becomes EXTENDED when it is given an adaptor matrix */
+static void check_basic(const char*path) {
+  const uint32_t channels=4;
+  float32_t*ambidata=(float32_t*)data_sine(FLOAT32, FRAMES, channels, 100);
+  float32_t*ambiresult=(float32_t*)data_calloc(FLOAT32, FRAMES*channels);
+  ambix_matrix_t*matrix=make_matrix(AMBICHANNELS, channels, 0.5);
+  ambix_info_t info;
+  ambix_t*ambix=NULL;
+  float32_t diff;
+  int64_t err64;
+  STARTTEST("\n");
+
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_BASIC;
+  info.ambichannels=channels;
+  info.samplerate=48000;
+  info.sampleformat=AMBIX_SAMPLEFORMAT_FLOAT32;
+  ambix=ambix_open(path, AMBIX_WRITE, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't create ambix file '%s' for writing", path);
+  err64=ambix_writef_float32(ambix, ambidata, NULL, FRAMES);
+  fail_if((err64!=FRAMES), __LINE__, "wrote only %d frames of %d", (int)err64, (int)FRAMES);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+  memset(&info, 0, sizeof(info));
+  ambix=ambix_open(path, AMBIX_RDRW, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for read/write", path);
+  fail_if((AMBIX_BASIC!=info.fileformat), __LINE__, "RDRW file has format %d", info.fileformat);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_set_adaptormatrix(ambix, matrix)), __LINE__, "couldn't give BASIC file an adaptor matrix");
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_EXTENDED;
+  ambix=ambix_open(path, AMBIX_READ, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path);
+  fail_if((AMBIX_EXTENDED!=info.fileformat), __LINE__, "edited file has format %d", info.fileformat);
+  fail_if((channels!=info.ambichannels), __LINE__, "edited file has %d ambichannels", info.ambichannels);
+  diff=matrix_diff(__LINE__, ambix_get_adaptormatrix(ambix), matrix, 1e-7);
+  fail_if((diff>1e-7), __LINE__, "adaptor matrix differs by %g", diff);
+  err64=ambix_readf_float32(ambix, ambiresult, NULL, FRAMES);
+  fail_if((err64!=FRAMES), __LINE__, "read only %d frames of %d", (int)err64, (int)FRAMES);
+  diff=data_diff(__LINE__, FLOAT32, ambidata, ambiresult, FRAMES*channels, 0.);
+  fail_if((diff>0.), __LINE__, "ambisonics data differs by %g", diff);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+  /* presented as BASIC, the file is now expanded to the full set */
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_BASIC;
+  ambix=ambix_open(path, AMBIX_READ, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path);
+  fail_if((AMBICHANNELS!=info.ambichannels), __LINE__, "edited file expands to %d ambichannels", info.ambichannels);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+  ambixtest_rmfile(path);
+  ambix_matrix_destroy(matrix);
+  free(ambidata);
+  free(ambiresult);
+  STOPTEST("\n");
+}
+
+static void check_invalid(const char*path) {
+  float32_t*ambidata=(float32_t*)data_sine(FLOAT32, FRAMES, AMBICHANNELS, 100);
+  float32_t*otherdata=(float32_t*)data_ramp(FLOAT32, FRAMES, EXTRACHANNELS);
+  ambix_matrix_t*matrix=make_matrix(16, AMBICHANNELS, 0.5);
+  ambix_info_t info;
+  STARTTEST("\n");
+  ambixtest_rmfile(path);
+  memset(&info, 0, sizeof(info));
+  fail_if((NULL!=ambix_open(path, AMBIX_RDRW, &info)), __LINE__, "opened non-existing file '%s' for read/write", path);
+
+  write_file(path, matrix, ambidata, otherdata);
+  memset(&info, 0, sizeof(info));
+  fail_if((NULL!=ambix_open(path, AMBIX_RDRW|AMBIX_PREFETCH, &info)), __LINE__, "opened file for read/write with prefetching");
+  memset(&info, 0, sizeof(info));
+  fail_if((NULL!=ambix_open(path, AMBIX_RDRW|AMBIX_WRITEBEHIND, &info)), __LINE__, "opened file for read/write with write-behind");
+
+  ambixtest_rmfile(path);
+  ambix_matrix_destroy(matrix);
+  free(ambidata);
+  free(otherdata);
+  STOPTEST("\n");
+}
+
+int main(int argc, char**argv) {
+  const char*path=FILENAME_MAIN;
+  check_edit(path);
+  check_opendata(path);
+  check_basic(path);
+  check_invalid(path);
+  return pass();
+}
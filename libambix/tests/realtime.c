@@ -0,0 +1,373 @@
+/* realtime - test that reading/writing in AMBIX_REALTIME mode does not allocate memory
+
+   Copyright © 2026 IOhannes m zmölnig <zmoelnig@iem.at>.
+         Institute of Electronic Music and Acoustics (IEM),
+         University of Music and Dramatic Arts, Graz
+
+   This file is part of libambix
+
+   libambix is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   libambix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "common.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define FRAMES (16*256)
+#define BLOCKSIZE 256
+#define AMBICHANNELS 9
+#define FULLCHANNELS 16
+#define EXTRACHANNELS 2
+
+/* count the allocations done by the test thread (while 'armed'),
+ * by wrapping the allocator of the C library */
+#if defined __GLIBC__ && !defined __SANITIZE_ADDRESS__
+# define HAVE_MALLOC_COUNTER 1
+extern void*__libc_malloc(size_t size);
+extern void*__libc_calloc(size_t nmemb, size_t size);
+extern void*__libc_realloc(void*ptr, size_t size);
+extern void __libc_free(void*ptr);
+
+static __thread int armed=0;
+static __thread unsigned long allocations=0;
+
+void*malloc(size_t size) {
+  if(armed)allocations++;
+  return __libc_malloc(size);
+}
+void*calloc(size_t nmemb, size_t size) {
+  if(armed)allocations++;
+  return __libc_calloc(nmemb, size);
+}
+void*realloc(void*ptr, size_t size) {
+  if(armed)allocations++;
+  return __libc_realloc(ptr, size);
+}
+void free(void*ptr) {
+  __libc_free(ptr);
+}
+#endif
+
+static void arm(void) {
+#ifdef HAVE_MALLOC_COUNTER
+  allocations=0;
+  armed=1;
+#endif
+}
+static unsigned long disarm(void) {
+#ifdef HAVE_MALLOC_COUNTER
+  armed=0;
+  return allocations;
+#else
+  return 0;
+#endif
+}
+
+static ambix_matrix_t*make_matrix(void) {
+  ambix_matrix_t*matrix=ambix_matrix_init(FULLCHANNELS, AMBICHANNELS, NULL);
+  uint32_t r, c;
+  for(r=0; r<matrix->rows; r++)
+    for(c=0; c<matrix->cols; c++)
+      matrix->data[r][c]=(float32_t)(((r*matrix->cols+c)*7919)%101)/101. - 0.5;
+  return matrix;
+}
+
+static ambix_t*open_write(const char*path, ambix_filemode_t mode) {
+  ambix_matrix_t*matrix=make_matrix();
+  ambix_info_t info;
+  ambix_t*ambix=NULL;
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_EXTENDED;
+  info.ambichannels=AMBICHANNELS;
+  info.extrachannels=EXTRACHANNELS;
+  info.samplerate=48000;
+  info.sampleformat=AMBIX_SAMPLEFORMAT_PCM24;
+  ambix=ambix_open(path, AMBIX_WRITE|mode, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't create ambix file '%s' for writing", path);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_set_adaptormatrix(ambix, matrix)), __LINE__, "failed setting adaptor matrix");
+  ambix_matrix_destroy(matrix);
+  return ambix;
+}
+static ambix_t*open_read(const char*path, ambix_filemode_t mode) {
+  ambix_info_t info;
+  ambix_t*ambix=NULL;
+  memset(&info, 0, sizeof(info));
+  /* present the data as a full set, so the matrix is applied */
+  info.fileformat=AMBIX_BASIC;
+  ambix=ambix_open(path, AMBIX_READ|mode, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path);
+  fail_if((FULLCHANNELS!=info.ambichannels), __LINE__, "got %d ambichannels (expected %d)", info.ambichannels, FULLCHANNELS);
+  return ambix;
+}
+
+static void check_hook(const char*path) {
+  float32_t*ambidata=(float32_t*)data_calloc(FLOAT32, FRAMES*FULLCHANNELS);
+  float32_t*otherdata=(float32_t*)data_calloc(FLOAT32, FRAMES*EXTRACHANNELS);
+  ambix_t*ambix=NULL;
+  unsigned long count;
+  int64_t err64;
+  STARTTEST("\n");
+#ifndef HAVE_MALLOC_COUNTER
+  skip_if(1, __LINE__, "cannot count allocations on this platform");
+#endif
+  ambix=open_write(path, 0);
+  err64=ambix_writef_float32(ambix, ambidata, otherdata, FRAMES);
+  fail_if((FRAMES!=err64), __LINE__, "wrote %d frames of %d", (int)err64, FRAMES);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+  /* without preallocation, the first large block grows the buffers */
+  ambix=open_read(path, 0);
+  arm();
+  err64=ambix_readf_float32(ambix, ambidata, otherdata, FRAMES);
+  count=disarm();
+  fail_if((FRAMES!=err64), __LINE__, "read %d frames of %d", (int)err64, FRAMES);
+  fail_if((0==count), __LINE__, "allocations are not counted");
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+  free(ambidata);
+  free(otherdata);
+  STOPTEST("\n");
+}
+
+static void check_write(const char*path) {
+  float32_t*ambidata=(float32_t*)data_sine(FLOAT32, FRAMES, AMBICHANNELS, 10);
+  float32_t*otherdata=(float32_t*)data_ramp(FLOAT32, FRAMES, EXTRACHANNELS);
+  int16_t*ambidata16=(int16_t*)data_calloc(INT16, BLOCKSIZE*AMBICHANNELS);
+  int16_t*otherdata16=(int16_t*)data_calloc(INT16, BLOCKSIZE*EXTRACHANNELS);
+  float32_t*ambiplanar[AMBICHANNELS], *otherplanar[EXTRACHANNELS];
+  ambix_marker_t marker;
+  ambix_t*ambix=NULL;
+  unsigned long count;
+  int64_t err64=0, done;
+  uint32_t c;
+  STARTTEST("\n");
+  for(c=0; c<AMBICHANNELS; c++)
+    ambiplanar[c]=ambidata+c*BLOCKSIZE;
+  for(c=0; c<EXTRACHANNELS; c++)
+    otherplanar[c]=otherdata+c*BLOCKSIZE;
+
+  ambix=open_write(path, AMBIX_REALTIME);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_set_max_blocksize(ambix, BLOCKSIZE)), __LINE__, "couldn't set blocksize");
+  /* the header has been written */
+  memset(&marker, 0, sizeof(marker));
+  fail_if((AMBIX_ERR_SUCCESS==ambix_add_marker(ambix, &marker)), __LINE__, "added marker after setting blocksize");
+  fail_if((AMBIX_ERR_SUCCESS==ambix_set_threads(ambix, 4)), __LINE__, "used threads in realtime mode");
+
+  arm();
+  for(done=0; done<FRAMES-4*BLOCKSIZE; done+=BLOCKSIZE) {
+    err64=ambix_writef_float32(ambix, ambidata+done*AMBICHANNELS, otherdata+done*EXTRACHANNELS, BLOCKSIZE);
+    if(BLOCKSIZE!=err64)
+      break;
+  }
+  if(BLOCKSIZE==err64)
+    err64=ambix_writef_int16(ambix, ambidata16, otherdata16, BLOCKSIZE);
+  if(BLOCKSIZE==err64)
+    err64=ambix_writef_float32_planar(ambix, ambiplanar, otherplanar, BLOCKSIZE);
+  count=disarm();
+  fail_if((BLOCKSIZE!=err64), __LINE__, "wrote %d frames of %d", (int)err64, BLOCKSIZE);
+  fail_if((count), __LINE__, "writing allocated memory %lu times", count);
+
+  /* larger blocks are written in several passes */
+  arm();
+  err64=ambix_writef_float32(ambix, ambidata, otherdata, 2*BLOCKSIZE);
+  count=disarm();
+  fail_if((2*BLOCKSIZE!=err64), __LINE__, "writing a large block returned %d", (int)err64);
+  fail_if((count), __LINE__, "writing a large block allocated memory %lu times", count);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+  free(ambidata);
+  free(otherdata);
+  free(ambidata16);
+  free(otherdata16);
+  STOPTEST("\n");
+}
+
+static void check_read(const char*path) {
+  float32_t*ambidata=(float32_t*)data_calloc(FLOAT32, BLOCKSIZE*FULLCHANNELS);
+  float32_t*otherdata=(float32_t*)data_calloc(FLOAT32, BLOCKSIZE*EXTRACHANNELS);
+  float64_t*ambidata64=(float64_t*)data_calloc(FLOAT64, BLOCKSIZE*FULLCHANNELS);
+  float64_t*otherdata64=(float64_t*)data_calloc(FLOAT64, BLOCKSIZE*EXTRACHANNELS);
+  float32_t*largeambidata=(float32_t*)data_calloc(FLOAT32, 2*BLOCKSIZE*FULLCHANNELS);
+  float32_t*largeotherdata=(float32_t*)data_calloc(FLOAT32, 2*BLOCKSIZE*EXTRACHANNELS);
+  float32_t*ambiplanar[FULLCHANNELS], *otherplanar[EXTRACHANNELS];
+  ambix_t*ambix=NULL;
+  unsigned long count;
+  int64_t err64=0, done=0;
+  uint32_t c;
+  STARTTEST("\n");
+  for(c=0; c<FULLCHANNELS; c++)
+    ambiplanar[c]=ambidata+c*BLOCKSIZE;
+  for(c=0; c<EXTRACHANNELS; c++)
+    otherplanar[c]=otherdata+c*BLOCKSIZE;
+
+  ambix=open_read(path, AMBIX_REALTIME);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_set_max_blocksize(ambix, BLOCKSIZE)), __LINE__, "couldn't set blocksize");
+  arm();
+  while(done<FRAMES) {
+    switch((done/BLOCKSIZE)%3) {
+    case 0:
+      err64=ambix_readf_float32(ambix, ambidata, otherdata, BLOCKSIZE);
+      break;
+    case 1:
+      err64=ambix_readf_float64(ambix, ambidata64, otherdata64, BLOCKSIZE);
+      break;
+    default:
+      err64=ambix_readf_float32_planar(ambix, ambiplanar, otherplanar, BLOCKSIZE);
+    }
+    if(BLOCKSIZE!=err64)
+      break;
+    done+=err64;
+  }
+  count=disarm();
+  fail_if((FRAMES!=done), __LINE__, "read %d frames of %d", (int)done, FRAMES);
+  fail_if((count), __LINE__, "reading allocated memory %lu times", count);
+
+  fail_if((0!=ambix_seek(ambix, 0, SEEK_SET)), __LINE__, "couldn't rewind");
+  arm();
+  err64=ambix_readf_float32(ambix, largeambidata, largeotherdata, 2*BLOCKSIZE);
+  count=disarm();
+  fail_if((2*BLOCKSIZE!=err64), __LINE__, "reading a large block returned %d", (int)err64);
+  fail_if((count), __LINE__, "reading a large block allocated memory %lu times", count);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+  free(ambidata);
+  free(otherdata);
+  free(ambidata64);
+  free(otherdata64);
+  free(largeambidata);
+  free(largeotherdata);
+  STOPTEST("\n");
+}
+
+static void check_prefetch(const char*path) {
+  float32_t*ambidata=(float32_t*)data_calloc(FLOAT32, BLOCKSIZE*FULLCHANNELS);
+  float32_t*otherdata=(float32_t*)data_calloc(FLOAT32, BLOCKSIZE*EXTRACHANNELS);
+  ambix_t*ambix=NULL;
+  unsigned long count=0;
+  int64_t done=0, available=0;
+  int retries=1000;
+  STARTTEST("\n");
+
+  ambix=open_read(path, AMBIX_REALTIME|AMBIX_PREFETCH);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_set_max_blocksize(ambix, BLOCKSIZE)), __LINE__, "couldn't set blocksize");
+  while(done<FRAMES && retries--) {
+    int64_t err64;
+    arm();
+    err64=ambix_readf_float32(ambix, ambidata, otherdata, BLOCKSIZE);
+    count+=disarm();
+    fail_if((err64<0), __LINE__, "reading failed with %d", (int)err64);
+    done+=err64;
+    /* the background thread might not have caught up yet */
+    if(err64<BLOCKSIZE)
+      usleep(1000);
+  }
+  fail_if((FRAMES!=done), __LINE__, "read %d frames of %d", (int)done, FRAMES);
+  fail_if((count), __LINE__, "reading allocated memory %lu times", count);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_get_prefetch(ambix, &available, NULL, NULL) || available), __LINE__, "%d frames left", (int)available);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+  free(ambidata);
+  free(otherdata);
+  STOPTEST("\n");
+}
+
+static void check_writebehind(const char*path) {
+  float32_t*ambidata=(float32_t*)data_sine(FLOAT32, BLOCKSIZE, AMBICHANNELS, 10);
+  float32_t*otherdata=(float32_t*)data_ramp(FLOAT32, BLOCKSIZE, EXTRACHANNELS);
+  int16_t*ambidata16=(int16_t*)data_calloc(INT16, BLOCKSIZE*AMBICHANNELS);
+  ambix_t*ambix=NULL;
+  unsigned long count;
+  int64_t err64=0, done;
+  STARTTEST("\n");
+
+  ambix=open_write(path, AMBIX_REALTIME|AMBIX_WRITEBEHIND);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_set_max_blocksize(ambix, BLOCKSIZE)), __LINE__, "couldn't set blocksize");
+  fail_if((AMBIX_ERR_SUCCESS==ambix_set_backpressure(ambix, AMBIX_BACKPRESSURE_BLOCK)), __LINE__, "allowed blocking in realtime mode");
+  arm();
+  for(done=0; done<FRAMES; done+=BLOCKSIZE) {
+    err64=ambix_writef_float32(ambix, ambidata, otherdata, BLOCKSIZE);
+    if(BLOCKSIZE!=err64)
+      break;
+  }
+  count=disarm();
+  fail_if((BLOCKSIZE!=err64), __LINE__, "wrote %d frames of %d", (int)err64, BLOCKSIZE);
+  fail_if((count), __LINE__, "writing allocated memory %lu times", count);
+  /* switching the sample type would mean waiting for the queue */
+  if(AMBIX_ERR_SUCCESS==ambix_get_writebehind(ambix, NULL, NULL, NULL, NULL))
+    fail_if((ambix_writef_int16(ambix, ambidata16, NULL, BLOCKSIZE)>=0), __LINE__, "switched sample type in realtime mode");
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+  free(ambidata);
+  free(otherdata);
+  free(ambidata16);
+  STOPTEST("\n");
+}
+
+static void check_keyframes(const char*path) {
+  float32_t*ambidata=(float32_t*)data_sine(FLOAT32, FRAMES, AMBICHANNELS, 10);
+  float32_t*otherdata=(float32_t*)data_ramp(FLOAT32, FRAMES, EXTRACHANNELS);
+  ambix_matrix_t*matrix=make_matrix();
+  ambix_matrix_t*silence=ambix_matrix_init(FULLCHANNELS, AMBICHANNELS, NULL);
+  ambix_matrix_t*identity=ambix_matrix_init(FULLCHANNELS, FULLCHANNELS, NULL);
+  ambix_t*ambix=NULL;
+  unsigned long count;
+  int64_t err64=0, done;
+  int pass;
+  STARTTEST("\n");
+
+  ambix=open_write(path, 0);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_add_keyframe(ambix, 0, matrix)), __LINE__, "couldn't add keyframe");
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_add_keyframe(ambix, FRAMES/2, silence)), __LINE__, "couldn't add keyframe");
+  err64=ambix_writef_float32(ambix, ambidata, otherdata, FRAMES);
+  fail_if((FRAMES!=err64), __LINE__, "wrote %d frames of %d", (int)err64, FRAMES);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+  /* once as stored in the file, once pre-multiplied with another matrix */
+  for(pass=0; pass<2; pass++) {
+    ambix=open_read(path, AMBIX_REALTIME);
+    fail_if((2!=ambix_get_num_keyframes(ambix)), __LINE__, "got %d keyframes", (int)ambix_get_num_keyframes(ambix));
+    if(pass)
+      fail_if((AMBIX_ERR_SUCCESS!=ambix_set_adaptormatrix(ambix, ambix_matrix_fill(identity, AMBIX_MATRIX_IDENTITY))), __LINE__, "failed setting adaptor matrix");
+    fail_if((AMBIX_ERR_SUCCESS!=ambix_set_max_blocksize(ambix, BLOCKSIZE)), __LINE__, "couldn't set blocksize");
+    arm();
+    for(done=0; done<FRAMES; done+=err64) {
+      err64=ambix_readf_float32(ambix, ambidata, otherdata, BLOCKSIZE);
+      if(err64<=0)
+        break;
+    }
+    count=disarm();
+    fail_if((FRAMES!=done), __LINE__, "read %d frames of %d", (int)done, FRAMES);
+    fail_if((count), __LINE__, "reading keyframes allocated memory %lu times", count);
+    fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+  }
+
+  ambix_matrix_destroy(matrix);
+  ambix_matrix_destroy(silence);
+  ambix_matrix_destroy(identity);
+  free(ambidata);
+  free(otherdata);
+  STOPTEST("\n");
+}
+
+int main(int argc, char**argv) {
+  const char*path=FILENAME_MAIN;
+  check_hook(path);
+  check_write(path);
+  check_read(path);
+  check_prefetch(path);
+  check_writebehind(path);
+  check_keyframes(path);
+  ambixtest_rmfile(path);
+  return pass();
+}
@@ -0,0 +1,227 @@
+/* sampleformats - test conversion from/to all sample formats
+
+   Copyright © 2026 IOhannes m zmölnig <zmoelnig@iem.at>.
+         Institute of Electronic Music and Acoustics (IEM),
+         University of Music and Dramatic Arts, Graz
+
+   This file is part of libambix
+
+   libambix is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   libambix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "common.h"
+#include <string.h>
+
+/* write (BASIC) data in the given sampleformat and read it back */
+static void check_roundtrip(const char*path, ambixtest_presentationformat_t fmt, ambix_sampleformat_t format, float32_t eps) {
+  const uint32_t channels=4;
+  /* more than the backend converts at once */
+  const int64_t frames=10000+17;
+  ambix_info_t info;
+  ambix_t*ambix=NULL;
+  int64_t err64;
+  float32_t errf;
+  void*data=data_ramp(fmt, frames, channels);
+  void*resultdata=data_calloc(fmt, frames*channels);
+  STARTTEST("format=%d, datafmt=%d\n", format, fmt);
+
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_BASIC;
+  info.ambichannels=channels;
+  info.samplerate=48000;
+  info.sampleformat=format;
+  ambix=ambix_open(path, AMBIX_WRITE, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't create ambix file '%s' for writing", path);
+  err64=ambixtest_writef(ambix, fmt, data, 0, NULL, 0, frames);
+  fail_if((err64!=frames), __LINE__, "wrote only %d frames of %d", (int)err64, (int)frames);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+  memset(&info, 0, sizeof(info));
+  ambix=ambix_open(path, AMBIX_READ, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path);
+  fail_if((info.sampleformat!=format), __LINE__, "got sampleformat %d (expected %d)", info.sampleformat, format);
+  fail_if((info.frames!=frames), __LINE__, "got %d frames (expected %d)", (int)info.frames, (int)frames);
+  fail_if((info.samplerate!=48000), __LINE__, "got samplerate %g", info.samplerate);
+  fail_if((info.ambichannels!=channels), __LINE__, "got %d channels", info.ambichannels);
+  err64=ambixtest_readf(ambix, fmt, resultdata, 0, NULL, 0, frames);
+  fail_if((err64!=frames), __LINE__, "read only %d frames of %d", (int)err64, (int)frames);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+  errf=data_diff(__LINE__, fmt, data, resultdata, frames*channels, eps);
+  fail_if((errf>eps), __LINE__, "diffing data returned %g (>%g)", errf, eps);
+
+  free(data);
+  free(resultdata);
+  ambixtest_rmfile(path);
+  STOPTEST("format=%d, datafmt=%d\n", format, fmt);
+}
+
+static void write_be32(unsigned char*data, uint32_t v) {
+  data[0]=(unsigned char)(v>>24);
+  data[1]=(unsigned char)(v>>16);
+  data[2]=(unsigned char)(v>> 8);
+  data[3]=(unsigned char)(v    );
+}
+/* read a (hand-crafted) big-endian 24bit file */
+static void check_bigendian24(const char*path) {
+  static const int32_t samples[]={0x123456, -0x123456, 0x7FFFFF, -0x800000, 1, -1};
+  const uint32_t channels=2, frames=3;
+  unsigned char header[8+12+32+12+4];
+  unsigned char data[3*sizeof(samples)/sizeof(*samples)];
+  const double samplerate=44100.;
+  uint64_t rate;
+  int32_t idata[sizeof(samples)/sizeof(*samples)];
+  float32_t fdata[sizeof(samples)/sizeof(*samples)];
+  ambix_info_t info;
+  ambix_t*ambix=NULL;
+  FILE*f;
+  uint32_t i;
+  STARTTEST("\n");
+
+  memset(header, 0, sizeof(header));
+  memcpy(header, "caff\0\1\0\0", 8);
+  memcpy(header+8, "desc", 4);
+  write_be32(header+16, 32);
+  memcpy(&rate, &samplerate, sizeof(rate));
+  write_be32(header+20, (uint32_t)(rate>>32));
+  write_be32(header+24, (uint32_t)rate);
+  memcpy(header+28, "lpcm", 4);
+  write_be32(header+32, 0); /* integer, big-endian */
+  write_be32(header+36, 3*channels);
+  write_be32(header+40, 1);
+  write_be32(header+44, channels);
+  write_be32(header+48, 24);
+  memcpy(header+52, "data", 4);
+  write_be32(header+56, 0xFFFFFFFF); /* unknown size */
+  write_be32(header+60, 0xFFFFFFFF);
+  for(i=0; i<frames*channels; i++) {
+    const uint32_t v=(uint32_t)samples[i];
+    data[3*i+0]=(unsigned char)(v>>16);
+    data[3*i+1]=(unsigned char)(v>> 8);
+    data[3*i+2]=(unsigned char)(v    );
+  }
+  f=fopen(path, "wb");
+  fail_if((NULL==f), __LINE__, "couldn't create '%s'", path);
+  fwrite(header, 1, sizeof(header), f);
+  fwrite(data, 1, sizeof(data), f);
+  fclose(f);
+
+  memset(&info, 0, sizeof(info));
+  ambix=ambix_open(path, AMBIX_READ, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path);
+  fail_if((info.sampleformat!=AMBIX_SAMPLEFORMAT_PCM24), __LINE__, "got sampleformat %d", info.sampleformat);
+  fail_if((info.frames!=frames), __LINE__, "got %d frames (expected %d)", (int)info.frames, (int)frames);
+  fail_if((ambix_readf_int32(ambix, NULL, idata, frames)!=frames), __LINE__, "couldn't read int32 data");
+  for(i=0; i<frames*channels; i++)
+    fail_if((idata[i]!=samples[i]*256), __LINE__, "sample[%d]=%d (expected %d)", i, idata[i], samples[i]*256);
+
+  fail_if((ambix_seek(ambix, 0, SEEK_SET)!=0), __LINE__, "couldn't rewind");
+  fail_if((ambix_readf_float32(ambix, NULL, fdata, frames)!=frames), __LINE__, "couldn't read float32 data");
+  for(i=0; i<frames*channels; i++)
+    fail_if((fdata[i]!=(float32_t)(samples[i]/8388608.)), __LINE__, "sample[%d]=%g (expected %g)", i, fdata[i], samples[i]/8388608.);
+  fail_if((ambix_readf_float32(ambix, NULL, fdata, frames)!=0), __LINE__, "read beyond end of file");
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+  ambixtest_rmfile(path);
+  STOPTEST("\n");
+}
+
+/* hand-crafted files with broken 'desc' resp. 'data' chunks */
+static void check_malformed(const char*path) {
+  const struct {
+    uint32_t bytesperpacket, channels, bits;
+    uint32_t datasize_hi, datasize_lo;
+    int64_t frames;
+  } files[]={
+    /* 0x40000000 channels of 32bit: the frame size overflows to 0 */
+    {0, 0x40000000, 32, 0, 4+16, -1},
+    {0, 2, 16, 0, 4+16, -1},
+    /* too many channels (the frame size would be fine) */
+    {0x80000000, 0x20000000, 32, 0, 4+16, -1},
+    {4*1025, 1025, 32, 0, 4+16, -1},
+    {4*1024, 1024, 32, 0, 4+16, 0},
+    /* a 'data' chunk that extends way beyond the end of the file */
+    {4, 2, 16, 0x7FFFFFFF, 0xFFFFFFF0, 4},
+  };
+  unsigned char header[8+12+32+12+4];
+  unsigned char data[16];
+  const double samplerate=44100.;
+  uint64_t rate;
+  unsigned int i;
+  STARTTEST("\n");
+  memset(data, 0, sizeof(data));
+  for(i=0; i<sizeof(files)/sizeof(*files); i++) {
+    ambix_info_t info;
+    ambix_t*ambix=NULL;
+    FILE*f;
+    memset(header, 0, sizeof(header));
+    memcpy(header, "caff\0\1\0\0", 8);
+    memcpy(header+8, "desc", 4);
+    write_be32(header+16, 32);
+    memcpy(&rate, &samplerate, sizeof(rate));
+    write_be32(header+20, (uint32_t)(rate>>32));
+    write_be32(header+24, (uint32_t)rate);
+    memcpy(header+28, "lpcm", 4);
+    write_be32(header+32, 0); /* integer, big-endian */
+    write_be32(header+36, files[i].bytesperpacket);
+    write_be32(header+40, 1);
+    write_be32(header+44, files[i].channels);
+    write_be32(header+48, files[i].bits);
+    memcpy(header+52, "data", 4);
+    write_be32(header+56, files[i].datasize_hi);
+    write_be32(header+60, files[i].datasize_lo);
+    f=fopen(path, "wb");
+    fail_if((NULL==f), __LINE__, "couldn't create '%s'", path);
+    fwrite(header, 1, sizeof(header), f);
+    fwrite(data, 1, sizeof(data), f);
+    fclose(f);
+
+    memset(&info, 0, sizeof(info));
+    ambix=ambix_open(path, AMBIX_READ, &info);
+    if(files[i].frames<0) {
+      fail_if((NULL!=ambix), __LINE__, "opened malformed file #%d", i);
+    } else {
+      fail_if((NULL==ambix), __LINE__, "couldn't open file #%d", i);
+      fail_if((info.frames!=files[i].frames), __LINE__, "file #%d has %d frames (expected %d)", i, (int)info.frames, (int)files[i].frames);
+      fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+    }
+  }
+  ambixtest_rmfile(path);
+  STOPTEST("\n");
+}
+
+int main(int argc, char**argv) {
+  const char*path=FILENAME_MAIN;
+  const ambix_sampleformat_t formats[]={
+    AMBIX_SAMPLEFORMAT_PCM16,
+    AMBIX_SAMPLEFORMAT_PCM24,
+    AMBIX_SAMPLEFORMAT_PCM32,
+    AMBIX_SAMPLEFORMAT_FLOAT32,
+    AMBIX_SAMPLEFORMAT_FLOAT64,
+  };
+  unsigned int i;
+  for(i=0; i<sizeof(formats)/sizeof(*formats); i++) {
+    /* 16bit files can only hold 16bit data */
+    const float32_t eps16=2./32768.;
+    const float32_t eps=(AMBIX_SAMPLEFORMAT_PCM16==formats[i])?eps16:1e-6;
+    check_roundtrip(path, INT16, formats[i], 2./65535.);
+    check_roundtrip(path, INT32, formats[i], eps);
+    check_roundtrip(path, FLOAT32, formats[i], eps);
+    check_roundtrip(path, FLOAT64, formats[i], eps);
+  }
+  check_bigendian24(path);
+  check_malformed(path);
+
+  return pass();
+}
@@ -0,0 +1,164 @@
+#include "common.h"
+
+/* libambix's private header */
+#include "private.h"
+
+#include <math.h>
+#include <string.h>
+
+static float32_t frand(void) {
+  return ((float32_t)rand())/((float32_t)RAND_MAX) * 2.f - 1.f;
+}
+
+static float32_t kernel_diff(const float32_t*A, const float32_t*B, uint32_t stride, uint32_t rows, int64_t frames) {
+  float32_t maxdiff=0.;
+  int64_t f;
+  uint32_t r;
+  for(f=0; f<frames; f++) {
+    for(r=0; r<rows; r++) {
+      float32_t d=fabsf(A[f*stride+r]-B[f*stride+r]);
+      if(d>maxdiff)maxdiff=d;
+    }
+  }
+  return maxdiff;
+}
+
+static void check_kernels(const _ambix_kernels_t*kernels, uint32_t rows, uint32_t cols, uint32_t extra) {
+  const _ambix_kernels_t*ref=_ambix_get_kernels_simd(AMBIX_SIMD_NONE);
+  const int64_t frames=37;
+  const uint32_t srcstride=cols+extra, dststride=rows+extra;
+  const float32_t eps=1e-5*cols;
+  float32_t*mtx=calloc(rows*cols, sizeof(float32_t));
+  float32_t*src=calloc(frames*srcstride, sizeof(float32_t));
+  float32_t*dst=calloc(frames*dststride, sizeof(float32_t));
+  float32_t*dstref=calloc(frames*dststride, sizeof(float32_t));
+  float32_t diff;
+  uint32_t i;
+  STARTTEST("[%d] %dx%d (+%d)\n", kernels->simd, rows, cols, extra);
+  for(i=0; i<rows*cols; i++)mtx[i]=frand();
+  for(i=0; i<frames*srcstride; i++)src[i]=frand();
+
+  ref->mtxmul_float32(dstref, dststride, mtx, rows, cols, src, srcstride, frames);
+  kernels->mtxmul_float32(dst, dststride, mtx, rows, cols, src, srcstride, frames);
+  diff=kernel_diff(dst, dstref, dststride, rows, frames);
+  fail_if(diff>eps, __LINE__, "mtxmul_float32[%d] %dx%d differs by %g>%g", kernels->simd, rows, cols, diff, eps);
+
+  ref->mtxmul_float32_acc64(dstref, dststride, mtx, rows, cols, src, srcstride, frames);
+  kernels->mtxmul_float32_acc64(dst, dststride, mtx, rows, cols, src, srcstride, frames);
+  diff=kernel_diff(dst, dstref, dststride, rows, frames);
+  fail_if(diff>1e-6, __LINE__, "mtxmul_float32_acc64[%d] %dx%d differs by %g>%g", kernels->simd, rows, cols, diff, 1e-6);
+
+  free(mtx);
+  free(src);
+  free(dst);
+  free(dstref);
+  STOPTEST("[%d] %dx%d (+%d)\n", kernels->simd, rows, cols, extra);
+}
+
+/* the fixed-point kernels must give exactly the same results as the reference */
+#define CHECK_FIXED_KERNELS(typ, scale)                                 \
+  static void check_kernels_##typ(const _ambix_kernels_t*kernels, uint32_t rows, uint32_t cols, uint32_t extra) { \
+    const _ambix_kernels_t*ref=_ambix_get_kernels_simd(AMBIX_SIMD_NONE); \
+    const int64_t frames=37;                                            \
+    const uint32_t srcstride=cols+extra, dststride=rows+extra;          \
+    float32_t*mtx=calloc(rows*cols, sizeof(float32_t));                 \
+    int32_t*fixed=calloc(rows*cols, sizeof(int32_t));                   \
+    typ##_t*src=calloc(frames*srcstride, sizeof(typ##_t));              \
+    typ##_t*dst=calloc(frames*dststride, sizeof(typ##_t));              \
+    typ##_t*dstref=calloc(frames*dststride, sizeof(typ##_t));           \
+    int shift;                                                          \
+    uint32_t i;                                                         \
+    STARTTEST("[%d] %dx%d (+%d)\n", kernels->simd, rows, cols, extra);  \
+    for(i=0; i<rows*cols; i++)mtx[i]=frand();                           \
+    for(i=0; i<frames*srcstride; i++)src[i]=(typ##_t)(frand()*scale);   \
+    shift=_ambix_matrix_to_fixed(mtx, rows, cols, fixed);               \
+    fail_if(shift<0, __LINE__, "cannot convert matrix to fixed point"); \
+    ref->mtxmul_##typ(dstref, dststride, fixed, rows, cols, shift, src, srcstride, frames); \
+    kernels->mtxmul_##typ(dst, dststride, fixed, rows, cols, shift, src, srcstride, frames); \
+    fail_if(memcmp(dst, dstref, frames*dststride*sizeof(typ##_t)), __LINE__, \
+            "mtxmul_" #typ "[%d] %dx%d differs", kernels->simd, rows, cols); \
+    free(mtx);                                                          \
+    free(fixed);                                                        \
+    free(src);                                                          \
+    free(dst);                                                          \
+    free(dstref);                                                       \
+    STOPTEST("[%d] %dx%d (+%d)\n", kernels->simd, rows, cols, extra);   \
+  }
+CHECK_FIXED_KERNELS(int16, 32767.)
+CHECK_FIXED_KERNELS(int32, 2147483647.)
+
+/* cache-blocking must not change the result at all */
+static void check_tiled(const _ambix_kernels_t*kernels, uint32_t rows, uint32_t cols) {
+  const int64_t frames=3001;
+  const uint32_t srcstride=cols+1, dststride=rows+1;
+  float32_t*mtx=calloc(rows*cols, sizeof(float32_t));
+  int32_t*fixed=calloc(rows*cols, sizeof(int32_t));
+  float32_t*src=calloc(frames*srcstride, sizeof(float32_t));
+  float32_t*dst=calloc(frames*dststride, sizeof(float32_t));
+  float32_t*dstref=calloc(frames*dststride, sizeof(float32_t));
+  int16_t*src16=calloc(frames*srcstride, sizeof(int16_t));
+  int16_t*dst16=calloc(frames*dststride, sizeof(int16_t));
+  int16_t*dstref16=calloc(frames*dststride, sizeof(int16_t));
+  int shift;
+  int64_t i;
+  STARTTEST("[%d] %dx%d\n", kernels->simd, rows, cols);
+  for(i=0; i<rows*cols; i++)mtx[i]=frand()/cols;
+  for(i=0; i<frames*srcstride; i++) {
+    src[i]=frand();
+    src16[i]=(int16_t)(src[i]*32767.);
+  }
+
+  kernels->mtxmul_float32(dstref, dststride, mtx, rows, cols, src, srcstride, frames);
+  _ambix_mtxmul_float32_tiled(kernels->mtxmul_float32, dst, dststride, mtx, rows, cols, src, srcstride, frames);
+  fail_if(memcmp(dst, dstref, frames*dststride*sizeof(float32_t)), __LINE__,
+          "tiled mtxmul_float32[%d] %dx%d differs", kernels->simd, rows, cols);
+
+  kernels->mtxmul_float32_acc64(dstref, dststride, mtx, rows, cols, src, srcstride, frames);
+  _ambix_mtxmul_float32_tiled(kernels->mtxmul_float32_acc64, dst, dststride, mtx, rows, cols, src, srcstride, frames);
+  fail_if(memcmp(dst, dstref, frames*dststride*sizeof(float32_t)), __LINE__,
+          "tiled mtxmul_float32_acc64[%d] %dx%d differs", kernels->simd, rows, cols);
+
+  shift=_ambix_matrix_to_fixed(mtx, rows, cols, fixed);
+  fail_if(shift<0, __LINE__, "cannot convert matrix to fixed point");
+  kernels->mtxmul_int16(dstref16, dststride, fixed, rows, cols, shift, src16, srcstride, frames);
+  _ambix_mtxmul_int16_tiled(kernels->mtxmul_int16, dst16, dststride, fixed, rows, cols, shift, src16, srcstride, frames);
+  fail_if(memcmp(dst16, dstref16, frames*dststride*sizeof(int16_t)), __LINE__,
+          "tiled mtxmul_int16[%d] %dx%d differs", kernels->simd, rows, cols);
+
+  free(mtx); free(fixed);
+  free(src); free(dst); free(dstref);
+  free(src16); free(dst16); free(dstref16);
+  STOPTEST("[%d] %dx%d\n", kernels->simd, rows, cols);
+}
+
+int main(int argc, char**argv) {
+  static const uint32_t sizes[][2] = {
+    {1, 1}, {4, 4}, {9, 4}, {4, 9}, {16, 16}, {7, 5}, {5, 7}, {25, 36}, {64, 64}, {3, 17},
+    /* the specialised full-set sizes */
+    {9, 9}, {25, 25}, {36, 36}, {49, 49},
+  };
+  const _ambix_simd_t simds[] = {
+    AMBIX_SIMD_NONE, AMBIX_SIMD_SSE2, AMBIX_SIMD_AVX2, AMBIX_SIMD_AVX512, AMBIX_SIMD_NEON,
+  };
+  unsigned int s, i;
+
+  fail_if(NULL==_ambix_get_kernels(), __LINE__, "no default kernels");
+  for(s=0; s<sizeof(simds)/sizeof(*simds); s++) {
+    const _ambix_kernels_t*kernels=_ambix_get_kernels_simd(simds[s]);
+    if(!kernels) {
+      printf("SIMD level %d not available\n", simds[s]);
+      continue;
+    }
+    for(i=0; i<sizeof(sizes)/sizeof(*sizes); i++) {
+      check_kernels(kernels, sizes[i][0], sizes[i][1], 0);
+      check_kernels(kernels, sizes[i][0], sizes[i][1], 3);
+      check_kernels_int16(kernels, sizes[i][0], sizes[i][1], 3);
+      check_kernels_int32(kernels, sizes[i][0], sizes[i][1], 3);
+    }
+    check_tiled(kernels, 64, 64);
+    check_tiled(kernels, 121, 121);
+    check_tiled(kernels, 255, 37);
+  }
+
+  return pass();
+}
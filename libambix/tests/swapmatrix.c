@@ -0,0 +1,349 @@
+/* swapmatrix - test replacing the adaptor matrix while reading
+
+   Copyright © 2026 IOhannes m zmölnig <zmoelnig@iem.at>.
+         Institute of Electronic Music and Acoustics (IEM),
+         University of Music and Dramatic Arts, Graz
+
+   This file is part of libambix
+
+   libambix is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   libambix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "common.h"
+#include <string.h>
+#ifdef HAVE_PTHREADS
+# include <pthread.h>
+#endif
+
+#define FRAMES 1000
+#define BLOCKSIZE 100
+#define CROSSFADE 250
+#define EXTRACHANNELS 1
+
+static ambix_matrix_t*random_matrix(uint32_t rows, uint32_t cols) {
+  ambix_matrix_t*mtx=ambix_matrix_init(rows, cols, NULL);
+  uint32_t r, c;
+  for(r=0; r<rows; r++)
+    for(c=0; c<cols; c++)
+      mtx->data[r][c]=((float32_t)rand())/((float32_t)RAND_MAX) * 2.f - 1.f;
+  return mtx;
+}
+
+/* write 'channels' raw ambisonics channels (with an adaptor matrix) and the extra channels
+ * (BASIC files with extra channels are not read back as BASIC, so we use an identity adaptor if there's none) */
+static float32_t*write_file(const char*path, uint32_t channels, const ambix_matrix_t*adaptor) {
+  float32_t*data=(float32_t*)data_sine(FLOAT32, FRAMES, channels+EXTRACHANNELS, 10);
+  ambix_matrix_t*identity=NULL;
+  ambix_info_t info;
+  ambix_t*ambix=NULL;
+  int64_t err64;
+  if(!adaptor) {
+    identity=ambix_matrix_init(channels, channels, NULL);
+    adaptor=ambix_matrix_fill(identity, AMBIX_MATRIX_IDENTITY);
+  }
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_EXTENDED;
+  info.ambichannels=channels;
+  info.extrachannels=EXTRACHANNELS;
+  info.samplerate=44100;
+  info.sampleformat=AMBIX_SAMPLEFORMAT_FLOAT32;
+  ambix=ambix_open(path, AMBIX_WRITE, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't create ambix file '%s' for writing", path);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_set_adaptormatrix(ambix, adaptor)), __LINE__, "failed setting adaptor matrix");
+  if(identity)
+    ambix_matrix_destroy(identity);
+  {
+    /* split the interleaved data into ambisonics and extra channels */
+    float32_t*ambidata=(float32_t*)data_calloc(FLOAT32, FRAMES*channels);
+    float32_t*otherdata=(float32_t*)data_calloc(FLOAT32, FRAMES*EXTRACHANNELS);
+    int64_t f;
+    for(f=0; f<FRAMES; f++) {
+      memcpy(ambidata+f*channels, data+f*(channels+EXTRACHANNELS), channels*sizeof(float32_t));
+      memcpy(otherdata+f*EXTRACHANNELS, data+f*(channels+EXTRACHANNELS)+channels, EXTRACHANNELS*sizeof(float32_t));
+    }
+    err64=ambix_writef_float32(ambix, ambidata, otherdata, FRAMES);
+    free(ambidata);
+    free(otherdata);
+  }
+  fail_if((FRAMES!=err64), __LINE__, "wrote only %d frames of %d", (int)err64, FRAMES);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+  return data;
+}
+
+/* y = m * x (or x, if m is NULL) */
+static void apply(const ambix_matrix_t*m, const float32_t*x, uint32_t channels, float64_t*y) {
+  uint32_t r, c;
+  for(r=0; r<channels; r++) {
+    y[r]=0.;
+    if(!m) {
+      y[r]=x[r];
+      continue;
+    }
+    for(c=0; c<m->cols; c++)
+      y[r]+=(float64_t)m->data[r][c]*x[c];
+  }
+}
+
+/* compare a frame with the crossfade from 'from' to 'to' ('pos' frames into a crossfade of 'length') */
+static void check_frame(const float32_t*result, const float32_t*raw, uint32_t rows,
+                        const ambix_matrix_t*from, const ambix_matrix_t*to,
+                        int64_t pos, int64_t length, int line) {
+  float64_t a[16], b[16];
+  const float64_t gain=(pos+1>=length)?1.:(float64_t)(pos+1)/(float64_t)length;
+  uint32_t r;
+  apply(from, raw, rows, a);
+  apply(to, raw, rows, b);
+  for(r=0; r<rows; r++) {
+    const float64_t expected=a[r]+gain*(b[r]-a[r]);
+    fail_if((fabs(result[r]-expected)>1e-5), line, "frame %d[%d] is %g instead of %g", (int)pos, r, result[r], expected);
+  }
+}
+
+/* swap matrices (with and without crossfades) between reads of a file presented as BASIC */
+static void check_swap(const char*path, int planar) {
+  const uint32_t channels=4;
+  float32_t*raw=write_file(path, channels, NULL);
+  ambix_matrix_t*mtxB=random_matrix(channels, channels);
+  ambix_matrix_t*mtxC=random_matrix(channels, channels);
+  float32_t*ambidata=(float32_t*)data_calloc(FLOAT32, FRAMES*channels);
+  float32_t*otherdata=(float32_t*)data_calloc(FLOAT32, FRAMES*EXTRACHANNELS);
+  float32_t*ambiplanar[4], *otherplanar[EXTRACHANNELS];
+  float32_t frame[4];
+  ambix_info_t info;
+  ambix_t*ambix=NULL;
+  int64_t done=0, f;
+  uint32_t c;
+  STARTTEST("planar=%d\n", planar);
+  for(c=0; c<channels; c++)
+    ambiplanar[c]=ambidata+c*FRAMES;
+  otherplanar[0]=otherdata;
+
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_BASIC;
+  ambix=ambix_open(path, AMBIX_READ, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path);
+
+  /* block#0: no matrix; block#1: B; blocks#2-#4: fade to C; blocks#5,...: C */
+  for(done=0; done<FRAMES; done+=BLOCKSIZE) {
+    const int64_t block=done/BLOCKSIZE;
+    int64_t err64;
+    if(1==block)
+      fail_if((AMBIX_ERR_SUCCESS!=ambix_swap_adaptormatrix(ambix, mtxB, 0)), __LINE__, "swapping matrix B failed");
+    if(2==block) {
+      /* only the last matrix published before reading is used */
+      fail_if((AMBIX_ERR_SUCCESS!=ambix_swap_adaptormatrix(ambix, mtxB, 1)), __LINE__, "swapping matrix B failed");
+      fail_if((AMBIX_ERR_SUCCESS!=ambix_swap_adaptormatrix(ambix, mtxC, CROSSFADE)), __LINE__, "swapping matrix C failed");
+    }
+    if(planar) {
+      float32_t*ambiblock[4], *otherblock[EXTRACHANNELS];
+      for(c=0; c<channels; c++)
+        ambiblock[c]=ambiplanar[c]+done;
+      otherblock[0]=otherplanar[0]+done;
+      err64=ambix_readf_float32_planar(ambix, ambiblock, otherblock, BLOCKSIZE);
+    } else {
+      err64=ambix_readf_float32(ambix, ambidata+done*channels, otherdata+done*EXTRACHANNELS, BLOCKSIZE);
+    }
+    fail_if((BLOCKSIZE!=err64), __LINE__, "read only %d frames of %d", (int)err64, BLOCKSIZE);
+  }
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+  for(f=0; f<FRAMES; f++) {
+    const float32_t*x=raw+f*(channels+EXTRACHANNELS);
+    for(c=0; c<channels; c++)
+      frame[c]=planar?ambiplanar[c][f]:ambidata[f*channels+c];
+    if(f<BLOCKSIZE)
+      check_frame(frame, x, channels, NULL, NULL, 0, 0, __LINE__);
+    else if(f<2*BLOCKSIZE)
+      check_frame(frame, x, channels, NULL, mtxB, 0, 0, __LINE__);
+    else
+      check_frame(frame, x, channels, mtxB, mtxC, f-2*BLOCKSIZE, CROSSFADE, __LINE__);
+    fail_if((otherdata[f]!=x[channels]), __LINE__, "extra channel differs at frame %d", (int)f);
+  }
+
+  ambix_matrix_destroy(mtxB);
+  ambix_matrix_destroy(mtxC);
+  free(raw);
+  free(ambidata);
+  free(otherdata);
+  ambixtest_rmfile(path);
+  STOPTEST("planar=%d\n", planar);
+}
+
+/* fade from the adaptor matrix of an EXTENDED file to a rotated version of it */
+static void check_extended(const char*path) {
+  const uint32_t rawchannels=9, fullchannels=16;
+  ambix_matrix_t*adaptor=random_matrix(fullchannels, rawchannels);
+  ambix_matrix_t*rotation=random_matrix(fullchannels, fullchannels);
+  ambix_matrix_t*rotated=ambix_matrix_init(fullchannels, rawchannels, NULL);
+  float32_t*raw=write_file(path, rawchannels, adaptor);
+  float32_t*ambidata=(float32_t*)data_calloc(FLOAT32, FRAMES*fullchannels);
+  float32_t*otherdata=(float32_t*)data_calloc(FLOAT32, FRAMES*EXTRACHANNELS);
+  ambix_info_t info;
+  ambix_t*ambix=NULL;
+  int64_t err64, f;
+  uint32_t r, c, i;
+  STARTTEST("\n");
+  for(r=0; r<fullchannels; r++)
+    for(c=0; c<rawchannels; c++) {
+      float64_t sum=0.;
+      for(i=0; i<fullchannels; i++)
+        sum+=(float64_t)rotation->data[r][i]*adaptor->data[i][c];
+      rotated->data[r][c]=(float32_t)sum;
+    }
+
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_BASIC;
+  ambix=ambix_open(path, AMBIX_READ, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path);
+  fail_if((fullchannels!=info.ambichannels), __LINE__, "file has %d instead of %d channels", info.ambichannels, fullchannels);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_swap_adaptormatrix(ambix, rotation, FRAMES/2)), __LINE__, "swapping rotation failed");
+  /* a single large block, the crossfade ends in the middle */
+  err64=ambix_readf_float32(ambix, ambidata, otherdata, FRAMES);
+  fail_if((FRAMES!=err64), __LINE__, "read only %d frames of %d", (int)err64, FRAMES);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+  for(f=0; f<FRAMES; f++)
+    check_frame(ambidata+f*fullchannels, raw+f*(rawchannels+EXTRACHANNELS), fullchannels,
+                adaptor, rotated, f, FRAMES/2, __LINE__);
+
+  ambix_matrix_destroy(adaptor);
+  ambix_matrix_destroy(rotation);
+  ambix_matrix_destroy(rotated);
+  free(raw);
+  free(ambidata);
+  free(otherdata);
+  ambixtest_rmfile(path);
+  STOPTEST("\n");
+}
+
+static void check_invalid(const char*path) {
+  const uint32_t channels=4;
+  float32_t*raw=write_file(path, channels, NULL);
+  ambix_matrix_t*matrix=random_matrix(channels, channels);
+  ambix_matrix_t*wrongmatrix=random_matrix(channels+1, channels);
+  ambix_info_t info;
+  ambix_t*ambix=NULL;
+  STARTTEST("\n");
+  fail_if((AMBIX_ERR_INVALID_HANDLE!=ambix_swap_adaptormatrix(NULL, matrix, 0)), __LINE__, "swapped matrix of NULL handle");
+
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_BASIC;
+  ambix=ambix_open(path, AMBIX_READ, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path);
+  fail_if((AMBIX_ERR_INVALID_DIMENSION!=ambix_swap_adaptormatrix(ambix, wrongmatrix, 0)), __LINE__, "swapped matrix with wrong dimensions");
+  fail_if((AMBIX_ERR_SUCCESS==ambix_swap_adaptormatrix(ambix, NULL, 0)), __LINE__, "swapped NULL matrix");
+  /* a pending matrix is freed when closing */
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_swap_adaptormatrix(ambix, matrix, 10)), __LINE__, "swapping matrix failed");
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_EXTENDED;
+  ambix=ambix_open(path, AMBIX_READ, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path);
+  fail_if((AMBIX_ERR_SUCCESS==ambix_swap_adaptormatrix(ambix, matrix, 0)), __LINE__, "swapped matrix of EXTENDED handle");
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+  ambix_matrix_destroy(matrix);
+  ambix_matrix_destroy(wrongmatrix);
+  free(raw);
+  ambixtest_rmfile(path);
+  STOPTEST("\n");
+}
+
+#ifdef HAVE_PTHREADS
+/* swap between two scaled identity matrices while another thread is reading:
+ * all channels of a frame must always have the same gain */
+typedef struct {
+  ambix_t*ambix;
+  const float32_t*raw;
+  volatile int stop;
+  int errors;
+} reader_t;
+static void*reader_thread(void*userdata) {
+  reader_t*reader=(reader_t*)userdata;
+  float32_t ambidata[64*4], otherdata[64*EXTRACHANNELS];
+  int64_t pos=0;
+  while(!reader->stop) {
+    int64_t err64=ambix_readf_float32(reader->ambix, ambidata, otherdata, 64), f;
+    uint32_t c;
+    if(err64<64) {
+      ambix_seek(reader->ambix, 0, SEEK_SET);
+      pos=0;
+      continue;
+    }
+    for(f=0; f<err64; f++) {
+      const float32_t*x=reader->raw+(pos+f)*(4+EXTRACHANNELS);
+      float64_t gain=-1.;
+      for(c=0; c<4; c++) {
+        float64_t g;
+        if(fabs(x[c])<1e-3)
+          continue;
+        g=ambidata[f*4+c]/x[c];
+        if(gain<0.)
+          gain=g;
+        if(fabs(g-gain)>1e-3 || g<1.-1e-3 || g>2.+1e-3)
+          reader->errors++;
+      }
+    }
+    pos+=err64;
+  }
+  return NULL;
+}
+static void check_concurrent(const char*path) {
+  float32_t*raw=write_file(path, 4, NULL);
+  ambix_matrix_t*matrix[2];
+  ambix_info_t info;
+  reader_t reader;
+  pthread_t thread;
+  int i;
+  STARTTEST("\n");
+  for(i=0; i<2; i++) {
+    matrix[i]=ambix_matrix_init(4, 4, NULL);
+    ambix_matrix_fill(matrix[i], AMBIX_MATRIX_IDENTITY);
+    matrix[i]->data[0][0]=matrix[i]->data[1][1]=matrix[i]->data[2][2]=matrix[i]->data[3][3]=(float32_t)(i+1);
+  }
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_BASIC;
+  memset(&reader, 0, sizeof(reader));
+  reader.ambix=ambix_open(path, AMBIX_READ, &info);
+  reader.raw=raw;
+  fail_if((NULL==reader.ambix), __LINE__, "couldn't open ambix file '%s' for reading", path);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_swap_adaptormatrix(reader.ambix, matrix[0], 0)), __LINE__, "swapping matrix failed");
+  fail_if((0!=pthread_create(&thread, NULL, reader_thread, &reader)), __LINE__, "couldn't start reader thread");
+  for(i=0; i<10000; i++)
+    fail_if((AMBIX_ERR_SUCCESS!=ambix_swap_adaptormatrix(reader.ambix, matrix[i%2], i%3*20)), __LINE__, "swapping matrix#%d failed", i);
+  reader.stop=1;
+  pthread_join(thread, NULL);
+  fail_if((reader.errors), __LINE__, "%d frames were processed with a broken matrix", reader.errors);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(reader.ambix)), __LINE__, "closing ambix file %p", reader.ambix);
+  ambix_matrix_destroy(matrix[0]);
+  ambix_matrix_destroy(matrix[1]);
+  free(raw);
+  ambixtest_rmfile(path);
+  STOPTEST("\n");
+}
+#endif /* HAVE_PTHREADS */
+
+int main(int argc, char**argv) {
+  const char*path=FILENAME_MAIN;
+  check_swap(path, 0);
+  check_swap(path, 1);
+  check_extended(path);
+  check_invalid(path);
+#ifdef HAVE_PTHREADS
+  check_concurrent(path);
+#endif
+  return pass();
+}
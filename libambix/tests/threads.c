@@ -0,0 +1,140 @@
+/* threads - test multi-threaded matrix application
+
+   Copyright © 2026 IOhannes m zmölnig <zmoelnig@iem.at>.
+         Institute of Electronic Music and Acoustics (IEM),
+         University of Music and Dramatic Arts, Graz
+
+   This file is part of libambix
+
+   libambix is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   libambix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "common.h"
+#include <string.h>
+
+/* write an EXTENDED file via the BASIC api and read it back (both ways),
+ * using the given number of threads */
+static void write_read(const char*path, ambixtest_presentationformat_t fmt, ambix_sampleformat_t format,
+                       const ambix_matrix_t*matrix, uint32_t threads,
+                       const void*ambidata, const void*otherdata, uint32_t extrachannels, int64_t frames,
+                       void*resultambidata, void*resultrawdata, void*resultotherdata) {
+  ambix_info_t info;
+  ambix_t*ambix=NULL;
+  int64_t err64;
+
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_BASIC;
+  info.ambichannels=matrix->cols;
+  info.extrachannels=extrachannels;
+  info.samplerate=44100;
+  info.sampleformat=format;
+  ambix=ambix_open(path, AMBIX_WRITE, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't create ambix file '%s' for writing", path);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_set_threads(ambix, threads)), __LINE__, "couldn't use %d threads", threads);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_set_adaptormatrix(ambix, matrix)), __LINE__, "failed setting adaptor matrix");
+  err64=ambixtest_writef(ambix, fmt, ambidata, 0, otherdata, 0, frames);
+  fail_if((err64!=frames), __LINE__, "wrote only %d frames of %d", (int)err64, (int)frames);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+  /* reconstruct the full set */
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_BASIC;
+  ambix=ambix_open(path, AMBIX_READ, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_set_threads(ambix, threads)), __LINE__, "couldn't use %d threads", threads);
+  err64=ambixtest_readf(ambix, fmt, resultambidata, 0, resultotherdata, 0, frames);
+  fail_if((err64!=frames), __LINE__, "read only %d frames of %d", (int)err64, (int)frames);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+  /* the reduced set, as written to disk */
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_EXTENDED;
+  ambix=ambix_open(path, AMBIX_READ, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path);
+  err64=ambixtest_readf(ambix, fmt, resultrawdata, 0, resultotherdata, 0, frames);
+  fail_if((err64!=frames), __LINE__, "read only %d frames of %d", (int)err64, (int)frames);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+}
+
+/* the results must not depend on the number of threads */
+static void check_threads(const char*path, ambixtest_presentationformat_t fmt, ambix_sampleformat_t format,
+                          uint32_t threads) {
+  const uint32_t fullambichannels=16, ambichannels=9, extrachannels=2;
+  const int64_t frames=20000+17;
+  const size_t ambisize=frames*fullambichannels*data_size(fmt);
+  const size_t rawsize=frames*ambichannels*data_size(fmt);
+  const size_t othersize=frames*extrachannels*data_size(fmt);
+  ambix_matrix_t*matrix=ambix_matrix_init(fullambichannels, ambichannels, NULL);
+  void*ambidata=data_sine(fmt, frames, fullambichannels, 1000);
+  void*otherdata=data_ramp(fmt, frames, extrachannels);
+  void*resultambi1=data_calloc(fmt, frames*fullambichannels);
+  void*resultambiN=data_calloc(fmt, frames*fullambichannels);
+  void*resultraw1=data_calloc(fmt, frames*ambichannels);
+  void*resultrawN=data_calloc(fmt, frames*ambichannels);
+  void*resultother1=data_calloc(fmt, frames*extrachannels);
+  void*resultotherN=data_calloc(fmt, frames*extrachannels);
+  uint32_t r, c;
+  STARTTEST("format=%d, datafmt=%d, threads=%d\n", format, fmt, threads);
+
+  for(r=0; r<fullambichannels; r++)
+    for(c=0; c<ambichannels; c++)
+      matrix->data[r][c]=(float32_t)(((r*ambichannels+c)*7919)%101)/101. - 0.5;
+
+  write_read(path, fmt, format, matrix, 1, ambidata, otherdata, extrachannels, frames,
+             resultambi1, resultraw1, resultother1);
+  write_read(path, fmt, format, matrix, threads, ambidata, otherdata, extrachannels, frames,
+             resultambiN, resultrawN, resultotherN);
+
+  fail_if(memcmp(resultraw1, resultrawN, rawsize), __LINE__, "written data differs with %d threads", threads);
+  fail_if(memcmp(resultambi1, resultambiN, ambisize), __LINE__, "reconstructed data differs with %d threads", threads);
+  fail_if(memcmp(resultother1, resultotherN, othersize), __LINE__, "extra channels differ with %d threads", threads);
+
+  ambix_matrix_destroy(matrix);
+  free(ambidata);
+  free(otherdata);
+  free(resultambi1); free(resultambiN);
+  free(resultraw1); free(resultrawN);
+  free(resultother1); free(resultotherN);
+  ambixtest_rmfile(path);
+  STOPTEST("format=%d, datafmt=%d, threads=%d\n", format, fmt, threads);
+}
+
+int main(int argc, char**argv) {
+  ambix_info_t info;
+  ambix_t*ambix=NULL;
+  const char*path=FILENAME_MAIN;
+
+  /* check whether threads are supported at all */
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_BASIC;
+  info.ambichannels=4;
+  info.samplerate=44100;
+  info.sampleformat=AMBIX_SAMPLEFORMAT_FLOAT32;
+  ambix=ambix_open(path, AMBIX_WRITE, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't create ambix file '%s' for writing", path);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_set_threads(ambix, 1)), __LINE__, "couldn't disable threads");
+  skip_if((AMBIX_ERR_SUCCESS!=ambix_set_threads(ambix, 4)), __LINE__, "threads not supported");
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_set_threads(ambix, 0)), __LINE__, "couldn't use one thread per CPU");
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+  ambixtest_rmfile(path);
+
+  check_threads(path, FLOAT32, AMBIX_SAMPLEFORMAT_FLOAT32, 2);
+  check_threads(path, FLOAT32, AMBIX_SAMPLEFORMAT_FLOAT32, 7);
+  check_threads(path, FLOAT64, AMBIX_SAMPLEFORMAT_FLOAT64, 4);
+  check_threads(path, INT32, AMBIX_SAMPLEFORMAT_PCM32, 3);
+  check_threads(path, INT16, AMBIX_SAMPLEFORMAT_PCM16, 4);
+
+  return pass();
+}
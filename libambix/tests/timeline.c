@@ -0,0 +1,296 @@
+/* timeline - test time-varying adaptor matrices (keyframes)
+
+   Copyright © 2026 IOhannes m zmölnig <zmoelnig@iem.at>.
+         Institute of Electronic Music and Acoustics (IEM),
+         University of Music and Dramatic Arts, Graz
+
+   This file is part of libambix
+
+   libambix is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   libambix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "common.h"
+#include <string.h>
+#include <math.h>
+
+#define FRAMES 1024
+#define CHANNELS 4
+#define EXTRACHANNELS 1
+/* the matrix is evaluated every 64 frames, so we put the keyframes on that grid */
+#define BLOCKFRAMES 64
+#define NUMKEYS 4
+
+/* A at 128, fading to B at 512, jumping to C and fading to D at 832 */
+static const int64_t keyframes[NUMKEYS]={128, 512, 512, 832};
+
+static ambix_matrix_t*random_matrix(uint32_t rows, uint32_t cols) {
+  ambix_matrix_t*mtx=ambix_matrix_init(rows, cols, NULL);
+  uint32_t r, c;
+  for(r=0; r<rows; r++)
+    for(c=0; c<cols; c++)
+      mtx->data[r][c]=((float32_t)rand())/((float32_t)RAND_MAX) * 2.f - 1.f;
+  return mtx;
+}
+
+/* write an EXTENDED file with the static adaptor matrix and the keyframes
+ * (added out of order, but with B before C, as they share a position) */
+static float32_t*write_file(const char*path, const ambix_matrix_t*adaptor, ambix_matrix_t*keys[NUMKEYS]) {
+  float32_t*data=(float32_t*)data_sine(FLOAT32, FRAMES, CHANNELS+EXTRACHANNELS, 10);
+  float32_t*ambidata=(float32_t*)data_calloc(FLOAT32, FRAMES*CHANNELS);
+  float32_t*otherdata=(float32_t*)data_calloc(FLOAT32, FRAMES*EXTRACHANNELS);
+  ambix_info_t info;
+  ambix_t*ambix=NULL;
+  const int order[NUMKEYS]={3, 1, 0, 2};
+  int64_t err64, f;
+  int k;
+  for(f=0; f<FRAMES; f++) {
+    memcpy(ambidata+f*CHANNELS, data+f*(CHANNELS+EXTRACHANNELS), CHANNELS*sizeof(float32_t));
+    memcpy(otherdata+f*EXTRACHANNELS, data+f*(CHANNELS+EXTRACHANNELS)+CHANNELS, EXTRACHANNELS*sizeof(float32_t));
+  }
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_EXTENDED;
+  info.ambichannels=CHANNELS;
+  info.extrachannels=EXTRACHANNELS;
+  info.samplerate=44100;
+  info.sampleformat=AMBIX_SAMPLEFORMAT_FLOAT32;
+  ambix=ambix_open(path, AMBIX_WRITE, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't create ambix file '%s' for writing", path);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_set_adaptormatrix(ambix, adaptor)), __LINE__, "failed setting adaptor matrix");
+  for(k=0; k<NUMKEYS; k++)
+    fail_if((AMBIX_ERR_SUCCESS!=ambix_add_keyframe(ambix, keyframes[order[k]], keys[order[k]])), __LINE__,
+            "failed adding keyframe #%d", order[k]);
+  fail_if((NUMKEYS!=ambix_get_num_keyframes(ambix)), __LINE__, "got %d keyframes instead of %d", ambix_get_num_keyframes(ambix), NUMKEYS);
+  err64=ambix_writef_float32(ambix, ambidata, otherdata, FRAMES);
+  fail_if((FRAMES!=err64), __LINE__, "wrote only %d frames of %d", (int)err64, FRAMES);
+  /* too late */
+  fail_if((AMBIX_ERR_SUCCESS==ambix_add_keyframe(ambix, 0, keys[0])), __LINE__, "added keyframe after writing");
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+  free(ambidata);
+  free(otherdata);
+  return data;
+}
+
+/* the matrix at a given position */
+static float64_t key_coeff(ambix_matrix_t*keys[NUMKEYS], int64_t pos, uint32_t r, uint32_t c) {
+  int k;
+  if(pos<keyframes[0])
+    return keys[0]->data[r][c];
+  for(k=NUMKEYS-1; k>=0; k--) {
+    if(keyframes[k]<=pos)
+      break;
+  }
+  if(k+1>=NUMKEYS)
+    return keys[k]->data[r][c];
+  return keys[k]->data[r][c] + (float64_t)(pos-keyframes[k])/(float64_t)(keyframes[k+1]-keyframes[k])
+    * (keys[k+1]->data[r][c] - keys[k]->data[r][c]);
+}
+
+/* compare a frame with (premultiply *) keys(pos) * x */
+static void check_frame(const float32_t*result, const float32_t*x, ambix_matrix_t*keys[NUMKEYS],
+                        const ambix_matrix_t*premultiply, int64_t pos, int64_t frame, int line) {
+  float64_t full[CHANNELS];
+  uint32_t r, c;
+  for(r=0; r<CHANNELS; r++) {
+    full[r]=0.;
+    for(c=0; c<CHANNELS; c++)
+      full[r]+=key_coeff(keys, pos, r, c)*x[c];
+  }
+  for(r=0; r<(premultiply?premultiply->rows:CHANNELS); r++) {
+    float64_t expected=full[r];
+    if(premultiply) {
+      expected=0.;
+      for(c=0; c<CHANNELS; c++)
+        expected+=premultiply->data[r][c]*full[c];
+    }
+    fail_if((fabs(result[r]-expected)>1e-4), line, "frame %d[%d] is %g instead of %g", (int)frame, r, result[r], expected);
+  }
+}
+
+/* read the file as BASIC (in blocks of 'blocksize' frames) */
+static void check_read(const char*path, const float32_t*raw, ambix_matrix_t*keys[NUMKEYS],
+                       const ambix_matrix_t*premultiply, int64_t blocksize, int planar) {
+  const uint32_t rows=premultiply?premultiply->rows:CHANNELS;
+  const int64_t grid=(blocksize<BLOCKFRAMES)?blocksize:BLOCKFRAMES;
+  float32_t*ambidata=(float32_t*)data_calloc(FLOAT32, FRAMES*rows);
+  float32_t*otherdata=(float32_t*)data_calloc(FLOAT32, FRAMES*EXTRACHANNELS);
+  float32_t frame[CHANNELS];
+  ambix_info_t info;
+  ambix_t*ambix=NULL;
+  int64_t done, f;
+  uint32_t c;
+  STARTTEST("blocksize=%d planar=%d premultiply=%p\n", (int)blocksize, planar, premultiply);
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_BASIC;
+  ambix=ambix_open(path, AMBIX_READ, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path);
+  if(premultiply)
+    fail_if((AMBIX_ERR_SUCCESS!=ambix_set_adaptormatrix(ambix, premultiply)), __LINE__, "failed setting adaptor matrix");
+
+  for(done=0; done<FRAMES; done+=blocksize) {
+    int64_t err64;
+    if(planar) {
+      float32_t*ambiblock[CHANNELS], *otherblock[EXTRACHANNELS];
+      for(c=0; c<rows; c++)
+        ambiblock[c]=ambidata+c*FRAMES+done;
+      otherblock[0]=otherdata+done;
+      err64=ambix_readf_float32_planar(ambix, ambiblock, otherblock, blocksize);
+    } else {
+      err64=ambix_readf_float32(ambix, ambidata+done*rows, otherdata+done*EXTRACHANNELS, blocksize);
+    }
+    fail_if((blocksize!=err64), __LINE__, "read only %d frames of %d", (int)err64, (int)blocksize);
+  }
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+  for(f=0; f<FRAMES; f++) {
+    const float32_t*x=raw+f*(CHANNELS+EXTRACHANNELS);
+    for(c=0; c<rows; c++)
+      frame[c]=planar?ambidata[c*FRAMES+f]:ambidata[f*rows+c];
+    /* the matrix is the one at the beginning of the block */
+    check_frame(frame, x, keys, premultiply, f-f%grid, f, __LINE__);
+    fail_if((otherdata[f]!=x[CHANNELS]), __LINE__, "extra channel differs at frame %d", (int)f);
+  }
+  free(ambidata);
+  free(otherdata);
+  STOPTEST("blocksize=%d planar=%d premultiply=%p\n", (int)blocksize, planar, premultiply);
+}
+
+/* after seeking, the matrix is looked up for the new position */
+static void check_seek(const char*path, const float32_t*raw, ambix_matrix_t*keys[NUMKEYS]) {
+  const int64_t positions[]={700, 100, 511, 512, 900, 300};
+  float32_t ambidata[BLOCKFRAMES*CHANNELS], otherdata[BLOCKFRAMES*EXTRACHANNELS];
+  ambix_info_t info;
+  ambix_t*ambix=NULL;
+  unsigned int i;
+  STARTTEST("\n");
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_BASIC;
+  ambix=ambix_open(path, AMBIX_READ, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path);
+  for(i=0; i<sizeof(positions)/sizeof(*positions); i++) {
+    const int64_t pos=positions[i];
+    int64_t err64=ambix_seek(ambix, pos, SEEK_SET);
+    fail_if((pos!=err64), __LINE__, "seeking to %d returned %d", (int)pos, (int)err64);
+    err64=ambix_readf_float32(ambix, ambidata, otherdata, 1);
+    fail_if((1!=err64), __LINE__, "read %d frames at %d", (int)err64, (int)pos);
+    check_frame(ambidata, raw+pos*(CHANNELS+EXTRACHANNELS), keys, NULL, pos, pos, __LINE__);
+  }
+  /* relative seeks */
+  fail_if((700!=ambix_seek(ambix, 700-301, SEEK_CUR)), __LINE__, "seeking forward failed");
+  fail_if((1!=ambix_readf_float32(ambix, ambidata, otherdata, 1)), __LINE__, "reading failed");
+  check_frame(ambidata, raw+700*(CHANNELS+EXTRACHANNELS), keys, NULL, 700, 700, __LINE__);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+  STOPTEST("\n");
+}
+
+/* the keyframes are stored as they were added (sorted by their position) */
+static void check_keyframes(const char*path, const ambix_matrix_t*adaptor, ambix_matrix_t*keys[NUMKEYS]) {
+  ambix_info_t info;
+  ambix_t*ambix=NULL;
+  int64_t frame=-1;
+  uint32_t k, r, c;
+  STARTTEST("\n");
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_EXTENDED;
+  ambix=ambix_open(path, AMBIX_READ, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path);
+  fail_if((CHANNELS!=info.ambichannels), __LINE__, "file has %d ambisonics channels instead of %d", info.ambichannels, CHANNELS);
+  fail_if((0!=matrix_diff(__LINE__, ambix_get_adaptormatrix(ambix), adaptor, 1e-7)), __LINE__, "adaptor matrix differs");
+  fail_if((NUMKEYS!=ambix_get_num_keyframes(ambix)), __LINE__, "got %d keyframes instead of %d", ambix_get_num_keyframes(ambix), NUMKEYS);
+  for(k=0; k<NUMKEYS; k++) {
+    const ambix_matrix_t*key=ambix_get_keyframe(ambix, k, &frame);
+    fail_if((NULL==key), __LINE__, "keyframe #%d is missing", k);
+    fail_if((keyframes[k]!=frame), __LINE__, "keyframe #%d is at %d instead of %d", k, (int)frame, (int)keyframes[k]);
+    for(r=0; r<CHANNELS; r++)
+      for(c=0; c<CHANNELS; c++)
+        fail_if((key->data[r][c]!=keys[k]->data[r][c]), __LINE__, "keyframe #%d[%d,%d] differs", k, r, c);
+  }
+  fail_if((NULL!=ambix_get_keyframe(ambix, NUMKEYS, &frame)), __LINE__, "got non-existing keyframe");
+  fail_if((AMBIX_ERR_SUCCESS==ambix_delete_keyframes(ambix)), __LINE__, "deleted keyframes of a file opened for reading");
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+  STOPTEST("\n");
+}
+
+static void check_invalid(const char*path) {
+  ambix_matrix_t*adaptor=random_matrix(CHANNELS, CHANNELS);
+  ambix_matrix_t*wrongmatrix=random_matrix(9, CHANNELS);
+  ambix_info_t info;
+  ambix_t*ambix=NULL;
+  STARTTEST("\n");
+  fail_if((AMBIX_ERR_INVALID_HANDLE!=ambix_add_keyframe(NULL, 0, adaptor)), __LINE__, "added keyframe to NULL handle");
+  fail_if((0!=ambix_get_num_keyframes(NULL)), __LINE__, "NULL handle has keyframes");
+
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_EXTENDED;
+  info.ambichannels=CHANNELS;
+  info.extrachannels=0;
+  info.samplerate=44100;
+  info.sampleformat=AMBIX_SAMPLEFORMAT_FLOAT32;
+  ambix=ambix_open(path, AMBIX_WRITE, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't create ambix file '%s' for writing", path);
+  fail_if((AMBIX_ERR_INVALID_DIMENSION!=ambix_add_keyframe(ambix, 0, adaptor)), __LINE__, "added keyframe without adaptor matrix");
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_set_adaptormatrix(ambix, adaptor)), __LINE__, "failed setting adaptor matrix");
+  fail_if((AMBIX_ERR_INVALID_DIMENSION!=ambix_add_keyframe(ambix, 0, wrongmatrix)), __LINE__, "added keyframe with wrong dimensions");
+  fail_if((AMBIX_ERR_SUCCESS==ambix_add_keyframe(ambix, -1, adaptor)), __LINE__, "added keyframe at negative position");
+  fail_if((AMBIX_ERR_SUCCESS==ambix_add_keyframe(ambix, 0, NULL)), __LINE__, "added NULL keyframe");
+  fail_if((AMBIX_ERR_SUCCESS==ambix_delete_keyframes(ambix)), __LINE__, "deleted non-existing keyframes");
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_add_keyframe(ambix, 10, adaptor)), __LINE__, "failed adding keyframe");
+  /* the adaptor matrix cannot change its dimensions anymore */
+  fail_if((AMBIX_ERR_INVALID_DIMENSION!=ambix_set_adaptormatrix(ambix, wrongmatrix)), __LINE__, "changed dimensions of adaptor matrix");
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_delete_keyframes(ambix)), __LINE__, "failed deleting keyframes");
+  fail_if((0!=ambix_get_num_keyframes(ambix)), __LINE__, "keyframes have not been deleted");
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+  /* files without keyframes */
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_EXTENDED;
+  ambix=ambix_open(path, AMBIX_READ, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path);
+  fail_if((0!=ambix_get_num_keyframes(ambix)), __LINE__, "deleted keyframes have been written");
+  fail_if((AMBIX_ERR_SUCCESS==ambix_add_keyframe(ambix, 0, adaptor)), __LINE__, "added keyframe to a file opened for reading");
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+  ambix_matrix_destroy(adaptor);
+  ambix_matrix_destroy(wrongmatrix);
+  ambixtest_rmfile(path);
+  STOPTEST("\n");
+}
+
+int main(int argc, char**argv) {
+  const char*path=FILENAME_MAIN;
+  ambix_matrix_t*adaptor=random_matrix(CHANNELS, CHANNELS);
+  ambix_matrix_t*premultiply=random_matrix(3, CHANNELS);
+  ambix_matrix_t*keys[NUMKEYS];
+  float32_t*raw;
+  int k;
+  for(k=0; k<NUMKEYS; k++)
+    keys[k]=random_matrix(CHANNELS, CHANNELS);
+  raw=write_file(path, adaptor, keys);
+
+  check_keyframes(path, adaptor, keys);
+  check_read(path, raw, keys, NULL, BLOCKFRAMES, 0);
+  check_read(path, raw, keys, NULL, FRAMES, 0);
+  check_read(path, raw, keys, NULL, FRAMES, 1);
+  check_read(path, raw, keys, premultiply, BLOCKFRAMES/2, 0);
+  check_seek(path, raw, keys);
+  check_invalid(path);
+
+  for(k=0; k<NUMKEYS; k++)
+    ambix_matrix_destroy(keys[k]);
+  ambix_matrix_destroy(adaptor);
+  ambix_matrix_destroy(premultiply);
+  free(raw);
+  ambixtest_rmfile(path);
+  return pass();
+}
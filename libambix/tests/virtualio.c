@@ -0,0 +1,308 @@
+/* virtualio - test reading/writing ambix streams via memory, file descriptors and callbacks
+
+   Copyright © 2026 IOhannes m zmölnig <zmoelnig@iem.at>.
+         Institute of Electronic Music and Acoustics (IEM),
+         University of Music and Dramatic Arts, Graz
+
+   This file is part of libambix
+
+   libambix is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   libambix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "common.h"
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#ifndef _WIN32
+# include <unistd.h>
+# include <sys/wait.h>
+#endif
+
+#define FRAMES (4096+17)
+#define AMBICHANNELS 9
+#define EXTRACHANNELS 2
+
+static ambix_matrix_t*make_matrix(void) {
+  ambix_matrix_t*matrix=ambix_matrix_init(16, AMBICHANNELS, NULL);
+  uint32_t r, c;
+  for(r=0; r<matrix->rows; r++)
+    for(c=0; c<matrix->cols; c++)
+      matrix->data[r][c]=(float32_t)(((r*matrix->cols+c)*7919)%101)/101. - 0.5;
+  return matrix;
+}
+static void set_info(ambix_info_t*info) {
+  memset(info, 0, sizeof(*info));
+  info->fileformat=AMBIX_EXTENDED;
+  info->ambichannels=AMBICHANNELS;
+  info->extrachannels=EXTRACHANNELS;
+  info->samplerate=48000;
+  info->sampleformat=AMBIX_SAMPLEFORMAT_FLOAT32;
+}
+
+/* write the test data (with a marker) to an already opened stream, and close it */
+static void write_stream(int line, ambix_t*ambix) {
+  ambix_matrix_t*matrix=make_matrix();
+  float32_t*ambidata=(float32_t*)data_sine(FLOAT32, FRAMES, AMBICHANNELS, 10);
+  float32_t*otherdata=(float32_t*)data_ramp(FLOAT32, FRAMES, EXTRACHANNELS);
+  ambix_marker_t marker;
+  int64_t err64;
+  fail_if((NULL==ambix), line, "couldn't open stream for writing");
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_set_adaptormatrix(ambix, matrix)), line, "failed setting adaptor matrix");
+  memset(&marker, 0, sizeof(marker));
+  marker.position=23.;
+  strncpy(marker.name, "virtual", sizeof(marker.name)-1);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_add_marker(ambix, &marker)), line, "couldn't add marker");
+  /* write in two blocks, to exercise partial writes */
+  err64=ambix_writef_float32(ambix, ambidata, otherdata, 1000);
+  fail_if((err64!=1000), line, "wrote only %d frames of %d", (int)err64, 1000);
+  err64=ambix_writef_float32(ambix, ambidata+1000*AMBICHANNELS, otherdata+1000*EXTRACHANNELS, FRAMES-1000);
+  fail_if((err64!=FRAMES-1000), line, "wrote only %d frames of %d", (int)err64, FRAMES-1000);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), line, "closing stream %p", ambix);
+  free(ambidata);
+  free(otherdata);
+  ambix_matrix_destroy(matrix);
+}
+
+/* check the content of an already opened stream, and close it */
+static void check_stream(int line, ambix_t*ambix, const ambix_info_t*info, int64_t expectedframes, uint32_t markers) {
+  ambix_matrix_t*matrix=make_matrix();
+  float32_t*ambidata=(float32_t*)data_sine(FLOAT32, FRAMES, AMBICHANNELS, 10);
+  float32_t*otherdata=(float32_t*)data_ramp(FLOAT32, FRAMES, EXTRACHANNELS);
+  float32_t*ambiresult=(float32_t*)data_calloc(FLOAT32, FRAMES*AMBICHANNELS);
+  float32_t*otherresult=(float32_t*)data_calloc(FLOAT32, FRAMES*EXTRACHANNELS);
+  ambix_marker_t*marker=NULL;
+  float32_t diff;
+  int64_t err64;
+  fail_if((NULL==ambix), line, "couldn't open stream for reading");
+  fail_if((expectedframes!=(int64_t)info->frames), line, "stream has %d frames (expected %d)", (int)info->frames, (int)expectedframes);
+  fail_if((AMBICHANNELS!=info->ambichannels), line, "stream has %d ambichannels", info->ambichannels);
+  fail_if((EXTRACHANNELS!=info->extrachannels), line, "stream has %d extrachannels", info->extrachannels);
+  fail_if((48000!=info->samplerate), line, "stream has samplerate %g", info->samplerate);
+  diff=matrix_diff(line, ambix_get_adaptormatrix(ambix), matrix, 1e-7);
+  fail_if((diff>1e-7), line, "adaptor matrix differs by %g", diff);
+  fail_if((markers!=ambix_get_num_markers(ambix)), line, "stream has %d markers (expected %d)", ambix_get_num_markers(ambix), markers);
+  marker=ambix_get_marker(ambix, 0);
+  fail_if((NULL==marker || 23.!=marker->position || strcmp(marker->name, "virtual")), line, "first marker differs");
+
+  /* read in two blocks, then try to read beyond the end */
+  err64=ambix_readf_float32(ambix, ambiresult, otherresult, 1000);
+  fail_if((err64!=1000), line, "read only %d frames of %d", (int)err64, 1000);
+  err64=ambix_readf_float32(ambix, ambiresult+1000*AMBICHANNELS, otherresult+1000*EXTRACHANNELS, FRAMES-1000);
+  fail_if((err64!=FRAMES-1000), line, "read only %d frames of %d", (int)err64, FRAMES-1000);
+  diff=data_diff(line, FLOAT32, ambidata, ambiresult, FRAMES*AMBICHANNELS, 1e-7);
+  fail_if((diff>1e-7), line, "ambisonics data differs by %g", diff);
+  diff=data_diff(line, FLOAT32, otherdata, otherresult, FRAMES*EXTRACHANNELS, 1e-7);
+  fail_if((diff>1e-7), line, "extra data differs by %g", diff);
+  err64=ambix_readf_float32(ambix, ambiresult, otherresult, 1);
+  fail_if((err64!=0), line, "read %d frames beyond the end", (int)err64);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), line, "closing stream %p", ambix);
+
+  free(ambidata);
+  free(otherdata);
+  free(ambiresult);
+  free(otherresult);
+  ambix_matrix_destroy(matrix);
+}
+
+static void check_memory(void) {
+  void*data=NULL;
+  int64_t size=0;
+  ambix_info_t info;
+  ambix_marker_t marker;
+  ambix_t*ambix=NULL;
+  STARTTEST("\n");
+
+  set_info(&info);
+  write_stream(__LINE__, ambix_open_memory(&data, &size, AMBIX_WRITE, &info));
+  fail_if((NULL==data || size<=FRAMES*(AMBICHANNELS+EXTRACHANNELS)*4), __LINE__, "got %d bytes at %p", (int)size, data);
+
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_EXTENDED;
+  ambix=ambix_open_memory(&data, &size, AMBIX_READ, &info);
+  /* seeking works in memory */
+  fail_if((NULL==ambix || 100!=ambix_seek(ambix, 100, SEEK_SET) || 0!=ambix_seek(ambix, 0, SEEK_SET)), __LINE__, "couldn't seek in memory");
+  check_stream(__LINE__, ambix, &info, FRAMES, 1);
+
+  /* edit the buffer in place */
+  memset(&info, 0, sizeof(info));
+  ambix=ambix_open_memory(&data, &size, AMBIX_RDRW, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't open memory for editing");
+  memset(&marker, 0, sizeof(marker));
+  marker.position=42.;
+  strncpy(marker.name, "edited", sizeof(marker.name)-1);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_add_marker(ambix, &marker)), __LINE__, "couldn't add marker");
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing edited stream");
+
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_EXTENDED;
+  check_stream(__LINE__, ambix_open_memory(&data, &size, AMBIX_READ, &info), &info, FRAMES, 2);
+
+  /* garbage */
+  memset(data, 0, (size_t)size);
+  memset(&info, 0, sizeof(info));
+  fail_if((NULL!=ambix_open_memory(&data, &size, AMBIX_READ, &info)), __LINE__, "opened garbage");
+  free(data);
+  fail_if((NULL!=ambix_open_memory(NULL, &size, AMBIX_READ, &info)), __LINE__, "opened NULL buffer");
+  STOPTEST("\n");
+}
+
+static void check_fd(const char*path) {
+  ambix_info_t info;
+  int fd;
+  STARTTEST("\n");
+  fd=open(path, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+  fail_if((fd<0), __LINE__, "couldn't create '%s'", path);
+  set_info(&info);
+  write_stream(__LINE__, ambix_open_fd(fd, AMBIX_WRITE, &info, 1));
+
+  /* the file is an ordinary ambix file */
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_EXTENDED;
+  check_stream(__LINE__, ambix_open(path, AMBIX_READ, &info), &info, FRAMES, 1);
+
+  fd=open(path, O_RDONLY);
+  fail_if((fd<0), __LINE__, "couldn't open '%s'", path);
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_EXTENDED;
+  check_stream(__LINE__, ambix_open_fd(fd, AMBIX_READ, &info, 0), &info, FRAMES, 1);
+  /* we didn't ask to close the descriptor */
+  fail_if((close(fd)), __LINE__, "descriptor was closed");
+
+  ambixtest_rmfile(path);
+  STOPTEST("\n");
+}
+
+#ifndef _WIN32
+static void check_pipe(void) {
+  ambix_info_t info;
+  ambix_t*ambix=NULL;
+  int fds[2], status=0;
+  pid_t pid;
+  STARTTEST("\n");
+  fail_if((pipe(fds)), __LINE__, "couldn't create pipe");
+  pid=fork();
+  fail_if((pid<0), __LINE__, "couldn't fork");
+  if(!pid) {
+    /* the writer */
+    close(fds[0]);
+    set_info(&info);
+    write_stream(__LINE__, ambix_open_fd(fds[1], AMBIX_WRITE, &info, 1));
+    _exit(0);
+  }
+  close(fds[1]);
+
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_EXTENDED;
+  ambix=ambix_open_fd(fds[0], AMBIX_READ, &info, 1);
+  fail_if((NULL==ambix), __LINE__, "couldn't open pipe for reading");
+  /* pipes can only be read sequentially */
+  fail_if((0!=ambix_seek(ambix, 0, SEEK_CUR)), __LINE__, "couldn't stay where we are");
+  fail_if((ambix_seek(ambix, 10, SEEK_SET)>=0), __LINE__, "seeked in a pipe");
+  /* and the length is not known */
+  check_stream(__LINE__, ambix, &info, 0, 1);
+
+  fail_if((waitpid(pid, &status, 0)!=pid || !WIFEXITED(status) || WEXITSTATUS(status)), __LINE__, "writer failed");
+  STOPTEST("\n");
+}
+#endif
+
+/* user-supplied callbacks: an append-only (non-seekable) memory stream */
+typedef struct stream_t {
+  unsigned char data[1<<20];
+  int64_t size, position;
+  int64_t calls;
+} stream_t;
+static int64_t stream_read(void*ptr, int64_t count, void*userdata) {
+  stream_t*x=(stream_t*)userdata;
+  x->calls++;
+  /* deliver the data in small pieces */
+  if(count>1000)
+    count=1000;
+  if(count>x->size-x->position)
+    count=x->size-x->position;
+  memcpy(ptr, x->data+x->position, (size_t)count);
+  x->position+=count;
+  return count;
+}
+static int64_t stream_write(const void*ptr, int64_t count, void*userdata) {
+  stream_t*x=(stream_t*)userdata;
+  x->calls++;
+  if(count>(int64_t)sizeof(x->data)-x->size)
+    count=(int64_t)sizeof(x->data)-x->size;
+  memcpy(x->data+x->size, ptr, (size_t)count);
+  x->size+=count;
+  return count;
+}
+static int64_t stream_noseek(int64_t offset, int whence, void*userdata) {
+  return -1;
+}
+
+static void check_callbacks(void) {
+  static stream_t stream;
+  float32_t frame[2*4]={0};
+  ambix_virtual_io_t vio;
+  ambix_info_t info;
+  ambix_t*ambix=NULL;
+  ambix_marker_t marker;
+  STARTTEST("\n");
+  memset(&vio, 0, sizeof(vio));
+  vio.seek=stream_noseek;
+  vio.read=stream_read;
+  vio.write=stream_write;
+
+  memset(&info, 0, sizeof(info));
+  fail_if((NULL!=ambix_open_virtual(NULL, AMBIX_READ, &info, &stream)), __LINE__, "opened without callbacks");
+  fail_if((NULL!=ambix_open_virtual(&vio, AMBIX_RDRW, &info, &stream)), __LINE__, "opened non-seekable stream for editing");
+
+  set_info(&info);
+  write_stream(__LINE__, ambix_open_virtual(&vio, AMBIX_WRITE, &info, &stream));
+  fail_if((stream.calls<2), __LINE__, "callbacks were not used");
+
+  stream.calls=0;
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_EXTENDED;
+  check_stream(__LINE__, ambix_open_virtual(&vio, AMBIX_READ, &info, &stream), &info, 0, 1);
+  fail_if((stream.calls<2), __LINE__, "callbacks were not used");
+
+  /* the sample data is left open-ended, so nothing can follow it */
+  stream.size=stream.position=0;
+  set_info(&info);
+  info.fileformat=AMBIX_BASIC;
+  info.ambichannels=4;
+  info.extrachannels=0;
+  ambix=ambix_open_virtual(&vio, AMBIX_WRITE, &info, &stream);
+  fail_if((NULL==ambix), __LINE__, "couldn't open stream for writing");
+  fail_if((1!=ambix_writef_float32(ambix, frame, NULL, 1)), __LINE__, "couldn't write");
+  memset(&marker, 0, sizeof(marker));
+  fail_if((AMBIX_ERR_SUCCESS==ambix_add_marker(ambix, &marker)), __LINE__, "added marker after the sample data");
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing stream %p", ambix);
+  memset(&info, 0, sizeof(info));
+  stream.position=0;
+  ambix=ambix_open_virtual(&vio, AMBIX_READ, &info, &stream);
+  fail_if((NULL==ambix || AMBIX_BASIC!=info.fileformat || 4!=info.ambichannels), __LINE__, "couldn't re-open BASIC stream");
+  fail_if((1!=ambix_readf_float32(ambix, frame, NULL, 2)), __LINE__, "couldn't read open-ended stream");
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing stream %p", ambix);
+  STOPTEST("\n");
+}
+
+int main(int argc, char**argv) {
+  check_memory();
+  check_fd(FILENAME_MAIN);
+#ifndef _WIN32
+  check_pipe();
+#endif
+  check_callbacks();
+  return pass();
+}
@@ -0,0 +1,298 @@
+/* writebehind - test writing files in a background thread
+
+   Copyright © 2026 IOhannes m zmölnig <zmoelnig@iem.at>.
+         Institute of Electronic Music and Acoustics (IEM),
+         University of Music and Dramatic Arts, Graz
+
+   This file is part of libambix
+
+   libambix is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   libambix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "common.h"
+#include <string.h>
+
+#define FULLAMBICHANNELS 16
+
+typedef struct {
+  int64_t frames;
+  uint32_t ambichannels, extrachannels;
+  float32_t*ambidata, *otherdata;
+  int16_t*ambidata16, *otherdata16;
+  /* the same data, one channel after the other */
+  float32_t*planar;
+} testdata_t;
+
+static ambix_t*open_write(const char*path, ambix_filemode_t mode, ambix_sampleformat_t format, ambix_matrix_t*matrix, uint32_t extrachannels) {
+  ambix_info_t info;
+  ambix_t*ambix=NULL;
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_BASIC;
+  info.ambichannels=matrix?matrix->cols:FULLAMBICHANNELS;
+  info.extrachannels=extrachannels;
+  info.samplerate=44100;
+  info.sampleformat=format;
+  ambix=ambix_open(path, mode, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't create ambix file '%s' for writing", path);
+  if(matrix)
+    fail_if((AMBIX_ERR_SUCCESS!=ambix_set_adaptormatrix(ambix, matrix)), __LINE__, "failed setting adaptor matrix");
+  return ambix;
+}
+
+/* write the data in blocks of varying size, type and layout */
+static void write_sequence(ambix_t*ambix, const testdata_t*data) {
+  const int64_t blocksizes[]={64, 1000, 40000, 333};
+  const uint32_t ambichannels=data->ambichannels, extrachannels=data->extrachannels;
+  float32_t*ambiplanar[FULLAMBICHANNELS], *otherplanar[FULLAMBICHANNELS];
+  int64_t f, err64;
+  unsigned int block;
+  for(f=0, block=0; f<data->frames; f+=err64, block++) {
+    int64_t count=blocksizes[block%(sizeof(blocksizes)/sizeof(*blocksizes))];
+    uint32_t c;
+    if(count>data->frames-f)
+      count=data->frames-f;
+    switch((block/3)%3) {
+    case 0:
+      err64=ambix_writef_float32(ambix, data->ambidata+f*ambichannels, data->otherdata+f*extrachannels, count);
+      break;
+    case 1:
+      err64=ambix_writef_int16(ambix, data->ambidata16+f*ambichannels, data->otherdata16+f*extrachannels, count);
+      break;
+    default:
+      for(c=0; c<ambichannels; c++)
+        ambiplanar[c]=data->planar+c*data->frames+f;
+      for(c=0; c<extrachannels; c++)
+        otherplanar[c]=data->planar+(ambichannels+c)*data->frames+f;
+      err64=ambix_writef_float32_planar(ambix, ambiplanar, otherplanar, count);
+      break;
+    }
+    fail_if((err64!=count), __LINE__, "wrote only %d frames of %d at %d", (int)err64, (int)count, (int)f);
+  }
+}
+
+static float32_t*read_all(const char*path, uint32_t channels, int64_t frames) {
+  float32_t*result=(float32_t*)data_calloc(FLOAT32, (frames+1)*channels);
+  ambix_info_t info;
+  ambix_t*ambix=NULL;
+  int64_t err64;
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_BASIC;
+  ambix=ambix_open(path, AMBIX_READ, &info);
+  fail_if((NULL==ambix), __LINE__, "couldn't open ambix file '%s' for reading", path);
+  fail_if((info.frames!=frames), __LINE__, "file has %d frames (expected %d)", (int)info.frames, (int)frames);
+  err64=ambix_readf_float32(ambix, result, result+frames*info.ambichannels, frames);
+  fail_if((err64!=frames), __LINE__, "read only %d frames of %d", (int)err64, (int)frames);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+  return result;
+}
+
+static void check_writebehind(const char*path, ambix_sampleformat_t format, int use_matrix) {
+  const uint32_t rawambichannels=use_matrix?9:FULLAMBICHANNELS, extrachannels=use_matrix?2:0;
+  const uint32_t channels=FULLAMBICHANNELS+extrachannels;
+  const int64_t frames=100000+17;
+  ambix_matrix_t*matrix=NULL;
+  float32_t*expected=NULL, *result=NULL;
+  testdata_t data;
+  ambix_t*ambix=NULL;
+  int64_t err64, queued, highwater;
+  uint64_t overruns, dropped;
+  uint32_t c;
+  int64_t f;
+  STARTTEST("format=%d, matrix=%d\n", format, use_matrix);
+
+  data.frames=frames;
+  data.ambichannels=FULLAMBICHANNELS;
+  data.extrachannels=extrachannels;
+  data.ambidata=(float32_t*)data_sine(FLOAT32, frames, FULLAMBICHANNELS, 1000);
+  data.otherdata=(float32_t*)data_ramp(FLOAT32, frames, extrachannels);
+  data.ambidata16=(int16_t*)data_sine(INT16, frames, FULLAMBICHANNELS, 1000);
+  data.otherdata16=(int16_t*)data_ramp(INT16, frames, extrachannels);
+  data.planar=(float32_t*)data_calloc(FLOAT32, frames*channels);
+  for(f=0; f<frames; f++) {
+    for(c=0; c<FULLAMBICHANNELS; c++)
+      data.planar[c*frames+f]=data.ambidata[f*FULLAMBICHANNELS+c];
+    for(c=0; c<extrachannels; c++)
+      data.planar[(FULLAMBICHANNELS+c)*frames+f]=data.otherdata[f*extrachannels+c];
+  }
+  if(use_matrix) {
+    uint32_t r;
+    matrix=ambix_matrix_init(FULLAMBICHANNELS, rawambichannels, NULL);
+    for(r=0; r<FULLAMBICHANNELS; r++)
+      for(c=0; c<rawambichannels; c++)
+        matrix->data[r][c]=(float32_t)(((r*rawambichannels+c)*7919)%101)/101. - 0.5;
+  }
+
+  /* reference: write synchronously */
+  ambix=open_write(path, AMBIX_WRITE, format, matrix, extrachannels);
+  fail_if((AMBIX_ERR_SUCCESS==ambix_set_backpressure(ambix, AMBIX_BACKPRESSURE_DROP)), __LINE__, "set back-pressure without AMBIX_WRITEBEHIND");
+  write_sequence(ambix, &data);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+  expected=read_all(path, channels, frames);
+
+  /* the same in the background */
+  ambix=open_write(path, AMBIX_WRITE|AMBIX_WRITEBEHIND, format, matrix, extrachannels);
+  write_sequence(ambix, &data);
+  if(AMBIX_ERR_SUCCESS==ambix_get_writebehind(ambix, &queued, &highwater, &overruns, &dropped)) {
+    fail_if((queued<0 || queued>highwater), __LINE__, "invalid queue state %d/%d", (int)queued, (int)highwater);
+    fail_if((highwater<1), __LINE__, "nothing was ever queued");
+    fail_if((dropped!=0), __LINE__, "dropped %d frames while blocking", (int)dropped);
+  } else {
+    printf("writing in the background is not supported\n");
+  }
+  /* closing flushes the queue */
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+  result=read_all(path, channels, frames);
+  fail_if(memcmp(expected, result, frames*channels*sizeof(*result)), __LINE__, "data written in the background differs");
+  free(result);
+
+  /* seeking waits for the queue */
+  ambix=open_write(path, AMBIX_WRITE|AMBIX_WRITEBEHIND, format, matrix, extrachannels);
+  err64=ambix_writef_float32(ambix, data.ambidata, data.otherdata, 1000);
+  fail_if((err64!=1000), __LINE__, "wrote only %d frames of 1000", (int)err64);
+  fail_if((ambix_seek(ambix, 0, SEEK_CUR)!=1000), __LINE__, "wrong position after writing");
+  if(AMBIX_ERR_SUCCESS==ambix_get_writebehind(ambix, &queued, NULL, NULL, NULL))
+    fail_if((queued!=0), __LINE__, "%d frames still queued after seeking", (int)queued);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+  ambixtest_rmfile(path);
+  free(expected);
+  free(data.ambidata);
+  free(data.otherdata);
+  free(data.ambidata16);
+  free(data.otherdata16);
+  free(data.planar);
+  if(matrix)
+    ambix_matrix_destroy(matrix);
+  STOPTEST("format=%d, matrix=%d\n", format, use_matrix);
+}
+
+/* what happens if the queue is full */
+static void check_backpressure(const char*path) {
+  /* more than fits into the queue */
+  const int64_t hugeframes=1<<20;
+  const int64_t frames=1000;
+  float32_t*ambidata=(float32_t*)data_sine(FLOAT32, hugeframes, FULLAMBICHANNELS, 1000);
+  float32_t*expected=NULL;
+  ambix_t*ambix=NULL;
+  int64_t err64, queued, highwater;
+  uint64_t overruns, dropped;
+  STARTTEST("\n");
+
+  fail_if((NULL!=ambix_open(path, AMBIX_READ|AMBIX_WRITEBEHIND, NULL)), __LINE__, "opened '%s' for reading in write-behind mode", path);
+
+  ambix=open_write(path, AMBIX_WRITE|AMBIX_WRITEBEHIND, AMBIX_SAMPLEFORMAT_FLOAT32, NULL, 0);
+  if(AMBIX_ERR_SUCCESS!=ambix_get_writebehind(ambix, NULL, NULL, NULL, NULL)) {
+    printf("writing in the background is not supported\n");
+    fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+    ambixtest_rmfile(path);
+    free(ambidata);
+    STOPTEST("\n");
+    return;
+  }
+  fail_if((AMBIX_ERR_SUCCESS==ambix_set_backpressure(ambix, (ambix_backpressure_t)42)), __LINE__, "set invalid back-pressure policy");
+
+  err64=ambix_writef_float32(ambix, ambidata, NULL, frames);
+  fail_if((err64!=frames), __LINE__, "wrote only %d frames of %d", (int)err64, (int)frames);
+
+  /* blocks that do not fit are dropped as a whole */
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_set_backpressure(ambix, AMBIX_BACKPRESSURE_DROP)), __LINE__, "couldn't set DROP policy");
+  err64=ambix_writef_float32(ambix, ambidata, NULL, hugeframes);
+  fail_if((err64!=hugeframes), __LINE__, "dropping returned %d (expected %d)", (int)err64, (int)hugeframes);
+  ambix_get_writebehind(ambix, NULL, NULL, &overruns, &dropped);
+  fail_if((overruns!=1), __LINE__, "%d overruns (expected 1)", (int)overruns);
+  fail_if(((int64_t)dropped!=hugeframes), __LINE__, "dropped %d frames (expected %d)", (int)dropped, (int)hugeframes);
+
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_set_backpressure(ambix, AMBIX_BACKPRESSURE_ERROR)), __LINE__, "couldn't set ERROR policy");
+  err64=ambix_writef_float32(ambix, ambidata, NULL, hugeframes);
+  fail_if((err64>=0), __LINE__, "overrun did not fail (%d)", (int)err64);
+  ambix_get_writebehind(ambix, NULL, NULL, &overruns, &dropped);
+  fail_if((overruns!=2), __LINE__, "%d overruns (expected 2)", (int)overruns);
+  fail_if(((int64_t)dropped!=hugeframes), __LINE__, "dropped %d frames (expected %d)", (int)dropped, (int)hugeframes);
+
+  /* small blocks still go through */
+  err64=ambix_writef_float32(ambix, ambidata+frames*FULLAMBICHANNELS, NULL, frames);
+  fail_if((err64!=frames), __LINE__, "wrote only %d frames of %d", (int)err64, (int)frames);
+
+  /* blocking waits for the writer thread */
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_set_backpressure(ambix, AMBIX_BACKPRESSURE_BLOCK)), __LINE__, "couldn't set BLOCK policy");
+  err64=ambix_writef_float32(ambix, ambidata+2*frames*FULLAMBICHANNELS, NULL, hugeframes-2*frames);
+  fail_if((err64!=hugeframes-2*frames), __LINE__, "wrote only %d frames of %d", (int)err64, (int)(hugeframes-2*frames));
+  ambix_get_writebehind(ambix, &queued, &highwater, &overruns, NULL);
+  fail_if((overruns!=3), __LINE__, "%d overruns (expected 3)", (int)overruns);
+  fail_if((highwater<queued || highwater>=hugeframes), __LINE__, "invalid high-water mark %d", (int)highwater);
+  fail_if((AMBIX_ERR_SUCCESS!=ambix_close(ambix)), __LINE__, "closing ambix file %p", ambix);
+
+  expected=read_all(path, FULLAMBICHANNELS, hugeframes);
+  fail_if(memcmp(expected, ambidata, hugeframes*FULLAMBICHANNELS*sizeof(*ambidata)), __LINE__, "data written in the background differs");
+
+  ambixtest_rmfile(path);
+  free(ambidata);
+  free(expected);
+  STOPTEST("\n");
+}
+
+/* a stream that refuses to take more than a few bytes */
+static int64_t broken_written=0;
+static int64_t broken_write(const void*ptr, int64_t count, void*userdata) {
+  if(broken_written+count > 4096)
+    return -1;
+  broken_written+=count;
+  return count;
+}
+static int64_t broken_seek(int64_t offset, int whence, void*userdata) {
+  return -1;
+}
+
+static void check_failure(void) {
+  const int64_t frames=1000;
+  float32_t*ambidata=(float32_t*)data_sine(FLOAT32, frames, 4, 1000);
+  ambix_virtual_io_t vio;
+  ambix_info_t info;
+  ambix_t*ambix=NULL;
+  int64_t err64;
+  STARTTEST("\n");
+  memset(&vio, 0, sizeof(vio));
+  vio.seek=broken_seek;
+  vio.write=broken_write;
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_BASIC;
+  info.ambichannels=4;
+  info.samplerate=44100;
+  info.sampleformat=AMBIX_SAMPLEFORMAT_FLOAT32;
+  ambix=ambix_open_virtual(&vio, AMBIX_WRITE|AMBIX_WRITEBEHIND, &info, NULL);
+  fail_if((NULL==ambix), __LINE__, "couldn't open stream for writing in the background");
+  if(AMBIX_ERR_SUCCESS!=ambix_get_writebehind(ambix, NULL, NULL, NULL, NULL)) {
+    printf("writing in the background is not supported\n");
+  } else {
+    err64=ambix_writef_float32(ambix, ambidata, NULL, frames);
+    fail_if((err64!=frames), __LINE__, "queued only %d frames of %d", (int)err64, (int)frames);
+    /* the failure of the writer thread is reported when draining the queue */
+    err64=ambix_seek(ambix, 0, SEEK_CUR);
+    fail_if((err64>=0), __LINE__, "seeking after a failed write returned %d", (int)err64);
+  }
+  ambix_close(ambix);
+  free(ambidata);
+  STOPTEST("\n");
+}
+
+int main(int argc, char**argv) {
+  const char*path=FILENAME_MAIN;
+  check_writebehind(path, AMBIX_SAMPLEFORMAT_FLOAT32, 0);
+  check_writebehind(path, AMBIX_SAMPLEFORMAT_FLOAT32, 1);
+  check_writebehind(path, AMBIX_SAMPLEFORMAT_PCM24, 1);
+  check_backpressure(path);
+  check_failure();
+  return pass();
+}
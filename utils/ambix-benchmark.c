@@ -0,0 +1,1022 @@
+/* ambix-benchmark -  measure the performance of libambix              -*- c -*-
+
+   Copyright © 2026 IOhannes m zmölnig <zmoelnig@iem.at>.
+         Institute of Electronic Music and Acoustics (IEM),
+         University of Music and Dramatic Arts, Graz
+
+   This file is part of libambix
+
+   libambix is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   libambix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+*/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include "ambix/ambix.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifdef _WIN32
+# include <windows.h>
+#else
+# include <time.h>
+#endif
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif
+
+void print_version(const char*name);
+void print_usage(const char*name);
+
+/* wallclock time in seconds */
+static double now(void) {
+#ifdef _WIN32
+  LARGE_INTEGER freq, count;
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&count);
+  return (double)count.QuadPart/(double)freq.QuadPart;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec*1e-9;
+#endif
+}
+
+/* number of multiply-accumulates per measurement */
+#define BENCHMARK_MACS (1<<30)
+
+static ambix_matrix_t*random_matrix(uint32_t rows, uint32_t cols) {
+  ambix_matrix_t*mtx=ambix_matrix_init(rows, cols, NULL);
+  uint32_t r, c;
+  if(!mtx)
+    return NULL;
+  for(r=0; r<rows; r++)
+    for(c=0; c<cols; c++)
+      mtx->data[r][c]=((float32_t)rand())/((float32_t)RAND_MAX) * 2.f - 1.f;
+  return mtx;
+}
+
+/* the matrix benchmarks measure the deprecated (but still public) entry points,
+ * so silence the deprecation warnings for them (and only them) */
+#if defined(__GNUC__)
+# pragma GCC diagnostic push
+# pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+#elif defined(_MSC_VER)
+# pragma warning(push)
+# pragma warning(disable: 4996)
+#endif
+static ambix_matrix_t*matrix_multiply(const ambix_matrix_t*A, const ambix_matrix_t*B, ambix_matrix_t*result) {
+  return ambix_matrix_multiply(A, B, result);
+}
+static ambix_matrix_t*matrix_pinv(const ambix_matrix_t*matrix, ambix_matrix_t*pinv) {
+  return ambix_matrix_pinv(matrix, pinv);
+}
+#if defined(__GNUC__)
+# pragma GCC diagnostic pop
+#elif defined(_MSC_VER)
+# pragma warning(pop)
+#endif
+
+/* multiply a matrix with blocks of various sizes */
+#define BENCHMARK_MATRIX(typ, scale)                                    \
+  static void benchmark_matrix_##typ(uint32_t channels, int64_t frames) { \
+    ambix_matrix_t*mtx=random_matrix(channels, channels);               \
+    typ##_t*source=(typ##_t*)calloc(channels*frames, sizeof(typ##_t)); \
+    typ##_t*dest=(typ##_t*)calloc(channels*frames, sizeof(typ##_t));   \
+    int64_t reps=BENCHMARK_MACS/(frames*channels*channels), i;         \
+    double start, duration;                                             \
+    if(!mtx || !source || !dest) {                                      \
+      printf("out of memory\n");                                        \
+      goto done;                                                        \
+    }                                                                   \
+    if(reps<1)reps=1;                                                   \
+    for(i=0; i<channels*frames; i++)                                    \
+      source[i]=(typ##_t)((((float32_t)rand())/((float32_t)RAND_MAX) - .5f) * scale); \
+    /* warmup */                                                        \
+    ambix_matrix_multiply_##typ(dest, mtx, source, frames);             \
+    start=now();                                                        \
+    for(i=0; i<reps; i++)                                               \
+      ambix_matrix_multiply_##typ(dest, mtx, source, frames);           \
+    duration=now()-start;                                               \
+    printf("matrix\t%-8s %3dx%-3d %6d frames: %8.2f Mframes/s  %7.2f GMAC/s\n", \
+           #typ, channels, channels, (int)frames,                       \
+           reps*frames/duration*1e-6,                                   \
+           reps*frames*channels*channels/duration*1e-9);                \
+  done:                                                                 \
+    ambix_matrix_destroy(mtx);                                          \
+    free(source);                                                       \
+    free(dest);                                                         \
+  }
+BENCHMARK_MATRIX(float32, 1.)
+BENCHMARK_MATRIX(int16, 32767.)
+
+static void benchmark_matrix(void) {
+  const uint32_t channels[]={4, 16, 64, 121};
+  const int64_t frames[]={64, 1024, 65536};
+  unsigned int c, f;
+  for(c=0; c<sizeof(channels)/sizeof(*channels); c++)
+    for(f=0; f<sizeof(frames)/sizeof(*frames); f++)
+      benchmark_matrix_float32(channels[c], frames[f]);
+  for(c=0; c<sizeof(channels)/sizeof(*channels); c++)
+    for(f=0; f<sizeof(frames)/sizeof(*frames); f++)
+      benchmark_matrix_int16(channels[c], frames[f]);
+}
+
+/* throughput and accuracy of the precision modes, with normal and denormal input */
+static void benchmark_precision(void) {
+  const uint32_t channels[]={16, 64, 121};
+  const int64_t frames=1024;
+  const struct {
+    const char*name;
+    ambix_precision_t precision;
+  } modes[]={
+    {"fast", AMBIX_PRECISION_FAST},
+    {"double", AMBIX_PRECISION_DOUBLE},
+    {"kahan", AMBIX_PRECISION_KAHAN},
+    {"fast+ftz", AMBIX_PRECISION_FAST|AMBIX_PRECISION_FLUSH_DENORMALS},
+    {"double+ftz", AMBIX_PRECISION_DOUBLE|AMBIX_PRECISION_FLUSH_DENORMALS},
+  };
+  const struct {
+    const char*name;
+    float32_t scale;
+  } signals[]={{"normal", 1.}, {"denormal", 1e-40}};
+  unsigned int c, m, s;
+  for(c=0; c<sizeof(channels)/sizeof(*channels); c++) {
+    const uint32_t chans=channels[c];
+    ambix_matrix_t*mtx=random_matrix(chans, chans);
+    float32_t*source=(float32_t*)calloc(chans*frames, sizeof(float32_t));
+    float32_t*dest=(float32_t*)calloc(chans*frames, sizeof(float32_t));
+    long double*reference=(long double*)calloc(chans*frames, sizeof(long double));
+    int64_t reps=BENCHMARK_MACS/(frames*chans*chans)/4, i;
+    if(reps<1)reps=1;
+    if(!mtx || !source || !dest || !reference) {
+      printf("out of memory\n");
+      goto done;
+    }
+    for(s=0; s<sizeof(signals)/sizeof(*signals); s++) {
+      long double maxref=0.;
+      int64_t f;
+      uint32_t r, k;
+      for(i=0; i<chans*frames; i++)
+        source[i]=(((float32_t)rand())/((float32_t)RAND_MAX) - .5f) * signals[s].scale;
+      for(f=0; f<frames; f++)
+        for(r=0; r<chans; r++) {
+          long double sum=0.;
+          for(k=0; k<chans; k++)
+            sum+=(long double)mtx->data[r][k]*source[f*chans+k];
+          reference[f*chans+r]=sum;
+          if(fabsl(sum)>maxref)maxref=fabsl(sum);
+        }
+      for(m=0; m<sizeof(modes)/sizeof(*modes); m++) {
+        double start, duration;
+        long double err=0.;
+        /* warmup */
+        ambix_matrix_multiply_float32_precision(dest, mtx, source, frames, modes[m].precision);
+        for(i=0; i<chans*frames; i++)
+          if(fabsl(dest[i]-reference[i])>err)err=fabsl(dest[i]-reference[i]);
+        start=now();
+        for(i=0; i<reps; i++)
+          ambix_matrix_multiply_float32_precision(dest, mtx, source, frames, modes[m].precision);
+        duration=now()-start;
+        printf("precision\t%-10s %-8s %3dx%-3d: %8.2f Mframes/s  max.error %g\n",
+               modes[m].name, signals[s].name, chans, chans,
+               reps*frames/duration*1e-6,
+               (double)((maxref>0.)?err/maxref:err));
+      }
+    }
+  done:
+    ambix_matrix_destroy(mtx);
+    free(source);
+    free(dest);
+    free(reference);
+  }
+}
+
+/* multiply matrices of various sizes with each other */
+static void benchmark_multiply(void) {
+  const uint32_t sizes[]={16, 64, 121, 256};
+  unsigned int s;
+  for(s=0; s<sizeof(sizes)/sizeof(*sizes); s++) {
+    const uint32_t size=sizes[s];
+    ambix_matrix_t*left=random_matrix(size, size);
+    ambix_matrix_t*right=random_matrix(size, size);
+    ambix_matrix_t*result=ambix_matrix_init(size, size, NULL);
+    int64_t reps=BENCHMARK_MACS/((int64_t)size*size*size)/8, i;
+    double start, duration;
+    if(reps<1)reps=1;
+    if(left && right && result) {
+      matrix_multiply(left, right, result);
+      start=now();
+      for(i=0; i<reps; i++)
+        matrix_multiply(left, right, result);
+      duration=now()-start;
+      printf("multiply\t%3dx%-3d: %10.2f us  %7.2f GMAC/s\n",
+             size, size, duration/reps*1e6,
+             reps*(double)size*size*size/duration*1e-9);
+    } else {
+      printf("out of memory\n");
+    }
+    if(left)ambix_matrix_destroy(left);
+    if(right)ambix_matrix_destroy(right);
+    if(result)ambix_matrix_destroy(result);
+  }
+}
+
+/* relative residual max|A*P*A-A|/max|A| of a pseudo-inverse P */
+static double pinv_residual(const ambix_matrix_t*A, const ambix_matrix_t*P) {
+  ambix_matrix_t*AP=matrix_multiply(A, P, NULL);
+  double maxA=0., err=0.;
+  uint32_t r, c, i;
+  if(!AP)
+    return -1.;
+  for(r=0; r<A->rows; r++)
+    for(c=0; c<A->cols; c++) {
+      double sum=0., a=A->data[r][c];
+      for(i=0; i<A->rows; i++)
+        sum+=(double)AP->data[r][i]*A->data[i][c];
+      sum-=a;
+      if(a<0.)a=-a;
+      if(sum<0.)sum=-sum;
+      if(a>maxA)maxA=a;
+      if(sum>err)err=sum;
+    }
+  ambix_matrix_destroy(AP);
+  return (maxA>0.)?err/maxA:err;
+}
+/* pseudo-invert (reduced set) matrices of various sizes and condition */
+static void benchmark_pinv(void) {
+  const struct {
+    uint32_t rows, cols;
+    /* the columns are scaled down to 'dynamics', to make the matrix ill-conditioned */
+    float32_t dynamics;
+  } sizes[]={{16, 9, 1.}, {64, 49, 1.}, {64, 49, 1e-3}, {121, 100, 1.}, {256, 200, 1.}, {256, 256, 1.}};
+  unsigned int s;
+  for(s=0; s<sizeof(sizes)/sizeof(*sizes); s++) {
+    const uint32_t rows=sizes[s].rows, cols=sizes[s].cols;
+    ambix_matrix_t*mtx=random_matrix(rows, cols);
+    ambix_matrix_t*pinv=ambix_matrix_init(cols, rows, NULL);
+    int64_t reps=BENCHMARK_MACS/((int64_t)rows*cols*cols)/64, i;
+    double start, duration;
+    uint32_t r, c;
+    if(reps<1)reps=1;
+    if(mtx && pinv) {
+      float32_t scale=1.;
+      for(c=0; c<cols; c++) {
+        for(r=0; r<rows; r++)
+          mtx->data[r][c]*=scale;
+        scale*=(float32_t)pow(sizes[s].dynamics, 1./cols);
+      }
+      matrix_pinv(mtx, pinv);
+      start=now();
+      for(i=0; i<reps; i++)
+        matrix_pinv(mtx, pinv);
+      duration=now()-start;
+      printf("pinv\t%3dx%-3d (dynamics %g): %10.2f us  residual %g\n",
+             rows, cols, sizes[s].dynamics, duration/reps*1e6,
+             pinv_residual(mtx, pinv));
+    } else {
+      printf("out of memory\n");
+    }
+    if(mtx)ambix_matrix_destroy(mtx);
+    if(pinv)ambix_matrix_destroy(pinv);
+  }
+}
+
+/* a scratch file for the I/O benchmarks */
+static const char*tmpfilename(void) {
+  static char filename[1024];
+  const char*tmpdir=getenv("TMPDIR");
+  if(!tmpdir)
+    tmpdir=".";
+  snprintf(filename, sizeof(filename), "%s/ambix-benchmark.caf", tmpdir);
+  return filename;
+}
+
+static uint32_t num_cpus(void) {
+  long cpus=1;
+#if defined _WIN32
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  cpus=info.dwNumberOfProcessors;
+#elif defined HAVE_UNISTD_H && defined _SC_NPROCESSORS_ONLN
+  cpus=sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+  return (cpus>1)?(uint32_t)cpus:1;
+}
+
+/* write and read back BASIC files in various sample formats */
+#define BENCHMARK_IO_FRAMES (1<<19)
+#define BENCHMARK_IO_BLOCKSIZE 4096
+static void benchmark_io(void) {
+  const char*filename=tmpfilename();
+  const uint32_t channels=16;
+  const struct {
+    ambix_sampleformat_t format;
+    const char*name;
+    uint32_t samplesize;
+  } formats[]={
+    {AMBIX_SAMPLEFORMAT_FLOAT32, "float32", 4},
+    {AMBIX_SAMPLEFORMAT_PCM16, "pcm16", 2},
+    {AMBIX_SAMPLEFORMAT_PCM24, "pcm24", 3},
+  };
+  float32_t*data=(float32_t*)calloc(channels*BENCHMARK_IO_BLOCKSIZE, sizeof(float32_t));
+  unsigned int i;
+  int64_t f;
+  if(!data) {
+    printf("out of memory\n");
+    return;
+  }
+  for(f=0; f<channels*BENCHMARK_IO_BLOCKSIZE; f++)
+    data[f]=((float32_t)rand())/((float32_t)RAND_MAX) * 2.f - 1.f;
+
+  for(i=0; i<sizeof(formats)/sizeof(*formats); i++) {
+    const double megabytes=(double)BENCHMARK_IO_FRAMES*channels*formats[i].samplesize*1e-6;
+    ambix_info_t info;
+    ambix_t*ambix=NULL;
+    double start, writetime, readtime;
+    int64_t frames=0, got;
+
+    memset(&info, 0, sizeof(info));
+    info.fileformat=AMBIX_BASIC;
+    info.ambichannels=channels;
+    info.samplerate=48000;
+    info.sampleformat=formats[i].format;
+    start=now();
+    ambix=ambix_open(filename, AMBIX_WRITE, &info);
+    if(!ambix) {
+      printf("io\tcannot create '%s'\n", filename);
+      break;
+    }
+    for(f=0; f<BENCHMARK_IO_FRAMES; f+=BENCHMARK_IO_BLOCKSIZE)
+      ambix_writef_float32(ambix, data, NULL, BENCHMARK_IO_BLOCKSIZE);
+    ambix_close(ambix);
+    writetime=now()-start;
+
+    memset(&info, 0, sizeof(info));
+    start=now();
+    ambix=ambix_open(filename, AMBIX_READ, &info);
+    if(!ambix) {
+      printf("io\tcannot open '%s'\n", filename);
+      break;
+    }
+    do {
+      got=ambix_readf_float32(ambix, data, NULL, BENCHMARK_IO_BLOCKSIZE);
+      frames+=got;
+    } while(got>0);
+    ambix_close(ambix);
+    readtime=now()-start;
+
+    printf("io\t%2d channels %-8s: write %8.2f Mframes/s (%7.1f MB/s)  read %8.2f Mframes/s (%7.1f MB/s)\n",
+           channels, formats[i].name,
+           BENCHMARK_IO_FRAMES/writetime*1e-6, megabytes/writetime,
+           frames/readtime*1e-6, megabytes/readtime);
+  }
+  remove(filename);
+  free(data);
+}
+
+/* read a float32 file via stdio, via the mapping, and without copying */
+static void benchmark_mmap(void) {
+  const char*filename=tmpfilename();
+  const uint32_t channels=16;
+  const int64_t frames=BENCHMARK_IO_FRAMES*2;
+  const double megabytes=(double)frames*channels*sizeof(float32_t)*1e-6;
+  const struct {
+    ambix_filemode_t mode;
+    int zerocopy;
+    const char*name;
+  } modes[]={
+    {AMBIX_READ, 0, "readf"},
+    {AMBIX_READ|AMBIX_MMAP, 0, "readf+mmap"},
+    {AMBIX_READ|AMBIX_MMAP, 1, "map_frames"},
+  };
+  float32_t*data=(float32_t*)calloc(channels*BENCHMARK_IO_BLOCKSIZE, sizeof(float32_t));
+  ambix_info_t info;
+  ambix_t*ambix=NULL;
+  unsigned int i, run;
+  int64_t f;
+  if(!data) {
+    printf("out of memory\n");
+    return;
+  }
+  for(f=0; f<channels*BENCHMARK_IO_BLOCKSIZE; f++)
+    data[f]=((float32_t)rand())/((float32_t)RAND_MAX) * 2.f - 1.f;
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_BASIC;
+  info.ambichannels=channels;
+  info.samplerate=48000;
+  info.sampleformat=AMBIX_SAMPLEFORMAT_FLOAT32;
+  ambix=ambix_open(filename, AMBIX_WRITE, &info);
+  if(!ambix) {
+    printf("mmap\tcannot create '%s'\n", filename);
+    free(data);
+    return;
+  }
+  for(f=0; f<frames; f+=BENCHMARK_IO_BLOCKSIZE)
+    ambix_writef_float32(ambix, data, NULL, BENCHMARK_IO_BLOCKSIZE);
+  ambix_close(ambix);
+
+  for(i=0; i<sizeof(modes)/sizeof(*modes); i++) {
+    /* the first run warms up the page cache */
+    for(run=0; run<4; run++) {
+      double start=now(), duration;
+      float32_t sum=0.f;
+      int64_t got;
+      memset(&info, 0, sizeof(info));
+      ambix=ambix_open(filename, modes[i].mode, &info);
+      if(!ambix) {
+        printf("mmap\tcannot open '%s'\n", filename);
+        break;
+      }
+      f=0;
+      do {
+        const float32_t*samples=data;
+        int64_t n;
+        if(modes[i].zerocopy)
+          got=ambix_map_frames(ambix, &samples, BENCHMARK_IO_BLOCKSIZE);
+        else
+          got=ambix_readf_float32(ambix, data, NULL, BENCHMARK_IO_BLOCKSIZE);
+        /* touch all the data (like an analysis would) */
+        for(n=0; n<got*channels; n++)
+          sum+=samples[n];
+        f+=(got>0)?got:0;
+      } while(got>0);
+      ambix_close(ambix);
+      duration=now()-start;
+      if(run)
+        printf("mmap\t%-10s (%d): %9.3f ms  %8.1f MB/s  [%d frames, %g]\n",
+               modes[i].name, run, duration*1000., megabytes/duration, (int)f, sum);
+    }
+  }
+  remove(filename);
+  free(data);
+}
+
+/* read a file like an audio callback would (small blocks at a fixed rate),
+ * and measure how long each call to ambix_readf() takes */
+#define BENCHMARK_PREFETCH_BLOCKSIZE 256
+static void benchmark_prefetch(void) {
+  const char*filename=tmpfilename();
+  const uint32_t channels=16;
+  const int64_t frames=BENCHMARK_IO_FRAMES;
+  /* 8 times faster than realtime at 48kHz */
+  const double period=BENCHMARK_PREFETCH_BLOCKSIZE/48000./8.;
+  const struct {
+    ambix_filemode_t mode;
+    const char*name;
+  } modes[]={
+    {AMBIX_READ, "readf"},
+    {AMBIX_READ|AMBIX_PREFETCH, "readf+prefetch"},
+  };
+  float32_t*data=(float32_t*)calloc(channels*BENCHMARK_IO_BLOCKSIZE, sizeof(float32_t));
+  ambix_info_t info;
+  ambix_t*ambix=NULL;
+  unsigned int i;
+  int64_t f;
+  if(!data) {
+    printf("out of memory\n");
+    return;
+  }
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_BASIC;
+  info.ambichannels=channels;
+  info.samplerate=48000;
+  info.sampleformat=AMBIX_SAMPLEFORMAT_PCM24;
+  ambix=ambix_open(filename, AMBIX_WRITE, &info);
+  if(!ambix) {
+    printf("prefetch\tcannot create '%s'\n", filename);
+    free(data);
+    return;
+  }
+  for(f=0; f<channels*BENCHMARK_IO_BLOCKSIZE; f++)
+    data[f]=((float32_t)rand())/((float32_t)RAND_MAX) * 2.f - 1.f;
+  for(f=0; f<frames; f+=BENCHMARK_IO_BLOCKSIZE)
+    ambix_writef_float32(ambix, data, NULL, BENCHMARK_IO_BLOCKSIZE);
+  ambix_close(ambix);
+
+  for(i=0; i<sizeof(modes)/sizeof(*modes); i++) {
+    double deadline, total=0., worst=0.;
+    uint64_t underruns=0;
+    int64_t calls=0, got;
+    memset(&info, 0, sizeof(info));
+    ambix=ambix_open(filename, modes[i].mode, &info);
+    if(!ambix) {
+      printf("prefetch\tcannot open '%s'\n", filename);
+      break;
+    }
+    /* pre-roll: give the reader thread a chance to fill the ring */
+    if(modes[i].mode & AMBIX_PREFETCH) {
+      int64_t available=0, size=0;
+      deadline=now()+1.;
+      while(AMBIX_ERR_SUCCESS==ambix_get_prefetch(ambix, &available, &size, NULL)
+            && available<size && now()<deadline);
+    }
+    deadline=now();
+    do {
+      double start, duration;
+      /* wait for the next period */
+      while((start=now()) < deadline);
+      deadline+=period;
+      got=ambix_readf_float32(ambix, data, NULL, BENCHMARK_PREFETCH_BLOCKSIZE);
+      duration=now()-start;
+      total+=duration;
+      if(duration>worst)
+        worst=duration;
+      calls++;
+    } while(got>0);
+    ambix_get_prefetch(ambix, NULL, NULL, &underruns);
+    ambix_close(ambix);
+    printf("prefetch\t%-14s: %6d calls of %d frames, average %7.2f us, worst %8.2f us, %d underruns\n",
+           modes[i].name, (int)calls, BENCHMARK_PREFETCH_BLOCKSIZE,
+           total/calls*1e6, worst*1e6, (int)underruns);
+  }
+  remove(filename);
+  free(data);
+}
+
+/* write a 3rd order EXTENDED file like an audio callback would,
+ * and measure how long each call to ambix_writef() takes */
+static void benchmark_writebehind(void) {
+  const char*filename=tmpfilename();
+  const uint32_t fullchannels=16, channels=9;
+  const int64_t frames=BENCHMARK_IO_FRAMES;
+  /* 8 times faster than realtime at 48kHz */
+  const double period=BENCHMARK_PREFETCH_BLOCKSIZE/48000./8.;
+  const struct {
+    ambix_filemode_t mode;
+    const char*name;
+  } modes[]={
+    {AMBIX_WRITE, "writef"},
+    {AMBIX_WRITE|AMBIX_WRITEBEHIND, "writef+behind"},
+  };
+  ambix_matrix_t*mtx=random_matrix(fullchannels, channels);
+  float32_t*data=(float32_t*)calloc(fullchannels*BENCHMARK_PREFETCH_BLOCKSIZE, sizeof(float32_t));
+  unsigned int i;
+  int64_t f;
+  if(!mtx || !data) {
+    printf("out of memory\n");
+    goto done;
+  }
+  for(f=0; f<fullchannels*BENCHMARK_PREFETCH_BLOCKSIZE; f++)
+    data[f]=((float32_t)rand())/((float32_t)RAND_MAX) * 2.f - 1.f;
+
+  for(i=0; i<sizeof(modes)/sizeof(*modes); i++) {
+    double deadline, start, total=0., worst=0., closetime;
+    int64_t highwater=0;
+    uint64_t overruns=0;
+    ambix_info_t info;
+    ambix_t*ambix=NULL;
+    int64_t calls=0;
+    memset(&info, 0, sizeof(info));
+    info.fileformat=AMBIX_BASIC;
+    info.ambichannels=channels;
+    info.samplerate=48000;
+    info.sampleformat=AMBIX_SAMPLEFORMAT_PCM24;
+    ambix=ambix_open(filename, modes[i].mode, &info);
+    if(!ambix || AMBIX_ERR_SUCCESS!=ambix_set_adaptormatrix(ambix, mtx)) {
+      printf("writebehind\tcannot create '%s'\n", filename);
+      if(ambix)
+        ambix_close(ambix);
+      break;
+    }
+    deadline=now();
+    for(f=0; f<frames; f+=BENCHMARK_PREFETCH_BLOCKSIZE) {
+      double duration;
+      /* wait for the next period */
+      while((start=now()) < deadline);
+      deadline+=period;
+      ambix_writef_float32(ambix, data, NULL, BENCHMARK_PREFETCH_BLOCKSIZE);
+      duration=now()-start;
+      total+=duration;
+      if(duration>worst)
+        worst=duration;
+      calls++;
+    }
+    ambix_get_writebehind(ambix, NULL, &highwater, &overruns, NULL);
+    start=now();
+    ambix_close(ambix);
+    closetime=now()-start;
+    printf("writebehind\t%-13s: %6d calls of %d frames, average %7.2f us, worst %8.2f us, close %7.2f ms, high-water %d frames, %d overruns\n",
+           modes[i].name, (int)calls, BENCHMARK_PREFETCH_BLOCKSIZE,
+           total/calls*1e6, worst*1e6, closetime*1e3, (int)highwater, (int)overruns);
+  }
+ done:
+  remove(filename);
+  if(mtx)
+    ambix_matrix_destroy(mtx);
+  free(data);
+}
+
+/* open (and close) a set of files with many markers and regions,
+ * with and without looking at the markers */
+#define BENCHMARK_OPEN_FILES 16
+#define BENCHMARK_OPEN_MARKERS 1000
+static void benchmark_open(void) {
+  const uint32_t channels=16;
+  char filenames[BENCHMARK_OPEN_FILES][1024];
+  float32_t*data=(float32_t*)calloc(channels*BENCHMARK_IO_BLOCKSIZE, sizeof(float32_t));
+  ambix_info_t info;
+  ambix_t*ambix=NULL;
+  unsigned int i, m;
+  int readmarkers;
+  if(!data) {
+    printf("out of memory\n");
+    return;
+  }
+  for(i=0; i<BENCHMARK_OPEN_FILES; i++) {
+    snprintf(filenames[i], sizeof(filenames[i]), "%s.%d.caf", tmpfilename(), i);
+    memset(&info, 0, sizeof(info));
+    info.fileformat=AMBIX_BASIC;
+    info.ambichannels=channels;
+    info.samplerate=48000;
+    info.sampleformat=AMBIX_SAMPLEFORMAT_FLOAT32;
+    ambix=ambix_open(filenames[i], AMBIX_WRITE, &info);
+    if(!ambix) {
+      printf("open\tcannot create '%s'\n", filenames[i]);
+      goto done;
+    }
+    for(m=0; m<BENCHMARK_OPEN_MARKERS; m++) {
+      ambix_marker_t marker;
+      ambix_region_t region;
+      memset(&marker, 0, sizeof(marker));
+      memset(&region, 0, sizeof(region));
+      marker.position=m*10.;
+      snprintf(marker.name, sizeof(marker.name), "marker #%d in file #%d", m, i);
+      ambix_add_marker(ambix, &marker);
+      region.start_position=m*10.;
+      region.end_position=m*10.+5.;
+      snprintf(region.name, sizeof(region.name), "region #%d in file #%d", m, i);
+      ambix_add_region(ambix, &region);
+    }
+    ambix_writef_float32(ambix, data, NULL, BENCHMARK_IO_BLOCKSIZE);
+    ambix_close(ambix);
+  }
+
+  for(readmarkers=0; readmarkers<2; readmarkers++) {
+    const int reps=8;
+    double start, duration;
+    uint32_t markers=0;
+    int r;
+    start=now();
+    for(r=0; r<reps; r++) {
+      for(i=0; i<BENCHMARK_OPEN_FILES; i++) {
+        memset(&info, 0, sizeof(info));
+        ambix=ambix_open(filenames[i], AMBIX_READ, &info);
+        if(!ambix) {
+          printf("open\tcannot open '%s'\n", filenames[i]);
+          goto done;
+        }
+        if(readmarkers)
+          markers+=ambix_get_num_markers(ambix)+ambix_get_num_regions(ambix);
+        ambix_close(ambix);
+      }
+    }
+    duration=now()-start;
+    printf("open\t%d files with %d markers+regions, %-13s: %8.2f us per file [%d]\n",
+           BENCHMARK_OPEN_FILES, BENCHMARK_OPEN_MARKERS, readmarkers?"markers read":"markers unused",
+           duration/(reps*BENCHMARK_OPEN_FILES)*1e6, (int)markers);
+  }
+ done:
+  for(i=0; i<BENCHMARK_OPEN_FILES; i++)
+    remove(filenames[i]);
+  free(data);
+}
+
+/* scan a directory of (EXTENDED) files, with ambix_probe() vs ambix_open() */
+#define BENCHMARK_PROBE_FILES 256
+static void benchmark_probe(void) {
+  const uint32_t channels=9, fullchannels=16, frames=48000;
+  char (*filenames)[1024]=calloc(BENCHMARK_PROBE_FILES, sizeof(*filenames));
+  float32_t*data=(float32_t*)calloc(fullchannels*BENCHMARK_IO_BLOCKSIZE, sizeof(float32_t));
+  ambix_matrix_t*matrix=random_matrix(fullchannels, channels);
+  ambix_matrix_t*probed=ambix_matrix_init(0, 0, NULL);
+  ambix_info_t info;
+  ambix_t*ambix=NULL;
+  unsigned int i, created=0;
+  int probe;
+  if(!filenames || !data || !matrix || !probed) {
+    printf("out of memory\n");
+    goto done;
+  }
+  for(i=0; i<BENCHMARK_PROBE_FILES; i++) {
+    uint32_t f;
+    snprintf(filenames[i], sizeof(filenames[i]), "%s.%d.caf", tmpfilename(), i);
+    memset(&info, 0, sizeof(info));
+    info.fileformat=AMBIX_EXTENDED;
+    info.ambichannels=channels;
+    info.samplerate=48000;
+    info.sampleformat=AMBIX_SAMPLEFORMAT_PCM24;
+    ambix=ambix_open(filenames[i], AMBIX_WRITE, &info);
+    if(!ambix) {
+      printf("probe\tcannot create '%s'\n", filenames[i]);
+      goto done;
+    }
+    created++;
+    ambix_set_adaptormatrix(ambix, matrix);
+    for(f=0; f<frames; f+=BENCHMARK_IO_BLOCKSIZE)
+      ambix_writef_float32(ambix, data, NULL, BENCHMARK_IO_BLOCKSIZE);
+    ambix_close(ambix);
+  }
+
+  for(probe=0; probe<2; probe++) {
+    const int reps=8;
+    double start, duration;
+    uint64_t total=0;
+    int r;
+    start=now();
+    for(r=0; r<reps; r++) {
+      for(i=0; i<BENCHMARK_PROBE_FILES; i++) {
+        memset(&info, 0, sizeof(info));
+        if(probe) {
+          if(AMBIX_ERR_SUCCESS!=ambix_probe(filenames[i], &info, probed)) {
+            printf("probe\tcannot probe '%s'\n", filenames[i]);
+            goto done;
+          }
+        } else {
+          ambix=ambix_open(filenames[i], AMBIX_READ, &info);
+          if(!ambix) {
+            printf("probe\tcannot open '%s'\n", filenames[i]);
+            goto done;
+          }
+          ambix_matrix_copy(ambix_get_adaptormatrix(ambix), probed);
+          ambix_close(ambix);
+        }
+        total+=info.frames;
+      }
+    }
+    duration=now()-start;
+    printf("probe\t%d files, %-18s: %8.2f us per file [%d]\n",
+           BENCHMARK_PROBE_FILES, probe?"ambix_probe":"ambix_open+close",
+           duration/(reps*BENCHMARK_PROBE_FILES)*1e6, (int)total);
+  }
+ done:
+  for(i=0; i<created; i++)
+    remove(filenames[i]);
+  if(probed)
+    ambix_matrix_destroy(probed);
+  if(matrix)
+    ambix_matrix_destroy(matrix);
+  free(filenames);
+  free(data);
+}
+
+/* reconstruct a 7th order full set from an EXTENDED file with 1..N threads */
+#define BENCHMARK_THREADS_FRAMES (1<<19)
+#define BENCHMARK_THREADS_BLOCKSIZE (1<<16)
+static void benchmark_threads(void) {
+  const char*filename=tmpfilename();
+  const uint32_t fullchannels=64, channels=49;
+  const uint32_t maxthreads=num_cpus();
+  ambix_matrix_t*mtx=random_matrix(fullchannels, channels);
+  float32_t*data=(float32_t*)calloc(fullchannels*BENCHMARK_THREADS_BLOCKSIZE, sizeof(float32_t));
+  ambix_info_t info;
+  ambix_t*ambix=NULL;
+  double singlethreaded=0.;
+  int64_t f;
+  uint32_t threads;
+  if(!mtx || !data) {
+    printf("out of memory\n");
+    goto done;
+  }
+  for(f=0; f<fullchannels*BENCHMARK_THREADS_BLOCKSIZE; f++)
+    data[f]=((float32_t)rand())/((float32_t)RAND_MAX) * 2.f - 1.f;
+
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_BASIC;
+  info.ambichannels=channels;
+  info.samplerate=48000;
+  info.sampleformat=AMBIX_SAMPLEFORMAT_FLOAT32;
+  ambix=ambix_open(filename, AMBIX_WRITE, &info);
+  if(!ambix || AMBIX_ERR_SUCCESS!=ambix_set_adaptormatrix(ambix, mtx)) {
+    printf("threads\tcannot create '%s'\n", filename);
+    goto done;
+  }
+  for(f=0; f<BENCHMARK_THREADS_FRAMES; f+=BENCHMARK_THREADS_BLOCKSIZE)
+    ambix_writef_float32(ambix, data, NULL, BENCHMARK_THREADS_BLOCKSIZE);
+  ambix_close(ambix);
+  ambix=NULL;
+
+  for(threads=1; threads<=maxthreads; threads=(threads<maxthreads && 2*threads>maxthreads)?maxthreads:2*threads) {
+    double start, duration;
+    int64_t frames=0, got;
+    memset(&info, 0, sizeof(info));
+    info.fileformat=AMBIX_BASIC;
+    ambix=ambix_open(filename, AMBIX_READ, &info);
+    if(!ambix) {
+      printf("threads\tcannot open '%s'\n", filename);
+      goto done;
+    }
+    if(AMBIX_ERR_SUCCESS!=ambix_set_threads(ambix, threads)) {
+      printf("threads\t%2d threads not supported\n", threads);
+      goto done;
+    }
+    start=now();
+    while((got=ambix_readf_float32(ambix, data, NULL, BENCHMARK_THREADS_BLOCKSIZE))>0)
+      frames+=got;
+    duration=now()-start;
+    ambix_close(ambix);
+    ambix=NULL;
+    if(1==threads)
+      singlethreaded=duration;
+    printf("threads\t%2dx%-2d %6d frames/block %2d threads: %8.2f Mframes/s  speedup %5.2f\n",
+           fullchannels, channels, BENCHMARK_THREADS_BLOCKSIZE, threads,
+           frames/duration*1e-6, singlethreaded/duration);
+  }
+
+ done:
+  if(ambix)
+    ambix_close(ambix);
+  remove(filename);
+  if(mtx)
+    ambix_matrix_destroy(mtx);
+  free(data);
+}
+
+/* read a 3rd order EXTENDED file into per-channel buffers,
+ * either interleaved (and de-interleaved by the caller) or planar */
+static void benchmark_planar(void) {
+  const char*filename=tmpfilename();
+  const uint32_t fullchannels=16, channels=9;
+  ambix_matrix_t*mtx=random_matrix(fullchannels, channels);
+  float32_t*interleaved=(float32_t*)calloc(fullchannels*BENCHMARK_THREADS_BLOCKSIZE, sizeof(float32_t));
+  float32_t*planar=(float32_t*)calloc(fullchannels*BENCHMARK_THREADS_BLOCKSIZE, sizeof(float32_t));
+  float32_t*planarchannels[16];
+  ambix_info_t info;
+  ambix_t*ambix=NULL;
+  int64_t f;
+  uint32_t c;
+  int mode;
+  if(!mtx || !interleaved || !planar) {
+    printf("out of memory\n");
+    goto done;
+  }
+  for(c=0; c<fullchannels; c++)
+    planarchannels[c]=planar+c*BENCHMARK_THREADS_BLOCKSIZE;
+  for(f=0; f<fullchannels*BENCHMARK_THREADS_BLOCKSIZE; f++)
+    interleaved[f]=((float32_t)rand())/((float32_t)RAND_MAX) * 2.f - 1.f;
+
+  memset(&info, 0, sizeof(info));
+  info.fileformat=AMBIX_BASIC;
+  info.ambichannels=channels;
+  info.samplerate=48000;
+  info.sampleformat=AMBIX_SAMPLEFORMAT_FLOAT32;
+  ambix=ambix_open(filename, AMBIX_WRITE, &info);
+  if(!ambix || AMBIX_ERR_SUCCESS!=ambix_set_adaptormatrix(ambix, mtx)) {
+    printf("planar\tcannot create '%s'\n", filename);
+    goto done;
+  }
+  for(f=0; f<BENCHMARK_THREADS_FRAMES; f+=BENCHMARK_THREADS_BLOCKSIZE)
+    ambix_writef_float32(ambix, interleaved, NULL, BENCHMARK_THREADS_BLOCKSIZE);
+  ambix_close(ambix);
+  ambix=NULL;
+
+  for(mode=0; mode<2; mode++) {
+    const int64_t blocksize=1024;
+    double start, duration;
+    int64_t frames=0, got;
+    memset(&info, 0, sizeof(info));
+    info.fileformat=AMBIX_BASIC;
+    ambix=ambix_open(filename, AMBIX_READ, &info);
+    if(!ambix) {
+      printf("planar\tcannot open '%s'\n", filename);
+      goto done;
+    }
+    start=now();
+    do {
+      if(mode) {
+        got=ambix_readf_float32_planar(ambix, planarchannels, NULL, blocksize);
+      } else {
+        got=ambix_readf_float32(ambix, interleaved, NULL, blocksize);
+        for(f=0; f<got; f++)
+          for(c=0; c<fullchannels; c++)
+            planarchannels[c][f]=interleaved[f*fullchannels+c];
+      }
+      frames+=got;
+    } while(got>0);
+    duration=now()-start;
+    ambix_close(ambix);
+    ambix=NULL;
+    printf("planar\t%2dx%-2d %6d frames/block %-11s: %8.2f Mframes/s\n",
+           fullchannels, channels, (int)blocksize, mode?"planar":"interleaved",
+           frames/duration*1e-6);
+  }
+
+ done:
+  if(ambix)
+    ambix_close(ambix);
+  remove(filename);
+  if(mtx)
+    ambix_matrix_destroy(mtx);
+  free(interleaved);
+  free(planar);
+}
+
+typedef struct {
+  const char*name;
+  void (*fun)(void);
+} benchmark_t;
+
+static const benchmark_t benchmarks[] = {
+  {"matrix", benchmark_matrix},
+  {"precision", benchmark_precision},
+  {"multiply", benchmark_multiply},
+  {"pinv", benchmark_pinv},
+  {"threads", benchmark_threads},
+  {"planar", benchmark_planar},
+  {"io", benchmark_io},
+  {"mmap", benchmark_mmap},
+  {"prefetch", benchmark_prefetch},
+  {"writebehind", benchmark_writebehind},
+  {"open", benchmark_open},
+  {"probe", benchmark_probe},
+};
+
+static int run_benchmark(const char*name) {
+  unsigned int i;
+  for(i=0; i<sizeof(benchmarks)/sizeof(*benchmarks); i++) {
+    if(!strcmp(name, benchmarks[i].name)) {
+      benchmarks[i].fun();
+      return 1;
+    }
+  }
+  printf("unknown benchmark '%s'\n", name);
+  return 0;
+}
+
+int main(int argc, char**argv) {
+  int i;
+  if(argc>1) {
+    if((!strcmp(argv[1], "-V")) || (!strcmp(argv[1], "--version")))
+      print_version(argv[0]);
+    if((!strcmp(argv[1], "-h")) || (!strcmp(argv[1], "--help")))
+      print_usage(argv[0]);
+  }
+
+  if(argc<2) {
+    unsigned int b;
+    for(b=0; b<sizeof(benchmarks)/sizeof(*benchmarks); b++)
+      benchmarks[b].fun();
+    return 0;
+  }
+  for(i=1; i<argc; i++) {
+    if(!run_benchmark(argv[i]))
+      return 1;
+  }
+  return 0;
+}
+
+void print_usage(const char*name) {
+  unsigned int b;
+  printf("\n");
+  printf("Usage: %s [benchmark...]\n", name);
+  printf("Measure the performance of libambix\n");
+  printf("(if no benchmark is given, all benchmarks are run)\n");
+
+  printf("\n");
+  printf("Options:\n");
+  printf("  -h, --help                       Print this help\n");
+  printf("  -V, --version                    Version information\n");
+  printf("\n");
+  printf("Benchmarks:\n");
+  for(b=0; b<sizeof(benchmarks)/sizeof(*benchmarks); b++)
+    printf("  %s\n", benchmarks[b].name);
+  printf("\n");
+
+#ifdef PACKAGE_BUGREPORT
+  printf("Report bugs to: %s\n\n", PACKAGE_BUGREPORT);
+#endif
+#ifdef PACKAGE_URL
+  printf("Home page: %s\n", PACKAGE_URL);
+#endif
+
+  exit(1);
+}
+void print_version(const char*name) {
+#ifdef PACKAGE_VERSION
+  printf("%s %s\n", name, PACKAGE_VERSION);
+#endif
+  printf("\n");
+  printf("Copyright (C) 2026 Institute of Electronic Music and Acoustics (IEM), University of Music and Dramatic Arts (KUG), Graz, Austria.\n");
+  printf("\n");
+  printf("License LGPLv2.1: GNU Lesser GPL version 2.1 or later <http://gnu.org/licenses/lgpl.html>\n");
+  printf("This is free software: you are free to change and redistribute it.\n");
+  printf("There is NO WARRANTY, to the extent permitted by law.\n");
+  printf("\n");
+  printf("Written by IOhannes m zmoelnig <zmoelnig@iem.at>\n");
+  exit(1);
+}
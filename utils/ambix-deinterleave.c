@@ -66,8 +66,6 @@ typedef struct ai_t {
   SF_INFO *outinfo;
   uint32_t numOuts;
 
-  ambix_matrix_t matrix;
-
   uint32_t blocksize;
   int format;
 #define DEFAULT_BLOCKSIZE 1024
@@ -239,18 +237,16 @@ static ai_t*ai_close(ai_t*ai) {
     free(ai->infilename);
   ai->infilename=NULL;
 
-  ambix_matrix_deinit (&ai->matrix);
-
   free(ai);
 
   return NULL;
 }
 
 static ai_t*ai_open_input(ai_t*ai) {
-  const ambix_matrix_t*matrix=NULL;
   if(!ai)return ai;
   if(!ai->inhandle) {
-    ai->info.fileformat=AMBIX_EXTENDED;
+    /* let the library reconstruct the full set */
+    ai->info.fileformat=AMBIX_BASIC;
 
     ai->inhandle=ambix_open(ai->infilename, AMBIX_READ, &ai->info);
   }
@@ -262,16 +258,6 @@ static ai_t*ai_open_input(ai_t*ai) {
     return ai_close(ai);
   }
 
-  if(ai->info.ambichannels>0) {
-    matrix=ambix_get_adaptormatrix(ai->inhandle);
-    if(!matrix) {
-      return ai_close(ai);
-    }
-    ambix_matrix_copy(matrix, &ai->matrix);
-  } else {
-    ambix_matrix_deinit(&ai->matrix);
-  }
-
   return ai;
 }
 
@@ -281,7 +267,7 @@ static ai_t*ai_open_output(ai_t*ai) {
   int32_t chan, channel, ambichannels, extrachannels;
   if(!ai)return ai;
 
-  ambichannels=ai->matrix.rows;
+  ambichannels=ai->info.ambichannels;
   extrachannels=ai->info.extrachannels;
 
   if(!ai->outhandles) {
@@ -356,154 +342,79 @@ static ai_t*ai_open_output(ai_t*ai) {
 }
 
 
-static void
-deinterleaver(float*dest, const float*source, uint64_t frames, uint32_t channels) {
-  uint64_t frame;
-  for(frame=0; frame<frames; frame++) {
-    uint64_t channel;
-    for(channel=0; channel<channels; channel++) {
-      dest[channel*frames+frame] = *source++;
-    }
-  }
-}
-
 static ai_t*ai_copy_block(ai_t*ai,
-                          float*rawdata,
-                          float*cookeddata,
-                          float*extradata,
-                          float*deinterleavebuffer,
+                          float32_t**channels,
                           uint64_t frames) {
-  uint32_t ambichannels, fullambichannels, extrachannels;
-  uint64_t channel, c;
+  uint32_t ambichannels;
+  uint32_t channel;
   sf_count_t framed;
 
-  const ambix_matrix_t*matrix;
-  uint32_t rows, cols;
-
-  //printf("rawdata=%p\tcookeddata=%p\textradata=%p\n", rawdata, cookeddata, extradata);
-
   if(!ai)return ai;
-  matrix=&ai->matrix;
-  rows=matrix->rows;
-  cols=matrix->cols;
-
   ambichannels=ai->info.ambichannels;
-  extrachannels=ai->info.extrachannels;
-  fullambichannels=rows;
-  if(cols!=ambichannels) {
-    printf("columns do not match ambichannels %d!=%d\n", cols, ambichannels);
-  }
 
-  /* read the raw data */
-  framed=ambix_readf_float32(ai->inhandle,
-                             rawdata,
-                             extradata,
-                             frames);
+  /* read the data directly into the per-channel buffers */
+  framed=ambix_readf_float32_planar(ai->inhandle,
+                                    channels,
+                                    channels+ambichannels,
+                                    frames);
 
   if(frames!=framed) {
     printf("failed reading %d frames (got %d)\n", (int)frames, (int)framed);
     return ai_close(ai);
   }
 
-  /* decode the ambisonics data */
-  //  printf("reading ambidata %p & %p\n", rawdata, cookeddata);
-  channel=0;
-
-  if(rawdata && cookeddata) {
-
-    if(AMBIX_ERR_SUCCESS!=ambix_matrix_multiply_float32(cookeddata, matrix, rawdata, frames)) {
-      printf("failed decoding\n");
+  /* store the ambisonics and extra data */
+  for(channel=0; channel<ai->numOuts; channel++) {
+    framed=sf_writef_float(ai->outhandles[channel], channels[channel], frames);
+    if(frames!=framed) {
+      printf("failed writing %d %sframes to %d (got %d)\n", (int)frames,
+             (channel<ambichannels)?"ambi":"extra",
+             (int)channel, (int)framed);
       return ai_close(ai);
     }
-
-    /* deinterleave the buffer */
-    deinterleaver(deinterleavebuffer, cookeddata, frames, fullambichannels);
-
-    /* store the ambisonics data */
-    for(c=0; c<fullambichannels; c++) {
-      framed=sf_writef_float(ai->outhandles[channel], deinterleavebuffer+c*frames, frames);
-      if(frames!=framed) {
-        printf("failed writing %d ambiframes to %d (got %d)\n", (int)frames, (int)channel, (int)framed);
-        return ai_close(ai);
-      }
-      channel++;
-    }
   }
-  /* store the extra data */
-  //  printf("reading extradata %p\n", extradata);
-  if(extradata) {
-    deinterleaver(deinterleavebuffer, extradata, frames, extrachannels);
-    for(c=0; c<extrachannels; c++) {
-      framed=sf_writef_float(ai->outhandles[channel], deinterleavebuffer+c*frames, frames);
-      if(frames!=framed) {
-        printf("failed writing %d extraframes to %d (got %d)\n", (int)frames, (int)channel, (int)framed);
-        return ai_close(ai);
-      }
-      channel++;
-    }
-  }
-  //printf("reading done\n");
   return ai;
 }
 
 static ai_t*ai_copy(ai_t*ai) {
   uint64_t blocksize=0, blocks=0;
   uint64_t frames=0;
-  float32_t*rawdata=NULL, *cookeddata=NULL, *extradata=NULL,*deinterleavebuf=NULL;
-  uint64_t size=0;
+  float32_t*data=NULL, **channels=NULL;
+  uint32_t channel;
   if(!ai)return ai;
   blocksize=ai->blocksize;
   if(blocksize<1)
     blocksize=DEFAULT_BLOCKSIZE;
   frames=ai->info.frames;
 
-  if(ai->info.ambichannels) {
-    const ambix_matrix_t*matrix=&ai->matrix;
-    if(!matrix) {
-      printf("no adaptor matrix found...\n");
-      return ai_close(ai);
-    }
-    size=(ai->info.ambichannels)*blocksize;
-    rawdata=(float32_t*)malloc(sizeof(float32_t)*size);
-    cookeddata=(float32_t*)malloc(sizeof(float32_t)*(matrix->rows)*blocksize);
-    if((matrix->rows)*blocksize > size)
-      size=(matrix->rows)*blocksize;
-
-  }
-  if(ai->info.extrachannels) {
-    extradata=(float32_t*)malloc(sizeof(float32_t)*(ai->info.extrachannels)*blocksize);
-    if((ai->info.extrachannels)*blocksize > size)
-      size=(ai->info.extrachannels)*blocksize;
-  }
-  deinterleavebuf=(float32_t*)malloc(sizeof(float32_t)*size);
-  if(NULL==deinterleavebuf) {
+  data=(float32_t*)malloc(sizeof(float32_t)*ai->numOuts*blocksize);
+  channels=(float32_t**)malloc(sizeof(float32_t*)*ai->numOuts);
+  if(NULL==data || NULL==channels) {
     ai=ai_close(ai);
     goto done;
   }
+  for(channel=0; channel<ai->numOuts; channel++)
+    channels[channel]=data+channel*blocksize;
 
   while(frames>blocksize) {
     blocks++;
-    ai = ai_copy_block(ai, rawdata, cookeddata, extradata, deinterleavebuf, blocksize);
+    ai = ai_copy_block(ai, channels, blocksize);
     if(!ai) {
       goto done;
     }
     frames-=blocksize;
   }
 
-  ai = ai_copy_block(ai, rawdata, cookeddata, extradata, deinterleavebuf, frames);
+  ai = ai_copy_block(ai, channels, frames);
 
  done:
-  free(rawdata);
-  free(cookeddata);
-  free(extradata);
-  free(deinterleavebuf);
+  free(data);
+  free(channels);
 
   //  printf("reading really done %p\n", ai);
   return ai;
 }
 
-
-
 static int ambix_deinterleave(ai_t*ai) {
   ai_t*result=ai_open_input(ai);
   //  if(result)printf("success @ %d!\n", __LINE__);
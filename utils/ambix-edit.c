@@ -0,0 +1,423 @@
+/* ambix_edit -  modify the metadata of an ambix file in place              -*- c -*-
+
+   Copyright © 2026 IOhannes m zmölnig <zmoelnig@iem.at>.
+         Institute of Electronic Music and Acoustics (IEM),
+         University of Music and Dramatic Arts, Graz
+
+   This file is part of libambix
+
+   libambix is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of
+   the License, or (at your option) any later version.
+
+   libambix is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+ * ambix_edit [-M] [-R] [-m <pos>:<name>] [-r <start>:<end>:<name>] [-X <matrixfile>] [-l] <file>
+ *
+ * changes the markers, regions and the adaptor matrix of an ambix file,
+ * without rewriting the sample data.
+ * markers and regions are deleted first, then the new ones are added.
+ * 'matrixfile' is either an ambix file (whose adaptor matrix is used), or a
+ * text file (as written by octave) with one row of the matrix per line.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include "ambix/ambix.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define MAX_EDITS 256
+
+typedef struct ae_t {
+  char*filename;
+  int list;
+  int delete_markers;
+  int delete_regions;
+  ambix_marker_t*markers;
+  uint32_t num_markers;
+  ambix_region_t*regions;
+  uint32_t num_regions;
+  ambix_matrix_t*matrix;
+} ae_t;
+
+static void print_usage(const char*path);
+static void print_version(const char*path);
+static int ae_exit = 0;
+
+/* get the adaptor matrix of an ambix file */
+static ambix_matrix_t*ae_matrix_ambix(const char*path) {
+  ambix_info_t info;
+  ambix_t*ambix=NULL;
+  ambix_matrix_t*matrix=NULL;
+  const ambix_matrix_t*mtx;
+  memset(&info, 0, sizeof(info));
+  ambix=ambix_open(path, AMBIX_READ, &info);
+  if(!ambix)
+    return NULL;
+  mtx=ambix_get_adaptormatrix(ambix);
+  if(mtx)
+    matrix=ambix_matrix_copy(mtx, NULL);
+  ambix_close(ambix);
+  return matrix;
+}
+/* read a matrix from a text file: one row per line, '#' starts a comment */
+static ambix_matrix_t*ae_matrix_text(const char*path) {
+  char line[65536];
+  float32_t*data=NULL;
+  uint32_t rows=0, cols=0, count=0;
+  ambix_matrix_t*matrix=NULL;
+  FILE*file=fopen(path, "r");
+  if(!file)
+    return NULL;
+  while(fgets(line, sizeof(line), file)) {
+    char*s=line, *end=NULL;
+    uint32_t c=0;
+    if('#' == *line)
+      continue;
+    for(;;) {
+      float32_t*tmp;
+      const double v=strtod(s, &end);
+      if(end == s)
+        break;
+      s=end;
+      tmp=(float32_t*)realloc(data, (count+1)*sizeof(*data));
+      if(!tmp)
+        goto cleanup;
+      data=tmp;
+      data[count++]=(float32_t)v;
+      c++;
+    }
+    if(!c)
+      continue;
+    if(cols && c!=cols) {
+      fprintf(stderr, "ambix_edit: row %d of matrix '%s' has %d columns (expected %d)\n", rows, path, c, cols);
+      goto cleanup;
+    }
+    cols=c;
+    rows++;
+  }
+  if(rows && cols) {
+    matrix=ambix_matrix_init(rows, cols, NULL);
+    if(matrix && AMBIX_ERR_SUCCESS != ambix_matrix_fill_data(matrix, data)) {
+      ambix_matrix_destroy(matrix);
+      matrix=NULL;
+    }
+  }
+ cleanup:
+  fclose(file);
+  free(data);
+  return matrix;
+}
+
+/* '<pos>:<name>' resp. '<start>:<end>:<name>' */
+static const char*ae_parse_position(const char*s, float64_t*position) {
+  char*end=NULL;
+  *position=strtod(s, &end);
+  if(end == s || (*end && ':' != *end))
+    return NULL;
+  return (*end)?end+1:end;
+}
+static int ae_add_marker(ae_t*ae, const char*spec) {
+  ambix_marker_t*marker;
+  const char*name;
+  if(ae->num_markers >= MAX_EDITS)
+    return 0;
+  marker=ae->markers+ae->num_markers;
+  memset(marker, 0, sizeof(*marker));
+  name=ae_parse_position(spec, &marker->position);
+  if(!name)
+    return 0;
+  strncpy(marker->name, name, sizeof(marker->name)-1);
+  ae->num_markers++;
+  return 1;
+}
+static int ae_add_region(ae_t*ae, const char*spec) {
+  ambix_region_t*region;
+  const char*name;
+  if(ae->num_regions >= MAX_EDITS)
+    return 0;
+  region=ae->regions+ae->num_regions;
+  memset(region, 0, sizeof(*region));
+  name=ae_parse_position(spec, &region->start_position);
+  if(name)
+    name=ae_parse_position(name, &region->end_position);
+  if(!name)
+    return 0;
+  strncpy(region->name, name, sizeof(region->name)-1);
+  ae->num_regions++;
+  return 1;
+}
+
+static void ae_list(ambix_t*ambix) {
+  const ambix_matrix_t*matrix=ambix_get_adaptormatrix(ambix);
+  uint32_t i, num;
+  printf("Adaptor matrix\t: ");
+  if(!matrix) {
+    printf("**none**\n");
+  } else {
+    uint32_t r, c;
+    printf("[%dx%d]\n", matrix->rows, matrix->cols);
+    for(r=0; r<matrix->rows; r++) {
+      printf("\t");
+      for(c=0; c<matrix->cols; c++)
+        printf("%.6f ", matrix->data[r][c]);
+      printf("\n");
+    }
+  }
+  num=ambix_get_num_markers(ambix);
+  printf("Number of Markers\t: %d\n", num);
+  for(i=0; i<num; i++) {
+    const ambix_marker_t*marker=ambix_get_marker(ambix, i);
+    if(marker)
+      printf("  Marker %d: name: %s position: %f\n", i, marker->name, marker->position);
+  }
+  num=ambix_get_num_regions(ambix);
+  printf("Number of Regions\t: %d\n", num);
+  for(i=0; i<num; i++) {
+    const ambix_region_t*region=ambix_get_region(ambix, i);
+    if(region)
+      printf("  Region %d: name: %s start_position: %f end_position: %f\n", i, region->name, region->start_position, region->end_position);
+  }
+}
+
+static int ae_modifies(const ae_t*ae) {
+  return ae->delete_markers || ae->delete_regions || ae->num_markers || ae->num_regions || ae->matrix;
+}
+
+static int ae_process(ae_t*ae) {
+  ambix_info_t info;
+  ambix_t*ambix=NULL;
+  ambix_err_t err;
+  uint32_t i;
+  int result=1;
+
+  memset(&info, 0, sizeof(info));
+  /* only open the file for writing if we are going to change it */
+  ambix=ambix_open(ae->filename, ae_modifies(ae)?AMBIX_RDRW:AMBIX_READ, &info);
+  if(!ambix) {
+    fprintf(stderr, "ambix_edit: couldn't open '%s'\n", ae->filename);
+    ae_exit=66;
+    return 0;
+  }
+
+  /* deleting non-existing markers is fine */
+  if(ae->delete_markers)
+    ambix_delete_markers(ambix);
+  if(ae->delete_regions)
+    ambix_delete_regions(ambix);
+  for(i=0; i<ae->num_markers; i++) {
+    if(AMBIX_ERR_SUCCESS != ambix_add_marker(ambix, ae->markers+i)) {
+      fprintf(stderr, "ambix_edit: couldn't add marker '%s'\n", ae->markers[i].name);
+      result=0;
+    }
+  }
+  for(i=0; i<ae->num_regions; i++) {
+    if(AMBIX_ERR_SUCCESS != ambix_add_region(ambix, ae->regions+i)) {
+      fprintf(stderr, "ambix_edit: couldn't add region '%s'\n", ae->regions[i].name);
+      result=0;
+    }
+  }
+  if(ae->matrix) {
+    err=ambix_set_adaptormatrix(ambix, ae->matrix);
+    if(AMBIX_ERR_SUCCESS != err) {
+      fprintf(stderr, "ambix_edit: couldn't set [%dx%d] adaptor matrix for %d ambisonics channels (error %d)\n",
+              ae->matrix->rows, ae->matrix->cols, info.ambichannels, err);
+      result=0;
+    }
+  }
+  if(ae->list)
+    ae_list(ambix);
+
+  if(AMBIX_ERR_SUCCESS != ambix_close(ambix)) {
+    fprintf(stderr, "ambix_edit: couldn't write '%s'\n", ae->filename);
+    result=0;
+  }
+  if(!result)
+    ae_exit=74;
+  return result;
+}
+
+static void ae_cleanup(ae_t*ae) {
+  free(ae->markers);
+  free(ae->regions);
+  if(ae->matrix)
+    ambix_matrix_destroy(ae->matrix);
+}
+
+static int ae_init(ae_t*ae, int argc, char**argv) {
+  const char*name=argv[0];
+  memset(ae, 0, sizeof(*ae));
+  ae->markers=(ambix_marker_t*)calloc(MAX_EDITS, sizeof(*ae->markers));
+  ae->regions=(ambix_region_t*)calloc(MAX_EDITS, sizeof(*ae->regions));
+  if(!ae->markers || !ae->regions) {
+    ae_exit=71;
+    return 0;
+  }
+
+  argv++;
+  argc--;
+  while(argc>0) {
+    if(!strcmp(argv[0], "-h") || !strcmp(argv[0], "--help")) {
+      print_usage(name);
+    }
+    if(!strcmp(argv[0], "-V") || !strcmp(argv[0], "--version")) {
+      print_version(name);
+    }
+    if(!strcmp(argv[0], "-l") || !strcmp(argv[0], "--list")) {
+      ae->list=1;
+      argv++;
+      argc--;
+      continue;
+    }
+    if(!strcmp(argv[0], "-M") || !strcmp(argv[0], "--delete-markers")) {
+      ae->delete_markers=1;
+      argv++;
+      argc--;
+      continue;
+    }
+    if(!strcmp(argv[0], "-R") || !strcmp(argv[0], "--delete-regions")) {
+      ae->delete_regions=1;
+      argv++;
+      argc--;
+      continue;
+    }
+    if(!strcmp(argv[0], "-m") || !strcmp(argv[0], "--marker")) {
+      if(argc>1) {
+        if(!ae_add_marker(ae, argv[1])) {
+          fprintf(stderr, "invalid marker '%s' (expected '<position>:<name>')\n", argv[1]);
+          ae_exit=64;
+          return 0;
+        }
+        argv+=2;
+        argc-=2;
+        continue;
+      }
+      fprintf(stderr, "no marker specified\n");
+      ae_exit=64;
+      return 0;
+    }
+    if(!strcmp(argv[0], "-r") || !strcmp(argv[0], "--region")) {
+      if(argc>1) {
+        if(!ae_add_region(ae, argv[1])) {
+          fprintf(stderr, "invalid region '%s' (expected '<start>:<end>:<name>')\n", argv[1]);
+          ae_exit=64;
+          return 0;
+        }
+        argv+=2;
+        argc-=2;
+        continue;
+      }
+      fprintf(stderr, "no region specified\n");
+      ae_exit=64;
+      return 0;
+    }
+    if(!strcmp(argv[0], "-X") || !strcmp(argv[0], "--matrix")) {
+      if(argc>1) {
+        if(ae->matrix)
+          ambix_matrix_destroy(ae->matrix);
+        ae->matrix=ae_matrix_ambix(argv[1]);
+        if(!ae->matrix)
+          ae->matrix=ae_matrix_text(argv[1]);
+        if(!ae->matrix) {
+          fprintf(stderr, "Couldn't read matrix '%s'\n", argv[1]);
+          ae_exit=66;
+          return 0;
+        }
+        argv+=2;
+        argc-=2;
+        continue;
+      }
+      fprintf(stderr, "no matrix file specified\n");
+      ae_exit=64;
+      return 0;
+    }
+    ae->filename=argv[0];
+    argv++;
+    argc--;
+    if(argc>0) {
+      fprintf(stderr, "only a single file can be edited\n");
+      ae_exit=64;
+      return 0;
+    }
+  }
+
+  if(!ae->filename) {
+    fprintf(stderr, "no file specified\n");
+    ae_exit=66;
+    return 0;
+  }
+  if(!ae_modifies(ae))
+    ae->list=1;
+  return 1;
+}
+
+int main(int argc, char**argv) {
+  ae_t ae;
+  if(argc<2)
+    print_usage(argv[0]);
+  if(ae_init(&ae, argc, argv))
+    ae_process(&ae);
+  ae_cleanup(&ae);
+  return ae_exit;
+}
+
+void print_usage(const char*name) {
+  printf("\n");
+  printf("Usage: %s [options] file\n", name);
+  printf("Modify the markers, regions and adaptor matrix of an ambix file (without rewriting the audio data)\n");
+
+  printf("\n");
+  printf("Options:\n");
+  printf("  -h, --help                       Print this help\n");
+  printf("  -V, --version                    Version information\n");
+  printf("  -l, --list                       List markers, regions and the adaptor matrix (after applying the changes)\n");
+  printf("  -M, --delete-markers             Delete all markers (before adding new ones)\n");
+  printf("  -R, --delete-regions             Delete all regions (before adding new ones)\n");
+  printf("  -m, --marker <pos>:<name>        Add a marker at frame <pos>\n");
+  printf("  -r, --region <start>:<end>:<name>\n");
+  printf("                                   Add a region from frame <start> to <end>\n");
+  printf("  -X, --matrix <matrixfile>        Replace the adaptor matrix with the one found in\n");
+  printf("                                   <matrixfile> (an ambix file, or a text file with one row per line)\n");
+  printf("\n");
+  printf("Without any modifying options, '--list' is implied.\n");
+  printf("The number of columns of the adaptor matrix must match the number of ambisonics channels in the file.\n");
+  printf("\n");
+
+#ifdef PACKAGE_BUGREPORT
+  printf("Report bugs to: %s\n\n", PACKAGE_BUGREPORT);
+#endif
+#ifdef PACKAGE_URL
+  printf("Home page: %s\n", PACKAGE_URL);
+#endif
+
+  exit(1);
+}
+void print_version(const char*name) {
+#ifdef PACKAGE_VERSION
+  printf("%s %s\n", name, PACKAGE_VERSION);
+#endif
+  printf("\n");
+  printf("Copyright (C) 2026 Institute of Electronic Music and Acoustics (IEM), University of Music and Dramatic Arts (KUG), Graz, Austria.\n");
+  printf("\n");
+  printf("License LGPLv2.1: GNU Lesser GPL version 2.1 or later <http://gnu.org/licenses/lgpl.html>\n");
+  printf("This is free software: you are free to change and redistribute it.\n");
+  printf("There is NO WARRANTY, to the extent permitted by law.\n");
+  printf("\n");
+  printf("Written by IOhannes m zmoelnig <zmoelnig@iem.at>\n");
+  exit(1);
+}